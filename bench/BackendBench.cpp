@@ -0,0 +1,139 @@
+#include "Bench.h"
+
+#include <random>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#include "storage.h"
+#include "crypto.h"
+
+namespace {
+    std::vector<CryptoKernelBench::Result> measureBackend(const std::string& backend,
+                                                          const std::vector<std::string>& ids) {
+        const unsigned int readers = 4;
+        const size_t commitSize = 1000;
+
+        const std::string path = CryptoKernelBench::tempPath("backend-db");
+        CryptoKernel::Storage::destroy(path);
+
+        CryptoKernel::Storage::Profile profile = CryptoKernel::Storage::Profile::chainstate();
+        profile.backend = backend;
+        profile.readCacheSize = 0;
+        profile.mapSize = uint64_t(1024) * 1024 * 1024;
+        profile.optimistic = false;
+        profile.groupCommit = false;
+
+        Json::Value output;
+        output["value"] = Json::UInt64(100000000);
+        output["nonce"] = Json::UInt64(7919);
+        output["data"]["publicKey"] = CryptoKernel::Crypto(true).getPublicKey();
+
+        CryptoKernel::Storage::Table table("utxos", 3);
+
+        uint64_t writeTime;
+        uint64_t writeAllocated;
+        {
+            CryptoKernel::Storage db(path, profile,
+                                     std::make_shared<CryptoKernel::Storage::BinaryCodec>());
+
+            CryptoKernelBench::Timer timer;
+            for(size_t i = 0; i < ids.size(); i += commitSize) {
+                std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(db.begin());
+                for(size_t j = i; j < std::min(i + commitSize, ids.size()); j++) {
+                    table.put(dbTx.get(), ids[j], output);
+                }
+                dbTx->commit();
+            }
+            writeTime = timer.elapsed();
+            writeAllocated = timer.allocated();
+        }
+        const uint64_t diskBytes = CryptoKernelBench::directorySize(path);
+
+        uint64_t readTime;
+        uint64_t readAllocated;
+        uint64_t scanTime;
+        uint64_t scanAllocated;
+        {
+            // Reopened so reads go to the files rather than freshly written memory
+            CryptoKernel::Storage db(path, profile,
+                                     std::make_shared<CryptoKernel::Storage::BinaryCodec>());
+
+            std::atomic<uint64_t> missing(0);
+
+            CryptoKernelBench::Timer timer;
+            std::vector<std::thread> threads;
+            for(unsigned int t = 0; t < readers; t++) {
+                threads.push_back(std::thread([&, t]{
+                    std::vector<std::string> lookups(ids);
+                    std::shuffle(lookups.begin(), lookups.end(), std::mt19937(t));
+
+                    std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(db.beginReadOnly());
+                    for(const auto& id : lookups) {
+                        if(table.get(dbTx.get(), id).isNull()) {
+                            missing++;
+                        }
+                    }
+                }));
+            }
+
+            for(auto& thread : threads) {
+                thread.join();
+            }
+            readTime = timer.elapsed();
+            readAllocated = timer.allocated();
+            if(missing > 0) {
+                throw std::runtime_error("Missing benchmark keys");
+            }
+
+            timer.reset();
+            uint64_t scanned = 0;
+            CryptoKernel::Storage::Table::Iterator it(&table, &db);
+            for(it.SeekToFirst(); it.Valid(); it.Next()) {
+                scanned += it.value().size();
+            }
+            scanTime = timer.elapsed();
+            scanAllocated = timer.allocated();
+            if(scanned == 0) {
+                throw std::runtime_error("Missing benchmark keys");
+            }
+        }
+        CryptoKernel::Storage::destroy(path);
+
+        CryptoKernelBench::Result write;
+        write.name = "backend/" + backend + "/write";
+        write.ops = ids.size();
+        write.nanoseconds = writeTime;
+        write.bytesAllocated = writeAllocated;
+        write.counters["diskBytes"] = diskBytes;
+
+        CryptoKernelBench::Result read;
+        read.name = "backend/" + backend + "/read/" + std::to_string(readers);
+        read.ops = ids.size() * readers;
+        read.nanoseconds = readTime;
+        read.bytesAllocated = readAllocated;
+
+        CryptoKernelBench::Result scan;
+        scan.name = "backend/" + backend + "/scan";
+        scan.ops = ids.size();
+        scan.nanoseconds = scanTime;
+        scan.bytesAllocated = scanAllocated;
+
+        return {write, read, scan};
+    }
+}
+
+CK_BENCHMARK(backendBench) {
+    std::vector<std::string> ids;
+    for(unsigned int i = 0; i < 100000; i++) {
+        ids.push_back(CryptoKernel::Crypto::sha256("out" + std::to_string(i)));
+    }
+
+    std::vector<CryptoKernelBench::Result> results;
+    for(const std::string backend : {"leveldb", "lmdb"}) {
+        const auto measured = measureBackend(backend, ids);
+        results.insert(results.end(), measured.begin(), measured.end());
+    }
+
+    return results;
+}
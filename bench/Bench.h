@@ -0,0 +1,105 @@
+#ifndef BENCH_H_INCLUDED
+#define BENCH_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <functional>
+
+namespace CryptoKernelBench {
+
+/**
+* A single measurement reported by a benchmark
+*/
+struct Result {
+    std::string name;
+    uint64_t ops;
+    uint64_t nanoseconds;
+    // Heap bytes allocated during the timed region, from Timer::allocated
+    uint64_t bytesAllocated;
+    std::map<std::string, double> counters;
+};
+
+typedef std::function<std::vector<Result>()> Benchmark;
+
+/**
+* Adds a benchmark to the set run by the bench runner
+*
+* @param name the name of the benchmark
+* @param benchmark the function to run, returns its measurements
+* @return always 0, used to register benchmarks during static initialisation
+*/
+int registerBenchmark(const std::string& name, const Benchmark& benchmark);
+
+std::vector<std::pair<std::string, Benchmark>>& getBenchmarks();
+
+/**
+* Returns the number of bytes allocated with operator new by every thread
+* since the bench runner started
+*/
+uint64_t allocatedBytes();
+
+/**
+* Returns the number of heap allocations made by every thread since the
+* bench runner started
+*/
+uint64_t allocationCount();
+
+/**
+* Measures the wall time and heap allocations of a region
+*/
+class Timer {
+public:
+    Timer() {
+        reset();
+    }
+
+    void reset() {
+        start = std::chrono::steady_clock::now();
+        startAllocated = allocatedBytes();
+        startAllocations = allocationCount();
+    }
+
+    uint64_t elapsed() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - start).count();
+    }
+
+    uint64_t allocated() const {
+        return allocatedBytes() - startAllocated;
+    }
+
+    uint64_t allocations() const {
+        return allocationCount() - startAllocations;
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+    uint64_t startAllocated;
+    uint64_t startAllocations;
+};
+
+/**
+* Returns the total size in bytes of the files in the given directory, or
+* the size of the file if the path is a file
+*/
+uint64_t directorySize(const std::string& path);
+
+/**
+* Returns a path for a benchmark database inside the runner's temporary
+* directory, which is removed when the runner exits
+*
+* @param name the name of the database
+* @return the path to use for the database
+*/
+std::string tempPath(const std::string& name);
+
+}
+
+#define CK_BENCHMARK(name) \
+    static std::vector<CryptoKernelBench::Result> name(); \
+    static const int name##Registered = CryptoKernelBench::registerBenchmark(#name, name); \
+    static std::vector<CryptoKernelBench::Result> name()
+
+#endif // BENCH_H_INCLUDED
@@ -0,0 +1,91 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <openssl/crypto.h>
+
+#include "Bench.h"
+
+namespace {
+    std::atomic<uint64_t> allocated(0);
+    std::atomic<uint64_t> allocations(0);
+
+    void count(const size_t size) {
+        allocated.fetch_add(size, std::memory_order_relaxed);
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // OpenSSL allocates its BIGNUMs and digest contexts with malloc rather
+    // than operator new, so they are counted through its hooks
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+    void* opensslMalloc(size_t size, const char*, int) {
+        count(size);
+        return std::malloc(size);
+    }
+
+    void* opensslRealloc(void* ptr, size_t size, const char*, int) {
+        count(size);
+        return std::realloc(ptr, size);
+    }
+
+    void opensslFree(void* ptr, const char*, int) {
+        std::free(ptr);
+    }
+#else
+    void* opensslMalloc(size_t size) {
+        count(size);
+        return std::malloc(size);
+    }
+
+    void* opensslRealloc(void* ptr, size_t size) {
+        count(size);
+        return std::realloc(ptr, size);
+    }
+
+    void opensslFree(void* ptr) {
+        std::free(ptr);
+    }
+#endif
+
+    // Has to run before OpenSSL allocates anything, it fails afterwards
+    const int opensslCounted = CRYPTO_set_mem_functions(opensslMalloc, opensslRealloc,
+                                                        opensslFree);
+}
+
+// Counts every heap allocation so benchmarks can report bytes allocated
+void* operator new(size_t size) {
+    count(size);
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if(ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+uint64_t CryptoKernelBench::allocatedBytes() {
+    return allocated.load(std::memory_order_relaxed);
+}
+
+uint64_t CryptoKernelBench::allocationCount() {
+    return allocations.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,121 @@
+#include "Bench.h"
+
+#include "blockchain.h"
+#include "crypto.h"
+
+namespace {
+    const unsigned int blockTransactions = 2000;
+
+    // A block of single input, single output spends like those mined from the mempool
+    CryptoKernel::Blockchain::block sampleBlock() {
+        Json::Value data;
+        data["publicKey"] = "BGOjpbmxzX26d7zHmNxy3RWb94MzTciGhF7y8ehF2EH2BlTDStCrAhSmmfmbaWDuRYqagRViAhVj6QhOsfp4oT4=";
+
+        Json::Value spendData;
+        spendData["signature"] = "MEUCIQDDyHnvL5Wt3y4E7vXHZmFmAaPRHhd3hDlbpK5jV7hRbAIgNj1xAAWZo0I6AUNxnO4yWovMf3aRSVnbdqXdG/7YUqE=";
+
+        std::set<CryptoKernel::Blockchain::transaction> txs;
+        for(unsigned int i = 0; i < blockTransactions; i++) {
+            const CryptoKernel::uint256 outputId(CryptoKernel::Crypto::sha256("out" + std::to_string(i)));
+            txs.insert(CryptoKernel::Blockchain::transaction({CryptoKernel::Blockchain::input(outputId, spendData)},
+                                                             {CryptoKernel::Blockchain::output(50000, i, data)},
+                                                             1530888581));
+        }
+
+        const CryptoKernel::Blockchain::transaction coinbaseTx({},
+            {CryptoKernel::Blockchain::output(100000000, 0, data)}, 1530888581, true);
+
+        return CryptoKernel::Blockchain::block(txs, coinbaseTx, CryptoKernel::uint256(), 1530888581,
+                                               Json::nullValue, 1);
+    }
+
+    CryptoKernelBench::Result result(const std::string& name, const unsigned int ops,
+                                     const CryptoKernelBench::Timer& timer) {
+        CryptoKernelBench::Result returning;
+        returning.name = name;
+        returning.ops = ops;
+        returning.nanoseconds = timer.elapsed();
+        returning.bytesAllocated = timer.allocated();
+        returning.counters["allocationsPerTx"] = double(timer.allocations()) / ops;
+
+        return returning;
+    }
+}
+
+// Passes a 2,000 transaction block around the way the chain, mempool and
+// network do. Each op is one transaction of the block.
+CK_BENCHMARK(blockBench) {
+    std::vector<CryptoKernelBench::Result> results;
+
+    const CryptoKernel::Blockchain::block Block = sampleBlock();
+
+    // Handing the block on, as getBlock and the network queues do
+    const unsigned int copies = 10;
+    CryptoKernelBench::Timer timer;
+    for(unsigned int i = 0; i < copies; i++) {
+        const CryptoKernel::Blockchain::block copy = Block;
+        if(copy.getTransactions().size() != blockTransactions) {
+            throw std::runtime_error("Benchmark block was not copied");
+        }
+    }
+    results.push_back(result("block/copy", copies * blockTransactions, timer));
+
+    // Parsing a block received from a peer, then only its header as the
+    // header checks ahead of the block do
+    const Json::Value blockJson = Block.toJson();
+    const unsigned int parses = 5;
+    timer.reset();
+    for(unsigned int i = 0; i < parses; i++) {
+        const CryptoKernel::Blockchain::block parsed(blockJson);
+        if(parsed.getId() != Block.getId()) {
+            throw std::runtime_error("Benchmark block was not parsed");
+        }
+    }
+    results.push_back(result("block/parse", parses * blockTransactions, timer));
+
+    timer.reset();
+    for(unsigned int i = 0; i < parses; i++) {
+        const CryptoKernel::Blockchain::blockHeader parsed(blockJson);
+        if(parsed.getId() != Block.getId()) {
+            throw std::runtime_error("Benchmark header was not parsed");
+        }
+    }
+    results.push_back(result("block/header", parses * blockTransactions, timer));
+
+    // Reading every input and output as verifyTransaction and confirmTransaction do
+    unsigned int signatures = 0;
+    timer.reset();
+    for(const CryptoKernel::Blockchain::transaction& tx : Block.getTransactions()) {
+        for(const CryptoKernel::Blockchain::input& inp : tx.getInputs()) {
+            signatures += inp.getData()["signature"].isString();
+        }
+
+        for(const CryptoKernel::Blockchain::output& out : tx.getOutputs()) {
+            signatures += out.getData()["publicKey"].isString();
+        }
+    }
+    results.push_back(result("block/walk", blockTransactions, timer));
+
+    if(signatures != 2 * blockTransactions) {
+        throw std::runtime_error("Benchmark block data was not read");
+    }
+
+    // Queueing the transactions for broadcast, filling the mempool with them,
+    // building a template and evicting them again once the block connects
+    CryptoKernel::Blockchain::Mempool mempool;
+    timer.reset();
+    const std::set<CryptoKernel::Blockchain::transaction>& blockTxs = Block.getTransactions();
+    const std::vector<CryptoKernel::Blockchain::transaction> broadcast(blockTxs.begin(), blockTxs.end());
+    for(const auto& tx : broadcast) {
+        mempool.insert(tx, 1000, false);
+    }
+    const unsigned int selected = mempool.getTransactions().size();
+    const unsigned int evicted = mempool.removeConflicts(Block);
+    results.push_back(result("block/mempool", blockTransactions, timer));
+
+    if(selected != blockTransactions || evicted != blockTransactions) {
+        throw std::runtime_error("Benchmark transactions did not pass through the mempool");
+    }
+
+    return results;
+}
@@ -0,0 +1,278 @@
+#include "Bench.h"
+
+#include <cstdio>
+
+#include "blockchain.h"
+#include "crypto.h"
+#include "log.h"
+#include "consensus/regtest.h"
+
+namespace {
+    // Transactions in each block of the chain that is reorganised away
+    const unsigned int spendsPerBlock = 10;
+
+    // Transactions in the block that is connected
+    const unsigned int blockSpends = 200;
+
+    class BenchChain : public CryptoKernel::Blockchain {
+    public:
+        BenchChain(CryptoKernel::Log* log, const std::string& dbDir)
+            : CryptoKernel::Blockchain(log, dbDir) {}
+
+    private:
+        std::string getCoinbaseOwner(const std::string& publicKey) {
+            return publicKey;
+        }
+
+        uint64_t getBlockReward(const uint64_t height) {
+            return 100000000;
+        }
+    };
+
+    CryptoKernel::Blockchain::transaction signedSpend(CryptoKernel::Crypto& crypto,
+                                                      const CryptoKernel::Blockchain::dbOutput& out,
+                                                      const std::set<CryptoKernel::Blockchain::output>& outputs) {
+        const std::string outputSetId = CryptoKernel::Blockchain::transaction::getOutputSetId(outputs).toString();
+
+        Json::Value spendData;
+        spendData["signature"] = crypto.sign(out.getId().toString() + outputSetId);
+
+        return CryptoKernel::Blockchain::transaction({CryptoKernel::Blockchain::input(out.getId(), spendData)},
+                                                     outputs, 1530888581);
+    }
+
+    // Mines a block that splits a coinbase into count outputs for publicKey
+    void splitCoinbase(CryptoKernel::Blockchain& chain, CryptoKernel::Consensus::Regtest& consensus,
+                       CryptoKernel::Crypto& crypto, const std::string& minerKey,
+                       const unsigned int count) {
+        Json::Value outData;
+        outData["publicKey"] = crypto.getPublicKey();
+
+        consensus.mineBlock(true, crypto.getPublicKey());
+        std::set<CryptoKernel::Blockchain::output> split;
+        for(unsigned int i = 0; i < count; i++) {
+            split.insert(CryptoKernel::Blockchain::output(100000, i, outData));
+        }
+        chain.submitTransaction(signedSpend(crypto,
+                                            *chain.getUnspentOutputs(crypto.getPublicKey()).begin(), split));
+        consensus.mineBlock(true, minerKey);
+
+        if(chain.getUnspentOutputs(crypto.getPublicKey()).size() != count) {
+            throw std::runtime_error("Benchmark outputs were not created");
+        }
+    }
+
+    // A block with only a coinbase on top of the given block
+    CryptoKernel::Blockchain::block forkBlock(const CryptoKernel::uint256& previousBlockId,
+                                              const uint64_t height, const std::string& publicKey,
+                                              const bool isBetter) {
+        Json::Value data;
+        data["publicKey"] = publicKey;
+        const CryptoKernel::Blockchain::transaction coinbaseTx({},
+            {CryptoKernel::Blockchain::output(100000000, height, data)}, 1530888581 + height, true);
+
+        Json::Value consensusData;
+        consensusData["isBetter"] = isBetter;
+
+        return CryptoKernel::Blockchain::block({}, coinbaseTx, previousBlockId, 1530888581 + height,
+                                               consensusData, height);
+    }
+
+    // Mines depth blocks of spends, then connects a longer fork from below them
+    CryptoKernelBench::Result measureReorg(const unsigned int depth) {
+        const std::string dir = CryptoKernelBench::tempPath("reorg-db");
+        const std::string genesis = CryptoKernelBench::tempPath("reorg-genesis.json");
+        CryptoKernel::Storage::destroy(dir);
+        CryptoKernel::BlockStore::destroy(dir + ".blocks");
+        std::remove((dir + ".mempool").c_str());
+        std::remove(genesis.c_str());
+
+        CryptoKernel::Log log(CryptoKernelBench::tempPath("reorg.log"));
+
+        uint64_t elapsed;
+        uint64_t allocated;
+        {
+            BenchChain chain(&log, dir);
+            CryptoKernel::Consensus::Regtest consensus(&chain);
+            chain.loadChain(&consensus, genesis);
+            consensus.start();
+
+            CryptoKernel::Crypto crypto(true);
+            CryptoKernel::Crypto miner(true);
+            const std::string pubKey = crypto.getPublicKey();
+
+            Json::Value outData;
+            outData["publicKey"] = pubKey;
+
+            splitCoinbase(chain, consensus, crypto, miner.getPublicKey(), depth * spendsPerBlock);
+            const auto outs = chain.getUnspentOutputs(pubKey);
+
+            const CryptoKernel::Blockchain::dbBlock forkPoint = chain.getBlockDB("tip");
+
+            auto out = outs.begin();
+            for(unsigned int i = 0; i < depth; i++) {
+                for(unsigned int j = 0; j < spendsPerBlock; j++, out++) {
+                    chain.submitTransaction(signedSpend(crypto, *out,
+                        {CryptoKernel::Blockchain::output(50000, i * spendsPerBlock + j, outData)}));
+                }
+                if(chain.mempoolCount() != spendsPerBlock) {
+                    throw std::runtime_error("Benchmark spends were not accepted");
+                }
+                consensus.mineBlock(true, miner.getPublicKey());
+            }
+
+            if(chain.getBlockDB("tip").getHeight() != forkPoint.getHeight() + depth) {
+                throw std::runtime_error("Benchmark blocks were not mined");
+            }
+
+            // Candidates until the last block of the fork makes it the longer chain
+            CryptoKernel::uint256 previousBlockId = forkPoint.getId();
+            for(unsigned int i = 1; i <= depth; i++) {
+                const auto Block = forkBlock(previousBlockId, forkPoint.getHeight() + i,
+                                             miner.getPublicKey(), false);
+                chain.submitBlock(Block);
+                previousBlockId = Block.getId();
+            }
+            const auto last = forkBlock(previousBlockId, forkPoint.getHeight() + depth + 1,
+                                        miner.getPublicKey(), true);
+
+            CryptoKernelBench::Timer timer;
+            chain.submitBlock(last);
+            elapsed = timer.elapsed();
+            allocated = timer.allocated();
+
+            if(chain.getBlockDB("tip").getId() != last.getId()) {
+                throw std::runtime_error("Benchmark fork was not connected");
+            }
+        }
+        CryptoKernel::Storage::destroy(dir);
+        CryptoKernel::BlockStore::destroy(dir + ".blocks");
+        std::remove((dir + ".mempool").c_str());
+        std::remove(genesis.c_str());
+
+        CryptoKernelBench::Result result;
+        result.name = "reorg/depth" + std::to_string(depth);
+        result.ops = depth;
+        result.nanoseconds = elapsed;
+        result.bytesAllocated = allocated;
+        result.counters["spendsPerBlock"] = spendsPerBlock;
+
+        return result;
+    }
+}
+
+// Disconnects depth blocks and connects depth + 1, putting the disconnected
+// spends back in the mempool. Each op is one disconnected block.
+CK_BENCHMARK(reorgBench) {
+    std::vector<CryptoKernelBench::Result> results;
+    for(const unsigned int depth : {1, 10, 50}) {
+        results.push_back(measureReorg(depth));
+    }
+
+    return results;
+}
+
+// Connects a block of spends whose signatures the mempool has already
+// checked, so most of the work is looking up and recording ids
+CK_BENCHMARK(connectBench) {
+    const std::string dir = CryptoKernelBench::tempPath("connect-db");
+    const std::string genesis = CryptoKernelBench::tempPath("connect-genesis.json");
+    CryptoKernel::Storage::destroy(dir);
+    CryptoKernel::BlockStore::destroy(dir + ".blocks");
+    std::remove(genesis.c_str());
+
+    CryptoKernel::Log log(CryptoKernelBench::tempPath("connect.log"));
+
+    CryptoKernelBench::Result result;
+    {
+        BenchChain chain(&log, dir);
+        CryptoKernel::Consensus::Regtest consensus(&chain);
+        chain.loadChain(&consensus, genesis);
+        consensus.start();
+
+        CryptoKernel::Crypto crypto(true);
+        CryptoKernel::Crypto miner(true);
+
+        Json::Value outData;
+        outData["publicKey"] = crypto.getPublicKey();
+
+        splitCoinbase(chain, consensus, crypto, miner.getPublicKey(), blockSpends);
+
+        unsigned int nonce = 0;
+        for(const auto& out : chain.getUnspentOutputs(crypto.getPublicKey())) {
+            chain.submitTransaction(signedSpend(crypto, out,
+                {CryptoKernel::Blockchain::output(50000, nonce++, outData)}));
+        }
+
+        auto Block = chain.generateVerifyingBlock(miner.getPublicKey());
+        Json::Value consensusData = Block.getConsensusData();
+        consensusData["isBetter"] = true;
+        Block.setConsensusData(consensusData);
+
+        if(Block.getTransactions().size() != blockSpends) {
+            throw std::runtime_error("Benchmark spends were not accepted");
+        }
+
+        CryptoKernelBench::Timer timer;
+        const bool connected = std::get<0>(chain.submitBlock(Block));
+
+        result.name = "block/connect";
+        result.ops = blockSpends;
+        result.nanoseconds = timer.elapsed();
+        result.bytesAllocated = timer.allocated();
+        result.counters["allocationsPerBlock"] = timer.allocations();
+        result.counters["allocationsPerTx"] = double(timer.allocations()) / blockSpends;
+
+        if(!connected) {
+            throw std::runtime_error("Benchmark block was not connected");
+        }
+    }
+
+    // Serves the block back the way getblocks does, from a reopened chain
+    // so its outputs are read from the database rather than the coins cache
+    CryptoKernelBench::Result serve;
+    CryptoKernelBench::Result tip;
+    {
+        BenchChain chain(&log, dir);
+        CryptoKernel::Consensus::Regtest consensus(&chain);
+        chain.loadChain(&consensus, genesis);
+
+        const uint64_t height = chain.getBlockDB("tip").getHeight();
+        const unsigned int rounds = 10;
+        size_t bytes = 0;
+
+        CryptoKernelBench::Timer timer;
+        for(unsigned int i = 0; i < rounds; i++) {
+            bytes = CryptoKernel::Storage::toString(chain.getBlockByHeight(height).toJson()).size();
+        }
+
+        serve.name = "block/serve";
+        serve.ops = rounds * blockSpends;
+        serve.nanoseconds = timer.elapsed();
+        serve.bytesAllocated = timer.allocated();
+        serve.counters["blockBytes"] = bytes;
+
+        // Polling the tip height as the network thread and RPCs do
+        const unsigned int polls = 1000;
+        uint64_t tipHeight = 0;
+        timer.reset();
+        for(unsigned int i = 0; i < polls; i++) {
+            tipHeight = chain.getBlockDB("tip").getHeight();
+        }
+
+        tip.name = "block/tip";
+        tip.ops = polls;
+        tip.nanoseconds = timer.elapsed();
+        tip.bytesAllocated = timer.allocated();
+
+        if(tipHeight != height) {
+            throw std::runtime_error("Benchmark tip moved");
+        }
+    }
+    CryptoKernel::Storage::destroy(dir);
+    CryptoKernel::BlockStore::destroy(dir + ".blocks");
+    std::remove((dir + ".mempool").c_str());
+    std::remove(genesis.c_str());
+
+    return {result, serve, tip};
+}
@@ -0,0 +1,93 @@
+#include "Bench.h"
+
+#include "storage.h"
+#include "crypto.h"
+
+namespace {
+    // Values shaped like the utxos and transactions tables
+    std::vector<Json::Value> sampleValues(const unsigned int count) {
+        CryptoKernel::Crypto crypto(true);
+        const std::string publicKey = crypto.getPublicKey();
+
+        std::vector<Json::Value> values;
+        for(unsigned int i = 0; i < count; i++) {
+            Json::Value output;
+            output["value"] = Json::UInt64(100000000 + i);
+            output["nonce"] = Json::UInt64(i * 7919);
+            output["data"]["publicKey"] = publicKey;
+            output["creationTx"] = CryptoKernel::Crypto::sha256("tx" + std::to_string(i));
+            output["id"] = CryptoKernel::Crypto::sha256("out" + std::to_string(i));
+            values.push_back(output);
+
+            Json::Value tx;
+            tx["inputs"].append(CryptoKernel::Crypto::sha256("in" + std::to_string(i)));
+            tx["outputs"].append(output["id"]);
+            tx["outputs"].append(CryptoKernel::Crypto::sha256("change" + std::to_string(i)));
+            tx["confirmingBlock"] = CryptoKernel::Crypto::sha256("block" + std::to_string(i / 100));
+            tx["coinbaseTx"] = false;
+            tx["timestamp"] = Json::UInt64(1530888581 + i);
+            values.push_back(tx);
+        }
+
+        return values;
+    }
+
+    CryptoKernelBench::Result measureCodec(const std::string& name,
+                                           const std::shared_ptr<CryptoKernel::Storage::Codec>& codec,
+                                           const std::vector<Json::Value>& values) {
+        std::vector<std::string> encoded;
+        encoded.reserve(values.size());
+
+        uint64_t bytes = 0;
+        CryptoKernelBench::Timer timer;
+        for(const auto& value : values) {
+            encoded.push_back(codec->encode(value));
+        }
+        const uint64_t encodeTime = timer.elapsed();
+
+        for(const auto& data : encoded) {
+            bytes += data.size();
+        }
+
+        timer.reset();
+        for(const auto& data : encoded) {
+            if(codec->decode(data).isNull()) {
+                throw std::runtime_error("Failed to decode benchmark value");
+            }
+        }
+        const uint64_t decodeTime = timer.elapsed();
+        const uint64_t decodeAllocated = timer.allocated();
+
+        // Bytes on disk after LevelDB has compressed and compacted the values
+        const std::string dir = CryptoKernelBench::tempPath("codec-db");
+        CryptoKernel::Storage::destroy(dir);
+        {
+            CryptoKernel::Storage db(dir, false, 0, false, codec);
+            std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(db.begin());
+            for(unsigned int i = 0; i < values.size(); i++) {
+                dbTx->put(std::to_string(i), values[i]);
+            }
+            dbTx->commit();
+        }
+        const uint64_t diskBytes = CryptoKernelBench::directorySize(dir);
+        CryptoKernel::Storage::destroy(dir);
+
+        CryptoKernelBench::Result result;
+        result.name = "codec/" + name + "/decode";
+        result.ops = values.size();
+        result.nanoseconds = decodeTime;
+        result.bytesAllocated = decodeAllocated;
+        result.counters["encodeNsPerOp"] = double(encodeTime) / values.size();
+        result.counters["bytesPerValue"] = double(bytes) / values.size();
+        result.counters["diskBytes"] = diskBytes;
+
+        return result;
+    }
+}
+
+CK_BENCHMARK(codecBench) {
+    const auto values = sampleValues(10000);
+
+    return {measureCodec("json", std::make_shared<CryptoKernel::Storage::JsonCodec>(), values),
+            measureCodec("binary", std::make_shared<CryptoKernel::Storage::BinaryCodec>(), values)};
+}
@@ -0,0 +1,82 @@
+#include "Bench.h"
+
+#include <thread>
+
+#include "storage.h"
+#include "crypto.h"
+
+namespace {
+    CryptoKernelBench::Result measureCommits(const unsigned int submitters,
+                                             const bool groupCommit) {
+        const unsigned int commitsPerSubmitter = 200;
+
+        const std::string dir = CryptoKernelBench::tempPath("commit-db");
+        CryptoKernel::Storage::destroy(dir);
+
+        CryptoKernel::Storage::CommitStats stats;
+        uint64_t elapsed;
+        uint64_t allocated;
+        {
+            CryptoKernel::Storage db(dir, true, 8, true,
+                                     std::make_shared<CryptoKernel::Storage::BinaryCodec>());
+            db.setGroupCommit(groupCommit);
+
+            // Roughly what submitTransaction writes for a one in, one out transaction
+            Json::Value output;
+            output["value"] = Json::UInt64(100000000);
+            output["nonce"] = Json::UInt64(7919);
+            output["data"]["publicKey"] = CryptoKernel::Crypto(true).getPublicKey();
+
+            CryptoKernelBench::Timer timer;
+
+            std::vector<std::thread> threads;
+            for(unsigned int t = 0; t < submitters; t++) {
+                threads.push_back(std::thread([&, t]{
+                    for(unsigned int i = 0; i < commitsPerSubmitter; i++) {
+                        const std::string id = CryptoKernel::Crypto::sha256(std::to_string(t) + "/" +
+                                                                            std::to_string(i));
+                        std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(db.begin());
+                        dbTx->get("utxos/1/" + id);
+                        dbTx->put("utxos/1/" + id, output);
+                        dbTx->put("inputs/1/" + id, output["data"]);
+                        dbTx->commit();
+                    }
+                }));
+            }
+
+            for(auto& thread : threads) {
+                thread.join();
+            }
+
+            elapsed = timer.elapsed();
+            allocated = timer.allocated();
+            stats = db.getCommitStats();
+        }
+        CryptoKernel::Storage::destroy(dir);
+
+        CryptoKernelBench::Result result;
+        result.name = std::string("commit/") + (groupCommit ? "group" : "single") + "/" +
+                      std::to_string(submitters);
+        result.ops = stats.commits;
+        result.nanoseconds = elapsed;
+        result.bytesAllocated = allocated;
+        result.counters["writes"] = stats.writes;
+        result.counters["syncs"] = stats.syncs;
+        result.counters["commitsPerWrite"] = double(stats.commits) / stats.writes;
+        for(const auto& bucket : stats.groupSizes) {
+            result.counters["groupsUpTo" + std::to_string(bucket.first)] = bucket.second;
+        }
+
+        return result;
+    }
+}
+
+CK_BENCHMARK(commitBench) {
+    std::vector<CryptoKernelBench::Result> results;
+    for(const unsigned int submitters : {1, 2, 4, 8, 16}) {
+        results.push_back(measureCommits(submitters, false));
+        results.push_back(measureCommits(submitters, true));
+    }
+
+    return results;
+}
@@ -0,0 +1,132 @@
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Bench.h"
+#include "storage.h"
+
+namespace {
+    std::string tempDir;
+}
+
+std::string CryptoKernelBench::tempPath(const std::string& name) {
+    return tempDir + "/" + name;
+}
+
+std::vector<std::pair<std::string, CryptoKernelBench::Benchmark>>&
+CryptoKernelBench::getBenchmarks() {
+    static std::vector<std::pair<std::string, Benchmark>> benchmarks;
+    return benchmarks;
+}
+
+int CryptoKernelBench::registerBenchmark(const std::string& name,
+                                         const Benchmark& benchmark) {
+    getBenchmarks().push_back(std::make_pair(name, benchmark));
+    return 0;
+}
+
+uint64_t CryptoKernelBench::directorySize(const std::string& path) {
+    uint64_t total = 0;
+
+    // Some databases, such as LMDB ones, are a single file
+    struct stat pathInfo;
+    if(stat(path.c_str(), &pathInfo) == 0 && S_ISREG(pathInfo.st_mode)) {
+        return pathInfo.st_size;
+    }
+
+    DIR* dir = opendir(path.c_str());
+    if(dir == nullptr) {
+        return 0;
+    }
+
+    while(dirent* entry = readdir(dir)) {
+        struct stat info;
+        const std::string file = path + "/" + entry->d_name;
+        if(stat(file.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+            total += info.st_size;
+        }
+    }
+
+    closedir(dir);
+
+    return total;
+}
+
+int main(int argc, char* argv[]) {
+    std::string filter;
+    bool json = false;
+    for(int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if(arg == "--json") {
+            json = true;
+        } else {
+            filter = arg;
+        }
+    }
+
+    // Databases go in a fresh directory so runs never see each other's data
+    const char* tmp = std::getenv("TMPDIR");
+    std::string dirTemplate = std::string(tmp != nullptr ? tmp : "/tmp") + "/ckbench-XXXXXX";
+    if(mkdtemp(&dirTemplate[0]) == nullptr) {
+        std::cerr << "Could not create a temporary directory" << std::endl;
+        return 1;
+    }
+    tempDir = dirTemplate;
+
+    Json::Value report;
+    report["benchmarks"] = Json::arrayValue;
+
+    for(const auto& benchmark : CryptoKernelBench::getBenchmarks()) {
+        if(benchmark.first.find(filter) == std::string::npos) {
+            continue;
+        }
+
+        for(const auto& result : benchmark.second()) {
+            const double nsPerOp = result.ops > 0 ? double(result.nanoseconds) / result.ops : 0;
+            const double opsPerSecond = result.nanoseconds > 0 ? result.ops * 1e9 / result.nanoseconds : 0;
+            const double bytesPerOp = result.ops > 0 ? double(result.bytesAllocated) / result.ops : 0;
+
+            if(json) {
+                Json::Value entry;
+                entry["benchmark"] = benchmark.first;
+                entry["name"] = result.name;
+                entry["ops"] = Json::UInt64(result.ops);
+                entry["nanoseconds"] = Json::UInt64(result.nanoseconds);
+                entry["nsPerOp"] = nsPerOp;
+                entry["opsPerSecond"] = opsPerSecond;
+                entry["bytesAllocated"] = Json::UInt64(result.bytesAllocated);
+                entry["bytesPerOp"] = bytesPerOp;
+                entry["counters"] = Json::objectValue;
+                for(const auto& counter : result.counters) {
+                    entry["counters"][counter.first] = counter.second;
+                }
+                report["benchmarks"].append(entry);
+                continue;
+            }
+
+            std::cout << std::left << std::setw(48) << result.name
+                      << std::right << std::setw(14) << std::fixed << std::setprecision(1)
+                      << nsPerOp << " ns/op"
+                      << std::setw(14) << opsPerSecond << " ops/s"
+                      << std::setw(12) << bytesPerOp << " B/op";
+
+            for(const auto& counter : result.counters) {
+                std::cout << "  " << counter.first << "=" << counter.second;
+            }
+
+            std::cout << std::endl;
+        }
+    }
+
+    if(json) {
+        std::cout << CryptoKernel::Storage::toString(report, true) << std::endl;
+    }
+
+    rmdir(tempDir.c_str());
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "Bench.h"
+
+#include <random>
+#include <algorithm>
+
+#include "storage.h"
+#include "crypto.h"
+#include "ckmath.h"
+
+namespace {
+    CryptoKernelBench::Result measureKeys(const std::string& name,
+                                          CryptoKernel::Storage::Table& table,
+                                          const std::vector<std::string>& ids,
+                                          const std::string& publicKey) {
+        const std::string dir = CryptoKernelBench::tempPath("key-db");
+        CryptoKernel::Storage::destroy(dir);
+
+        Json::Value output;
+        output["value"] = Json::UInt64(100000000);
+        output["nonce"] = Json::UInt64(7919);
+        output["data"]["publicKey"] = publicKey;
+
+        {
+            CryptoKernel::Storage db(dir, false, 8, true,
+                                     std::make_shared<CryptoKernel::Storage::BinaryCodec>());
+            std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(db.begin());
+            for(const auto& id : ids) {
+                table.put(dbTx.get(), id, output);
+                table.put(dbTx.get(), CryptoKernel::Storage::Key(publicKey).append(id), Json::nullValue, 0);
+            }
+            dbTx->commit();
+        }
+        const uint64_t diskBytes = CryptoKernelBench::directorySize(dir);
+
+        std::vector<std::string> lookups(ids);
+        std::shuffle(lookups.begin(), lookups.end(), std::mt19937(42));
+
+        uint64_t lookupTime;
+        uint64_t lookupAllocated;
+        uint64_t scanTime;
+        {
+            // Reopened so lookups go through the table files and block cache
+            CryptoKernel::Storage db(dir, false, 8, true,
+                                     std::make_shared<CryptoKernel::Storage::BinaryCodec>());
+            std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(db.beginReadOnly());
+
+            CryptoKernelBench::Timer timer;
+            for(const auto& id : lookups) {
+                if(table.get(dbTx.get(), id).isNull()) {
+                    throw std::runtime_error("Missing benchmark key");
+                }
+            }
+            lookupTime = timer.elapsed();
+            lookupAllocated = timer.allocated();
+
+            timer.reset();
+            uint64_t found = 0;
+            std::unique_ptr<CryptoKernel::Storage::Table::Iterator> it(new
+                CryptoKernel::Storage::Table::Iterator(&table, &db, dbTx->snapshot, publicKey, 0));
+            for(it->SeekToFirst(); it->Valid(); it->Next()) {
+                found += it->key().size();
+            }
+            scanTime = timer.elapsed();
+            if(found == 0) {
+                throw std::runtime_error("Missing benchmark keys");
+            }
+        }
+        CryptoKernel::Storage::destroy(dir);
+
+        CryptoKernelBench::Result result;
+        result.name = "keys/" + name + "/lookup";
+        result.ops = lookups.size();
+        result.nanoseconds = lookupTime;
+        result.bytesAllocated = lookupAllocated;
+        result.counters["diskBytes"] = diskBytes;
+        result.counters["keyBytes"] = table.getKey(ids[0]).size();
+        result.counters["scanNsPerKey"] = double(scanTime) / ids.size();
+
+        return result;
+    }
+}
+
+CK_BENCHMARK(keyBench) {
+    std::vector<std::string> ids;
+    for(unsigned int i = 0; i < 50000; i++) {
+        ids.push_back(CryptoKernel::BigNum(CryptoKernel::Crypto::sha256("out" + std::to_string(i))).toString());
+    }
+    const std::string publicKey = CryptoKernel::Crypto(true).getPublicKey();
+
+    CryptoKernel::Storage::Table named("utxos");
+    CryptoKernel::Storage::Table compact("utxos", 3);
+
+    return {measureKeys("text", named, ids, publicKey),
+            measureKeys("compact", compact, ids, publicKey)};
+}
@@ -0,0 +1,77 @@
+#include "Bench.h"
+
+#include <random>
+
+#include "blockchain.h"
+#include "crypto.h"
+
+namespace {
+    // Single input, single output transactions with random fees
+    std::vector<std::pair<CryptoKernel::Blockchain::transaction, uint64_t>> sampleTransactions(
+        const unsigned int count) {
+        std::mt19937_64 random(42);
+        std::uniform_int_distribution<uint64_t> feeDistribution(1000, 1000000);
+
+        Json::Value data;
+        data["publicKey"] = "BGOjpbmxzX26d7zHmNxy3RWb94MzTciGhF7y8ehF2EH2BlTDStCrAhSmmfmbaWDuRYqagRViAhVj6QhOsfp4oT4=";
+
+        Json::Value spendData;
+        spendData["signature"] = "MEUCIQDDyHnvL5Wt3y4E7vXHZmFmAaPRHhd3hDlbpK5jV7hRbAIgNj1xAAWZo0I6AUNxnO4yWovMf3aRSVnbdqXdG/7YUqE=";
+
+        std::vector<std::pair<CryptoKernel::Blockchain::transaction, uint64_t>> txs;
+        for(unsigned int i = 0; i < count; i++) {
+            const CryptoKernel::uint256 outputId(CryptoKernel::Crypto::sha256("out" + std::to_string(i)));
+            CryptoKernel::Blockchain::transaction tx({CryptoKernel::Blockchain::input(outputId, spendData)},
+                                                     {CryptoKernel::Blockchain::output(100000000, i, data)},
+                                                     1530888581);
+            txs.emplace_back(tx, feeDistribution(random));
+        }
+
+        return txs;
+    }
+}
+
+CK_BENCHMARK(mempoolBench) {
+    std::vector<CryptoKernelBench::Result> results;
+
+    for(const unsigned int count : {10000, 100000}) {
+        const auto txs = sampleTransactions(count);
+
+        CryptoKernel::Blockchain::Mempool mempool;
+
+        CryptoKernelBench::Timer timer;
+        for(const auto& tx : txs) {
+            if(!mempool.insert(tx.first, tx.second, false)) {
+                throw std::runtime_error("Benchmark transaction conflicts");
+            }
+        }
+
+        CryptoKernelBench::Result insert;
+        insert.name = "mempool/insert/" + std::to_string(count);
+        insert.ops = count;
+        insert.nanoseconds = timer.elapsed();
+        insert.bytesAllocated = timer.allocated();
+        // Compare with the bytes allocated per entry to check the estimate
+        insert.counters["usagePerEntry"] = double(mempool.usage()) / count;
+        results.push_back(insert);
+
+        const unsigned int templates = 10;
+        uint64_t fees = 0;
+        size_t selected = 0;
+        timer.reset();
+        for(unsigned int i = 0; i < templates; i++) {
+            selected = mempool.getTransactions(fees).size();
+        }
+
+        CryptoKernelBench::Result build;
+        build.name = "mempool/template/" + std::to_string(count);
+        build.ops = templates;
+        build.nanoseconds = timer.elapsed();
+        build.bytesAllocated = timer.allocated();
+        build.counters["transactions"] = selected;
+        build.counters["fees"] = fees;
+        results.push_back(build);
+    }
+
+    return results;
+}
@@ -0,0 +1,284 @@
+#include "Bench.h"
+
+#include <random>
+#include <algorithm>
+
+#include "storage.h"
+#include "crypto.h"
+
+namespace {
+    const unsigned int entries = 20000;
+
+    Json::Value sampleOutput(const unsigned int i) {
+        Json::Value output;
+        output["value"] = Json::UInt64(100000000 + i);
+        output["nonce"] = Json::UInt64(i * 7919);
+        output["data"]["publicKey"] = "BGOjpbmxzX26d7zHmNxy3RWb94MzTciGhF7y8ehF2EH2BlTDStCrAhSmmfmbaWDuRYqagRViAhVj6QhOsfp4oT4=";
+        output["creationTx"] = CryptoKernel::Crypto::sha256("tx" + std::to_string(i));
+        return output;
+    }
+
+    std::vector<std::string> sampleIds() {
+        std::vector<std::string> ids;
+        for(unsigned int i = 0; i < entries; i++) {
+            ids.push_back(CryptoKernel::Crypto::sha256("out" + std::to_string(i)));
+        }
+        return ids;
+    }
+
+    // Writes every id in transactions of batchSize puts each
+    CryptoKernelBench::Result measurePut(const std::vector<std::string>& ids,
+                                         const unsigned int batchSize) {
+        const std::string dir = CryptoKernelBench::tempPath("put-db");
+        CryptoKernel::Storage::destroy(dir);
+
+        std::vector<Json::Value> values;
+        for(unsigned int i = 0; i < ids.size(); i++) {
+            values.push_back(sampleOutput(i));
+        }
+
+        CryptoKernel::Storage::Table table("utxos", 3);
+
+        uint64_t elapsed;
+        uint64_t allocated;
+        uint64_t commits = 0;
+        {
+            CryptoKernel::Storage db(dir, false, 8, true,
+                                     std::make_shared<CryptoKernel::Storage::BinaryCodec>());
+
+            CryptoKernelBench::Timer timer;
+            for(size_t i = 0; i < ids.size(); i += batchSize) {
+                std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(db.begin());
+                for(size_t j = i; j < std::min<size_t>(i + batchSize, ids.size()); j++) {
+                    table.put(dbTx.get(), ids[j], values[j]);
+                }
+                dbTx->commit();
+                commits++;
+            }
+            elapsed = timer.elapsed();
+            allocated = timer.allocated();
+        }
+        CryptoKernel::Storage::destroy(dir);
+
+        CryptoKernelBench::Result result;
+        result.name = "transaction/put/batch" + std::to_string(batchSize);
+        result.ops = ids.size();
+        result.nanoseconds = elapsed;
+        result.bytesAllocated = allocated;
+        result.counters["commitNsPerOp"] = double(elapsed) / commits;
+
+        return result;
+    }
+
+    // Fills a database with every id for the read benchmarks
+    void fill(CryptoKernel::Storage& db, CryptoKernel::Storage::Table& table,
+              const std::vector<std::string>& ids) {
+        std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(db.begin());
+        for(unsigned int i = 0; i < ids.size(); i++) {
+            table.put(dbTx.get(), ids[i], sampleOutput(i));
+        }
+        dbTx->commit();
+    }
+}
+
+CK_BENCHMARK(transactionBench) {
+    const auto ids = sampleIds();
+
+    std::vector<CryptoKernelBench::Result> results;
+    for(const unsigned int batchSize : {1, 10, 100, 1000}) {
+        results.push_back(measurePut(ids, batchSize));
+    }
+
+    const std::string dir = CryptoKernelBench::tempPath("get-db");
+    CryptoKernel::Storage::destroy(dir);
+    {
+        CryptoKernel::Storage db(dir, false, 8, true,
+                                 std::make_shared<CryptoKernel::Storage::BinaryCodec>());
+        CryptoKernel::Storage::Table table("utxos", 3);
+        fill(db, table, ids);
+
+        std::vector<std::string> lookups(ids);
+        std::shuffle(lookups.begin(), lookups.end(), std::mt19937(42));
+
+        std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(db.beginReadOnly());
+        CryptoKernelBench::Timer timer;
+        for(const auto& id : lookups) {
+            if(table.get(dbTx.get(), id).isNull()) {
+                throw std::runtime_error("Missing benchmark key");
+            }
+        }
+
+        CryptoKernelBench::Result get;
+        get.name = "transaction/get";
+        get.ops = lookups.size();
+        get.nanoseconds = timer.elapsed();
+        get.bytesAllocated = timer.allocated();
+        results.push_back(get);
+
+        // A write transaction that reads back what it just wrote never
+        // touches the database
+        dbTx.reset(db.begin());
+        for(unsigned int i = 0; i < 1000; i++) {
+            table.put(dbTx.get(), ids[i], sampleOutput(i));
+        }
+        timer.reset();
+        for(unsigned int i = 0; i < 1000; i++) {
+            table.get(dbTx.get(), ids[i]);
+        }
+
+        CryptoKernelBench::Result own;
+        own.name = "transaction/get/own";
+        own.ops = 1000;
+        own.nanoseconds = timer.elapsed();
+        own.bytesAllocated = timer.allocated();
+        results.push_back(own);
+        dbTx->abort();
+    }
+    CryptoKernel::Storage::destroy(dir);
+
+    return results;
+}
+
+CK_BENCHMARK(iteratorBench) {
+    const auto ids = sampleIds();
+
+    std::vector<CryptoKernelBench::Result> results;
+
+    const std::string dir = CryptoKernelBench::tempPath("iterator-db");
+    CryptoKernel::Storage::destroy(dir);
+    {
+        CryptoKernel::Storage db(dir, false, 8, true,
+                                 std::make_shared<CryptoKernel::Storage::BinaryCodec>());
+        CryptoKernel::Storage::Table table("utxos", 3);
+        fill(db, table, ids);
+
+        CryptoKernelBench::Timer timer;
+        uint64_t scanned = 0;
+        {
+            CryptoKernel::Storage::Table::Iterator it(&table, &db);
+            for(it.SeekToFirst(); it.Valid(); it.Next()) {
+                if(!it.value().isNull()) {
+                    scanned++;
+                }
+            }
+        }
+
+        CryptoKernelBench::Result scan;
+        scan.name = "iterator/scan";
+        scan.ops = scanned;
+        scan.nanoseconds = timer.elapsed();
+        scan.bytesAllocated = timer.allocated();
+        results.push_back(scan);
+
+        if(scanned != ids.size()) {
+            throw std::runtime_error("Iterator missed benchmark keys");
+        }
+
+        timer.reset();
+        scanned = 0;
+        {
+            CryptoKernel::Storage::Table::Iterator it(&table, &db);
+            it.SeekToFirst();
+            for(auto batch = it.nextBatch(1000); !batch.empty(); batch = it.nextBatch(1000)) {
+                scanned += batch.size();
+            }
+        }
+
+        CryptoKernelBench::Result batched;
+        batched.name = "iterator/scan/batch1000";
+        batched.ops = scanned;
+        batched.nanoseconds = timer.elapsed();
+        batched.bytesAllocated = timer.allocated();
+        results.push_back(batched);
+
+        if(scanned != ids.size()) {
+            throw std::runtime_error("Iterator missed benchmark keys");
+        }
+    }
+    CryptoKernel::Storage::destroy(dir);
+
+    return results;
+}
+
+CK_BENCHMARK(jsonBench) {
+    std::vector<std::string> strings;
+    for(unsigned int i = 0; i < entries; i++) {
+        strings.push_back(CryptoKernel::Storage::toString(sampleOutput(i)));
+    }
+
+    std::vector<CryptoKernelBench::Result> results;
+
+    CryptoKernelBench::Timer timer;
+    std::vector<Json::Value> parsed;
+    parsed.reserve(strings.size());
+    for(const auto& str : strings) {
+        parsed.push_back(CryptoKernel::Storage::toJson(str));
+    }
+
+    CryptoKernelBench::Result toJson;
+    toJson.name = "json/toJson";
+    toJson.ops = strings.size();
+    toJson.nanoseconds = timer.elapsed();
+    toJson.bytesAllocated = timer.allocated();
+    results.push_back(toJson);
+
+    timer.reset();
+    uint64_t bytes = 0;
+    for(const auto& value : parsed) {
+        bytes += CryptoKernel::Storage::toString(value).size();
+    }
+
+    CryptoKernelBench::Result toString;
+    toString.name = "json/toString";
+    toString.ops = parsed.size();
+    toString.nanoseconds = timer.elapsed();
+    toString.bytesAllocated = timer.allocated();
+    toString.counters["bytesPerValue"] = double(bytes) / parsed.size();
+    results.push_back(toString);
+
+    return results;
+}
+
+CK_BENCHMARK(snapshotBench) {
+    const auto ids = sampleIds();
+    const unsigned int snapshots = 10000;
+
+    std::vector<CryptoKernelBench::Result> results;
+
+    const std::string dir = CryptoKernelBench::tempPath("snapshot-db");
+    CryptoKernel::Storage::destroy(dir);
+    {
+        CryptoKernel::Storage db(dir, false, 8, true,
+                                 std::make_shared<CryptoKernel::Storage::BinaryCodec>());
+        CryptoKernel::Storage::Table table("utxos", 3);
+        fill(db, table, ids);
+
+        CryptoKernelBench::Timer timer;
+        for(unsigned int i = 0; i < snapshots; i++) {
+            std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(db.beginReadOnly());
+        }
+
+        CryptoKernelBench::Result snapshot;
+        snapshot.name = "snapshot/create";
+        snapshot.ops = snapshots;
+        snapshot.nanoseconds = timer.elapsed();
+        snapshot.bytesAllocated = timer.allocated();
+        results.push_back(snapshot);
+
+        // An iterator without a snapshot takes its own
+        timer.reset();
+        for(unsigned int i = 0; i < snapshots; i++) {
+            CryptoKernel::Storage::Table::Iterator it(&table, &db);
+        }
+
+        CryptoKernelBench::Result iterator;
+        iterator.name = "snapshot/iterator";
+        iterator.ops = snapshots;
+        iterator.nanoseconds = timer.elapsed();
+        iterator.bytesAllocated = timer.allocated();
+        results.push_back(iterator);
+    }
+    CryptoKernel::Storage::destroy(dir);
+
+    return results;
+}
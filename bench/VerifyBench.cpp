@@ -0,0 +1,78 @@
+#include "Bench.h"
+
+#include "crypto.h"
+#include "threadpool.h"
+#include "sigcache.h"
+
+namespace {
+    const unsigned int signatures = 2000;
+
+    struct Signed {
+        std::string publicKey;
+        std::string message;
+        std::string signature;
+    };
+}
+
+// Verifies a block's worth of input signatures on pools of increasing size,
+// as submitBlock does once the inputs have been checked against the chain
+CK_BENCHMARK(verifyBench) {
+    std::vector<Signed> inputs;
+    for(unsigned int i = 0; i < signatures; i++) {
+        CryptoKernel::Crypto crypto(true);
+        const std::string message = CryptoKernel::Crypto::sha256("input" + std::to_string(i));
+        inputs.push_back(Signed{crypto.getPublicKey(), message, crypto.sign(message)});
+    }
+
+    std::vector<CryptoKernelBench::Result> results;
+    double serialNs = 0;
+    for(const unsigned int threads : {1, 2, 4, 8}) {
+        CryptoKernel::ThreadPool pool(threads);
+
+        CryptoKernelBench::Timer timer;
+        const bool verified = pool.parallelFor(inputs.size(), [&](const size_t i) {
+            CryptoKernel::Crypto crypto;
+            crypto.setPublicKey(inputs[i].publicKey);
+            return crypto.verify(inputs[i].message, inputs[i].signature);
+        });
+
+        CryptoKernelBench::Result result;
+        result.name = "verify/threads" + std::to_string(threads);
+        result.ops = inputs.size();
+        result.nanoseconds = timer.elapsed();
+        result.bytesAllocated = timer.allocated();
+
+        if(!verified) {
+            throw std::runtime_error("Benchmark signature did not verify");
+        }
+
+        if(threads == 1) {
+            serialNs = result.nanoseconds;
+        }
+        result.counters["speedup"] = serialNs / result.nanoseconds;
+        results.push_back(result);
+    }
+
+    // The same signatures again once the mempool has seen them
+    CryptoKernel::SignatureCache cache(CryptoKernel::SignatureCache::defaultMaxEntries);
+    for(const auto& input : inputs) {
+        cache.insert("ecdsa", input.publicKey, input.message, input.signature);
+    }
+
+    CryptoKernelBench::Timer timer;
+    for(const auto& input : inputs) {
+        if(!cache.contains("ecdsa", input.publicKey, input.message, input.signature)) {
+            throw std::runtime_error("Benchmark signature was not cached");
+        }
+    }
+
+    CryptoKernelBench::Result cached;
+    cached.name = "verify/cached";
+    cached.ops = inputs.size();
+    cached.nanoseconds = timer.elapsed();
+    cached.bytesAllocated = timer.allocated();
+    cached.counters["speedup"] = serialNs / cached.nanoseconds;
+    results.push_back(cached);
+
+    return results;
+}
@@ -2,6 +2,7 @@ sudo apt-get update && sudo apt-get install -y \
     git \
     build-essential \
     libleveldb-dev \
+    liblmdb-dev \
     libargtable2-dev \
     libreadline-dev \
     libcurl4-gnutls-dev \
@@ -35,7 +35,7 @@ workspace "CryptoKernel"
         linkoptions {"-rdynamic"}
 
 cklibs = {"crypto", "sfml-network", 
-"sfml-system", "leveldb", "jsoncpp", "jsonrpccpp-server", 
+"sfml-system", "leveldb", "lmdb", "jsoncpp", "jsonrpccpp-server", 
 "jsonrpccpp-client", "jsonrpccpp-common", "microhttpd", "cschnorr", "noiseprotocol"}
 
 linuxLinks = {"pthread", "lua5.3", "curl", "dl", "gcov"}
@@ -87,3 +87,12 @@ project "test"
     postbuildcommands{"%{cfg.linktarget.abspath}"}
 
     linkSystemSpecific()
+
+project "bench"
+
+    kind "ConsoleApp"
+    files {"bench/**.cpp", "bench/**.h"}
+    links {"ck"}
+    links(cklibs)
+
+    linkSystemSpecific()
@@ -192,6 +192,24 @@ public:
         else
         { throw jsonrpc::JsonRpcException(jsonrpc::Errors::ERROR_CLIENT_INVALID_RESPONSE, result.toStyledString()); }
     }
+    Json::Value getstorageinfo() throw (jsonrpc::JsonRpcException) {
+        Json::Value p;
+        p = Json::nullValue;
+        Json::Value result = this->CallMethod("getstorageinfo",p);
+        if (result.isObject())
+        { return result; }
+        else
+        { throw jsonrpc::JsonRpcException(jsonrpc::Errors::ERROR_CLIENT_INVALID_RESPONSE, result.toStyledString()); }
+    }
+    Json::Value rescanmempool() throw (jsonrpc::JsonRpcException) {
+        Json::Value p;
+        p = Json::nullValue;
+        Json::Value result = this->CallMethod("rescanmempool",p);
+        if (result.isObject())
+        { return result; }
+        else
+        { throw jsonrpc::JsonRpcException(jsonrpc::Errors::ERROR_CLIENT_INVALID_RESPONSE, result.toStyledString()); }
+    }
     Json::Value dumpprivkeys(const std::string& account,
                              const std::string& password) throw (jsonrpc::JsonRpcException) {
         Json::Value p;
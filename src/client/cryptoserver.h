@@ -76,6 +76,12 @@ public:
         this->bindAndAddMethod(jsonrpc::Procedure("getpeerinfo", jsonrpc::PARAMS_BY_NAME,
                                jsonrpc::JSON_OBJECT, NULL),
                                &CryptoRPCServer::getpeerinfoI);
+        this->bindAndAddMethod(jsonrpc::Procedure("getstorageinfo", jsonrpc::PARAMS_BY_NAME,
+                               jsonrpc::JSON_OBJECT, NULL),
+                               &CryptoRPCServer::getstorageinfoI);
+        this->bindAndAddMethod(jsonrpc::Procedure("rescanmempool", jsonrpc::PARAMS_BY_NAME,
+                               jsonrpc::JSON_OBJECT, NULL),
+                               &CryptoRPCServer::rescanmempoolI);
         this->bindAndAddMethod(jsonrpc::Procedure("dumpprivkeys", jsonrpc::PARAMS_BY_NAME,
                                jsonrpc::JSON_OBJECT, "account",jsonrpc::JSON_STRING,
                                "password", jsonrpc::JSON_STRING, NULL), &CryptoRPCServer::dumpprivkeysI);
@@ -147,6 +153,12 @@ public:
     inline virtual void getpeerinfoI(const Json::Value &request, Json::Value &response) {
         response = this->getpeerinfo();
     }
+    inline virtual void getstorageinfoI(const Json::Value &request, Json::Value &response) {
+        response = this->getstorageinfo();
+    }
+    inline virtual void rescanmempoolI(const Json::Value &request, Json::Value &response) {
+        response = this->rescanmempool();
+    }
     inline virtual void dumpprivkeysI(const Json::Value &request, Json::Value &response) {
         response = this->dumpprivkeys(request["account"].asString(), request["password"].asString());
     }
@@ -177,6 +189,8 @@ public:
     virtual Json::Value importprivkey(const std::string& name, const std::string& key,
                                       const std::string& password) = 0;
     virtual Json::Value getpeerinfo() = 0;
+    virtual Json::Value getstorageinfo() = 0;
+    virtual Json::Value rescanmempool() = 0;
     virtual Json::Value dumpprivkeys(const std::string& account, const std::string& password) = 0;
     virtual std::string getoutputsetid(const Json::Value& outputs) = 0;
     virtual std::string signmessage(const std::string& message, const std::string& publickey, const std::string& password) = 0;
@@ -208,6 +222,8 @@ public:
     virtual Json::Value importprivkey(const std::string& name, const std::string& key,
                                       const std::string& password);
     virtual Json::Value getpeerinfo();
+    virtual Json::Value getstorageinfo();
+    virtual Json::Value rescanmempool();
     virtual Json::Value dumpprivkeys(const std::string& account, const std::string& password);
     virtual std::string getoutputsetid(const Json::Value& outputs);
     virtual std::string signmessage(const std::string& message, const std::string& publickey, const std::string& password);
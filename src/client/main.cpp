@@ -117,6 +117,62 @@ int main(int argc, char* argv[]) {
                 #endif
                     std::cout << "Failed to start ckd" << std::endl;
                 }
+            } else if(command == "-recodedb") {
+                const std::string usage = "Usage: -recodedb [dbdir] [json|binary]";
+                if(argc == 4 + offset) {
+                    const std::string dbDir(argv[2 + offset]);
+                    const std::string format(argv[3 + offset]);
+
+                    std::shared_ptr<CryptoKernel::Storage::Codec> codec;
+                    if(format == "binary") {
+                        codec.reset(new CryptoKernel::Storage::BinaryCodec());
+                    } else if(format == "json") {
+                        codec.reset(new CryptoKernel::Storage::JsonCodec());
+                    }
+
+                    // Open the database with the profile the daemon uses for it
+                    std::string section;
+                    CryptoKernel::Storage::Profile defaults;
+                    const Json::Value* dbCoin = nullptr;
+                    for(const Json::Value& coin : config["coins"]) {
+                        if(coin["blockdb"].asString() == dbDir) {
+                            section = "chainstate";
+                            defaults = CryptoKernel::Storage::Profile::chainstate();
+                        } else if(coin["peerdb"].asString() == dbDir) {
+                            section = "peers";
+                            defaults = CryptoKernel::Storage::Profile::peers();
+                        } else if(coin["walletdb"].asString() == dbDir) {
+                            section = "wallet";
+                            defaults = CryptoKernel::Storage::Profile::wallet();
+                        } else {
+                            continue;
+                        }
+                        dbCoin = &coin;
+                        break;
+                    }
+
+                    if(!codec) {
+                        std::cout << usage << std::endl;
+                    } else if(!dbCoin) {
+                        std::cout << "No coin in config.json uses the database " << dbDir << std::endl;
+                    } else if(section == "chainstate" && format == "json") {
+                        // The blockchain reopens it with a BinaryCodec
+                        std::cout << "The chainstate is always stored as binary" << std::endl;
+                    } else {
+                        try {
+                            CryptoKernel::Storage::Profile profile =
+                                CryptoKernel::MulticoinLoader::getStorageProfile(section, defaults,
+                                                                                 config, *dbCoin);
+                            profile.sync = true;
+                            CryptoKernel::Storage db(dbDir, profile, codec);
+                            std::cout << "Recoded " << db.recode() << " values" << std::endl;
+                        } catch(const std::exception& e) {
+                            std::cout << "Failed to recode " << dbDir << ": " << e.what() << std::endl;
+                        }
+                    }
+                } else {
+                    std::cout << usage << std::endl;
+                }
             } else if(command == "getinfo") {
                 std::cout << client.getinfo().toStyledString() << std::endl;
             } else if(command == "account") {
@@ -179,6 +235,10 @@ int main(int argc, char* argv[]) {
                 }
             } else if(command == "getpeerinfo") {
                 std::cout << client.getpeerinfo() << std::endl;
+            } else if(command == "getstorageinfo") {
+                std::cout << client.getstorageinfo().toStyledString() << std::endl;
+            } else if(command == "rescanmempool") {
+                std::cout << client.rescanmempool().toStyledString() << std::endl;
             } else if(command == "gettransaction") {
                 if(argc == 3 + offset) {
                     std::cout << client.gettransaction(std::string(argv[2 + offset])).toStyledString() << std::endl;
@@ -195,7 +255,8 @@ int main(int argc, char* argv[]) {
                 }
             } else {
                 std::cout << "CryptoKernel - Blockchain Development Toolkit - v" << version << "\n\n"
-                          << "[-p [port]]\n\n"
+                          << "[-p [port]]\n"
+                          << "[-recodedb [dbdir] [json|binary]]\n\n"
                           << "account [accountname]\n"
                           << "compilecontract [code]\n"
                           << "dumpprivkeys [accountname]\n"
@@ -203,11 +264,13 @@ int main(int argc, char* argv[]) {
                           << "getblockbyheight [height]\n"
                           << "getinfo\n"
                           << "getpeerinfo\n"
+                          << "getstorageinfo\n"
                           << "gettransaction [id]\n"
                           << "importprivkey [accountname] [privkey]\n"
                           << "listaccounts\n"
                           << "listtransactions\n"
                           << "listunspentoutputs [accountname]\n"
+                          << "rescanmempool\n"
                           << "sendtoaddress [address] [amount]\n"
                           << "stop\n";
             }
@@ -29,7 +29,12 @@ CryptoKernel::MulticoinLoader::MulticoinLoader(const std::string& configFile,
         newCoin->blockchain.reset(new DynamicBlockchain(log,
                                                         coin["blockdb"].asString(),
                                                         coinbaseOwnerFunc,
-                                                        subsidyFunc));
+                                                        subsidyFunc,
+                                                        getStorageProfile("chainstate",
+                                                                          Storage::Profile::chainstate(),
+                                                                          config, coin),
+                                                        getCoinsCacheSize(config, coin),
+                                                        getMempoolMaxUsage(config, coin)));
 
         newCoin->consensusAlgo = getConsensusAlgo(coin["consensus"]["type"].asString(),
                                                   coin["consensus"]["params"],
@@ -43,13 +48,19 @@ CryptoKernel::MulticoinLoader::MulticoinLoader(const std::string& configFile,
 
         newCoin->network.reset(new Network(log, newCoin->blockchain.get(),
                                            coin["port"].asUInt(),
-                                           coin["peerdb"].asString()));
+                                           coin["peerdb"].asString(),
+                                           getStorageProfile("peers",
+                                                             Storage::Profile::peers(),
+                                                             config, coin)));
 
         if(!coin["walletdb"].empty()) {
             newCoin->wallet.reset(new Wallet(newCoin->blockchain.get(),
                                             newCoin->network.get(),
                                             log,
-                                            coin["walletdb"].asString()));
+                                            coin["walletdb"].asString(),
+                                            getStorageProfile("wallet",
+                                                              Storage::Profile::wallet(),
+                                                              config, coin)));
         }
 
         newCoin->httpserver.reset(new jsonrpc::HttpServerLocal(coin["rpcport"].asUInt(),
@@ -99,6 +110,46 @@ std::function<uint64_t(const uint64_t)> CryptoKernel::MulticoinLoader::getSubsid
     }
 }
 
+CryptoKernel::Storage::Profile CryptoKernel::MulticoinLoader::getStorageProfile(
+                                  const std::string& name,
+                                  const Storage::Profile& defaults,
+                                  const Json::Value& config,
+                                  const Json::Value& coin) {
+    // Coin specific settings take precedence over the shared ones
+    return defaults.override(config["storage"][name]).override(coin["storage"][name]);
+}
+
+uint64_t CryptoKernel::MulticoinLoader::getCoinsCacheSize(const Json::Value& config,
+                                                         const Json::Value& coin) const {
+    // Set alongside the chainstate's storage profile
+    for(const Json::Value* settings : {&coin, &config}) {
+        const Json::Value& size = (*settings)["storage"]["chainstate"]["coinsCacheSize"];
+        if(!size.isNull()) {
+            if(!size.isUInt64()) {
+                throw std::runtime_error("coinsCacheSize must be a number of bytes");
+            }
+            return size.asUInt64();
+        }
+    }
+
+    return Blockchain::defaultCoinsCacheSize;
+}
+
+uint64_t CryptoKernel::MulticoinLoader::getMempoolMaxUsage(const Json::Value& config,
+                                                          const Json::Value& coin) const {
+    for(const Json::Value* settings : {&coin, &config}) {
+        const Json::Value& size = (*settings)["mempool"]["maxUsage"];
+        if(!size.isNull()) {
+            if(!size.isUInt64()) {
+                throw std::runtime_error("mempool maxUsage must be a number of bytes");
+            }
+            return size.asUInt64();
+        }
+    }
+
+    return Blockchain::defaultMempoolMaxUsage;
+}
+
 std::unique_ptr<CryptoKernel::Consensus> CryptoKernel::MulticoinLoader::getConsensusAlgo(
                                          const std::string& name,
                                          const Json::Value& params,
@@ -120,8 +171,11 @@ CryptoKernel::MulticoinLoader::
 DynamicBlockchain::DynamicBlockchain(Log* GlobalLog,
                                      const std::string& dbDir,
                                      std::function<std::string(const std::string&)> getCoinbaseOwnerFunc,
-                                     std::function<uint64_t(const uint64_t)> getBlockRewardFunc) :
-CryptoKernel::Blockchain(GlobalLog, dbDir) {
+                                     std::function<uint64_t(const uint64_t)> getBlockRewardFunc,
+                                     const Storage::Profile& storageProfile,
+                                     const uint64_t coinsCacheSize,
+                                     const uint64_t mempoolMaxUsage) :
+CryptoKernel::Blockchain(GlobalLog, dbDir, storageProfile, coinsCacheSize, mempoolMaxUsage) {
     this->getCoinbaseOwnerFunc = getCoinbaseOwnerFunc;
     this->getBlockRewardFunc = getBlockRewardFunc;
 }
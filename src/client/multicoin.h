@@ -18,6 +18,13 @@ namespace CryptoKernel {
                             bool* running);
             ~MulticoinLoader();
 
+            // The profile for the coin's database in the given section of
+            // the storage config, "chainstate", "peers" or "wallet"
+            static Storage::Profile getStorageProfile(const std::string& name,
+                                                      const Storage::Profile& defaults,
+                                                      const Json::Value& config,
+                                                      const Json::Value& coin);
+
         private:
             struct Coin {
                 std::string name;
@@ -35,6 +42,10 @@ namespace CryptoKernel {
 
             std::function<uint64_t(const uint64_t)> getSubsidyFunc(const std::string& name) const;
 
+            uint64_t getCoinsCacheSize(const Json::Value& config, const Json::Value& coin) const;
+
+            uint64_t getMempoolMaxUsage(const Json::Value& config, const Json::Value& coin) const;
+
             std::unique_ptr<Consensus> getConsensusAlgo(const std::string& name,
                                                         const Json::Value& params,
                                                         const Json::Value& config,
@@ -45,7 +56,10 @@ namespace CryptoKernel {
                     DynamicBlockchain(Log* GlobalLog,
                                       const std::string& dbDir,
                                       std::function<std::string(const std::string&)> getCoinbaseOwnerFunc,
-                                      std::function<uint64_t(const uint64_t)> getBlockRewardFunc);
+                                      std::function<uint64_t(const uint64_t)> getBlockRewardFunc,
+                                      const Storage::Profile& storageProfile,
+                                      const uint64_t coinsCacheSize,
+                                      const uint64_t mempoolMaxUsage);
 
                 private:
                     virtual std::string getCoinbaseOwner(const std::string& publicKey);
@@ -63,6 +63,13 @@ Json::Value CryptoServer::getinfo() {
 
     returning["mempool"]["size"] = buffer.str();
 
+    const Json::Value mempoolInfo = blockchain->getMempoolInfo();
+    returning["mempool"]["usage"] = mempoolInfo["usage"];
+    returning["mempool"]["maxUsage"] = mempoolInfo["maxUsage"];
+    returning["mempool"]["evictions"] = mempoolInfo["evictions"];
+    returning["mempool"]["minFeeRate"] = mempoolInfo["minFeeRate"];
+    returning["signatureCache"] = blockchain->getSignatureCacheInfo();
+
     return returning;
 }
 
@@ -353,6 +360,27 @@ Json::Value CryptoServer::getpeerinfo() {
     return returning;
 }
 
+Json::Value CryptoServer::getstorageinfo() {
+    Json::Value returning;
+
+    returning["chainstate"] = blockchain->getStorageInfo();
+    returning["peers"] = network->getStorageInfo();
+    if(wallet != nullptr) {
+        returning["wallet"] = wallet->getStorageInfo();
+    }
+
+    return returning;
+}
+
+Json::Value CryptoServer::rescanmempool() {
+    Json::Value returning;
+
+    returning["evicted"] = blockchain->rescanMempool();
+    returning["count"] = blockchain->mempoolCount();
+
+    return returning;
+}
+
 Json::Value CryptoServer::dumpprivkeys(const std::string& account,
                                        const std::string& password) {
     Json::Value returning;
@@ -377,7 +405,7 @@ Json::Value CryptoServer::dumpprivkeys(const std::string& account,
 }
 
 std::string CryptoServer::getoutputsetid(const Json::Value& outputs) {
-    std::set<CryptoKernel::BigNum> outputIds;
+    std::set<CryptoKernel::uint256> outputIds;
     for(const auto& out : outputs) {
         outputIds.insert(CryptoKernel::Blockchain::output(out).getId());
     }
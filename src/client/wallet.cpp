@@ -24,12 +24,13 @@
 CryptoKernel::Wallet::Wallet(CryptoKernel::Blockchain* blockchain,
                              CryptoKernel::Network* network,
                              CryptoKernel::Log* log,
-                             const std::string& dbDir) {
+                             const std::string& dbDir,
+                             const Storage::Profile& storageProfile) {
     this->blockchain = blockchain;
     this->network = network;
     this->log = log;
 
-    walletdb.reset(new CryptoKernel::Storage(dbDir, true, 8, false));
+    walletdb.reset(new CryptoKernel::Storage(dbDir, storageProfile));
     accounts.reset(new CryptoKernel::Storage::Table("accounts"));
     utxos.reset(new CryptoKernel::Storage::Table("utxos"));
     transactions.reset(new CryptoKernel::Storage::Table("transactions"));
@@ -716,6 +717,10 @@ std::string CryptoKernel::Wallet::sendToAddress(const std::string& pubKey,
     return tx.getId().toString();
 }
 
+Json::Value CryptoKernel::Wallet::getStorageInfo() {
+    return walletdb->getProperties();
+}
+
 uint64_t CryptoKernel::Wallet::getTotalBalance() {
     std::lock_guard<std::recursive_mutex> lock(walletLock);
     std::unique_ptr<CryptoKernel::Storage::Table::Iterator> it(new
@@ -723,10 +728,13 @@ uint64_t CryptoKernel::Wallet::getTotalBalance() {
 
     uint64_t total = 0;
 
-    for(it->SeekToFirst(); it->Valid(); it->Next()) {
-        const Txo utxo = Txo(it->value());
-        if(!utxo.isSpent()) {
-            total += utxo.getValue();
+    it->SeekToFirst();
+    for(auto batch = it->nextBatch(1000); !batch.empty(); batch = it->nextBatch(1000)) {
+        for(const auto& entry : batch) {
+            const Txo utxo = Txo(entry.second);
+            if(!utxo.isSpent()) {
+                total += utxo.getValue();
+            }
         }
     }
 
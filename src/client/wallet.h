@@ -41,7 +41,8 @@ public:
     Wallet(CryptoKernel::Blockchain* blockchain,
            CryptoKernel::Network* network,
            CryptoKernel::Log* log,
-           const std::string& dbDir);
+           const std::string& dbDir,
+           const Storage::Profile& storageProfile = Storage::Profile::wallet());
 
     ~Wallet();
 
@@ -136,6 +137,8 @@ public:
                             const std::string& publicKey,
                             const std::string& password);
 
+    Json::Value getStorageInfo();
+
 private:
     std::unique_ptr<CryptoKernel::Storage> walletdb;
     std::unique_ptr<CryptoKernel::Storage::Table> accounts;
@@ -23,7 +23,6 @@
 #include <fstream>
 #include <math.h>
 #include <random>
-#include <thread>
 
 #include "blockchain.h"
 #include "crypto.h"
@@ -33,26 +32,46 @@
 #include "merkletree.h"
 
 CryptoKernel::Blockchain::Blockchain(CryptoKernel::Log* GlobalLog,
-                                     const std::string& dbDir) {
+                                     const std::string& dbDir,
+                                     const Storage::Profile& storageProfile,
+                                     const uint64_t coinsCacheSize,
+                                     const uint64_t mempoolMaxUsage) {
     status = false;
     this->dbDir = dbDir;
-    blockdb.reset(new CryptoKernel::Storage(dbDir, false, 20, true));
-    blocks.reset(new CryptoKernel::Storage::Table("blocks"));
-    transactions.reset(new CryptoKernel::Storage::Table("transactions"));
-    utxos.reset(new CryptoKernel::Storage::Table("utxos"));
-    stxos.reset(new CryptoKernel::Storage::Table("stxos"));
-    inputs.reset(new CryptoKernel::Storage::Table("inputs"));
-    candidates.reset(new CryptoKernel::Storage::Table("candidates"));
+    this->storageProfile = storageProfile;
+    blockReadStats = Storage::Transaction::ReadStats{0, 0};
+    blockVerifyStats = VerifyStats{0, 0, 0, 0};
+    verifyPool.reset(new ThreadPool());
+    openDB();
+    blocks.reset(new CryptoKernel::Storage::Table("blocks", 1));
+    transactions.reset(new CryptoKernel::Storage::Table("transactions", 2));
+    utxos.reset(new CryptoKernel::Storage::Table("utxos", 3));
+    stxos.reset(new CryptoKernel::Storage::Table("stxos", 4));
+    inputs.reset(new CryptoKernel::Storage::Table("inputs", 5));
+    candidates.reset(new CryptoKernel::Storage::Table("candidates", 6));
+    undo.reset(new CryptoKernel::Storage::Table("undo", 7));
+    blockPositions.reset(new CryptoKernel::Storage::Table("blockPositions", 9));
+    coins.reset(new CoinsCache(this, coinsCacheSize));
+    blockIndex.reset(new BlockIndex(this));
+    sigCache.reset(new SignatureCache(SignatureCache::defaultMaxEntries));
+    unconfirmedTransactions.setMaxUsage(mempoolMaxUsage);
     log = GlobalLog;
 }
 
 bool CryptoKernel::Blockchain::loadChain(CryptoKernel::Consensus* consensus,
                                          const std::string& genesisBlockFile) {
     this->consensus = consensus;
+    upgradeKeys();
     std::unique_ptr<Storage::Transaction> dbTransaction(blockdb->begin());
     const bool tipExists = blocks->get(dbTransaction.get(), "tip").isObject();
     dbTransaction->abort();
-    if(!tipExists) {
+    if(tipExists) {
+        {
+            std::unique_ptr<Storage::Transaction> dbTx(blockdb->beginReadOnly());
+            blockIndex->load(dbTx.get());
+        }
+        replayCoins();
+    } else {
         emptyDB();
         bool newGenesisBlock = false;
         std::ifstream t(genesisBlockFile);
@@ -93,13 +112,69 @@ bool CryptoKernel::Blockchain::loadChain(CryptoKernel::Consensus* consensus,
     const block genesisBlock = getBlockByHeight(1);
     genesisBlockId = genesisBlock.getId();
 
+    {
+        std::lock_guard<std::mutex> lock(mempoolMutex);
+        unconfirmedTransactions.setTip(getBlockDB("tip").getId());
+    }
+
+    loadMempool();
+
     status = true;
 
     return true;
 }
 
 CryptoKernel::Blockchain::~Blockchain() {
+    if(status) {
+        try {
+            std::unique_ptr<Storage::Transaction> dbTx(blockdb->begin());
+            CoinsCache::Batch coinsBatch(coins.get(), dbTx.get());
+            coinsBatch.commit(true);
+        } catch(const std::exception& e) {
+            log->printf(LOG_LEVEL_ERR, "blockchain::~Blockchain(): Failed to flush the coins cache: " +
+                        std::string(e.what()));
+        }
+
+        try {
+            saveMempool();
+        } catch(const std::exception& e) {
+            log->printf(LOG_LEVEL_ERR, "blockchain::~Blockchain(): Failed to save the mempool: " +
+                        std::string(e.what()));
+        }
+    }
+}
+
+void CryptoKernel::Blockchain::replayCoins() {
+    std::unique_ptr<Storage::Transaction> dbTx(blockdb->begin());
+    CoinsCache::Batch coinsBatch(coins.get(), dbTx.get());
+
+    // Databases written before the coins cache have no marker and are current
+    const Json::Value coinsTip = blocks->get(dbTx.get(), "coinstip");
+    std::stack<block> replay;
+    if(coinsTip.isString()) {
+        uint256 id = getBlockDB(dbTx.get(), "tip").getId();
+        while(id.toString() != coinsTip.asString()) {
+            const block Block = getBlock(dbTx.get(), id.toString());
+            replay.push(Block);
+            id = Block.getPreviousBlockId();
+        }
+    }
+
+    if(!replay.empty()) {
+        log->printf(LOG_LEVEL_INFO, "blockchain::replayCoins(): Replaying the spends of " +
+                    std::to_string(replay.size()) + " blocks");
+    }
+
+    while(!replay.empty()) {
+        for(const transaction& tx : replay.top().getTransactions()) {
+            for(const input& inp : tx.getInputs()) {
+                coins->spend(dbTx.get(), inp.getOutputId().toString());
+            }
+        }
+        replay.pop();
+    }
 
+    coinsBatch.commit(true);
 }
 
 std::set<CryptoKernel::Blockchain::transaction>
@@ -113,6 +188,14 @@ CryptoKernel::Blockchain::getUnconfirmedTransactions() {
 
 CryptoKernel::Blockchain::dbBlock CryptoKernel::Blockchain::getBlockDB(
     Storage::Transaction* transaction, const std::string& id, const bool mainChain) {
+    // Snapshot readers are answered from the tables as of their snapshot
+    if(id == "tip" && transaction->snapshot == nullptr) {
+        const std::shared_ptr<const dbBlock> tip = blockIndex->getTip(transaction);
+        if(tip) {
+            return *tip;
+        }
+    }
+
     Json::Value jsonBlock = blocks->get(transaction, id);
     if(!jsonBlock.isObject()) {
         // Check if it's an orphan
@@ -129,6 +212,13 @@ CryptoKernel::Blockchain::dbBlock CryptoKernel::Blockchain::getBlockDB(
 
 CryptoKernel::Blockchain::dbBlock CryptoKernel::Blockchain::getBlockDB(
     const std::string& id) {
+    if(id == "tip") {
+        const std::shared_ptr<const dbBlock> tip = blockIndex->getTip(nullptr);
+        if(tip) {
+            return *tip;
+        }
+    }
+
     std::unique_ptr<Storage::Transaction> tx(blockdb->beginReadOnly());
 
     return getBlockDB(tx.get(), id);
@@ -141,18 +231,157 @@ CryptoKernel::Blockchain::block CryptoKernel::Blockchain::getBlock(
     return buildBlock(transaction, block);
 }
 
+namespace {
+    // A transaction as kept in blockStore, with its id and the ids of its puts
+    Json::Value storedTransaction(const CryptoKernel::Blockchain::transaction& tx) {
+        Json::Value returning = tx.toJson();
+        returning["id"] = tx.getId().toString();
+
+        Json::ArrayIndex i = 0;
+        for(const CryptoKernel::Blockchain::input& inp : tx.getInputs()) {
+            returning["inputs"][i++]["id"] = inp.getId().toString();
+        }
+
+        i = 0;
+        for(const CryptoKernel::Blockchain::output& out : tx.getOutputs()) {
+            returning["outputs"][i++]["id"] = out.getId().toString();
+        }
+
+        return returning;
+    }
+
+    CryptoKernel::Blockchain::transaction loadTransaction(const Json::Value& stored) {
+        std::set<CryptoKernel::Blockchain::input> inputs;
+        for(const Json::Value& inp : stored["inputs"]) {
+            inputs.emplace_hint(inputs.end(), inp, CryptoKernel::uint256(inp["id"].asString()));
+        }
+
+        std::set<CryptoKernel::Blockchain::output> outputs;
+        for(const Json::Value& out : stored["outputs"]) {
+            outputs.emplace_hint(outputs.end(), out, CryptoKernel::uint256(out["id"].asString()));
+        }
+
+        return CryptoKernel::Blockchain::transaction(inputs, outputs, stored["timestamp"].asUInt64(),
+                CryptoKernel::uint256(stored["id"].asString()));
+    }
+
+    Json::Value positionJson(const CryptoKernel::BlockStore::Position& position) {
+        Json::Value returning;
+        returning["file"] = position.file;
+        returning["offset"] = Json::UInt64(position.offset);
+        returning["length"] = Json::UInt64(position.length);
+        return returning;
+    }
+
+    CryptoKernel::BlockStore::Position loadPosition(const Json::Value& position) {
+        CryptoKernel::BlockStore::Position returning;
+        returning.file = position["file"].asUInt();
+        returning.offset = position["offset"].asUInt64();
+        returning.length = position["length"].asUInt64();
+        return returning;
+    }
+
+    // A block body is its transactions in block order, each a little-endian
+    // 32-bit length followed by its binary encoding
+    void appendRecord(std::string& body, const std::string& record) {
+        const uint32_t length = record.size();
+        for(unsigned int i = 0; i < 4; i++) {
+            body.push_back(char((length >> (8 * i)) & 0xff));
+        }
+        body += record;
+    }
+}
+
+CryptoKernel::BlockStore::Position CryptoKernel::Blockchain::writeBody(Storage::Transaction* dbTx,
+        const uint256& id, const std::string& body) {
+    // A block reversed from the main chain keeps its position
+    const Json::Value stored = blockPositions->get(dbTx, id.toString());
+    if(stored.isObject() && stored["length"].asUInt64() == body.size()) {
+        return loadPosition(stored);
+    }
+
+    std::lock_guard<std::mutex> lock(appendedBodiesMutex);
+    const auto it = appendedBodies.find(id);
+    if(it != appendedBodies.end() && it->second.length == body.size()) {
+        return it->second;
+    }
+
+    const BlockStore::Position position = blockStore->append(body);
+    appendedBodies[id] = position;
+    return position;
+}
+
+void CryptoKernel::Blockchain::forgetCommittedBodies() {
+    std::lock_guard<std::mutex> lock(appendedBodiesMutex);
+    if(appendedBodies.empty()) {
+        return;
+    }
+
+    std::unique_ptr<Storage::Transaction> dbTx(blockdb->beginReadOnly());
+    for(auto it = appendedBodies.begin(); it != appendedBodies.end();) {
+        if(blockPositions->get(dbTx.get(), it->first.toString()).isObject()) {
+            it = appendedBodies.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+std::vector<Json::Value> CryptoKernel::Blockchain::getBlockTransactions(
+    Storage::Transaction* dbTx, const dbBlock& dbblock) {
+    std::vector<Json::Value> returning;
+
+    // Blocks connected before blockStore existed have no body there
+    const Json::Value position = blockPositions->get(dbTx, dbblock.getId().toString());
+    if(!position.isObject()) {
+        return returning;
+    }
+
+    const std::string body = blockStore->read(loadPosition(position));
+    size_t pos = 0;
+    while(pos + 4 <= body.size()) {
+        uint32_t length = 0;
+        for(unsigned int i = 0; i < 4; i++) {
+            length |= uint32_t(static_cast<unsigned char>(body[pos + i])) << (8 * i);
+        }
+        pos += 4;
+
+        if(length > body.size() - pos) {
+            break;
+        }
+
+        returning.push_back(Storage::fromBinary(body.substr(pos, length)));
+        pos += length;
+    }
+
+    if(pos != body.size() || returning.size() != dbblock.getTransactions().size() + 1) {
+        throw std::runtime_error("Body of block " + dbblock.getId().toString() + " is malformed");
+    }
+
+    return returning;
+}
+
 CryptoKernel::Blockchain::block CryptoKernel::Blockchain::buildBlock(
     Storage::Transaction* dbTx, const dbBlock& dbblock) {
+    const std::vector<Json::Value> stored = getBlockTransactions(dbTx, dbblock);
+    if(!stored.empty()) {
+        std::set<transaction> transactions;
+        for(auto it = stored.begin() + 1; it != stored.end(); it++) {
+            transactions.insert(transactions.end(), loadTransaction(*it));
+        }
+
+        return block(transactions, loadTransaction(stored.front()), dbblock);
+    }
+
     std::set<transaction> transactions;
 
     try {
-        for(const BigNum& txid : dbblock.getTransactions()) {
+        for(const uint256& txid : dbblock.getTransactions()) {
             transactions.insert(getTransaction(dbTx, txid.toString()));
         }
 
         return block(transactions, getTransaction(dbTx, dbblock.getCoinbaseTx().toString()),
-                    dbblock.getPreviousBlockId(), dbblock.getTimestamp(), dbblock.getConsensusData(),
-                    dbblock.getHeight());
+                     dbblock);
     } catch(const NotFoundException& e) {
         const Json::Value jsonBlock = candidates->get(dbTx, dbblock.getId().toString());
         if(jsonBlock.isObject()) {
@@ -165,13 +394,13 @@ CryptoKernel::Blockchain::block CryptoKernel::Blockchain::buildBlock(
 
 CryptoKernel::Blockchain::block CryptoKernel::Blockchain::getBlockByHeight(
     Storage::Transaction* transaction, const uint64_t height) {
-    const std::string id = blocks->get(transaction, std::to_string(height), 0).asString();
+    const std::string id = blocks->get(transaction, Storage::Key().append(height), 0).asString();
     return getBlock(transaction, id);
 }
 
 CryptoKernel::Blockchain::dbBlock CryptoKernel::Blockchain::getBlockByHeightDB(
     Storage::Transaction* transaction, const uint64_t height) {
-    const std::string id = blocks->get(transaction, std::to_string(height), 0).asString();
+    const std::string id = blocks->get(transaction, Storage::Key().append(height), 0).asString();
     return getBlockDB(transaction, id);
 }
 
@@ -201,28 +430,27 @@ CryptoKernel::Blockchain::output CryptoKernel::Blockchain::getOutput(
 
 CryptoKernel::Blockchain::output CryptoKernel::Blockchain::getOutput(
     Storage::Transaction* dbTx, const std::string& id) {
-    Json::Value outputJson = utxos->get(dbTx, id);
-    if(!outputJson.isObject()) {
-        outputJson = stxos->get(dbTx, id);
-        if(!outputJson.isObject()) {
-            throw NotFoundException("Output " + id);
-        }
-    }
-
-    return output(outputJson);
+    return getOutputDB(dbTx, id);
 }
 
 CryptoKernel::Blockchain::dbOutput CryptoKernel::Blockchain::getOutputDB(
     Storage::Transaction* dbTx, const std::string& id) {
-    Json::Value outputJson = utxos->get(dbTx, id);
-    if(!outputJson.isObject()) {
-        outputJson = stxos->get(dbTx, id);
-        if(!outputJson.isObject()) {
-            throw NotFoundException("Output " + id);
-        }
+    CoinsCache::Coin coin;
+    if(!coins->get(dbTx, id, coin)) {
+        throw NotFoundException("Output " + id);
+    }
+
+    return *coin.output;
+}
+
+std::shared_ptr<const CryptoKernel::Blockchain::dbOutput>
+CryptoKernel::Blockchain::getUnspentOutput(Storage::Transaction* dbTx, const std::string& id) {
+    CoinsCache::Coin coin;
+    if(!coins->get(dbTx, id, coin) || coin.spent) {
+        return nullptr;
     }
 
-    return dbOutput(outputJson);
+    return coin.output;
 }
 
 CryptoKernel::Blockchain::input CryptoKernel::Blockchain::getInput(
@@ -232,49 +460,76 @@ CryptoKernel::Blockchain::input CryptoKernel::Blockchain::getInput(
         throw NotFoundException("Input " + id);
     }
 
-    return input(inputJson);
+    return input(inputJson, uint256(id));
 }
 
 std::tuple<bool, bool> CryptoKernel::Blockchain::verifyTransaction(Storage::Transaction* dbTransaction,
         const transaction& tx, const bool coinbaseTx) {
+    std::vector<std::shared_ptr<const dbOutput>> spentOutputs;
+    const auto stateResult = verifyTransactionState(dbTransaction, tx, spentOutputs);
+    if(!std::get<0>(stateResult)) {
+        return stateResult;
+    }
+
+    return verifyTransactionRules(dbTransaction, tx, spentOutputs, coinbaseTx);
+}
+
+std::tuple<bool, bool> CryptoKernel::Blockchain::verifyTransactionState(
+        Storage::Transaction* dbTransaction, const transaction& tx,
+        std::vector<std::shared_ptr<const dbOutput>>& spentOutputs) {
     if(transactions->get(dbTransaction, tx.getId().toString()).isObject()) {
         log->printf(LOG_LEVEL_INFO, "blockchain::verifyTransaction(): tx already exists");
         return std::make_tuple(false, false);
     }
 
-    uint64_t inputTotal = 0;
-    uint64_t outputTotal = 0;
-
     for(const output& out : tx.getOutputs()) {
-        if(utxos->get(dbTransaction, out.getId().toString()).isObject() ||
-                stxos->get(dbTransaction, out.getId().toString()).isObject()) {
+        CoinsCache::Coin existing;
+        if(coins->get(dbTransaction, out.getId().toString(), existing)) {
             log->printf(LOG_LEVEL_INFO, "blockchain::verifyTransaction(): Output already exists");
             //Duplicate output
             return std::make_tuple(false, false);
         }
-
-        outputTotal += out.getValue();
     }
 
-    const CryptoKernel::BigNum outputHash = tx.getOutputSetId();
-
-    std::set<dbOutput> maybeAggregated;
-
+    spentOutputs.clear();
     for(const input& inp : tx.getInputs()) {
-        const Json::Value outJson = utxos->get(dbTransaction, inp.getOutputId().toString());
-        if(!outJson.isObject()) {
+        const auto unspent = getUnspentOutput(dbTransaction, inp.getOutputId().toString());
+        if(!unspent) {
             log->printf(LOG_LEVEL_INFO,
                         "blockchain::verifyTransaction(): Output has already been spent");
             return std::make_tuple(false, false);
         }
 
-        const dbOutput out = dbOutput(outJson);
+        spentOutputs.push_back(unspent);
+    }
+
+    return std::make_tuple(true, false);
+}
+
+std::tuple<bool, bool> CryptoKernel::Blockchain::verifyTransactionRules(
+        Storage::Transaction* dbTransaction, const transaction& tx,
+        const std::vector<std::shared_ptr<const dbOutput>>& spentOutputs,
+        const bool coinbaseTx) {
+    uint64_t inputTotal = 0;
+    uint64_t outputTotal = 0;
+
+    for(const output& out : tx.getOutputs()) {
+        outputTotal += out.getValue();
+    }
+
+    const CryptoKernel::uint256 outputHash = tx.getOutputSetId();
+
+    std::set<dbOutput> maybeAggregated;
+
+    auto spent = spentOutputs.begin();
+    for(const input& inp : tx.getInputs()) {
+        const dbOutput& out = **spent++;
         inputTotal += out.getValue();
 
-        const Json::Value outData = out.getData();
+        const Json::Value& outData = out.getData();
 
         if(!outData["schnorrKey"].empty() && outData["contract"].empty()) {
-            const Json::Value spendData = inp.getData();
+            const Json::Value& spendData = inp.getData();
             if(spendData["signature"].empty() || !spendData["signature"].isString()) {
                 maybeAggregated.emplace(out);
             }
@@ -283,18 +538,24 @@ std::tuple<bool, bool> CryptoKernel::Blockchain::verifyTransaction(Storage::Tran
                 log->printf(LOG_LEVEL_WARN, "blockchain::verifyTransaction(): Output has a malformed schnorr key, not checking its signature");
                 maybeAggregated.erase(out);
             } else if(spendData["signature"].isString()) {
-                CryptoKernel::Schnorr schnorr;
-                if(!schnorr.setPublicKey(outData["schnorrKey"].asString())) {
-                    log->printf(LOG_LEVEL_INFO,
-                                "blockchain::verifyTransaction(): Schnorr key is malformed");
-                    return std::make_tuple(false, true);
-                }
-
-                if(!schnorr.verify(out.getId().toString() + outputHash.toString(),
-                                spendData["signature"].asString())) {
-                    log->printf(LOG_LEVEL_INFO,
-                                "blockchain::verifyTransaction(): Could not verify input signature");
-                    return std::make_tuple(false, true);
+                const std::string message = out.getId().toString() + outputHash.toString();
+                if(!sigCache->contains("schnorr", outData["schnorrKey"].asString(), message,
+                                       spendData["signature"].asString())) {
+                    CryptoKernel::Schnorr schnorr;
+                    if(!schnorr.setPublicKey(outData["schnorrKey"].asString())) {
+                        log->printf(LOG_LEVEL_INFO,
+                                    "blockchain::verifyTransaction(): Schnorr key is malformed");
+                        return std::make_tuple(false, true);
+                    }
+
+                    if(!schnorr.verify(message, spendData["signature"].asString())) {
+                        log->printf(LOG_LEVEL_INFO,
+                                    "blockchain::verifyTransaction(): Could not verify input signature");
+                        return std::make_tuple(false, true);
+                    }
+
+                    sigCache->insert("schnorr", outData["schnorrKey"].asString(), message,
+                                     spendData["signature"].asString());
                 }
             }
         }
@@ -303,7 +564,7 @@ std::tuple<bool, bool> CryptoKernel::Blockchain::verifyTransaction(Storage::Tran
         // If the scripthash/keyhash is contained in the merkle tree, it's considered a
         // valid spend.
         if(!outData["merkleRoot"].empty() && outData["contract"].empty()) {
-            const Json::Value spendData = inp.getData();
+            const Json::Value& spendData = inp.getData();
             
             // Common sense checks
             if(!spendData["spendType"].isString()) {
@@ -342,8 +603,8 @@ std::tuple<bool, bool> CryptoKernel::Blockchain::verifyTransaction(Storage::Tran
             }
 
             // Verify if the spending script/pubkey hash is the first item in the proof
-            const BigNum& proofValue = proof->leaves.at(0);
-            const BigNum& spendValue = CryptoKernel::BigNum(CryptoKernel::Crypto::sha256(spendData["pubKeyOrScript"].asString()));
+            const uint256& proofValue = proof->leaves.at(0);
+            const uint256& spendValue = CryptoKernel::uint256(CryptoKernel::Crypto::sha256(spendData["pubKeyOrScript"].asString()));
             if(proofValue != spendValue) {
                 log->printf(LOG_LEVEL_INFO,
                             "blockchain::verifyTransaction(): Merkle proof does not start with the spending script or pubkey's hash");
@@ -370,10 +631,9 @@ std::tuple<bool, bool> CryptoKernel::Blockchain::verifyTransaction(Storage::Tran
                 // Verify if the signature is valid for the given pubkey
                 // We already checked that that pub key is allowed to spend
                 // the input by the checks above.
-                CryptoKernel::Crypto crypto;
-                crypto.setPublicKey(spendData["pubKeyOrScript"].asString());
-                if(!crypto.verify(out.getId().toString() + outputHash.toString(),
-                                spendData["signature"].asString())) {
+                if(!verifySignature(spendData["pubKeyOrScript"].asString(),
+                                    out.getId().toString() + outputHash.toString(),
+                                    spendData["signature"].asString())) {
                     log->printf(LOG_LEVEL_INFO,
                                 "blockchain::verifyTransaction(): Could not verify input signature for p2mr output");
                     return std::make_tuple(false, true);
@@ -387,17 +647,16 @@ std::tuple<bool, bool> CryptoKernel::Blockchain::verifyTransaction(Storage::Tran
         }
 
         if(!outData["publicKey"].empty() && outData["contract"].empty()) {
-            const Json::Value spendData = inp.getData();
+            const Json::Value& spendData = inp.getData();
             if(spendData["signature"].empty() || !spendData["signature"].isString()) {
                 log->printf(LOG_LEVEL_INFO,
                             "blockchain::verifyTransaction(): Could not verify input signature");
                 return std::make_tuple(false, true);
             }
 
-            CryptoKernel::Crypto crypto;
-            crypto.setPublicKey(outData["publicKey"].asString());
-            if(!crypto.verify(out.getId().toString() + outputHash.toString(),
-                              spendData["signature"].asString())) {
+            if(!verifySignature(outData["publicKey"].asString(),
+                                out.getId().toString() + outputHash.toString(),
+                                spendData["signature"].asString())) {
                 log->printf(LOG_LEVEL_INFO,
                             "blockchain::verifyTransaction(): Could not verify input signature");
                 return std::make_tuple(false, true);
@@ -406,7 +665,7 @@ std::tuple<bool, bool> CryptoKernel::Blockchain::verifyTransaction(Storage::Tran
     }
 
     for(const input& inp : tx.getInputs()) {
-        const Json::Value spendData = inp.getData();
+        const Json::Value& spendData = inp.getData();
         if(spendData["aggregateSignature"].isObject()) {
             if(!spendData["aggregateSignature"]["signs"].isArray() || !spendData["aggregateSignature"]["signature"].isString()) {
                 log->printf(LOG_LEVEL_INFO,
@@ -432,7 +691,7 @@ std::tuple<bool, bool> CryptoKernel::Blockchain::verifyTransaction(Storage::Tran
             }
 
             std::set<std::string> pubkeys;
-            std::set<BigNum> outputIds;
+            std::set<uint256> outputIds;
             for(const auto out : signs) {
                 auto it = maybeAggregated.begin();
                 std::advance(it, out);
@@ -441,24 +700,35 @@ std::tuple<bool, bool> CryptoKernel::Blockchain::verifyTransaction(Storage::Tran
                 outputIds.emplace(it->getId());
             }
 
-            CryptoKernel::Schnorr schnorr;
-            const std::string aggregatedPubkey = schnorr.pubkeyAggregate(pubkeys);
-            if(!schnorr.setPublicKey(aggregatedPubkey)) {
-                log->printf(LOG_LEVEL_INFO,
-                            "blockchain::verifyTransaction(): Aggregate signature malformed. Aggregated pubkey is invalid");
-                return std::make_tuple(false, true);
-            }
-
             std::string signaturePayload;
             for(const auto& id : outputIds) {
                 signaturePayload += id.toString();
             }
             signaturePayload += outputHash.toString();
 
-            if(!schnorr.verify(signaturePayload, spendData["aggregateSignature"]["signature"].asString())) {
-                log->printf(LOG_LEVEL_INFO,
-                            "blockchain::verifyTransaction(): Could not verify input signature");
-                return std::make_tuple(false, true);
+            // Cached by the set of keys, which skips aggregating them again
+            std::string pubkeyList;
+            for(const auto& pubkey : pubkeys) {
+                pubkeyList += pubkey + ",";
+            }
+
+            const std::string signature = spendData["aggregateSignature"]["signature"].asString();
+            if(!sigCache->contains("schnorr-aggregate", pubkeyList, signaturePayload, signature)) {
+                CryptoKernel::Schnorr schnorr;
+                const std::string aggregatedPubkey = schnorr.pubkeyAggregate(pubkeys);
+                if(!schnorr.setPublicKey(aggregatedPubkey)) {
+                    log->printf(LOG_LEVEL_INFO,
+                                "blockchain::verifyTransaction(): Aggregate signature malformed. Aggregated pubkey is invalid");
+                    return std::make_tuple(false, true);
+                }
+
+                if(!schnorr.verify(signaturePayload, signature)) {
+                    log->printf(LOG_LEVEL_INFO,
+                                "blockchain::verifyTransaction(): Could not verify input signature");
+                    return std::make_tuple(false, true);
+                }
+
+                sigCache->insert("schnorr-aggregate", pubkeyList, signaturePayload, signature);
             }
 
             std::set<dbOutput> removals;
@@ -513,152 +783,372 @@ std::tuple<bool, bool> CryptoKernel::Blockchain::verifyTransaction(Storage::Tran
 }
 
 std::tuple<bool, bool> CryptoKernel::Blockchain::submitTransaction(const transaction& tx) {
-    std::unique_ptr<Storage::Transaction> dbTx(blockdb->begin());
-    const auto result = submitTransaction(dbTx.get(), tx);
-    if(std::get<0>(result)) {
-        dbTx->commit();
-    }
-    return result;
-}
-
-std::tuple<bool, bool> CryptoKernel::Blockchain::submitBlock(const block& newBlock, bool genesisBlock) {
-    std::unique_ptr<Storage::Transaction> dbTx(blockdb->begin());
-    const auto result = submitBlock(dbTx.get(), newBlock, genesisBlock);
-    if(std::get<0>(result)) {
-        dbTx->commit();
-    }
-    return result;
-}
-
-std::tuple<bool, bool> CryptoKernel::Blockchain::submitTransaction(Storage::Transaction* dbTx,
-        const transaction& tx) {
-	const auto verifyResult = verifyTransaction(dbTx, tx);
-    if(std::get<0>(verifyResult)) {
-        if(consensus->submitTransaction(dbTx, tx)) {
+    for(unsigned int attempt = 1; ; attempt++) {
+        std::unique_ptr<Storage::Transaction> dbTx(blockdb->begin());
+        const uint64_t coinsGeneration = coins->getGeneration();
+        uint64_t fee = 0;
+        bool scripted = false;
+        auto result = verifyMempoolTransaction(dbTx.get(), tx, fee, scripted);
+
+        bool conflict = false;
+        if(std::get<0>(result)) {
+            // Spends are made in the coins cache rather than the tables so a
+            // block connected meanwhile is not a Storage conflict. Blocks bump
+            // the generation and evict their conflicts under mempoolMutex, so
+            // checking it under the same lock as the insert cannot let a
+            // double spend in.
             std::lock_guard<std::mutex> lock(mempoolMutex);
-			if(unconfirmedTransactions.insert(tx)) {
-				log->printf(LOG_LEVEL_INFO,
-							"blockchain::submitTransaction(): Received transaction " + tx.getId().toString());
-				return std::make_tuple(true, false);
-			} else {
-				log->printf(LOG_LEVEL_INFO,
-							"blockchain::submitTransaction(): " + tx.getId().toString() + " has a mempool conflict");
-				return std::make_tuple(false, false);
-			}
-        } else {
-            log->printf(LOG_LEVEL_INFO,
-                        "blockchain::submitTransaction(): Failed to submit transaction to consensus method");
-            return std::make_tuple(false, true);
+            conflict = coins->getGeneration() != coinsGeneration;
+            if(!conflict) {
+                result = admitTransaction(tx, fee, scripted);
+            }
         }
-    } else {
-        log->printf(LOG_LEVEL_INFO,
-                    "blockchain::submitTransaction(): Failed to verify transaction");
-        return verifyResult;
-    }
-}
-
-std::tuple<bool, bool> CryptoKernel::Blockchain::submitBlock(Storage::Transaction* dbTx,
-        const block& Block, bool genesisBlock) {
-    block newBlock = Block;
-
-    const std::string idAsString = newBlock.getId().toString();
-    //Check block does not already exist
-    if(blocks->get(dbTx, idAsString).isObject()) {
-        log->printf(LOG_LEVEL_INFO, "blockchain::submitBlock(): Block is already in main chain");
-        return std::make_tuple(true, false);
-    }
-
-    Json::Value previousBlockJson = blocks->get(dbTx,
-                                    newBlock.getPreviousBlockId().toString());
-    uint64_t blockHeight = 1;
 
-    bool onlySave = false;
+        if(std::get<0>(result) && !conflict) {
+            try {
+                dbTx->commit();
+            } catch(const Storage::ConflictException& e) {
+                conflict = true;
 
-    if(!genesisBlock) {
-        if(!previousBlockJson.isObject()) {
-            previousBlockJson = candidates->get(dbTx, newBlock.getPreviousBlockId().toString());
-            if(!previousBlockJson.isObject()) {
-                log->printf(LOG_LEVEL_INFO, "blockchain::submitBlock(): Previous block does not exist");
-                return std::make_tuple(false, true);
+                std::lock_guard<std::mutex> lock(mempoolMutex);
+                unconfirmedTransactions.remove(tx);
             }
-
-            const block previousBlock = block(previousBlockJson);
-            previousBlockJson = dbBlock(previousBlock).toJson();
         }
 
-        const dbBlock previousBlock = dbBlock(previousBlockJson);
-
-        /*//Check that the timestamp is realistic
-        if(newBlock.getTimestamp() < previousBlock.getTimestamp()) {
-            log->printf(LOG_LEVEL_INFO, "blockchain::submitBlock(): Timestamp is unrealistic");
-            return std::make_tuple(false, true);
-        }*/
+        if(conflict) {
+            if(attempt < commitAttempts) {
+                log->printf(LOG_LEVEL_INFO,
+                            "blockchain::submitTransaction(): Retrying " + tx.getId().toString() +
+                            " after a write conflict");
+                continue;
+            }
 
-        if(!consensus->checkConsensusRules(dbTx, newBlock, previousBlock)) {
-            log->printf(LOG_LEVEL_INFO,
-                        "blockchain::submitBlock(): Consensus rules cannot verify this block");
-            return std::make_tuple(false, true);
+            log->printf(LOG_LEVEL_WARN,
+                        "blockchain::submitTransaction(): Gave up on " + tx.getId().toString() +
+                        " after " + std::to_string(attempt) + " write conflicts");
+            return std::make_tuple(false, false);
         }
 
-        const dbBlock tip = getBlockDB(dbTx, "tip");
-        if(previousBlock.getId() != tip.getId()) {
-            //This block does not directly lead on from last block
-            //Check if the verifier should've come before the current tip
-            //If so, reorg, otherwise ignore it
-            if(consensus->isBlockBetter(dbTx, newBlock, tip)) {
-                log->printf(LOG_LEVEL_INFO, "blockchain::submitBlock(): Forking the chain");
-                if(!reorgChain(dbTx, previousBlock.getId())) {
-                    log->printf(LOG_LEVEL_INFO, "blockchain::submitBlock(): Alternative chain is not valid");
-                    return std::make_tuple(false, true);
+        return result;
+    }
+}
+
+std::tuple<bool, bool> CryptoKernel::Blockchain::submitBlock(const block& newBlock, bool genesisBlock) {
+    std::unique_ptr<Storage::Transaction> dbTx;
+    std::tuple<bool, bool> result;
+    for(unsigned int attempt = 1; ; attempt++) {
+        dbTx.reset(blockdb->begin());
+        CoinsCache::Batch coinsBatch(coins.get(), dbTx.get());
+        // Verification reads the same blocks and transactions many times over
+        dbTx->setReadMemoization(true);
+        result = submitBlock(dbTx.get(), newBlock, genesisBlock);
+        if(std::get<0>(result)) {
+            try {
+                coinsBatch.commit(genesisBlock);
+            } catch(const Storage::ConflictException& e) {
+                if(attempt < commitAttempts) {
+                    log->printf(LOG_LEVEL_INFO,
+                                "blockchain::submitBlock(): Retrying block after a write conflict");
+                    continue;
                 }
 
-                blockHeight = getBlockDB(dbTx, "tip").getHeight() + 1;
-            } else {
                 log->printf(LOG_LEVEL_WARN,
-                            "blockchain::submitBlock(): Chain has less verifier backing than current chain");
-                blockHeight = getBlockDB(dbTx, newBlock.getPreviousBlockId().toString()).getHeight() + 1;
-                onlySave = true;
+                            "blockchain::submitBlock(): Gave up on block after " +
+                            std::to_string(attempt) + " write conflicts");
+                result = std::make_tuple(false, false);
             }
-        } else {
-            blockHeight = tip.getHeight() + 1;
         }
+        break;
     }
 
-    if(!onlySave) {
-        uint64_t fees = 0;
+    forgetCommittedBodies();
 
-        const unsigned int threads = std::thread::hardware_concurrency();
-        const auto& txs = newBlock.getTransactions();
-        bool failure = false;
-        unsigned int nTx = 0;
-        std::vector<std::thread> threadsVec;
+    const Storage::Transaction::ReadStats readStats = dbTx->getReadStats();
+    log->printf(LOG_LEVEL_INFO,
+                "blockchain::submitBlock(): " + std::to_string(readStats.reads) +
+                " reads, " + std::to_string(readStats.repeatedReads) + " repeated");
+    {
+        std::lock_guard<std::mutex> lock(blockReadStatsMutex);
+        blockReadStats = readStats;
+    }
 
-        for(const auto& tx : txs) {
-            threadsVec.push_back(std::thread([&]{
-                if(!std::get<0>(verifyTransaction(dbTx, tx))) {
-                    failure = true;
-                }
-            }));
-            nTx++;
+    return result;
+}
 
-            if(nTx % threads == 0 || nTx >= txs.size()) {
-                for(auto& thread : threadsVec) {
-                    thread.join();
-                }
-                threadsVec.clear();
+std::tuple<bool, bool> CryptoKernel::Blockchain::verifyMempoolState(Storage::Transaction* dbTx,
+        const transaction& tx, std::vector<std::shared_ptr<const dbOutput>>& spentOutputs,
+        uint64_t& fee, bool& scripted) {
+    const auto verifyResult = verifyTransactionState(dbTx, tx, spentOutputs);
+    if(!std::get<0>(verifyResult)) {
+        return verifyResult;
+    }
 
-                if(failure) {
-                    log->printf(LOG_LEVEL_INFO,
-                            "blockchain::submitBlock(): Transaction could not be verified");
-                    return std::make_tuple(false, true);
-                }
-            }
-        }
+    // Scripts can read the chain, so they are re-run whenever the tip changes
+    scripted = false;
+    uint64_t inputTotal = 0;
+    uint64_t outputTotal = 0;
+    auto spent = spentOutputs.begin();
+    for(const input& inp : tx.getInputs()) {
+        const dbOutput& out = **spent++;
+        inputTotal += out.getValue();
+        if(!out.getData()["contract"].empty() || inp.getData()["spendType"] == "script") {
+            scripted = true;
+        }
+    }
+
+    for(const output& out : tx.getOutputs()) {
+        outputTotal += out.getValue();
+    }
+
+    // Refuse what the mempool would not keep before checking signatures
+    double minFeeRate;
+    {
+        std::lock_guard<std::mutex> lock(mempoolMutex);
+        minFeeRate = unconfirmedTransactions.getMinFeeRate();
+    }
+
+    if(inputTotal >= outputTotal && double(inputTotal - outputTotal) / tx.size() < minFeeRate) {
+        log->printf(LOG_LEVEL_INFO,
+                    "blockchain::submitTransaction(): " + tx.getId().toString() +
+                    " pays less than the mempool minimum fee rate of " +
+                    std::to_string(minFeeRate));
+        return std::make_tuple(false, false);
+    }
+
+    // Verifying the rules rejects transactions that spend more than their inputs
+    fee = inputTotal >= outputTotal ? inputTotal - outputTotal : 0;
+
+    return std::make_tuple(true, false);
+}
+
+std::tuple<bool, bool> CryptoKernel::Blockchain::verifyMempoolTransaction(Storage::Transaction* dbTx,
+        const transaction& tx, uint64_t& fee, bool& scripted) {
+    std::vector<std::shared_ptr<const dbOutput>> spentOutputs;
+    auto verifyResult = verifyMempoolState(dbTx, tx, spentOutputs, fee, scripted);
+    if(std::get<0>(verifyResult)) {
+        verifyResult = verifyTransactionRules(dbTx, tx, spentOutputs);
+    }
+
+    if(!std::get<0>(verifyResult)) {
+        log->printf(LOG_LEVEL_INFO,
+                    "blockchain::submitTransaction(): Failed to verify transaction");
+        return verifyResult;
+    }
+
+    if(!consensus->submitTransaction(dbTx, tx)) {
+        log->printf(LOG_LEVEL_INFO,
+                    "blockchain::submitTransaction(): Failed to submit transaction to consensus method");
+        return std::make_tuple(false, true);
+    }
+
+    return std::make_tuple(true, false);
+}
+
+std::tuple<bool, bool> CryptoKernel::Blockchain::admitTransaction(const transaction& tx,
+        const uint64_t fee, const bool scripted) {
+    if(!unconfirmedTransactions.insert(tx, fee, scripted)) {
+        log->printf(LOG_LEVEL_INFO,
+                    "blockchain::submitTransaction(): " + tx.getId().toString() + " has a mempool conflict");
+        return std::make_tuple(false, false);
+    }
+
+    const unsigned int evicted = unconfirmedTransactions.trim();
+    if(!unconfirmedTransactions.contains(tx.getId())) {
+        log->printf(LOG_LEVEL_INFO,
+                    "blockchain::submitTransaction(): Mempool is full, " +
+                    tx.getId().toString() + " pays too little to stay");
+        return std::make_tuple(false, false);
+    }
+
+    if(evicted > 0) {
+        log->printf(LOG_LEVEL_INFO,
+                    "blockchain::submitTransaction(): Evicted " + std::to_string(evicted) +
+                    " transactions to stay under the mempool limit");
+    }
+
+    log->printf(LOG_LEVEL_INFO,
+                "blockchain::submitTransaction(): Received transaction " + tx.getId().toString());
+    return std::make_tuple(true, false);
+}
+
+std::tuple<bool, bool> CryptoKernel::Blockchain::verifyHeaders(
+    const std::vector<blockHeader>& headers) {
+    if(headers.empty()) {
+        return std::make_tuple(true, false);
+    }
+
+    std::unique_ptr<Storage::Transaction> dbTx(blockdb->beginReadOnly());
+
+    std::unique_ptr<blockHeader> previousHeader;
+    try {
+        previousHeader.reset(new blockHeader(getBlockDB(dbTx.get(),
+                             headers.front().getPreviousBlockId().toString())));
+    } catch(const NotFoundException& e) {
+        log->printf(LOG_LEVEL_INFO, "blockchain::verifyHeaders(): Previous block does not exist");
+        return std::make_tuple(false, false);
+    }
+
+    return verifyHeaders(dbTx.get(), *previousHeader, headers);
+}
+
+std::tuple<bool, bool> CryptoKernel::Blockchain::verifyHeaders(const blockHeader& previousHeader,
+        const std::vector<blockHeader>& headers) {
+    std::unique_ptr<Storage::Transaction> dbTx(blockdb->beginReadOnly());
+
+    return verifyHeaders(dbTx.get(), previousHeader, headers);
+}
+
+std::tuple<bool, bool> CryptoKernel::Blockchain::verifyHeaders(Storage::Transaction* dbTx,
+        const blockHeader& previousHeader, const std::vector<blockHeader>& headers) {
+    const blockHeader* previous = &previousHeader;
+    for(const blockHeader& header : headers) {
+        if(header.getPreviousBlockId() != previous->getId()) {
+            log->printf(LOG_LEVEL_INFO, "blockchain::verifyHeaders(): Headers do not form a chain");
+            return std::make_tuple(false, true);
+        }
+
+        if(header.getHeight() != previous->getHeight() + 1) {
+            log->printf(LOG_LEVEL_INFO,
+                        "blockchain::verifyHeaders(): Header " + header.getId().toString() +
+                        " has the wrong height");
+            return std::make_tuple(false, true);
+        }
+
+        if(!consensus->checkConsensusRules(dbTx, header, *previous)) {
+            log->printf(LOG_LEVEL_INFO,
+                        "blockchain::verifyHeaders(): Consensus rules cannot verify header " +
+                        header.getId().toString());
+            return std::make_tuple(false, true);
+        }
+
+        previous = &header;
+    }
+
+    return std::make_tuple(true, false);
+}
+
+std::tuple<bool, bool> CryptoKernel::Blockchain::submitBlock(Storage::Transaction* dbTx,
+        const block& Block, bool genesisBlock) {
+    block newBlock = Block;
+
+    const std::string idAsString = newBlock.getId().toString();
+    //Check block does not already exist
+    if(blocks->get(dbTx, idAsString).isObject()) {
+        log->printf(LOG_LEVEL_INFO, "blockchain::submitBlock(): Block is already in main chain");
+        return std::make_tuple(true, false);
+    }
+
+    Json::Value previousBlockJson = blocks->get(dbTx,
+                                    newBlock.getPreviousBlockId().toString());
+    uint64_t blockHeight = 1;
+
+    bool onlySave = false;
+
+    if(!genesisBlock) {
+        if(!previousBlockJson.isObject()) {
+            previousBlockJson = candidates->get(dbTx, newBlock.getPreviousBlockId().toString());
+            if(!previousBlockJson.isObject()) {
+                log->printf(LOG_LEVEL_INFO, "blockchain::submitBlock(): Previous block does not exist");
+                return std::make_tuple(false, true);
+            }
+
+            const block previousBlock = block(previousBlockJson);
+            previousBlockJson = dbBlock(previousBlock).toJson();
+        }
+
+        const dbBlock previousBlock = dbBlock(previousBlockJson);
+
+        /*//Check that the timestamp is realistic
+        if(newBlock.getTimestamp() < previousBlock.getTimestamp()) {
+            log->printf(LOG_LEVEL_INFO, "blockchain::submitBlock(): Timestamp is unrealistic");
+            return std::make_tuple(false, true);
+        }*/
+
+        if(!consensus->checkConsensusRules(dbTx, newBlock, previousBlock)) {
+            log->printf(LOG_LEVEL_INFO,
+                        "blockchain::submitBlock(): Consensus rules cannot verify this block");
+            return std::make_tuple(false, true);
+        }
+
+        const dbBlock tip = getBlockDB(dbTx, "tip");
+        if(previousBlock.getId() != tip.getId()) {
+            //This block does not directly lead on from last block
+            //Check if the verifier should've come before the current tip
+            //If so, reorg, otherwise ignore it
+            if(consensus->isBlockBetter(dbTx, newBlock, tip)) {
+                log->printf(LOG_LEVEL_INFO, "blockchain::submitBlock(): Forking the chain");
+                if(!reorgChain(dbTx, previousBlock.getId())) {
+                    log->printf(LOG_LEVEL_INFO, "blockchain::submitBlock(): Alternative chain is not valid");
+                    return std::make_tuple(false, true);
+                }
+
+                blockHeight = getBlockDB(dbTx, "tip").getHeight() + 1;
+            } else {
+                log->printf(LOG_LEVEL_WARN,
+                            "blockchain::submitBlock(): Chain has less verifier backing than current chain");
+                blockHeight = blockIndex->get(dbTx, newBlock.getPreviousBlockId())->height + 1;
+                onlySave = true;
+            }
+        } else {
+            blockHeight = tip.getHeight() + 1;
+        }
+    }
+
+    if(!onlySave) {
+        uint64_t fees = 0;
+
+        const auto verifyStart = std::chrono::steady_clock::now();
+
+        // Check the inputs against the chain in order, then the signatures,
+        // scripts and fees in parallel. Conflicts between the block's own
+        // transactions were already rejected by block::checkRep().
+        const std::set<transaction>& blockTxs = newBlock.getTransactions();
+        std::vector<const transaction*> txs;
+        std::vector<std::vector<std::shared_ptr<const dbOutput>>> spentOutputs;
+        for(const transaction& tx : blockTxs) {
+            txs.push_back(&tx);
+            spentOutputs.emplace_back();
+            if(!std::get<0>(verifyTransactionState(dbTx, tx, spentOutputs.back()))) {
+                log->printf(LOG_LEVEL_INFO,
+                            "blockchain::submitBlock(): Transaction could not be verified");
+                return std::make_tuple(false, true);
+            }
+        }
+
+        const auto stateEnd = std::chrono::steady_clock::now();
+
+        const bool verified = verifyPool->parallelFor(txs.size(), [&](const size_t i) {
+            return std::get<0>(verifyTransactionRules(dbTx, *txs[i], spentOutputs[i]));
+        });
 
+        const auto rulesEnd = std::chrono::steady_clock::now();
+        const VerifyStats verifyStats = {txs.size(), verifyPool->size(),
+            std::chrono::duration<double, std::milli>(stateEnd - verifyStart).count(),
+            std::chrono::duration<double, std::milli>(rulesEnd - stateEnd).count()};
+        log->printf(LOG_LEVEL_INFO,
+                    "blockchain::submitBlock(): Verified " + std::to_string(verifyStats.transactions) +
+                    " transactions in " + std::to_string(verifyStats.stateMs) + "ms serially and " +
+                    std::to_string(verifyStats.rulesMs) + "ms on " +
+                    std::to_string(verifyStats.threads) + " threads");
+        {
+            std::lock_guard<std::mutex> lock(blockVerifyStatsMutex);
+            blockVerifyStats = verifyStats;
+        }
+
+        if(!verified) {
+            log->printf(LOG_LEVEL_INFO,
+                        "blockchain::submitBlock(): Transaction could not be verified");
+            return std::make_tuple(false, true);
+        }
+
+        for(size_t i = 0; i < txs.size(); i++) {
+            for(const auto& out : spentOutputs[i]) {
+                fees += out->getValue();
+            }
 
-        //Verify Transactions
-        for(const transaction& tx : newBlock.getTransactions()) {
-            fees += calculateTransactionFee(dbTx, tx);
+            for(const output& out : txs[i]->getOutputs()) {
+                fees -= out.getValue();
+            }
         }
 
         if(!std::get<0>(verifyTransaction(dbTx, newBlock.getCoinbaseTx(), true))) {
@@ -684,27 +1174,49 @@ std::tuple<bool, bool> CryptoKernel::Blockchain::submitBlock(Storage::Transactio
             return std::make_tuple(false, true);
         }
 
-        confirmTransaction(dbTx, newBlock.getCoinbaseTx(), newBlock.getId(), true);
+        // The body is written whole so the block is served with one read
+        std::vector<const transaction*> bodyTxs(1, &newBlock.getCoinbaseTx());
+        for(const transaction& tx : blockTxs) {
+            bodyTxs.push_back(&tx);
+        }
+
+        std::string body;
+        std::vector<BlockStore::Position> positions;
+        for(const transaction* tx : bodyTxs) {
+            const std::string record = Storage::toBinary(storedTransaction(*tx));
+            appendRecord(body, record);
+            positions.push_back(BlockStore::Position{0, body.size() - record.size(), record.size()});
+        }
+
+        const BlockStore::Position bodyPosition = writeBody(dbTx, newBlock.getId(), body);
+        blockPositions->put(dbTx, newBlock.getId().toString(), positionJson(bodyPosition));
 
         //Move transactions from unconfirmed to confirmed and add transaction utxos to db
-        for(const transaction& tx : newBlock.getTransactions()) {
-            confirmTransaction(dbTx, tx, newBlock.getId());
+        for(size_t i = 0; i < bodyTxs.size(); i++) {
+            positions[i].file = bodyPosition.file;
+            positions[i].offset += bodyPosition.offset;
+            confirmTransaction(dbTx, *bodyTxs[i], newBlock.getId(), positions[i], i == 0);
         }
+
+        writeUndo(dbTx, newBlock, blockHeight, spentOutputs);
     }
 
     if(onlySave) {
         Json::Value jsonBlock = newBlock.toJson();
         jsonBlock["height"] = blockHeight;
         candidates->put(dbTx, newBlock.getId().toString(), jsonBlock);
+        blockIndex->add(dbTx, newBlock.getId(), newBlock.getPreviousBlockId(), blockHeight,
+                        newBlock.getTimestamp());
     } else {
         const dbBlock toSave = dbBlock(newBlock, blockHeight);
         const Json::Value blockAsJson = toSave.toJson();
         candidates->erase(dbTx, idAsString);
         blocks->put(dbTx, "tip", blockAsJson);
-        blocks->put(dbTx, std::to_string(blockHeight), Json::Value(idAsString), 0);
+        blocks->put(dbTx, Storage::Key().append(blockHeight), Json::Value(idAsString), 0);
         blocks->put(dbTx, idAsString, blockAsJson);
-        std::lock_guard<std::mutex> lock(mempoolMutex);
-		unconfirmedTransactions.rescanMempool(dbTx, this);
+        blockIndex->connect(dbTx, toSave);
+        queueMempoolChange(dbTx, MempoolChange{std::make_shared<const block>(newBlock), true,
+                                               nullptr, 0, false});
     }
 
     if(genesisBlock) {
@@ -719,7 +1231,8 @@ std::tuple<bool, bool> CryptoKernel::Blockchain::submitBlock(Storage::Transactio
 }
 
 void CryptoKernel::Blockchain::confirmTransaction(Storage::Transaction* dbTransaction,
-        const transaction& tx, const BigNum& confirmingBlock, const bool coinbaseTx) {
+        const transaction& tx, const uint256& confirmingBlock, const BlockStore::Position& position,
+        const bool coinbaseTx) {
     //Execute custom transaction rules callback
     if(!consensus->confirmTransaction(dbTransaction, tx)) {
         log->printf(LOG_LEVEL_ERR, "Consensus rules failed to confirm transaction");
@@ -727,59 +1240,57 @@ void CryptoKernel::Blockchain::confirmTransaction(Storage::Transaction* dbTransa
 
     //"Spend" UTXOs
     for(const input& inp : tx.getInputs()) {
+        // The output itself moves to stxos when the coins cache is flushed
         const std::string outputId = inp.getOutputId().toString();
-        const Json::Value utxo = utxos->get(dbTransaction, outputId);
-        const auto txoData = dbOutput(utxo).getData();
-
-        stxos->put(dbTransaction, outputId, utxo);
+        const auto txoData = coins->spend(dbTransaction, outputId).output->getData();
 
         if(!txoData["publicKey"].isNull()) {
-            const auto txoStr = txoData["publicKey"].asString() + outputId;
+            const auto txoKey = Storage::Key(txoData["publicKey"].asString()).append(outputId);
 
-            stxos->put(dbTransaction, txoStr, Json::nullValue, 0);
-            utxos->erase(dbTransaction, txoStr, 0);
+            stxos->put(dbTransaction, txoKey, Json::nullValue, 0);
+            utxos->erase(dbTransaction, txoKey, 0);
         }
 
-        utxos->erase(dbTransaction, outputId);
-
         inputs->put(dbTransaction, inp.getId().toString(), dbInput(inp).toJson());
     }
 
     //Add new outputs to UTXOs
     for(const output& out : tx.getOutputs()) {
-        const auto txoData = out.getData();
+        const auto& txoData = out.getData();
         if(!txoData["publicKey"].isNull()) {
-            const auto txoStr = txoData["publicKey"].asString() + out.getId().toString();
-            utxos->put(dbTransaction, txoStr, Json::nullValue, 0);
+            const auto txoKey = Storage::Key(txoData["publicKey"].asString()).append(out.getId().toString());
+            utxos->put(dbTransaction, txoKey, Json::nullValue, 0);
         }
 
-        utxos->put(dbTransaction, out.getId().toString(), dbOutput(out, tx.getId()).toJson());
+        const dbOutput newOutput = dbOutput(out, tx.getId());
+        utxos->put(dbTransaction, out.getId().toString(), newOutput.toJson());
+        coins->add(dbTransaction, newOutput);
     }
 
     //Commit transaction
-    transactions->put(dbTransaction, tx.getId().toString(), Blockchain::dbTransaction(tx,
-                      confirmingBlock, coinbaseTx).toJson());
-
-    //Remove transaction from unconfirmed transactions vector
-    std::lock_guard<std::mutex> lock(mempoolMutex);
-    unconfirmedTransactions.remove(tx);
+    Json::Value txJson = Blockchain::dbTransaction(tx, confirmingBlock, coinbaseTx).toJson();
+    txJson["position"] = positionJson(position);
+    transactions->put(dbTransaction, tx.getId().toString(), txJson);
 }
 
 bool CryptoKernel::Blockchain::reorgChain(Storage::Transaction* dbTransaction,
-        const BigNum& newTipId) {
-    std::stack<block> blockList;
-
+        const uint256& newTipId) {
     //Find common fork block
-    Json::Value blockJson = candidates->get(dbTransaction, newTipId.toString());
-    while(blockJson.isObject()) {
-        const block currentBlock = block(blockJson);
-        blockList.push(currentBlock);
-        blockJson = candidates->get(dbTransaction, currentBlock.getPreviousBlockId().toString());
+    const BlockIndex::Entry* newTip = blockIndex->get(dbTransaction, newTipId);
+    const BlockIndex::Entry* forkBlock = blockIndex->getForkPoint(dbTransaction, newTip);
+    if(forkBlock == nullptr) {
+        log->printf(LOG_LEVEL_WARN, "blockchain::reorgChain(): New chain does not lead back to the main chain");
+        return false;
+    }
+
+    std::stack<block> blockList;
+    for(const BlockIndex::Entry* entry = newTip; entry != forkBlock; entry = entry->previous) {
+        blockList.push(block(candidates->get(dbTransaction, entry->id.toString())));
     }
 
     //Reverse blocks to that point
-    const BigNum forkBlockId = blockList.top().getPreviousBlockId();
-    while(getBlockDB(dbTransaction, "tip").getId() != forkBlockId) {
+    const uint64_t tipHeight = blockIndex->getTip(dbTransaction)->getHeight();
+    for(uint64_t height = tipHeight; height > forkBlock->height; height--) {
         reverseBlock(dbTransaction);
     }
 
@@ -822,8 +1333,12 @@ uint64_t CryptoKernel::Blockchain::calculateTransactionFee(Storage::Transaction*
     }
 
     for(const input& inp : tx.getInputs()) {
-        const dbOutput out = dbOutput(utxos->get(dbTx, inp.getOutputId().toString()));
-        inputTotal += out.getValue();
+        const auto out = getUnspentOutput(dbTx, inp.getOutputId().toString());
+        if(!out) {
+            throw InvalidElementException("Output " + inp.getOutputId().toString() +
+                                          " is not unspent");
+        }
+        inputTotal += out->getValue();
     }
 
     return inputTotal - outputTotal;
@@ -833,10 +1348,17 @@ CryptoKernel::Blockchain::block CryptoKernel::Blockchain::generateVerifyingBlock
     const std::string& publicKey) {
     std::unique_ptr<Storage::Transaction> dbTx(blockdb->beginReadOnly());
 
-    std::set<transaction> blockTransactions = getUnconfirmedTransactions();
+    std::set<transaction> blockTransactions;
+    uint64_t fees;
+    uint256 mempoolTip;
+    {
+        std::lock_guard<std::mutex> lock(mempoolMutex);
+        blockTransactions = unconfirmedTransactions.getTransactions(fees);
+        mempoolTip = unconfirmedTransactions.getTip();
+    }
 
     uint64_t height;
-    BigNum previousBlockId;
+    uint256 previousBlockId;
     bool genesisBlock = false;
     try {
         const dbBlock previousBlock = getBlockDB(dbTx.get(), "tip");
@@ -851,18 +1373,26 @@ CryptoKernel::Blockchain::block CryptoKernel::Blockchain::generateVerifyingBlock
 
     uint64_t value = getBlockReward(height);
 
-    for(const transaction& tx : blockTransactions) {
-        try {
-            value += calculateTransactionFee(dbTx.get(), tx);
-        } catch(const CryptoKernel::Blockchain::InvalidElementException& e) {
-            // rare case: the mempool was rescanned and some txs we have are now invalid.
-            // For now just return an empty block. In the future the mempool should be in 
-            // the database so the mempool and current unspent state are always consistent.
-            blockTransactions.clear();
-            break;
+    // The fees were worked out when the transactions entered the mempool.
+    // If a block was connected in between, check against the snapshot.
+    if(mempoolTip != previousBlockId) {
+        fees = 0;
+        for(const transaction& tx : blockTransactions) {
+            try {
+                fees += calculateTransactionFee(dbTx.get(), tx);
+            } catch(const CryptoKernel::Blockchain::InvalidElementException& e) {
+                // rare case: the mempool was rescanned and some txs we have are now invalid.
+                // For now just return an empty block. In the future the mempool should be in 
+                // the database so the mempool and current unspent state are always consistent.
+                blockTransactions.clear();
+                fees = 0;
+                break;
+            }
         }
     }
 
+    value += fees;
+
     const std::string pubKey = getCoinbaseOwner(publicKey);
 
     std::default_random_engine generator(now);
@@ -918,21 +1448,54 @@ std::set<CryptoKernel::Blockchain::dbOutput> CryptoKernel::Blockchain::getSpentO
     return returning;
 }
 
-void CryptoKernel::Blockchain::reverseBlock(Storage::Transaction* dbTransaction) {
-    const block tip = getBlock(dbTransaction, "tip");
+void CryptoKernel::Blockchain::writeUndo(Storage::Transaction* dbTransaction, const block& Block,
+        const uint64_t height, const std::vector<std::vector<std::shared_ptr<const dbOutput>>>& spentOutputs) {
+    Json::Value undoJson;
+    undoJson["id"] = Block.getId().toString();
+
+    // In the order of the block's transactions and their inputs
+    Json::Value& spent = undoJson["spent"];
+    spent = Json::arrayValue;
+    for(const auto& txSpent : spentOutputs) {
+        for(const auto& out : txSpent) {
+            spent.append(out->toJson());
+        }
+    }
 
-    auto eraseUtxo = [&](const auto& out, auto& db) {
-        db->erase(dbTransaction, out.getId().toString());
+    undo->put(dbTransaction, Storage::Key().append(height), undoJson);
+    if(height > undoDepth) {
+        undo->erase(dbTransaction, Storage::Key().append(height - undoDepth));
+    }
+}
 
-        const auto txoData = out.getData();
+void CryptoKernel::Blockchain::reverseBlock(Storage::Transaction* dbTransaction) {
+    const dbBlock tipDB = getBlockDB(dbTransaction, "tip");
+    const Storage::Key undoKey = Storage::Key().append(tipDB.getHeight());
+
+    // The undo record holds everything the block spent, otherwise the
+    // spent outputs are rebuilt from the tables
+    const Json::Value undoJson = undo->get(dbTransaction, undoKey);
+    const bool haveUndo = undoJson.isObject() &&
+                          undoJson["id"].asString() == tipDB.getId().toString();
+    const block tip = buildBlock(dbTransaction, tipDB);
+    Json::ArrayIndex spentIndex = 0;
+
+    auto eraseUtxo = [&](const output& out) {
+        // Until the coins cache is flushed a spent output may still be in utxos
+        const std::string id = out.getId().toString();
+        utxos->erase(dbTransaction, id);
+        stxos->erase(dbTransaction, id);
+        coins->erase(dbTransaction, id);
+
+        const auto& txoData = out.getData();
         if(!txoData["publicKey"].isNull()) {
-            const auto txoStr = txoData["publicKey"].asString() + out.getId().toString();
-            db->erase(dbTransaction, txoStr, 0);
+            const auto txoKey = Storage::Key(txoData["publicKey"].asString()).append(id);
+            utxos->erase(dbTransaction, txoKey, 0);
         }
     };
 
     for(const output& out : tip.getCoinbaseTx().getOutputs()) {
-        eraseUtxo(out, utxos);
+        eraseUtxo(out);
     }
 
     transactions->erase(dbTransaction, tip.getCoinbaseTx().getId().toString());
@@ -941,22 +1504,26 @@ void CryptoKernel::Blockchain::reverseBlock(Storage::Transaction* dbTransaction)
 
     for(const transaction& tx : tip.getTransactions()) {
         for(const output& out : tx.getOutputs()) {
-            eraseUtxo(out, utxos);
+            eraseUtxo(out);
         }
 
         for(const input& inp : tx.getInputs()) {
             inputs->erase(dbTransaction, inp.getId().toString());
 
             const std::string oldOutputId = inp.getOutputId().toString();
-            const dbOutput oldOutput = dbOutput(stxos->get(dbTransaction, oldOutputId));
-
-            eraseUtxo(oldOutput, stxos);
+            Json::Value txoData;
+            if(haveUndo) {
+                const dbOutput spentOutput(undoJson["spent"][spentIndex++]);
+                coins->restore(dbTransaction, spentOutput);
+                txoData = spentOutput.getData();
+            } else {
+                txoData = coins->unspend(dbTransaction, oldOutputId).output->getData();
+            }
 
-            utxos->put(dbTransaction, oldOutputId, oldOutput.toJson());
-            const auto txoData = oldOutput.getData();
             if(!txoData["publicKey"].isNull()) {
-                const auto txoStr = txoData["publicKey"].asString() + oldOutputId;
-                utxos->put(dbTransaction, txoStr, Json::nullValue, 0);
+                const auto txoKey = Storage::Key(txoData["publicKey"].asString()).append(oldOutputId);
+                stxos->erase(dbTransaction, txoKey, 0);
+                utxos->put(dbTransaction, txoKey, Json::nullValue, 0);
             }
         }
 
@@ -965,27 +1532,81 @@ void CryptoKernel::Blockchain::reverseBlock(Storage::Transaction* dbTransaction)
 		replayTxs.insert(tx);
     }
 
-    const dbBlock tipDB = getBlockDB(dbTransaction, "tip");
-
-    blocks->erase(dbTransaction, std::to_string(tipDB.getHeight()), 0);
+    undo->erase(dbTransaction, undoKey);
+    // The body and its position stay, so connecting the block again reuses them
+    blocks->erase(dbTransaction, Storage::Key().append(tipDB.getHeight()), 0);
     blocks->erase(dbTransaction, tip.getId().toString());
-    blocks->put(dbTransaction, "tip", getBlockDB(dbTransaction,
-                tip.getPreviousBlockId().toString()).toJson());
+    const dbBlock newTip = getBlockDB(dbTransaction, tip.getPreviousBlockId().toString());
+    blocks->put(dbTransaction, "tip", newTip.toJson());
+    blockIndex->disconnect(dbTransaction, newTip);
 
     candidates->put(dbTransaction, tip.getId().toString(), tip.toJson());
 
-    mempoolMutex.lock();
-	unconfirmedTransactions.rescanMempool(dbTransaction, this);
-    mempoolMutex.unlock();
+    queueMempoolChange(dbTransaction, MempoolChange{std::make_shared<const block>(tip), false,
+                                                    nullptr, 0, false});
 
 	for(const auto& tx : replayTxs) {
-		if(!std::get<0>(submitTransaction(dbTransaction, tx))) {
+        uint64_t fee = 0;
+        bool scripted = false;
+		if(!std::get<0>(verifyMempoolTransaction(dbTransaction, tx, fee, scripted))) {
             log->printf(LOG_LEVEL_WARN,
                         "Blockchain::reverseBlock(): previously moved transaction is now invalid");
+            continue;
         }
+
+        queueMempoolChange(dbTransaction, MempoolChange{nullptr, false,
+                                                        std::make_shared<const transaction>(tx),
+                                                        fee, scripted});
 	}
 }
 
+void CryptoKernel::Blockchain::queueMempoolChange(Storage::Transaction* dbTx,
+        const MempoolChange& change) {
+    std::lock_guard<std::mutex> lock(mempoolMutex);
+    mempoolChanges[dbTx].push_back(change);
+}
+
+void CryptoKernel::Blockchain::applyMempoolChanges(Storage::Transaction* dbTx) {
+    const auto it = mempoolChanges.find(dbTx);
+    if(it == mempoolChanges.end()) {
+        return;
+    }
+
+    unsigned int evicted = 0;
+    for(const MempoolChange& change : it->second) {
+        if(change.replayed) {
+            if(!unconfirmedTransactions.insert(*change.replayed, change.fee, change.scripted)) {
+                log->printf(LOG_LEVEL_INFO,
+                            "blockchain::applyMempoolChanges(): " +
+                            change.replayed->getId().toString() + " has a mempool conflict");
+            }
+        } else if(change.connected) {
+            for(const transaction& tx : change.changed->getTransactions()) {
+                unconfirmedTransactions.remove(tx);
+            }
+            evicted += unconfirmedTransactions.removeConflicts(*change.changed);
+            unconfirmedTransactions.setTip(change.changed->getId());
+        } else {
+            evicted += unconfirmedTransactions.removeConflicts(*change.changed);
+            unconfirmedTransactions.setTip(change.changed->getPreviousBlockId());
+        }
+    }
+    mempoolChanges.erase(it);
+
+    // Scripts can read the chain, so they are re-run against the committed
+    // tip. A snapshot is used because a writer could wait on the write lock
+    // held by a transaction that is waiting on mempoolMutex.
+    std::unique_ptr<Storage::Transaction> readTx(blockdb->beginReadOnly());
+    evicted += unconfirmedTransactions.trim() +
+               unconfirmedTransactions.rescanScripted(readTx.get(), this);
+
+    if(evicted > 0) {
+        log->printf(LOG_LEVEL_INFO,
+                    "blockchain::applyMempoolChanges(): Evicted " + std::to_string(evicted) +
+                    " mempool transactions invalidated by the chain");
+    }
+}
+
 CryptoKernel::Blockchain::dbTransaction CryptoKernel::Blockchain::getTransactionDB(
     Storage::Transaction* transaction, const std::string& id) {
     const Json::Value jsonTx = transactions->get(transaction, id);
@@ -993,7 +1614,7 @@ CryptoKernel::Blockchain::dbTransaction CryptoKernel::Blockchain::getTransaction
         throw NotFoundException("Transaction " + id);
     }
 
-    return dbTransaction(jsonTx);
+    return dbTransaction(jsonTx, uint256(id));
 }
 
 CryptoKernel::Blockchain::transaction CryptoKernel::Blockchain::getTransaction(
@@ -1003,25 +1624,109 @@ CryptoKernel::Blockchain::transaction CryptoKernel::Blockchain::getTransaction(
         throw NotFoundException("Transaction " + id);
     }
 
-    const dbTransaction tx = dbTransaction(jsonTx);
+    // Everything stored was verified when it was confirmed, so it is loaded
+    // with the ids it was stored under rather than hashed and checked again
+    const dbTransaction tx = dbTransaction(jsonTx, uint256(id));
+    if(jsonTx["position"].isObject()) {
+        return loadTransaction(Storage::fromBinary(blockStore->read(loadPosition(jsonTx["position"]))));
+    }
+
+    // Otherwise it was confirmed before blockStore existed
     std::set<output> outputs;
-    for(const BigNum& id : tx.getOutputs()) {
+    for(const uint256& id : tx.getOutputs()) {
         outputs.insert(getOutput(transaction, id.toString()));
     }
 
     std::set<input> inps;
-    for(const BigNum& id : tx.getInputs()) {
-        inps.insert(input(inputs->get(transaction, id.toString())));
+    for(const uint256& id : tx.getInputs()) {
+        inps.insert(input(inputs->get(transaction, id.toString()), id));
+    }
+
+    return CryptoKernel::Blockchain::transaction(inps, outputs, tx.getTimestamp(), tx.getId());
+}
+
+void CryptoKernel::Blockchain::upgradeKeys() {
+    // Databases written before the tables had ids store every key as text
+    const std::vector<Storage::Table*> tables = {blocks.get(), transactions.get(), utxos.get(),
+                                                  stxos.get(), inputs.get(), candidates.get()};
+    const std::vector<std::string> names = {"blocks", "transactions", "utxos", "stxos",
+                                            "inputs", "candidates"};
+
+    uint64_t upgraded = 0;
+    for(unsigned int i = 0; i < tables.size(); i++) {
+        Storage::Table* table = tables[i];
+        Storage::Table legacy(names[i]);
+        const bool txoTable = table == utxos.get() || table == stxos.get();
+
+        for(int index = -1; index <= 0; index++) {
+            std::unique_ptr<Storage::Transaction> snapshotTx(blockdb->beginReadOnly());
+            std::unique_ptr<Storage::Table::Iterator> it(new Storage::Table::Iterator(&legacy,
+                    blockdb.get(), snapshotTx->snapshot, Storage::Key(), index));
+
+            std::unique_ptr<Storage::Transaction> dbTx(blockdb->begin());
+            unsigned int pending = 0;
+            for(it->SeekToFirst(); it->Valid(); it->Next()) {
+                const std::string key = it->key();
+                legacy.erase(dbTx.get(), key, index);
+
+                if(index == -1) {
+                    const Json::Value value = it->value();
+                    table->put(dbTx.get(), key, value);
+
+                    // The public key index cannot be split back into its
+                    // parts so rebuild it from the outputs instead
+                    const Json::Value& publicKey = value["data"]["publicKey"];
+                    if(txoTable && publicKey.isString()) {
+                        table->put(dbTx.get(), Storage::Key(publicKey.asString()).append(key),
+                                   Json::nullValue, 0);
+                    }
+                } else if(table == blocks.get()) {
+                    table->put(dbTx.get(), Storage::Key().append(std::stoull(key)),
+                               it->value(), 0);
+                }
+
+                upgraded++;
+                if(++pending == 10000) {
+                    dbTx->commit();
+                    dbTx.reset(blockdb->begin());
+                    pending = 0;
+                }
+            }
+
+            dbTx->commit();
+        }
+    }
+
+    if(upgraded > 0) {
+        log->printf(LOG_LEVEL_INFO, "blockchain::upgradeKeys(): Upgraded " +
+                    std::to_string(upgraded) + " keys to the compact format");
     }
+}
 
-    return CryptoKernel::Blockchain::transaction(inps, outputs, tx.getTimestamp(),
-            tx.isCoinbaseTx());
+void CryptoKernel::Blockchain::openDB() {
+    blockdb.reset(new CryptoKernel::Storage(dbDir, storageProfile,
+                                            std::make_shared<Storage::BinaryCodec>()));
+    blockStore.reset(new BlockStore(getBlockStoreDirectory()));
 }
 
 void CryptoKernel::Blockchain::emptyDB() {
+    coins->clear();
+    blockIndex->clear();
     blockdb.reset();
+    blockStore.reset();
     CryptoKernel::Storage::destroy(dbDir);
-    blockdb.reset(new CryptoKernel::Storage(dbDir, false, 20, true));
+    BlockStore::destroy(getBlockStoreDirectory());
+    openDB();
+}
+
+Json::Value CryptoKernel::Blockchain::getStorageInfo() {
+    Json::Value returning = blockdb->getProperties();
+    returning["coins"] = coins->getStats();
+
+    const auto blockStoreSize = blockStore->getSize();
+    returning["blockStore"]["segments"] = blockStoreSize.first;
+    returning["blockStore"]["bytes"] = Json::UInt64(blockStoreSize.second);
+    return returning;
 }
 
 CryptoKernel::Storage::Transaction* CryptoKernel::Blockchain::getTxHandle() {
@@ -1029,15 +1734,77 @@ CryptoKernel::Storage::Transaction* CryptoKernel::Blockchain::getTxHandle() {
     return dbTx;
 }
 
+namespace {
+    // Heap overhead of one allocation, and of a node in a std::map or std::set
+    const uint64_t allocationOverhead = 16;
+    const uint64_t treeNodeOverhead = 32 + allocationOverhead;
+
+    // Ids are held inline, so they only add to the nodes they are keys or values of
+    const uint64_t idUsage = sizeof(CryptoKernel::uint256);
+
+    // Reference counts and vtable of a std::make_shared allocation
+    const uint64_t sharedControlBlock = 16;
+
+    // How far above the highest evicted fee per byte a trim sets the minimum
+    const double incrementalFeeRate = 1.0;
+
+    // jsoncpp keeps both objects and arrays in a std::map of its values
+    uint64_t jsonUsage(const Json::Value& value) {
+        uint64_t usage = 0;
+        if(value.isString()) {
+            usage += value.asString().size() + 1 + allocationOverhead;
+        } else if(value.isObject() || value.isArray()) {
+            usage += treeNodeOverhead;
+            for(auto it = value.begin(); it != value.end(); ++it) {
+                usage += treeNodeOverhead + sizeof(Json::Value) + jsonUsage(*it);
+                if(value.isObject()) {
+                    usage += it.name().size() + 1 + allocationOverhead;
+                }
+            }
+        }
+
+        return usage;
+    }
+}
+
 CryptoKernel::Blockchain::Mempool::Mempool() {
 	bytes = 0;
+    heapUsage = 0;
+    maxUsage = defaultMempoolMaxUsage;
+    evictions = 0;
+    minFeeRate = 0;
+    minFeeRateUpdated = std::chrono::steady_clock::now();
 }
 
-bool CryptoKernel::Blockchain::Mempool::insert(const transaction& tx) {
-	// Check if any inputs or outputs conflict
-	if(txs.find(tx.getId()) != txs.end()) {
-		return false;
-	}
+uint64_t CryptoKernel::Blockchain::Mempool::memoryUsage(const transaction& tx) {
+    // The entry in txs and in fees and byFeeRate
+    uint64_t usage = 3 * (treeNodeOverhead + idUsage) + sizeof(transaction) +
+                     sizeof(uint64_t) + sizeof(double);
+
+    // The input and output sets, each made with its shared_ptr control block
+    usage += 2 * (allocationOverhead + sharedControlBlock) + sizeof(std::set<input>) +
+             sizeof(std::set<output>);
+
+    for(const input& inp : tx.getInputs()) {
+        usage += treeNodeOverhead + sizeof(input) + jsonUsage(inp.getData());
+        // Its entries in inputs and outputs
+        usage += 2 * (treeNodeOverhead + 2 * idUsage);
+    }
+
+    for(const output& out : tx.getOutputs()) {
+        usage += treeNodeOverhead + sizeof(output) + jsonUsage(out.getData());
+        usage += treeNodeOverhead + 2 * idUsage;
+    }
+
+    return usage;
+}
+
+bool CryptoKernel::Blockchain::Mempool::insert(const transaction& tx, const uint64_t fee,
+                                               const bool scripted) {
+	// Check if any inputs or outputs conflict
+	if(txs.find(tx.getId()) != txs.end()) {
+		return false;
+	}
 
 	for(const input& inp : tx.getInputs()) {
 		if(inputs.find(inp.getId()) != inputs.end()) {
@@ -1055,17 +1822,25 @@ bool CryptoKernel::Blockchain::Mempool::insert(const transaction& tx) {
 		}
 	}
 
-	txs.insert(std::pair<BigNum, transaction>(tx.getId(), tx));
+	txs.insert(std::pair<uint256, transaction>(tx.getId(), tx));
 
     bytes += tx.size();
 
+    fees[tx.getId()] = fee;
+    byFeeRate.emplace(feeRate(tx, fee), tx.getId());
+    heapUsage += memoryUsage(tx);
+
+    if(scripted) {
+        this->scripted.insert(tx.getId());
+    }
+
 	for(const input& inp : tx.getInputs()) {
-		inputs.insert(std::pair<BigNum, BigNum>(inp.getId(), tx.getId()));
-        outputs.insert(std::pair<BigNum, BigNum>(inp.getOutputId(), tx.getId()));
+		inputs.insert(std::pair<uint256, uint256>(inp.getId(), tx.getId()));
+        outputs.insert(std::pair<uint256, uint256>(inp.getOutputId(), tx.getId()));
 	}
 
 	for(const output& out : tx.getOutputs()) {
-		outputs.insert(std::pair<BigNum, BigNum>(out.getId(), tx.getId()));
+		outputs.insert(std::pair<uint256, uint256>(out.getId(), tx.getId()));
 	}
 
 	return true;
@@ -1074,6 +1849,11 @@ bool CryptoKernel::Blockchain::Mempool::insert(const transaction& tx) {
 void CryptoKernel::Blockchain::Mempool::remove(const transaction& tx) {
 	if(txs.find(tx.getId()) != txs.end()) {
 		txs.erase(tx.getId());
+        scripted.erase(tx.getId());
+
+        byFeeRate.erase(std::make_pair(feeRate(tx, fees.at(tx.getId())), tx.getId()));
+        fees.erase(tx.getId());
+        heapUsage -= memoryUsage(tx);
 
         bytes -= tx.size();
 
@@ -1088,37 +1868,188 @@ void CryptoKernel::Blockchain::Mempool::remove(const transaction& tx) {
 	}
 }
 
-void CryptoKernel::Blockchain::Mempool::rescanMempool(Storage::Transaction* dbTx, Blockchain* blockchain) {
+unsigned int CryptoKernel::Blockchain::Mempool::removeConflicts(const block& changed) {
+    // Mempool transactions only spend confirmed outputs, so any output id
+    // shared with the block is either a double spend or a spend of an
+    // output that no longer exists
+    std::set<uint256> outputIds;
+    std::set<transaction> blockTxs = changed.getTransactions();
+    blockTxs.insert(changed.getCoinbaseTx());
+    for(const transaction& tx : blockTxs) {
+        for(const input& inp : tx.getInputs()) {
+            outputIds.insert(inp.getOutputId());
+        }
+
+        for(const output& out : tx.getOutputs()) {
+            outputIds.insert(out.getId());
+        }
+    }
+
+    std::set<uint256> removals;
+    for(const uint256& id : outputIds) {
+        const auto it = outputs.find(id);
+        if(it != outputs.end()) {
+            removals.insert(it->second);
+        }
+    }
+
+    for(const uint256& id : removals) {
+        // remove() erases the map entry before it is done with the transaction
+        const transaction tx = txs.at(id);
+        remove(tx);
+    }
+
+    return removals.size();
+}
+
+unsigned int CryptoKernel::Blockchain::Mempool::rescanMempool(Storage::Transaction* dbTx, Blockchain* blockchain) {
+    std::set<uint256> ids;
+    for(const auto& tx : txs) {
+        ids.insert(tx.first);
+    }
+
+    return rescan(dbTx, blockchain, ids);
+}
+
+unsigned int CryptoKernel::Blockchain::Mempool::rescanScripted(Storage::Transaction* dbTx, Blockchain* blockchain) {
+    return rescan(dbTx, blockchain, scripted);
+}
+
+unsigned int CryptoKernel::Blockchain::Mempool::rescan(Storage::Transaction* dbTx,
+        Blockchain* blockchain, const std::set<uint256>& ids) {
 	std::set<transaction> removals;
 
-	for(const auto& tx : txs) {
-        if(!std::get<0>(blockchain->verifyTransaction(dbTx, tx.second))) {
-			removals.insert(tx.second);
+	for(const uint256& id : ids) {
+        const transaction& tx = txs.at(id);
+        if(!std::get<0>(blockchain->verifyTransaction(dbTx, tx))) {
+			removals.insert(tx);
 		}
 	}
 
 	for(const auto& tx : removals) {
 		remove(tx);
 	}
+
+    return removals.size();
 }
 
 std::set<CryptoKernel::Blockchain::transaction> CryptoKernel::Blockchain::Mempool::getTransactions() const {
+    uint64_t fees;
+    return getTransactions(fees);
+}
+
+std::set<CryptoKernel::Blockchain::transaction> CryptoKernel::Blockchain::Mempool::getTransactions(
+    uint64_t& fees) const {
 	uint64_t totalSize = 0;
 	std::set<transaction> returning;
-
-	for(const auto& it : txs) {
-		if(totalSize + it.second.size() < 3.9 * 1024 * 1024) {
-			returning.insert(it.second);
-			totalSize += it.second.size();
+	fees = 0;
+
+	// Skip what does not fit in case a smaller transaction further down does
+	unsigned int misses = 0;
+	for(const auto& entry : byFeeRate) {
+		const transaction& tx = txs.at(entry.second);
+		if(totalSize + tx.size() < 3.9 * 1024 * 1024) {
+			returning.insert(tx);
+			totalSize += tx.size();
+			fees += this->fees.at(entry.second);
 			continue;
 		}
 
-		break;
+		if(++misses >= maxTemplateMisses) {
+			break;
+		}
+	}
+
+	return returning;
+}
+
+std::vector<CryptoKernel::Blockchain::transaction> CryptoKernel::Blockchain::Mempool::getAllTransactions() const {
+	std::vector<transaction> returning;
+	returning.reserve(txs.size());
+	for(const auto& entry : byFeeRate) {
+		returning.push_back(txs.at(entry.second));
 	}
 
 	return returning;
 }
 
+bool CryptoKernel::Blockchain::Mempool::contains(const uint256& id) const {
+    return txs.find(id) != txs.end();
+}
+
+unsigned int CryptoKernel::Blockchain::Mempool::trim() {
+    unsigned int evicted = 0;
+    double highestRate = 0;
+    while(heapUsage > maxUsage && !byFeeRate.empty()) {
+        const auto cheapest = std::prev(byFeeRate.end());
+        highestRate = std::max(highestRate, cheapest->first);
+
+        const transaction tx = txs.at(cheapest->second);
+        remove(tx);
+        evicted++;
+    }
+
+    if(evicted > 0) {
+        minFeeRate = std::max(getMinFeeRate(), highestRate + incrementalFeeRate);
+        minFeeRateUpdated = std::chrono::steady_clock::now();
+        evictions += evicted;
+    }
+
+    return evicted;
+}
+
+void CryptoKernel::Blockchain::Mempool::setMaxUsage(const uint64_t maxUsage) {
+    this->maxUsage = maxUsage;
+}
+
+uint64_t CryptoKernel::Blockchain::Mempool::getMaxUsage() const {
+    return maxUsage;
+}
+
+double CryptoKernel::Blockchain::Mempool::getMinFeeRate() {
+    if(minFeeRate > 0) {
+        const auto now = std::chrono::steady_clock::now();
+        const double elapsed = std::chrono::duration<double>(now - minFeeRateUpdated).count();
+        minFeeRate *= std::pow(0.5, elapsed / feeRateHalfLife);
+        minFeeRateUpdated = now;
+
+        if(minFeeRate < incrementalFeeRate / 2) {
+            minFeeRate = 0;
+        }
+    }
+
+    return minFeeRate;
+}
+
+uint64_t CryptoKernel::Blockchain::Mempool::getEvictions() const {
+    return evictions;
+}
+
+uint64_t CryptoKernel::Blockchain::Mempool::usage() const {
+    return heapUsage;
+}
+
+void CryptoKernel::Blockchain::Mempool::setTip(const uint256& id) {
+    tip = id;
+}
+
+CryptoKernel::uint256 CryptoKernel::Blockchain::Mempool::getTip() const {
+    return tip;
+}
+
+bool CryptoKernel::Blockchain::Mempool::FeeRateOrder::operator()(
+    const std::pair<double, uint256>& lhs, const std::pair<double, uint256>& rhs) const {
+    if(lhs.first != rhs.first) {
+        return lhs.first > rhs.first;
+    }
+
+    return lhs.second < rhs.second;
+}
+
+double CryptoKernel::Blockchain::Mempool::feeRate(const transaction& tx, const uint64_t fee) {
+    return double(fee) / tx.size();
+}
+
 unsigned int CryptoKernel::Blockchain::Mempool::count() const {
     return txs.size();
 }
@@ -1127,6 +2058,707 @@ unsigned int CryptoKernel::Blockchain::Mempool::size() const {
     return bytes;
 }
 
+const unsigned int CryptoKernel::Blockchain::CoinsCache::flushInterval;
+
+CryptoKernel::Blockchain::CoinsCache::CoinsCache(Blockchain* blockchain,
+                                                 const uint64_t maxBytes) {
+    this->blockchain = blockchain;
+    this->maxBytes = maxBytes;
+    bytes = 0;
+    dirtyBytes = 0;
+    generation = 0;
+    lastFlush = std::chrono::steady_clock::now();
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+    flushes = 0;
+    flushedOutputs = 0;
+    lastFlushMs = 0;
+    totalFlushMs = 0;
+}
+
+bool CryptoKernel::Blockchain::CoinsCache::get(Storage::Transaction* dbTx,
+                                               const std::string& id, Coin& coin) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return load(lock, dbTx, id, coin);
+}
+
+bool CryptoKernel::Blockchain::CoinsCache::load(std::unique_lock<std::mutex>& lock,
+                                                Storage::Transaction* dbTx,
+                                                const std::string& id, Coin& coin) {
+    const auto batch = pending.find(dbTx);
+    if(batch != pending.end()) {
+        const auto it = batch->second.entries.find(id);
+        if(it != batch->second.entries.end()) {
+            hits++;
+            coin = it->second.coin;
+            return !it->second.erased;
+        }
+    }
+
+    const auto it = entries.find(id);
+    if(it != entries.end()) {
+        lru.splice(lru.begin(), lru, it->second.second);
+        hits++;
+        coin = it->second.first.coin;
+        return true;
+    }
+
+    misses++;
+    const uint64_t readGeneration = generation;
+    lock.unlock();
+
+    Json::Value outputJson = blockchain->utxos->get(dbTx, id);
+    coin.spent = !outputJson.isObject();
+    if(coin.spent) {
+        outputJson = blockchain->stxos->get(dbTx, id);
+        if(!outputJson.isObject()) {
+            lock.lock();
+            return false;
+        }
+    }
+
+    coin.output = std::make_shared<const dbOutput>(outputJson);
+    const Entry entry = makeEntry(coin, id);
+
+    lock.lock();
+
+    // Snapshots can be older than the cache so only writers fill it. A
+    // transaction with a batch reads its own writes, which are only cached
+    // once the batch commits.
+    if(dbTx->snapshot == nullptr) {
+        const auto batch = pending.find(dbTx);
+        if(batch != pending.end()) {
+            batch->second.entries.emplace(id, entry);
+        } else if(readGeneration == generation && entries.find(id) == entries.end()) {
+            setEntry(id, entry);
+            evict();
+        }
+    }
+
+    return true;
+}
+
+CryptoKernel::Blockchain::CoinsCache::Entry CryptoKernel::Blockchain::CoinsCache::makeEntry(
+    const Coin& coin, const std::string& id) const {
+    Entry entry;
+    entry.coin = coin;
+    entry.erased = false;
+    entry.changed = false;
+    entry.dirty = false;
+
+    // Roughly what the map, the list and the decoded output take up
+    entry.bytes = sizeof(CacheEntry) + 2 * id.size() + 64;
+    if(coin.output) {
+        entry.bytes += sizeof(dbOutput) +
+                       CryptoKernel::Storage::toString(coin.output->getData()).size();
+    }
+
+    return entry;
+}
+
+void CryptoKernel::Blockchain::CoinsCache::setEntry(const std::string& id, const Entry& entry) {
+    const auto it = entries.find(id);
+    if(it != entries.end()) {
+        bytes -= it->second.first.bytes;
+        if(it->second.first.dirty) {
+            dirtyBytes -= it->second.first.bytes;
+        }
+        it->second.first = entry;
+        lru.splice(lru.begin(), lru, it->second.second);
+    } else {
+        lru.push_front(id);
+        entries.emplace(id, CacheEntry(entry, lru.begin()));
+    }
+
+    bytes += entry.bytes;
+    if(entry.dirty) {
+        dirtyBytes += entry.bytes;
+    }
+}
+
+void CryptoKernel::Blockchain::CoinsCache::removeEntry(const std::string& id) {
+    const auto it = entries.find(id);
+    if(it != entries.end()) {
+        bytes -= it->second.first.bytes;
+        if(it->second.first.dirty) {
+            dirtyBytes -= it->second.first.bytes;
+        }
+        lru.erase(it->second.second);
+        entries.erase(it);
+    }
+}
+
+void CryptoKernel::Blockchain::CoinsCache::evict() {
+    // Dirty outputs are not in the tables yet so only clean ones can go
+    auto it = lru.end();
+    while(bytes > maxBytes && it != lru.begin()) {
+        --it;
+        const auto entry = entries.find(*it);
+        if(!entry->second.first.dirty) {
+            bytes -= entry->second.first.bytes;
+            entries.erase(entry);
+            it = lru.erase(it);
+            evictions++;
+        }
+    }
+}
+
+void CryptoKernel::Blockchain::CoinsCache::add(Storage::Transaction* dbTx, const dbOutput& out) {
+    Coin coin;
+    coin.output = std::make_shared<const dbOutput>(out);
+    coin.spent = false;
+
+    const std::string id = out.getId().toString();
+    Entry entry = makeEntry(coin, id);
+    entry.changed = true;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    getPending(dbTx).entries[id] = entry;
+}
+
+CryptoKernel::Blockchain::CoinsCache::Coin CryptoKernel::Blockchain::CoinsCache::spend(
+    Storage::Transaction* dbTx, const std::string& id) {
+    std::unique_lock<std::mutex> lock(mutex);
+    Pending& batch = getPending(dbTx);
+
+    Coin coin;
+    if(!load(lock, dbTx, id, coin)) {
+        throw NotFoundException("Output " + id);
+    }
+
+    coin.spent = true;
+    Entry entry = makeEntry(coin, id);
+    entry.changed = true;
+    entry.dirty = true;
+    batch.entries[id] = entry;
+
+    return coin;
+}
+
+CryptoKernel::Blockchain::CoinsCache::Coin CryptoKernel::Blockchain::CoinsCache::unspend(
+    Storage::Transaction* dbTx, const std::string& id) {
+    std::unique_lock<std::mutex> lock(mutex);
+    Pending& batch = getPending(dbTx);
+
+    Coin coin;
+    if(!load(lock, dbTx, id, coin)) {
+        throw NotFoundException("Output " + id);
+    }
+
+    coin.spent = false;
+    Entry entry = makeEntry(coin, id);
+    entry.changed = true;
+    entry.dirty = true;
+    batch.entries[id] = entry;
+    batch.reorg = true;
+
+    return coin;
+}
+
+void CryptoKernel::Blockchain::CoinsCache::restore(Storage::Transaction* dbTx, const dbOutput& out) {
+    Coin coin;
+    coin.output = std::make_shared<const dbOutput>(out);
+    coin.spent = false;
+
+    const std::string id = out.getId().toString();
+    Entry entry = makeEntry(coin, id);
+    entry.changed = true;
+    entry.dirty = true;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Pending& batch = getPending(dbTx);
+    batch.entries[id] = entry;
+    batch.reorg = true;
+}
+
+void CryptoKernel::Blockchain::CoinsCache::erase(Storage::Transaction* dbTx, const std::string& id) {
+    Entry entry = makeEntry(Coin{nullptr, false}, id);
+    entry.erased = true;
+    entry.changed = true;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Pending& batch = getPending(dbTx);
+    batch.entries[id] = entry;
+    batch.reorg = true;
+}
+
+CryptoKernel::Blockchain::CoinsCache::Pending& CryptoKernel::Blockchain::CoinsCache::getPending(
+    Storage::Transaction* dbTx) {
+    const auto it = pending.find(dbTx);
+    if(it == pending.end()) {
+        throw std::runtime_error("Outputs can only be changed inside a coins batch");
+    }
+
+    return it->second;
+}
+
+void CryptoKernel::Blockchain::CoinsCache::write(Storage::Transaction* dbTx,
+                                                 const std::string& id, const Coin& coin) {
+    if(coin.spent) {
+        blockchain->stxos->put(dbTx, id, coin.output->toJson());
+        blockchain->utxos->erase(dbTx, id);
+    } else {
+        blockchain->utxos->put(dbTx, id, coin.output->toJson());
+        blockchain->stxos->erase(dbTx, id);
+    }
+}
+
+void CryptoKernel::Blockchain::CoinsCache::commit(Storage::Transaction* dbTx, const bool flush) {
+    const auto start = std::chrono::steady_clock::now();
+
+    // The outputs to flush are copied under the lock and written without it
+    std::vector<std::pair<std::string, Coin>> writes;
+    bool flushing;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const Pending& batch = getPending(dbTx);
+
+        uint64_t batchDirtyBytes = 0;
+        for(const auto& update : batch.entries) {
+            if(update.second.dirty) {
+                batchDirtyBytes += update.second.bytes;
+            }
+        }
+
+        // Blocks are only replayed forwards so a reorg is flushed with the
+        // transaction that makes it
+        flushing = flush || batch.reorg || dirtyBytes + batchDirtyBytes > maxBytes / 2 ||
+                   start - lastFlush > std::chrono::seconds(flushInterval);
+
+        if(flushing) {
+            for(const auto& entry : entries) {
+                if(entry.second.first.dirty && batch.entries.find(entry.first) == batch.entries.end()) {
+                    writes.emplace_back(entry.first, entry.second.first.coin);
+                }
+            }
+
+            for(const auto& update : batch.entries) {
+                if(update.second.dirty) {
+                    writes.emplace_back(update.first, update.second.coin);
+                }
+            }
+        }
+    }
+
+    if(flushing) {
+        for(const auto& update : writes) {
+            write(dbTx, update.first, update.second);
+        }
+
+        blockchain->blocks->put(dbTx, "coinstip",
+                                blockchain->getBlockDB(dbTx, "tip").getId().toString());
+    }
+
+    // The bodies the commit points at must be on disk before it is, whether
+    // or not the profile syncs the database. Otherwise a crash can keep the
+    // positions and lose the bytes, and the database no longer holds them.
+    blockchain->blockStore->sync();
+
+    // Writers that read the outputs also read the index, so one that reads
+    // the committed tables before the batch is published conflicts there
+    blockchain->blockIndex->commit(dbTx);
+
+    // Bumping the generation and reconciling the mempool with the batch
+    // happen under mempoolMutex, where submitTransaction checks the
+    // generation. mempoolMutex is taken before the coins mutex.
+    std::lock_guard<std::mutex> mempoolLock(blockchain->mempoolMutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const Pending& batch = getPending(dbTx);
+        const bool current = batch.generation == generation;
+        generation++;
+
+        for(const auto& update : batch.entries) {
+            const Entry& entry = update.second;
+            if(entry.erased) {
+                removeEntry(update.first);
+            } else if(entry.changed) {
+                setEntry(update.first, entry);
+            } else if(current && entries.find(update.first) == entries.end()) {
+                setEntry(update.first, entry);
+            }
+        }
+
+        if(flushing) {
+            // Outputs changed again since they were copied stay dirty
+            for(const auto& update : writes) {
+                const auto it = entries.find(update.first);
+                if(it != entries.end() && it->second.first.dirty &&
+                   it->second.first.coin.output == update.second.output &&
+                   it->second.first.coin.spent == update.second.spent) {
+                    it->second.first.dirty = false;
+                    dirtyBytes -= it->second.first.bytes;
+                }
+            }
+
+            const auto end = std::chrono::steady_clock::now();
+            lastFlush = end;
+            lastFlushMs = std::chrono::duration<double, std::milli>(end - start).count();
+            totalFlushMs += lastFlushMs;
+            flushes++;
+            flushedOutputs += writes.size();
+        }
+
+        evict();
+    }
+
+    blockchain->applyMempoolChanges(dbTx);
+}
+
+uint64_t CryptoKernel::Blockchain::CoinsCache::getGeneration() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return generation;
+}
+
+void CryptoKernel::Blockchain::CoinsCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    lru.clear();
+    bytes = 0;
+    dirtyBytes = 0;
+    generation++;
+}
+
+Json::Value CryptoKernel::Blockchain::CoinsCache::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Json::Value returning;
+    returning["maxBytes"] = Json::UInt64(maxBytes);
+    returning["bytes"] = Json::UInt64(bytes);
+    returning["dirtyBytes"] = Json::UInt64(dirtyBytes);
+    returning["outputs"] = Json::UInt64(entries.size());
+    returning["hits"] = Json::UInt64(hits);
+    returning["misses"] = Json::UInt64(misses);
+    returning["hitRate"] = hits + misses > 0 ? double(hits) / (hits + misses) : 0.0;
+    returning["evictions"] = Json::UInt64(evictions);
+    returning["flushes"] = Json::UInt64(flushes);
+    returning["flushedOutputs"] = Json::UInt64(flushedOutputs);
+    returning["lastFlushMs"] = lastFlushMs;
+    returning["averageFlushMs"] = flushes > 0 ? totalFlushMs / flushes : 0.0;
+    return returning;
+}
+
+CryptoKernel::Blockchain::CoinsCache::Batch::Batch(CoinsCache* cache,
+                                                   Storage::Transaction* dbTx) {
+    this->cache = cache;
+    this->dbTx = dbTx;
+
+    // Blocks are connected through the same transactions as their spends
+    cache->blockchain->blockIndex->begin(dbTx);
+
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    cache->pending[dbTx] = Pending{{}, false, cache->generation};
+}
+
+CryptoKernel::Blockchain::CoinsCache::Batch::~Batch() {
+    cache->blockchain->blockIndex->end(dbTx);
+
+    {
+        std::lock_guard<std::mutex> lock(cache->blockchain->mempoolMutex);
+        cache->blockchain->mempoolChanges.erase(dbTx);
+    }
+
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    cache->pending.erase(dbTx);
+}
+
+void CryptoKernel::Blockchain::CoinsCache::Batch::commit(const bool flush) {
+    cache->commit(dbTx, flush);
+}
+
+CryptoKernel::Blockchain::BlockIndex::BlockIndex(Blockchain* blockchain) {
+    this->blockchain = blockchain;
+    generation = 0;
+    committing = nullptr;
+}
+
+void CryptoKernel::Blockchain::BlockIndex::load(Storage::Transaction* dbTx) {
+    struct Header {
+        uint256 id;
+        uint256 previousBlockId;
+        uint64_t height;
+        uint64_t timestamp;
+        bool mainChain;
+    };
+
+    // The stored headers are trusted like everything else read back from
+    // the tables, so they are not hashed again
+    std::vector<Header> headers;
+    for(Storage::Table* table : {blockchain->blocks.get(), blockchain->candidates.get()}) {
+        Storage::Table::Iterator it(table, blockchain->blockdb.get(), dbTx->snapshot);
+        for(it.SeekToFirst(); it.Valid(); it.Next()) {
+            const std::string key = it.key();
+            if(key == "tip" || key == "coinstip") {
+                continue;
+            }
+
+            const Json::Value json = it.value();
+            headers.push_back(Header{uint256(key), uint256(json["previousBlockId"].asString()),
+                                     json["height"].asUInt64(), json["timestamp"].asUInt64(),
+                                     table == blockchain->blocks.get()});
+        }
+    }
+
+    // Parents before their children
+    std::sort(headers.begin(), headers.end(), [](const Header& a, const Header& b) {
+        return a.height < b.height;
+    });
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    mainChain.clear();
+    for(const Header& header : headers) {
+        Entry* entry = makeEntry(nullptr, header.id, header.previousBlockId, header.height,
+                                 header.timestamp);
+        if(header.mainChain) {
+            mainChain.push_back(entry);
+        }
+    }
+
+    const Json::Value tipJson = blockchain->blocks->get(dbTx, "tip");
+    tip.reset();
+    if(tipJson.isObject()) {
+        tip = std::make_shared<const dbBlock>(tipJson);
+    }
+
+    if((tip && (mainChain.empty() || mainChain.back()->id != tip->getId())) ||
+       (!mainChain.empty() && mainChain.back()->height != mainChain.size())) {
+        throw std::runtime_error("The main chain in the blocks table has gaps");
+    }
+
+    generation++;
+}
+
+void CryptoKernel::Blockchain::BlockIndex::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    mainChain.clear();
+    tip.reset();
+    generation++;
+}
+
+CryptoKernel::Blockchain::BlockIndex::Pending* CryptoKernel::Blockchain::BlockIndex::getPending(
+    Storage::Transaction* dbTx) {
+    const auto it = pending.find(dbTx);
+    if(it == pending.end()) {
+        return nullptr;
+    }
+
+    it->second.used = true;
+    return &it->second;
+}
+
+const CryptoKernel::Blockchain::BlockIndex::Entry* CryptoKernel::Blockchain::BlockIndex::find(
+    const Pending* batch, const uint256& id) const {
+    if(batch != nullptr) {
+        const auto it = batch->entries.find(id);
+        if(it != batch->entries.end()) {
+            return it->second.get();
+        }
+    }
+
+    const auto it = entries.find(id);
+    return it == entries.end() ? nullptr : it->second.get();
+}
+
+const CryptoKernel::Blockchain::BlockIndex::Entry* CryptoKernel::Blockchain::BlockIndex::findByHeight(
+    const Pending* batch, const uint64_t height) const {
+    const uint64_t kept = batch != nullptr ? batch->kept : mainChain.size();
+    const uint64_t length = kept + (batch != nullptr ? batch->connected.size() : 0);
+    if(height == 0 || height > length) {
+        return nullptr;
+    }
+
+    return height <= kept ? mainChain[height - 1] : batch->connected[height - 1 - kept];
+}
+
+CryptoKernel::Blockchain::BlockIndex::Entry* CryptoKernel::Blockchain::BlockIndex::makeEntry(
+    Pending* batch, const uint256& id, const uint256& previousBlockId, const uint64_t height,
+    const uint64_t timestamp) {
+    std::unique_ptr<Entry> entry(new Entry{id, find(batch, previousBlockId), height, timestamp});
+    Entry* returning = entry.get();
+    (batch != nullptr ? batch->entries : entries)[id] = std::move(entry);
+    return returning;
+}
+
+std::shared_ptr<const CryptoKernel::Blockchain::dbBlock> CryptoKernel::Blockchain::BlockIndex::getTip(
+    Storage::Transaction* dbTx) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Pending* batch = getPending(dbTx);
+    return batch != nullptr ? batch->tip : tip;
+}
+
+const CryptoKernel::Blockchain::BlockIndex::Entry* CryptoKernel::Blockchain::BlockIndex::get(
+    Storage::Transaction* dbTx, const uint256& id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return find(getPending(dbTx), id);
+}
+
+const CryptoKernel::Blockchain::BlockIndex::Entry* CryptoKernel::Blockchain::BlockIndex::getByHeight(
+    Storage::Transaction* dbTx, const uint64_t height) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return findByHeight(getPending(dbTx), height);
+}
+
+const CryptoKernel::Blockchain::BlockIndex::Entry* CryptoKernel::Blockchain::BlockIndex::getForkPoint(
+    Storage::Transaction* dbTx, const Entry* entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Pending* batch = getPending(dbTx);
+    while(entry != nullptr && findByHeight(batch, entry->height) != entry) {
+        entry = entry->previous;
+    }
+
+    return entry;
+}
+
+void CryptoKernel::Blockchain::BlockIndex::add(Storage::Transaction* dbTx, const uint256& id,
+        const uint256& previousBlockId, const uint64_t height, const uint64_t timestamp) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Pending* batch = getPending(dbTx);
+    if(find(batch, id) == nullptr) {
+        makeEntry(batch, id, previousBlockId, height, timestamp);
+        batch->changed = true;
+    }
+}
+
+void CryptoKernel::Blockchain::BlockIndex::connect(Storage::Transaction* dbTx, const dbBlock& block) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Pending* batch = getPending(dbTx);
+    const Entry* entry = find(batch, block.getId());
+    if(entry == nullptr) {
+        entry = makeEntry(batch, block.getId(), block.getPreviousBlockId(), block.getHeight(),
+                          block.getTimestamp());
+    }
+
+    batch->connected.push_back(entry);
+    batch->tip = std::make_shared<const dbBlock>(block);
+    batch->changed = true;
+}
+
+void CryptoKernel::Blockchain::BlockIndex::disconnect(Storage::Transaction* dbTx,
+        const dbBlock& newTip) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Pending* batch = getPending(dbTx);
+    if(!batch->connected.empty()) {
+        batch->connected.pop_back();
+    } else {
+        batch->kept--;
+    }
+
+    batch->tip = std::make_shared<const dbBlock>(newTip);
+    batch->changed = true;
+}
+
+void CryptoKernel::Blockchain::BlockIndex::begin(Storage::Transaction* dbTx) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Pending& batch = pending[dbTx];
+    batch.kept = mainChain.size();
+    batch.tip = tip;
+    batch.changed = false;
+    batch.used = false;
+    batch.generation = generation;
+}
+
+void CryptoKernel::Blockchain::BlockIndex::end(Storage::Transaction* dbTx) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.erase(dbTx);
+}
+
+void CryptoKernel::Blockchain::BlockIndex::commit(Storage::Transaction* dbTx) {
+    Pending* batch = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto it = pending.find(dbTx);
+        if(it != pending.end()) {
+            batch = &it->second;
+            // A transaction that read the index conflicts with one whose
+            // changes are published or still being written, so no writer
+            // reads the tables after a commit and the index from before it
+            if(batch->used && (batch->generation != generation || committing != nullptr)) {
+                dbTx->abort();
+                throw Storage::ConflictException("The block index changed during the transaction");
+            }
+
+            if(batch->changed) {
+                committing = dbTx;
+            }
+        }
+    }
+
+    // The storage commit can wait on the disk, readers keep using the
+    // published index meanwhile
+    try {
+        dbTx->commit();
+    } catch(...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(committing == dbTx) {
+            committing = nullptr;
+        }
+        throw;
+    }
+
+    if(batch != nullptr && batch->changed) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for(auto& entry : batch->entries) {
+            entries[entry.first] = std::move(entry.second);
+        }
+        batch->entries.clear();
+
+        mainChain.resize(batch->kept);
+        mainChain.insert(mainChain.end(), batch->connected.begin(), batch->connected.end());
+        tip = batch->tip;
+        generation++;
+        committing = nullptr;
+    }
+}
+
+CryptoKernel::Storage::Transaction::ReadStats CryptoKernel::Blockchain::getBlockReadStats() {
+    std::lock_guard<std::mutex> lock(blockReadStatsMutex);
+    return blockReadStats;
+}
+
+bool CryptoKernel::Blockchain::verifySignature(const std::string& publicKey,
+        const std::string& message, const std::string& signature) {
+    if(sigCache->contains("ecdsa", publicKey, message, signature)) {
+        return true;
+    }
+
+    CryptoKernel::Crypto crypto;
+    crypto.setPublicKey(publicKey);
+    if(!crypto.verify(message, signature)) {
+        return false;
+    }
+
+    sigCache->insert("ecdsa", publicKey, message, signature);
+
+    return true;
+}
+
+Json::Value CryptoKernel::Blockchain::getSignatureCacheInfo() {
+    const SignatureCache::Stats stats = sigCache->getStats();
+
+    Json::Value returning;
+    returning["entries"] = Json::UInt64(stats.entries);
+    returning["maxEntries"] = Json::UInt64(stats.maxEntries);
+    returning["hits"] = Json::UInt64(stats.hits);
+    returning["misses"] = Json::UInt64(stats.misses);
+    returning["evictions"] = Json::UInt64(stats.evictions);
+
+    const uint64_t lookups = stats.hits + stats.misses;
+    returning["hitRate"] = lookups > 0 ? double(stats.hits) / lookups : 0.0;
+
+    return returning;
+}
+
+CryptoKernel::Blockchain::VerifyStats CryptoKernel::Blockchain::getBlockVerifyStats() {
+    std::lock_guard<std::mutex> lock(blockVerifyStatsMutex);
+    return blockVerifyStats;
+}
+
+void CryptoKernel::Blockchain::setVerifyThreads(const unsigned int threads) {
+    verifyPool.reset(new ThreadPool(threads));
+}
+
 unsigned int CryptoKernel::Blockchain::mempoolCount() const {
     return unconfirmedTransactions.count();
 }
@@ -1134,3 +2766,244 @@ unsigned int CryptoKernel::Blockchain::mempoolCount() const {
 unsigned int CryptoKernel::Blockchain::mempoolSize() const {
     return unconfirmedTransactions.size();
 }
+
+Json::Value CryptoKernel::Blockchain::getMempoolInfo() {
+    std::lock_guard<std::mutex> lock(mempoolMutex);
+
+    Json::Value returning;
+    returning["count"] = unconfirmedTransactions.count();
+    returning["bytes"] = unconfirmedTransactions.size();
+    returning["usage"] = Json::UInt64(unconfirmedTransactions.usage());
+    returning["maxUsage"] = Json::UInt64(unconfirmedTransactions.getMaxUsage());
+    returning["evictions"] = Json::UInt64(unconfirmedTransactions.getEvictions());
+    returning["minFeeRate"] = unconfirmedTransactions.getMinFeeRate();
+
+    return returning;
+}
+
+unsigned int CryptoKernel::Blockchain::rescanMempool() {
+    std::unique_ptr<Storage::Transaction> dbTx(blockdb->begin());
+
+    std::lock_guard<std::mutex> lock(mempoolMutex);
+    const unsigned int evicted = unconfirmedTransactions.rescanMempool(dbTx.get(), this);
+    dbTx->abort();
+
+    log->printf(LOG_LEVEL_INFO,
+                "blockchain::rescanMempool(): Evicted " + std::to_string(evicted) +
+                " transactions");
+
+    return evicted;
+}
+
+namespace {
+    // Mempool files start with a magic and a version, then hold each
+    // transaction as a little-endian 32-bit length and its binary encoding
+    const std::string mempoolMagic = "ckmempool";
+    const char mempoolVersion = 1;
+}
+
+std::string CryptoKernel::Blockchain::getBlockStoreDirectory() const {
+    return dbDir + ".blocks";
+}
+
+std::string CryptoKernel::Blockchain::getMempoolFile() const {
+    // Beside rather than inside dbDir, which is a single file under LMDB
+    return dbDir + ".mempool";
+}
+
+unsigned int CryptoKernel::Blockchain::saveMempool() {
+    std::vector<transaction> txs;
+    {
+        std::lock_guard<std::mutex> lock(mempoolMutex);
+        txs = unconfirmedTransactions.getAllTransactions();
+    }
+
+    const std::string filename = getMempoolFile();
+    const std::string tempFilename = filename + ".new";
+
+    std::ofstream f(tempFilename, std::ios::binary | std::ios::trunc);
+    if(!f.is_open()) {
+        throw std::runtime_error("Could not open " + tempFilename);
+    }
+
+    f.write(mempoolMagic.data(), mempoolMagic.size());
+    f.put(mempoolVersion);
+    for(const transaction& tx : txs) {
+        const std::string data = Storage::toBinary(tx.toJson());
+        const uint32_t length = data.size();
+        for(unsigned int i = 0; i < 4; i++) {
+            f.put(char((length >> (8 * i)) & 0xff));
+        }
+        f.write(data.data(), data.size());
+    }
+
+    f.close();
+    if(!f) {
+        std::remove(tempFilename.c_str());
+        throw std::runtime_error("Could not write " + tempFilename);
+    }
+
+    // Replaced whole so a crash while writing leaves the last snapshot intact
+    if(std::rename(tempFilename.c_str(), filename.c_str()) != 0) {
+        std::remove(tempFilename.c_str());
+        throw std::runtime_error("Could not rename " + tempFilename + " to " + filename);
+    }
+
+    log->printf(LOG_LEVEL_INFO, "blockchain::saveMempool(): Saved " + std::to_string(txs.size()) +
+                " transactions");
+
+    return txs.size();
+}
+
+void CryptoKernel::Blockchain::loadMempool() {
+    const std::string filename = getMempoolFile();
+    std::ifstream f(filename, std::ios::binary);
+    if(!f.is_open()) {
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    const std::string contents((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    f.close();
+
+    // Removed now so a snapshot that crashes the node is not loaded again
+    std::remove(filename.c_str());
+
+    if(contents.compare(0, mempoolMagic.size(), mempoolMagic) != 0 ||
+       contents.size() <= mempoolMagic.size() || contents[mempoolMagic.size()] != mempoolVersion) {
+        log->printf(LOG_LEVEL_WARN, "blockchain::loadMempool(): " + filename +
+                    " is not a mempool snapshot, ignoring it");
+        return;
+    }
+
+    std::vector<transaction> txs;
+    size_t pos = mempoolMagic.size() + 1;
+    while(pos + 4 <= contents.size()) {
+        uint32_t length = 0;
+        for(unsigned int i = 0; i < 4; i++) {
+            length |= uint32_t(static_cast<unsigned char>(contents[pos + i])) << (8 * i);
+        }
+        pos += 4;
+
+        if(length > contents.size() - pos) {
+            break;
+        }
+
+        try {
+            txs.emplace_back(Storage::fromBinary(contents.substr(pos, length)));
+        } catch(const std::exception& e) {
+            log->printf(LOG_LEVEL_WARN, "blockchain::loadMempool(): Skipping a malformed transaction");
+        }
+        pos += length;
+    }
+
+    if(pos != contents.size()) {
+        log->printf(LOG_LEVEL_WARN, "blockchain::loadMempool(): " + filename + " is truncated");
+    }
+
+    unsigned int restored = 0;
+    unsigned int trimmed = 0;
+    for(unsigned int attempt = 1; ; attempt++) {
+        std::unique_ptr<Storage::Transaction> dbTx(blockdb->begin());
+        const uint64_t coinsGeneration = coins->getGeneration();
+
+        // Inputs are looked up one transaction at a time, signatures checked in parallel
+        std::vector<std::vector<std::shared_ptr<const dbOutput>>> spentOutputs(txs.size());
+        std::vector<uint64_t> fees(txs.size(), 0);
+        std::vector<char> scripted(txs.size(), false);
+        std::vector<char> valid(txs.size(), false);
+        std::vector<size_t> candidates;
+        for(size_t i = 0; i < txs.size(); i++) {
+            bool isScripted = false;
+            if(std::get<0>(verifyMempoolState(dbTx.get(), txs[i], spentOutputs[i], fees[i], isScripted))) {
+                scripted[i] = isScripted;
+                candidates.push_back(i);
+            }
+        }
+
+        verifyPool->parallelFor(candidates.size(), [&](const size_t i) {
+            const size_t index = candidates[i];
+            valid[index] = std::get<0>(verifyTransactionRules(dbTx.get(), txs[index], spentOutputs[index]));
+            return true;
+        });
+
+        std::vector<size_t> accepted;
+        for(const size_t i : candidates) {
+            if(valid[i] && consensus->submitTransaction(dbTx.get(), txs[i])) {
+                accepted.push_back(i);
+            }
+        }
+
+        // Admitted the way submitTransaction admits, and taken out again if
+        // the consensus state they were submitted with does not commit
+        // Only what this attempt inserted and trim() kept is taken out
+        std::vector<size_t> inserted;
+        trimmed = 0;
+        bool conflict = false;
+        {
+            std::lock_guard<std::mutex> lock(mempoolMutex);
+            conflict = coins->getGeneration() != coinsGeneration;
+            if(!conflict) {
+                for(const size_t i : accepted) {
+                    if(unconfirmedTransactions.insert(txs[i], fees[i], scripted[i])) {
+                        inserted.push_back(i);
+                    }
+                }
+
+                if(unconfirmedTransactions.trim() > 0) {
+                    std::vector<size_t> kept;
+                    for(const size_t i : inserted) {
+                        if(unconfirmedTransactions.contains(txs[i].getId())) {
+                            kept.push_back(i);
+                        } else {
+                            trimmed++;
+                        }
+                    }
+                    inserted = std::move(kept);
+                }
+            }
+        }
+
+        if(!conflict) {
+            try {
+                dbTx->commit();
+            } catch(const Storage::ConflictException& e) {
+                conflict = true;
+
+                std::lock_guard<std::mutex> lock(mempoolMutex);
+                for(const size_t i : inserted) {
+                    unconfirmedTransactions.remove(txs[i]);
+                }
+                inserted.clear();
+                trimmed = 0;
+            }
+        }
+
+        restored = inserted.size();
+
+        if(!conflict) {
+            break;
+        }
+
+        if(attempt < commitAttempts) {
+            log->printf(LOG_LEVEL_INFO,
+                        "blockchain::loadMempool(): Retrying the restore after a write conflict");
+            continue;
+        }
+
+        log->printf(LOG_LEVEL_WARN, "blockchain::loadMempool(): Gave up after " +
+                    std::to_string(attempt) + " write conflicts, no transactions were restored");
+        break;
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now() - start).count();
+    if(trimmed > 0) {
+        log->printf(LOG_LEVEL_INFO, "blockchain::loadMempool(): Dropped " + std::to_string(trimmed) +
+                    " transactions to keep the mempool within its size limit");
+    }
+    log->printf(LOG_LEVEL_INFO, "blockchain::loadMempool(): Restored " + std::to_string(restored) +
+                " of " + std::to_string(txs.size()) + " transactions in " +
+                std::to_string(elapsed) + "ms");
+}
@@ -22,19 +22,35 @@
 #include <set>
 #include <memory>
 #include <map>
+#include <list>
+#include <unordered_map>
+#include <chrono>
 
 #include "storage.h"
+#include "blockstore.h"
 #include "log.h"
 #include "ckmath.h"
+#include "uint256.h"
+#include "threadpool.h"
+#include "sigcache.h"
 
 namespace CryptoKernel {
 class Consensus;
 class Blockchain {
 public:
     Blockchain(CryptoKernel::Log* GlobalLog,
-               const std::string& dbDir);
+               const std::string& dbDir,
+               const Storage::Profile& storageProfile = Storage::Profile::chainstate(),
+               const uint64_t coinsCacheSize = defaultCoinsCacheSize,
+               const uint64_t mempoolMaxUsage = defaultMempoolMaxUsage);
     virtual ~Blockchain();
 
+    // Bytes of decoded outputs kept in memory in front of the chainstate
+    static const uint64_t defaultCoinsCacheSize = 256 * 1024 * 1024;
+
+    // Bytes of memory the mempool may use before it evicts its cheapest transactions
+    static const uint64_t defaultMempoolMaxUsage = 300 * 1024 * 1024;
+
     class InvalidElementException : public std::exception {
     public:
         InvalidElementException(const std::string& message) {
@@ -66,50 +82,62 @@ public:
         output(const uint64_t value, const uint64_t nonce, const Json::Value& data);
         output(const Json::Value& jsonOutput);
 
+        /**
+        * Loads an output that was verified before it was stored, taking its
+        * id as given instead of hashing and checking it again
+        *
+        * @param jsonOutput the stored output
+        * @param id the id it was stored with
+        */
+        output(const Json::Value& jsonOutput, const uint256& id);
+
         Json::Value toJson() const;
 
         uint64_t getValue() const;
         uint64_t getNonce() const;
-        Json::Value getData() const;
+        const Json::Value& getData() const;
 
-        BigNum getId() const;
+        uint256 getId() const;
 
         bool operator<(const output& rhs) const;
 
     private:
         void checkRep();
 
-        BigNum calculateId();
+        uint256 calculateId();
 
         uint64_t value;
         uint64_t nonce;
         Json::Value data;
 
-        BigNum id;
+        uint256 id;
     };
 
     class input {
     public:
-        input(const BigNum& outputId, const Json::Value& data);
+        input(const uint256& outputId, const Json::Value& data);
         input(const Json::Value& inputJson);
 
+        // Loads a stored input with the id it was stored under, see output
+        input(const Json::Value& inputJson, const uint256& id);
+
         Json::Value toJson() const;
 
-        Json::Value getData() const;
-        BigNum getOutputId() const;
-        BigNum getId() const;
+        const Json::Value& getData() const;
+        uint256 getOutputId() const;
+        uint256 getId() const;
 
         bool operator<(const input& rhs) const;
 
     private:
         void checkRep();
 
-        BigNum calculateId();
+        uint256 calculateId();
 
-        BigNum outputId;
+        uint256 outputId;
         Json::Value data;
 
-        BigNum id;
+        uint256 id;
 
     };
 
@@ -119,16 +147,25 @@ public:
                     const uint64_t timestamp, const bool coinbaseTx = false);
         transaction(const Json::Value& jsonTransaction, const bool coinbaseTx = false);
 
+        /**
+        * Rebuilds a confirmed transaction from stored puts without checking
+        * or hashing them again
+        *
+        * @param id the id the transaction was stored under
+        */
+        transaction(const std::set<input>& inputs, const std::set<output>& outputs,
+                    const uint64_t timestamp, const uint256& id);
+
         Json::Value toJson() const;
 
-        BigNum getId() const;
+        uint256 getId() const;
         uint64_t getTimestamp() const;
-        std::set<input> getInputs() const;
-        std::set<output> getOutputs() const;
+        const std::set<input>& getInputs() const;
+        const std::set<output>& getOutputs() const;
 
-        BigNum getOutputSetId() const;
+        uint256 getOutputSetId() const;
 
-        static BigNum getOutputSetId(const std::set<output>& outputs);
+        static uint256 getOutputSetId(const std::set<output>& outputs);
 
         bool operator<(const transaction& rhs) const;
 
@@ -137,54 +174,119 @@ public:
     private:
         void checkRep(const bool coinbaseTx);
 
-        BigNum calculateId();
+        uint256 calculateId();
 
-        std::set<input> inputs;
-        std::set<output> outputs;
+        // Immutable once constructed, so copies of a transaction share them
+        std::shared_ptr<const std::set<input>> inputs;
+        std::shared_ptr<const std::set<output>> outputs;
         uint64_t timestamp;
 
-        BigNum id;
+        uint256 id;
 
         unsigned int bytes;
     };
 
+    class block;
+    class dbBlock;
+
+    /**
+    * The fields of a block that its id covers, without its transactions.
+    * The transactions are represented by their merkle root, so a header
+    * can be parsed, hashed and checked against the consensus rules before
+    * the block body is downloaded or parsed.
+    */
+    class blockHeader {
+    public:
+        blockHeader(const block& fullBlock);
+        blockHeader(const dbBlock& storedBlock);
+
+        /**
+        * Parses a header from block or header JSON. Only the coinbase
+        * transaction is parsed, the other transactions are skipped.
+        */
+        blockHeader(const Json::Value& jsonBlock);
+
+        Json::Value toJson() const;
+
+        uint256 getCoinbaseTx() const;
+        uint256 getPreviousBlockId() const;
+        uint64_t getTimestamp() const;
+        const Json::Value& getConsensusData() const;
+        const Json::Value& getData() const;
+        uint64_t getHeight() const;
+        uint256 getTransactionMerkleRoot() const;
+
+        /**
+        * Returns true iff the block has transactions besides the coinbase
+        */
+        bool hasTransactions() const;
+
+        uint256 getId() const;
+
+    private:
+        void checkRep();
+
+        uint256 calculateId();
+
+        uint256 coinbaseTx;
+        uint256 previousBlockId;
+        uint64_t timestamp;
+        Json::Value consensusData;
+        Json::Value data;
+        uint64_t height;
+        bool transactions;
+        uint256 transactionMerkleRoot;
+
+        uint256 id;
+    };
+
     class block {
     public:
         block(const std::set<transaction>& transactions, const transaction& coinbaseTx,
-              const BigNum& previousBlockId, const uint64_t timestamp, const Json::Value& consensusData,
+              const uint256& previousBlockId, const uint64_t timestamp, const Json::Value& consensusData,
               const uint64_t height, const Json::Value data = Json::nullValue);
         block(const Json::Value& jsonBlock);
 
+        /**
+        * Rebuilds a block of the main chain from its stored header and
+        * transactions, trusting the header's id and merkle root
+        */
+        block(const std::set<transaction>& transactions, const transaction& coinbaseTx,
+              const dbBlock& header);
+
         Json::Value toJson() const;
 
-        std::set<transaction> getTransactions() const;
-        transaction getCoinbaseTx() const;
-        BigNum getPreviousBlockId() const;
+        const std::set<transaction>& getTransactions() const;
+        const transaction& getCoinbaseTx() const;
+        uint256 getPreviousBlockId() const;
         uint64_t getTimestamp() const;
-        Json::Value getConsensusData() const;
-		Json::Value getData() const;
+        const Json::Value& getConsensusData() const;
+		const Json::Value& getData() const;
         uint64_t getHeight() const;
-		BigNum getTransactionMerkleRoot() const;
+		uint256 getTransactionMerkleRoot() const;
 
         void setConsensusData(const Json::Value& data);
 
-        BigNum getId() const;
+        uint256 getId() const;
+
+        blockHeader getHeader() const;
 
     private:
         void checkRep();
 
-        BigNum calculateId();
+        uint256 calculateId();
 
-        std::set<transaction> transactions;
+        // Shared between copies of the block like a transaction's puts
+        std::shared_ptr<const std::set<transaction>> transactions;
         transaction coinbaseTx;
-        BigNum previousBlockId;
+        uint256 previousBlockId;
         uint64_t timestamp;
         Json::Value consensusData;
 		Json::Value data;
         uint64_t height;
-		BigNum transactionMerkleRoot;
+		uint256 transactionMerkleRoot;
 
-        BigNum id;
+        uint256 id;
     };
 
     class dbBlock {
@@ -195,33 +297,35 @@ public:
 
         Json::Value toJson() const;
 
-        std::set<BigNum> getTransactions() const;
-        BigNum getCoinbaseTx() const;
-        BigNum getPreviousBlockId() const;
+        std::set<uint256> getTransactions() const;
+        uint256 getCoinbaseTx() const;
+        uint256 getPreviousBlockId() const;
         uint64_t getTimestamp() const;
         Json::Value getConsensusData() const;
 		Json::Value getData() const;
-		BigNum getTransactionMerkleRoot() const;
+		uint256 getTransactionMerkleRoot() const;
 
         uint64_t getHeight() const;
 
-        BigNum getId() const;
+        uint256 getId() const;
+
+        blockHeader getHeader() const;
 
     private:
         void checkRep();
 
-        BigNum calculateId();
+        uint256 calculateId();
 
-        std::set<BigNum> transactions;
-        BigNum coinbaseTx;
-        BigNum previousBlockId;
+        std::set<uint256> transactions;
+        uint256 coinbaseTx;
+        uint256 previousBlockId;
         uint64_t timestamp;
         Json::Value consensusData;
 		Json::Value data;
         uint64_t height;
-		BigNum transactionMerkleRoot;
+		uint256 transactionMerkleRoot;
 
-        BigNum id;
+        uint256 id;
     };
 
     class dbInput : public input {
@@ -234,46 +338,75 @@ public:
 
     class dbOutput : public output {
     public:
-        dbOutput(const output& compactOutput, const BigNum& creationTx);
+        dbOutput(const output& compactOutput, const uint256& creationTx);
+
+        // Stored outputs carry their id, which is trusted rather than recalculated
         dbOutput(const Json::Value& jsonOutput);
 
         Json::Value toJson() const;
 
     private:
-        BigNum creationTx;
+        uint256 creationTx;
     };
 
     class dbTransaction {
     public:
-        dbTransaction(const transaction& compactTransaction, const BigNum& confirmingBlock,
+        dbTransaction(const transaction& compactTransaction, const uint256& confirmingBlock,
                       const bool coinbaseTx = false);
         dbTransaction(const Json::Value& jsonTransaction);
 
+        // Loads a stored transaction with the id it was stored under
+        dbTransaction(const Json::Value& jsonTransaction, const uint256& id);
+
         Json::Value toJson() const;
 
-        BigNum getId() const;
+        uint256 getId() const;
         bool isCoinbaseTx() const;
         uint64_t getTimestamp() const;
-        std::set<BigNum> getInputs() const;
-        std::set<BigNum> getOutputs() const;
+        std::set<uint256> getInputs() const;
+        std::set<uint256> getOutputs() const;
 
     private:
         void checkRep();
 
-        BigNum calculateId();
+        uint256 calculateId();
 
-        BigNum confirmingBlock;
+        uint256 confirmingBlock;
         bool coinbaseTx;
         uint64_t timestamp;
-        std::set<BigNum> inputs;
-        std::set<BigNum> outputs;
+        std::set<uint256> inputs;
+        std::set<uint256> outputs;
 
-        BigNum id;
+        uint256 id;
     };
 
     std::tuple<bool, bool> submitTransaction(const transaction& tx);
     std::tuple<bool, bool> submitBlock(const block& newBlock, bool genesisBlock = false);
 
+    /**
+    * Checks a chain of block headers ahead of their bodies. Each header must
+    * build on the one before it, the first on a block already stored, carry
+    * the next height and pass the consensus rules for headers. Nothing is
+    * stored, submitBlock checks the full blocks again.
+    *
+    * @param headers the headers in chain order
+    * @return a tuple of bools, the first is true iff the headers are valid,
+    *         the second is true iff the peer that sent them should be
+    *         penalised. Both are false if the first header's previous block
+    *         is not stored.
+    */
+    std::tuple<bool, bool> verifyHeaders(const std::vector<blockHeader>& headers);
+
+    /**
+    * Checks a chain of block headers continuing from a header that has
+    * already been checked, see above
+    *
+    * @param previousHeader the checked header the first header builds on
+    * @param headers the headers in chain order
+    */
+    std::tuple<bool, bool> verifyHeaders(const blockHeader& previousHeader,
+                                         const std::vector<blockHeader>& headers);
+
     block generateVerifyingBlock(const std::string& publicKey);
 
     block getBlock(Storage::Transaction* transaction, const std::string& id);
@@ -356,59 +489,582 @@ public:
     unsigned int mempoolCount() const;
     unsigned int mempoolSize() const;
 
-private:
-    std::unique_ptr<Storage::Table> blocks;
-    std::unique_ptr<Storage::Table> candidates;
-    std::unique_ptr<Storage::Table> transactions;
-    std::unique_ptr<Storage::Table> utxos;
-    std::unique_ptr<Storage::Table> stxos;
-    std::unique_ptr<Storage::Table> inputs;
+    /**
+    * Re-verifies every mempool transaction against the current tip and
+    * evicts the ones that are no longer valid. Connecting or reversing a
+    * block only evicts the transactions it conflicts with and re-runs the
+    * scripts of the rest, so this is a maintenance operation.
+    *
+    * @return the number of transactions evicted
+    */
+    unsigned int rescanMempool();
 
-    std::unique_ptr<Storage> blockdb;
-    BigNum genesisBlockId;
-    Log *log;
+    /**
+    * Returns the size and limits of the mempool
+    *
+    * @return a json object with the number of transactions as count, their
+    *         serialized size as bytes, their estimated heap usage as usage,
+    *         the limit on usage as maxUsage, how many transactions were
+    *         evicted to stay under it as evictions, and the fee per byte
+    *         below which transactions are refused as minFeeRate
+    */
+    Json::Value getMempoolInfo();
+
+    /**
+    * Writes every mempool transaction to a file alongside the chainstate
+    * database so it can be restored by loadChain. Called when the
+    * blockchain is destroyed.
+    *
+    * @return the number of transactions written
+    * @throw std::runtime_error if the file could not be written
+    */
+    unsigned int saveMempool();
+
+    /**
+    * Returns the storage read counters of the most recent call to submitBlock
+    *
+    * @return how many reads connecting the last block took, and how many of
+    *         them were repeats served from the transaction's read memo
+    */
+    Storage::Transaction::ReadStats getBlockReadStats();
+
+    /**
+    * Time spent verifying the transactions of a block
+    */
+    struct VerifyStats {
+        size_t transactions;
+        unsigned int threads;
+        // Checking inputs against the chain and the rest of the block, serially
+        double stateMs;
+        // Checking signatures, scripts and fees on the verification pool
+        double rulesMs;
+    };
+
+    /**
+    * Returns the verification timings of the most recent call to submitBlock
+    * that reached transaction verification
+    */
+    VerifyStats getBlockVerifyStats();
+
+    /**
+    * Replaces the pool that verifies block transactions. Must not be called
+    * while a block is being submitted.
+    *
+    * @param threads the number of verification threads
+    */
+    void setVerifyThreads(const unsigned int threads);
+
+    /**
+    * Returns the counters of the cache of verified signatures shared by the
+    * mempool and block verification
+    *
+    * @return a json object with the number of entries and the maximum,
+    *         hits, misses, hitRate and evictions
+    */
+    Json::Value getSignatureCacheInfo();
 
+    /**
+    * Returns the live properties of the chainstate database, of the
+    * cache of outputs in front of it and of the block store beside it
+    *
+    * @return a json object as described in Storage::getProperties() with
+    *         the coins cache counters under "coins" and the number of
+    *         segments and bytes of the block store under "blockStore"
+    */
+    Json::Value getStorageInfo();
+
+    /**
+    * Transactions waiting to be confirmed, indexed by the outputs they spend
+    * and create and by fee per byte. Transactions only spend confirmed
+    * outputs, so there are no chains of unconfirmed transactions to select
+    * together. Not thread-safe, the blockchain guards its pool with
+    * mempoolMutex.
+    *
+    * The pool's estimated heap usage is bounded. Trimming it evicts the
+    * lowest fee rates first and raises a minimum fee rate above them, which
+    * halves every feeRateHalfLife seconds after.
+    */
 	class Mempool {
 		public:
 			Mempool();
 
-			bool insert(const transaction& tx);
+			/**
+			* Adds a verified transaction unless it conflicts with one already in the pool
+			*
+			* @param fee the transaction's input total minus its output total
+			* @param scripted true if verifying the transaction runs a script,
+			*        whose result may change whenever the tip does
+			*/
+			bool insert(const transaction& tx, const uint64_t fee, const bool scripted);
 			void remove(const transaction& tx);
+			bool contains(const uint256& id) const;
+
+			/**
+			* Evicts the transactions with the lowest fee per byte until the
+			* pool's usage is within its limit
+			*
+			* @return the number of transactions evicted
+			*/
+			unsigned int trim();
+
+			void setMaxUsage(const uint64_t maxUsage);
+			uint64_t getMaxUsage() const;
+
+			/**
+			* Returns the fee per byte a transaction must pay to be admitted
+			*/
+			double getMinFeeRate();
+
+			// Transactions evicted by trim() since the pool was created
+			uint64_t getEvictions() const;
+
+			/**
+			* Returns the transactions with the highest fee per byte that fit
+			* in a block
+			*/
 			std::set<transaction> getTransactions() const;
-			void rescanMempool(Storage::Transaction* dbTx, Blockchain* blockchain);
+
+			/**
+			* Same as getTransactions()
+			*
+			* @param fees set to the sum of the fees of the returned transactions
+			*/
+			std::set<transaction> getTransactions(uint64_t& fees) const;
+
+			// Every transaction in the pool, highest fee per byte first
+			std::vector<transaction> getAllTransactions() const;
+
+			/**
+			* Evicts the transactions that spend or create an output that the
+			* given block spends or creates. Called with a connected block this
+			* removes double spends of its inputs, and with a reversed block it
+			* removes spends of the outputs it created.
+			*
+			* @return the number of transactions evicted
+			*/
+			unsigned int removeConflicts(const block& changed);
+
+			// Re-verifies every transaction, returning the number evicted
+			unsigned int rescanMempool(Storage::Transaction* dbTx, Blockchain* blockchain);
+
+			// Re-verifies the scripted transactions, returning the number evicted
+			unsigned int rescanScripted(Storage::Transaction* dbTx, Blockchain* blockchain);
+
+			// The id of the block the pool was last reconciled with
+			void setTip(const uint256& id);
+			uint256 getTip() const;
 
             unsigned int count() const;
             unsigned int size() const;
 
+			// Estimated heap bytes held by the transactions and the indexes over them
+			uint64_t usage() const;
+
+			/**
+			* Estimates the heap bytes a transaction takes up in the pool,
+			* counting its inputs, outputs and their JSON data, and its nodes
+			* in each index
+			*/
+			static uint64_t memoryUsage(const transaction& tx);
+
 		private:
-			std::map<BigNum, transaction> txs;
-			std::map<BigNum, BigNum> outputs;
-			std::map<BigNum, BigNum> inputs;
+			// Highest fee per byte first, ties broken by id
+			struct FeeRateOrder {
+				bool operator()(const std::pair<double, uint256>& lhs,
+				                const std::pair<double, uint256>& rhs) const;
+			};
+
+			std::map<uint256, transaction> txs;
+			std::map<uint256, uint256> outputs;
+			std::map<uint256, uint256> inputs;
+			std::map<uint256, uint64_t> fees;
+			std::set<std::pair<double, uint256>, FeeRateOrder> byFeeRate;
+			std::set<uint256> scripted;
+			uint256 tip;
 
             unsigned int bytes;
+
+			uint64_t heapUsage;
+			uint64_t maxUsage;
+			uint64_t evictions;
+
+			double minFeeRate;
+			std::chrono::steady_clock::time_point minFeeRateUpdated;
+
+			static const unsigned int feeRateHalfLife = 12 * 60 * 60;
+
+			// Transactions that did not fit in a template before it is considered full
+			static const unsigned int maxTemplateMisses = 1000;
+
+			static double feeRate(const transaction& tx, const uint64_t fee);
+
+			unsigned int rescan(Storage::Transaction* dbTx, Blockchain* blockchain,
+			                    const std::set<uint256>& ids);
 	};
 
+private:
+    std::unique_ptr<Storage::Table> blocks;
+    std::unique_ptr<Storage::Table> candidates;
+    std::unique_ptr<Storage::Table> transactions;
+    std::unique_ptr<Storage::Table> utxos;
+    std::unique_ptr<Storage::Table> stxos;
+    std::unique_ptr<Storage::Table> inputs;
+    // By height, the id of the block connected there and the outputs it spent
+    std::unique_ptr<Storage::Table> undo;
+    // By block id, where blockStore holds the body of a main chain block or of
+    // one reversed from it
+    std::unique_ptr<Storage::Table> blockPositions;
+
+    std::unique_ptr<Storage> blockdb;
+    // Main chain block bodies, each transaction with the ids of its puts
+    std::unique_ptr<BlockStore> blockStore;
+    // Bodies appended for blocks whose transaction has not committed, by
+    // block id, so a retry or a later submission of the block reuses them
+    std::unordered_map<uint256, BlockStore::Position> appendedBodies;
+    std::mutex appendedBodiesMutex;
+    uint256 genesisBlockId;
+    Log *log;
+
     Mempool unconfirmedTransactions;
     std::mutex mempoolMutex;
 
+    // A block connected or reversed through a Storage transaction, or a
+    // transaction of a reversed block to put back in the mempool
+    struct MempoolChange {
+        // Null for a replayed transaction
+        std::shared_ptr<const block> changed;
+        bool connected;
+        std::shared_ptr<const transaction> replayed;
+        uint64_t fee;
+        bool scripted;
+    };
+
+    // In the order they were made, guarded by mempoolMutex. They are applied
+    // when the transaction's coins batch commits and dropped with the batch
+    // otherwise, so an attempt that conflicts leaves the mempool as it was.
+    std::unordered_map<const Storage::Transaction*, std::vector<MempoolChange>> mempoolChanges;
+
+    void queueMempoolChange(Storage::Transaction* dbTx, const MempoolChange& change);
+    // Called with mempoolMutex held once the transaction has committed
+    void applyMempoolChanges(Storage::Transaction* dbTx);
+
+    /**
+    * Keeps decoded outputs in memory in front of the utxos and stxos tables.
+    * Outputs are written to utxos in the block that creates them but spends
+    * only mark the cached output, and the dirty outputs are moved between the
+    * tables in one batch once they fill half the cache or every
+    * flushInterval seconds. Each flush stores the tip it is current to under
+    * "coinstip" in the blocks table so the spends of later blocks can be
+    * replayed if the node stops without flushing.
+    *
+    * Changes made in a Storage transaction stay private to it until its batch
+    * commits.
+    */
+    class CoinsCache {
+        public:
+            struct Coin {
+                std::shared_ptr<const dbOutput> output;
+                bool spent;
+            };
+
+            CoinsCache(Blockchain* blockchain, const uint64_t maxBytes);
+
+            /**
+            * Looks an output up in the transaction's batch, then the cache,
+            * then the database
+            *
+            * @return true if the output exists, spent or unspent
+            */
+            bool get(Storage::Transaction* dbTx, const std::string& id, Coin& coin);
+
+            // Records an output the caller has written to utxos
+            void add(Storage::Transaction* dbTx, const dbOutput& out);
+
+            // Mark an existing output spent or unspent, returning it
+            Coin spend(Storage::Transaction* dbTx, const std::string& id);
+            Coin unspend(Storage::Transaction* dbTx, const std::string& id);
+            // Marks an output unspent from a copy kept by the caller, without looking it up
+            void restore(Storage::Transaction* dbTx, const dbOutput& out);
+
+            // Forgets an output the caller has erased from both tables
+            void erase(Storage::Transaction* dbTx, const std::string& id);
+
+            /**
+            * Collects the changes made through one Storage transaction. Destroying
+            * the batch without committing it discards them.
+            */
+            class Batch {
+                public:
+                    Batch(CoinsCache* cache, Storage::Transaction* dbTx);
+                    ~Batch();
+
+                    /**
+                    * Commits the Storage transaction and publishes the batch to
+                    * the cache, flushing the dirty outputs with it if they have
+                    * grown too large, are too old or flush is set
+                    *
+                    * @throw Storage::ConflictException if the Storage transaction conflicts
+                    */
+                    void commit(const bool flush = false);
+
+                private:
+                    CoinsCache* cache;
+                    Storage::Transaction* dbTx;
+            };
+
+            // Changes every time a batch commits
+            uint64_t getGeneration();
+
+            void clear();
+
+            Json::Value getStats();
+
+        private:
+            struct Entry {
+                Coin coin;
+                // Only in batches, the output was erased
+                bool erased;
+                // Batches only publish entries they changed over cached ones
+                bool changed;
+                // The tables do not reflect the spent flag yet
+                bool dirty;
+                size_t bytes;
+            };
+
+            struct Pending {
+                std::unordered_map<std::string, Entry> entries;
+                // Set once the batch unspends or erases outputs, which only
+                // happens when reversing blocks
+                bool reorg;
+                // Of the cache when the batch began
+                uint64_t generation;
+            };
+
+            typedef std::pair<Entry, std::list<std::string>::iterator> CacheEntry;
+
+            bool load(std::unique_lock<std::mutex>& lock, Storage::Transaction* dbTx,
+                      const std::string& id, Coin& coin);
+            Entry makeEntry(const Coin& coin, const std::string& id) const;
+            void setEntry(const std::string& id, const Entry& entry);
+            void removeEntry(const std::string& id);
+            void evict();
+            void write(Storage::Transaction* dbTx, const std::string& id, const Coin& coin);
+            void commit(Storage::Transaction* dbTx, const bool flush);
+            Pending& getPending(Storage::Transaction* dbTx);
+
+            Blockchain* blockchain;
+            uint64_t maxBytes;
+
+            std::unordered_map<std::string, CacheEntry> entries;
+            // Most recently used first
+            std::list<std::string> lru;
+            std::unordered_map<const Storage::Transaction*, Pending> pending;
+            uint64_t bytes;
+            uint64_t dirtyBytes;
+            uint64_t generation;
+
+            std::chrono::steady_clock::time_point lastFlush;
+
+            uint64_t hits;
+            uint64_t misses;
+            uint64_t evictions;
+            uint64_t flushes;
+            uint64_t flushedOutputs;
+            double lastFlushMs;
+            double totalFlushMs;
+
+            std::mutex mutex;
+
+            // Seconds dirty outputs may wait before they are flushed
+            static const unsigned int flushInterval = 600;
+    };
+
+    std::unique_ptr<CoinsCache> coins;
+
+    /**
+    * The main chain and candidate blocks as a tree of headers held in memory,
+    * so the tip, the main chain block at a height and where a candidate
+    * leaves the main chain are found without reading the database. Like the
+    * coins cache, changes made through a Storage transaction are only seen
+    * by that transaction until it commits. Snapshot readers keep reading the
+    * tables so they see the chain as of their snapshot.
+    */
+    class BlockIndex {
+        public:
+            struct Entry {
+                uint256 id;
+                // Null for the genesis block
+                const Entry* previous;
+                uint64_t height;
+                uint64_t timestamp;
+            };
+
+            BlockIndex(Blockchain* blockchain);
+
+            // Reads the main chain and the candidates from the tables
+            void load(Storage::Transaction* dbTx);
+
+            void clear();
+
+            // The main chain tip, null if there is no chain yet
+            std::shared_ptr<const dbBlock> getTip(Storage::Transaction* dbTx);
+
+            // Null if the block is neither on the main chain nor a candidate
+            const Entry* get(Storage::Transaction* dbTx, const uint256& id);
+
+            // The main chain block at height, null above the tip
+            const Entry* getByHeight(Storage::Transaction* dbTx, const uint64_t height);
+
+            // The last block entry has in common with the main chain, null
+            // if entry does not lead back to it
+            const Entry* getForkPoint(Storage::Transaction* dbTx, const Entry* entry);
+
+            // Records a block saved to the candidates
+            void add(Storage::Transaction* dbTx, const uint256& id, const uint256& previousBlockId,
+                     const uint64_t height, const uint64_t timestamp);
+
+            // Moves the tip forwards to a child of the current tip
+            void connect(Storage::Transaction* dbTx, const dbBlock& block);
+
+            // Moves the tip back to the parent of the current tip
+            void disconnect(Storage::Transaction* dbTx, const dbBlock& newTip);
+
+            // Called by CoinsCache::Batch, transactions that have not begun
+            // read the committed index and cannot change it
+            void begin(Storage::Transaction* dbTx);
+            void end(Storage::Transaction* dbTx);
+
+            /**
+            * Commits the Storage transaction and publishes its changes to the
+            * index. The index is not locked during the storage commit, a
+            * transaction that changed it holds committing until the commit
+            * succeeds or fails.
+            *
+            * @throw Storage::ConflictException if the transaction used the
+            *        index and another transaction has changed it since or is
+            *        committing a change to it
+            */
+            void commit(Storage::Transaction* dbTx);
+
+        private:
+            struct Pending {
+                std::unordered_map<uint256, std::unique_ptr<Entry>> entries;
+                // The committed main chain below kept stays, connected is
+                // built on top of it
+                uint64_t kept;
+                std::vector<const Entry*> connected;
+                std::shared_ptr<const dbBlock> tip;
+                bool changed;
+                bool used;
+                // Of the index when the transaction began
+                uint64_t generation;
+            };
+
+            Pending* getPending(Storage::Transaction* dbTx);
+            const Entry* find(const Pending* batch, const uint256& id) const;
+            const Entry* findByHeight(const Pending* batch, const uint64_t height) const;
+            Entry* makeEntry(Pending* batch, const uint256& id, const uint256& previousBlockId,
+                             const uint64_t height, const uint64_t timestamp);
+
+            Blockchain* blockchain;
+
+            std::unordered_map<uint256, std::unique_ptr<Entry>> entries;
+            // The main chain by height - 1
+            std::vector<const Entry*> mainChain;
+            std::shared_ptr<const dbBlock> tip;
+            std::unordered_map<const Storage::Transaction*, Pending> pending;
+            uint64_t generation;
+            // The transaction writing a change to the index, null if none
+            const Storage::Transaction* committing;
+
+            std::mutex mutex;
+    };
+
+    std::unique_ptr<BlockIndex> blockIndex;
+
     std::string dbDir;
+    Storage::Profile storageProfile;
+
+    Storage::Transaction::ReadStats blockReadStats;
+    std::mutex blockReadStatsMutex;
+
+    VerifyStats blockVerifyStats;
+    std::mutex blockVerifyStatsMutex;
+
+    std::unique_ptr<ThreadPool> verifyPool;
+
+    std::unique_ptr<SignatureCache> sigCache;
+
+    // Times a submission is attempted before giving up on write conflicts
+    static const unsigned int commitAttempts = 8;
+
+    // Blocks below the tip that keep their undo records, deeper reorgs
+    // rebuild the spent outputs from the tables
+    static const unsigned int undoDepth = 1000;
 
     std::tuple<bool, bool> verifyTransaction(Storage::Transaction* dbTransaction, const transaction& tx,
                            const bool coinbaseTx = false);
+    // Checks the transaction against the chain, collecting the outputs it spends in input order
+    std::tuple<bool, bool> verifyTransactionState(Storage::Transaction* dbTransaction,
+                           const transaction& tx,
+                           std::vector<std::shared_ptr<const dbOutput>>& spentOutputs);
+    // Checks what does not depend on other transactions, safe to run concurrently
+    std::tuple<bool, bool> verifyTransactionRules(Storage::Transaction* dbTransaction,
+                           const transaction& tx,
+                           const std::vector<std::shared_ptr<const dbOutput>>& spentOutputs,
+                           const bool coinbaseTx = false);
+    // Verifies an ECDSA signature through the signature cache
+    bool verifySignature(const std::string& publicKey, const std::string& message,
+                         const std::string& signature);
+    // Position is where the transaction was written to blockStore
     void confirmTransaction(Storage::Transaction* dbTransaction, const transaction& tx,
-                            const BigNum& confirmingBlock, const bool coinbaseTx = false);
+                            const uint256& confirmingBlock, const BlockStore::Position& position,
+                            const bool coinbaseTx = false);
+    // Appends a block body to blockStore unless the block already has one there
+    BlockStore::Position writeBody(Storage::Transaction* dbTx, const uint256& id,
+                                   const std::string& body);
+    // Drops the appended bodies that committed blocks now refer to
+    void forgetCommittedBodies();
+    // The stored transactions of a main chain block, the coinbase first, empty if it has none stored
+    std::vector<Json::Value> getBlockTransactions(Storage::Transaction* dbTx,
+                                                  const dbBlock& dbblock);
     uint64_t getTransactionFee(const transaction& tx);
+    std::shared_ptr<const dbOutput> getUnspentOutput(Storage::Transaction* dbTx,
+                                                     const std::string& id);
+    void replayCoins();
+    // Checks a transaction's inputs are unspent and that it pays the mempool
+    // minimum fee rate, giving its fee and whether it runs a script
+    std::tuple<bool, bool> verifyMempoolState(Storage::Transaction* dbTx, const transaction& tx,
+                                              std::vector<std::shared_ptr<const dbOutput>>& spentOutputs,
+                                              uint64_t& fee, bool& scripted);
+    void loadMempool();
+    std::string getMempoolFile() const;
+    std::string getBlockStoreDirectory() const;
     uint64_t calculateTransactionFee(Storage::Transaction* dbTx, const transaction& tx);
     bool status;
     void reverseBlock(Storage::Transaction* dbTransaction);
-    bool reorgChain(Storage::Transaction* dbTransaction, const BigNum& newTipId);
+    void writeUndo(Storage::Transaction* dbTransaction, const block& Block, const uint64_t height,
+                   const std::vector<std::vector<std::shared_ptr<const dbOutput>>>& spentOutputs);
+    bool reorgChain(Storage::Transaction* dbTransaction, const uint256& newTipId);
     virtual uint64_t getBlockReward(const uint64_t height) = 0;
     virtual std::string getCoinbaseOwner(const std::string& publicKey) = 0;
     Consensus* consensus;
+    void openDB();
     void emptyDB();
-    std::tuple<bool, bool> submitTransaction(Storage::Transaction* dbTx, const transaction& tx);
+    void upgradeKeys();
+    // Verifies a transaction for the mempool and passes it to the consensus
+    // method, giving its fee and whether it runs a script
+    std::tuple<bool, bool> verifyMempoolTransaction(Storage::Transaction* dbTx,
+                                                    const transaction& tx, uint64_t& fee,
+                                                    bool& scripted);
+    // Inserts a verified transaction into the mempool, called with mempoolMutex held
+    std::tuple<bool, bool> admitTransaction(const transaction& tx, const uint64_t fee,
+                                            const bool scripted);
     std::tuple<bool, bool> submitBlock(Storage::Transaction* dbTx, const block& newBlock,
                      bool genesisBlock = false);
+    std::tuple<bool, bool> verifyHeaders(Storage::Transaction* dbTx,
+                                         const blockHeader& previousHeader,
+                                         const std::vector<blockHeader>& headers);
     friend class Consensus;
     friend class ContractRunner;
 };
@@ -453,6 +1109,25 @@ public:
                                      CryptoKernel::Blockchain::block& block,
                                      const CryptoKernel::Blockchain::dbBlock& previousBlock) = 0;
 
+    /**
+    * Virtual method that returns true iff the given header conforms to the
+    * consensus rules that can be checked without the block body or the
+    * chain state it builds on. It is used to reject headers before their
+    * bodies are downloaded, so must be cheap. Blocks passing it are still
+    * checked in full by the method above. For Proof of Work this function
+    * would check the Proof of Work against the target the header claims.
+    * By default every header passes, leaving the checks to the full block.
+    *
+    * @param header the header to check the consensus rules of
+    * @param previousHeader the header the given header builds on
+    * @return true iff the rules are valid, otherwise false
+    */
+    virtual bool checkConsensusRules(Storage::Transaction* transaction,
+                                     const CryptoKernel::Blockchain::blockHeader& header,
+                                     const CryptoKernel::Blockchain::blockHeader& previousHeader) {
+        return true;
+    }
+
     /**
     * Pure virtual function that generates the consensus data
     * for a block owned by the given public key. In a Proof of
@@ -463,7 +1138,7 @@ public:
     * @return the consensusData for the block
     */
     virtual Json::Value generateConsensusData(Storage::Transaction* transaction,
-            const CryptoKernel::BigNum& previousBlockId, const std::string& publicKey) = 0;
+            const CryptoKernel::uint256& previousBlockId, const std::string& publicKey) = 0;
 
     /**
     * Callback for custom transaction behavior when when the blockchain needs to check
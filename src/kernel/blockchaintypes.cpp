@@ -1,10 +1,33 @@
 #include <sstream>
+#include <stdexcept>
 
 #include "blockchain.h"
 #include "crypto.h"
 #include "merkletree.h"
 
-CryptoKernel::Blockchain::output::output(const Json::Value& jsonOutput) {
+namespace {
+    // The id a stored output was written with
+    CryptoKernel::uint256 storedId(const Json::Value& jsonOutput) {
+        if(!jsonOutput["id"].isString()) {
+            throw CryptoKernel::Blockchain::InvalidElementException("Output JSON is malformed");
+        }
+
+        try {
+            return CryptoKernel::uint256(jsonOutput["id"].asString());
+        } catch(const std::invalid_argument& e) {
+            throw CryptoKernel::Blockchain::InvalidElementException("Output JSON is malformed");
+        }
+    }
+}
+
+CryptoKernel::Blockchain::output::output(const Json::Value& jsonOutput) : output(
+        jsonOutput, uint256()) {
+    checkRep();
+
+    id = calculateId();
+}
+
+CryptoKernel::Blockchain::output::output(const Json::Value& jsonOutput, const uint256& id) {
     try {
         value = jsonOutput["value"].asUInt64();
         nonce = jsonOutput["nonce"].asUInt64();
@@ -13,9 +36,7 @@ CryptoKernel::Blockchain::output::output(const Json::Value& jsonOutput) {
         throw InvalidElementException("Output JSON is malformed");
     }
 
-    checkRep();
-
-    id = calculateId();
+    this->id = id;
 }
 
 CryptoKernel::Blockchain::output::output(const uint64_t value, const uint64_t nonce,
@@ -54,19 +75,19 @@ uint64_t CryptoKernel::Blockchain::output::getNonce() const {
     return nonce;
 }
 
-Json::Value CryptoKernel::Blockchain::output::getData() const {
+const Json::Value& CryptoKernel::Blockchain::output::getData() const {
     return data;
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::output::calculateId() {
+CryptoKernel::uint256 CryptoKernel::Blockchain::output::calculateId() {
     std::stringstream buffer;
     buffer << value << nonce << CryptoKernel::Storage::toString(data, false);
 
     CryptoKernel::Crypto crypto;
-    return CryptoKernel::BigNum(crypto.sha256(buffer.str()));
+    return CryptoKernel::uint256(crypto.sha256(buffer.str()));
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::output::getId() const {
+CryptoKernel::uint256 CryptoKernel::Blockchain::output::getId() const {
     return id;
 }
 
@@ -85,17 +106,18 @@ bool CryptoKernel::Blockchain::output::operator<(const output& rhs) const {
 }
 
 CryptoKernel::Blockchain::dbOutput::dbOutput(const Json::Value& jsonOutput) : output(
-        jsonOutput) {
+        jsonOutput, storedId(jsonOutput)) {
     try {
-        creationTx = CryptoKernel::BigNum(jsonOutput["creationTx"].asString());
+        creationTx = CryptoKernel::uint256(jsonOutput["creationTx"].asString());
     } catch(const Json::Exception& e) {
         throw InvalidElementException("Output JSON is malformed");
+    } catch(const std::invalid_argument& e) {
+        throw InvalidElementException("Output JSON is malformed");
     }
 }
 
 CryptoKernel::Blockchain::dbOutput::dbOutput(const output& compactOutput,
-        const BigNum& creationTx) : output(compactOutput.getValue(), compactOutput.getNonce(),
-                    compactOutput.getData()) {
+        const uint256& creationTx) : output(compactOutput) {
     this->creationTx = creationTx;
 }
 
@@ -108,20 +130,27 @@ Json::Value CryptoKernel::Blockchain::dbOutput::toJson() const {
     return returning;
 }
 
-CryptoKernel::Blockchain::input::input(const Json::Value& inputJson) {
+CryptoKernel::Blockchain::input::input(const Json::Value& inputJson) : input(inputJson,
+        uint256()) {
+    checkRep();
+
+    id = calculateId();
+}
+
+CryptoKernel::Blockchain::input::input(const Json::Value& inputJson, const uint256& id) {
     try {
         data = inputJson["data"];
-        outputId = CryptoKernel::BigNum(inputJson["outputId"].asString());
+        outputId = CryptoKernel::uint256(inputJson["outputId"].asString());
     } catch(const Json::Exception& e) {
         throw InvalidElementException("Input JSON is malformed");
+    } catch(const std::invalid_argument& e) {
+        throw InvalidElementException("Input JSON is malformed");
     }
 
-    checkRep();
-
-    id = calculateId();
+    this->id = id;
 }
 
-CryptoKernel::Blockchain::input::input(const BigNum& outputId, const Json::Value& data) {
+CryptoKernel::Blockchain::input::input(const uint256& outputId, const Json::Value& data) {
     this->data = data;
     this->outputId = outputId;
 
@@ -147,24 +176,24 @@ Json::Value CryptoKernel::Blockchain::input::toJson() const {
     return returning;
 }
 
-Json::Value CryptoKernel::Blockchain::input::getData() const {
+const Json::Value& CryptoKernel::Blockchain::input::getData() const {
     return data;
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::input::getOutputId() const {
+CryptoKernel::uint256 CryptoKernel::Blockchain::input::getOutputId() const {
     return outputId;
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::input::getId() const {
+CryptoKernel::uint256 CryptoKernel::Blockchain::input::getId() const {
     return id;
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::input::calculateId() {
+CryptoKernel::uint256 CryptoKernel::Blockchain::input::calculateId() {
     std::stringstream buffer;
     buffer << outputId.toString() << CryptoKernel::Storage::toString(data, false);
 
     CryptoKernel::Crypto crypto;
-    return CryptoKernel::BigNum(crypto.sha256(buffer.str()));
+    return CryptoKernel::uint256(crypto.sha256(buffer.str()));
 }
 
 CryptoKernel::Blockchain::dbInput::dbInput(const Json::Value& inputJson) : input(
@@ -173,7 +202,7 @@ CryptoKernel::Blockchain::dbInput::dbInput(const Json::Value& inputJson) : input
 }
 
 CryptoKernel::Blockchain::dbInput::dbInput(const input& compactInput) : input(
-        compactInput.getOutputId(), compactInput.getData()) {
+        compactInput) {
 
 }
 
@@ -183,8 +212,8 @@ Json::Value CryptoKernel::Blockchain::dbInput::toJson() const {
 
 CryptoKernel::Blockchain::transaction::transaction(const std::set<input>& inputs,
         const std::set<output>& outputs, const uint64_t timestamp, const bool coinbaseTx) {
-    this->inputs = inputs;
-    this->outputs = outputs;
+    this->inputs = std::make_shared<const std::set<input>>(inputs);
+    this->outputs = std::make_shared<const std::set<output>>(outputs);
     this->timestamp = timestamp;
 
     bytes = CryptoKernel::Storage::toString(toJson()).size();
@@ -196,14 +225,19 @@ CryptoKernel::Blockchain::transaction::transaction(const std::set<input>& inputs
 
 CryptoKernel::Blockchain::transaction::transaction(const Json::Value& jsonTransaction,
         const bool coinbaseTx) {
+    std::set<input> inputs;
     for(const Json::Value& inp : jsonTransaction["inputs"]) {
         inputs.insert(CryptoKernel::Blockchain::input(inp));
     }
 
+    std::set<output> outputs;
     for(const Json::Value& out : jsonTransaction["outputs"]) {
         outputs.insert(CryptoKernel::Blockchain::output(out));
     }
 
+    this->inputs = std::make_shared<const std::set<input>>(std::move(inputs));
+    this->outputs = std::make_shared<const std::set<output>>(std::move(outputs));
+
     try {
         timestamp = jsonTransaction["timestamp"].asUInt64();
     } catch(const Json::Exception& e) {
@@ -217,6 +251,16 @@ CryptoKernel::Blockchain::transaction::transaction(const Json::Value& jsonTransa
     id = calculateId();
 }
 
+CryptoKernel::Blockchain::transaction::transaction(const std::set<input>& inputs,
+        const std::set<output>& outputs, const uint64_t timestamp, const uint256& id) {
+    this->inputs = std::make_shared<const std::set<input>>(inputs);
+    this->outputs = std::make_shared<const std::set<output>>(outputs);
+    this->timestamp = timestamp;
+    this->id = id;
+
+    bytes = CryptoKernel::Storage::toString(toJson()).size();
+}
+
 unsigned int CryptoKernel::Blockchain::transaction::size() const {
     return bytes;
 }
@@ -227,21 +271,21 @@ void CryptoKernel::Blockchain::transaction::checkRep(const bool coinbaseTx) {
         throw InvalidElementException("Transaction is too large");
     }
 
-    if(outputs.size() < 1) {
+    if(outputs->size() < 1) {
         throw InvalidElementException("Transaction has no outputs");
     }
 
-    if(coinbaseTx && inputs.size() > 0) {
+    if(coinbaseTx && inputs->size() > 0) {
         throw InvalidElementException("Coinbase transaction must have no inputs");
     }
 
-    if(!coinbaseTx && inputs.size() < 1) {
+    if(!coinbaseTx && inputs->size() < 1) {
         throw InvalidElementException("Transaction has no inputs");
     }
 
     uint64_t curTotal = 0;
     uint64_t prevTotal = 0;
-    for(const output& out : outputs) {
+    for(const output& out : *outputs) {
         curTotal += out.getValue();
 
         if(curTotal < prevTotal) {
@@ -251,27 +295,27 @@ void CryptoKernel::Blockchain::transaction::checkRep(const bool coinbaseTx) {
         prevTotal = curTotal;
     }
 
-    std::set<BigNum> outputIds;
+    std::set<uint256> outputIds;
 
-    for(const input& inp : inputs) {
+    for(const input& inp : *inputs) {
         outputIds.insert(inp.getOutputId());
     }
 
-    for(const output& out : outputs) {
+    for(const output& out : *outputs) {
         outputIds.insert(out.getId());
     }
 
-    if(outputIds.size() != outputs.size() + inputs.size()) {
+    if(outputIds.size() != outputs->size() + inputs->size()) {
         throw InvalidElementException("Output IDs are not unique in transaction");
     }
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::transaction::calculateId() {
+CryptoKernel::uint256 CryptoKernel::Blockchain::transaction::calculateId() {
     std::stringstream buffer;
 
-	if(!inputs.empty()) {
-		std::set<BigNum> inputIds;
-		for(const input& inp : inputs) {
+	if(!inputs->empty()) {
+		std::set<uint256> inputIds;
+		for(const input& inp : *inputs) {
 			inputIds.insert(inp.getId());
 		}
 
@@ -281,25 +325,25 @@ CryptoKernel::BigNum CryptoKernel::Blockchain::transaction::calculateId() {
 	buffer << getOutputSetId().toString() << timestamp;
 
     CryptoKernel::Crypto crypto;
-    return CryptoKernel::BigNum(crypto.sha256(buffer.str()));
+    return CryptoKernel::uint256(crypto.sha256(buffer.str()));
 }
 
 bool CryptoKernel::Blockchain::transaction::operator<(const transaction& rhs) const {
     return getId() < rhs.getId();
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::transaction::getId() const {
+CryptoKernel::uint256 CryptoKernel::Blockchain::transaction::getId() const {
     return id;
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::transaction::getOutputSetId() const {
-    return getOutputSetId(outputs);
+CryptoKernel::uint256 CryptoKernel::Blockchain::transaction::getOutputSetId() const {
+    return getOutputSetId(*outputs);
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::transaction::getOutputSetId(
+CryptoKernel::uint256 CryptoKernel::Blockchain::transaction::getOutputSetId(
     const std::set<output>& outputs) {
 
-	std::set<BigNum> outputIds;
+	std::set<uint256> outputIds;
     for(const output& out : outputs) {
         outputIds.insert(out.getId());
     }
@@ -311,14 +355,14 @@ uint64_t CryptoKernel::Blockchain::transaction::getTimestamp() const {
     return timestamp;
 }
 
-std::set<CryptoKernel::Blockchain::input>
+const std::set<CryptoKernel::Blockchain::input>&
 CryptoKernel::Blockchain::transaction::getInputs() const {
-    return inputs;
+    return *inputs;
 }
 
-std::set<CryptoKernel::Blockchain::output>
+const std::set<CryptoKernel::Blockchain::output>&
 CryptoKernel::Blockchain::transaction::getOutputs() const {
-    return outputs;
+    return *outputs;
 }
 
 Json::Value CryptoKernel::Blockchain::transaction::toJson() const {
@@ -326,11 +370,11 @@ Json::Value CryptoKernel::Blockchain::transaction::toJson() const {
 
     returning["timestamp"] = timestamp;
 
-    for(const input& inp : inputs) {
+    for(const input& inp : *inputs) {
         returning["inputs"].append(inp.toJson());
     }
 
-    for(const output& out : outputs) {
+    for(const output& out : *outputs) {
         returning["outputs"].append(out.toJson());
     }
 
@@ -338,32 +382,39 @@ Json::Value CryptoKernel::Blockchain::transaction::toJson() const {
 }
 
 CryptoKernel::Blockchain::dbTransaction::dbTransaction(const Json::Value&
-        jsonTransaction) {
+        jsonTransaction) : dbTransaction(jsonTransaction, uint256()) {
+    checkRep();
+
+    id = calculateId();
+}
+
+CryptoKernel::Blockchain::dbTransaction::dbTransaction(const Json::Value&
+        jsonTransaction, const uint256& id) {
     try {
-        this->confirmingBlock = CryptoKernel::BigNum(
+        this->confirmingBlock = CryptoKernel::uint256(
                                     jsonTransaction["confirmingBlock"].asString());
         this->coinbaseTx = jsonTransaction["coinbaseTx"].asBool();
 
         for(const Json::Value& inp : jsonTransaction["inputs"]) {
-            inputs.insert(CryptoKernel::BigNum(inp.asString()));
+            inputs.insert(CryptoKernel::uint256(inp.asString()));
         }
 
         for(const Json::Value& out : jsonTransaction["outputs"]) {
-            outputs.insert(CryptoKernel::BigNum(out.asString()));
+            outputs.insert(CryptoKernel::uint256(out.asString()));
         }
 
         timestamp = jsonTransaction["timestamp"].asUInt64();
     } catch(const Json::Exception& e) {
         throw InvalidElementException("Transaction JSON is malformed");
+    } catch(const std::invalid_argument& e) {
+        throw InvalidElementException("Transaction JSON is malformed");
     }
 
-    checkRep();
-
-    id = calculateId();
+    this->id = id;
 }
 
 CryptoKernel::Blockchain::dbTransaction::dbTransaction(const transaction&
-        compactTransaction, const BigNum& confirmingBlock, const bool coinbaseTx) {
+        compactTransaction, const uint256& confirmingBlock, const bool coinbaseTx) {
     this->confirmingBlock = confirmingBlock;
     this->coinbaseTx = coinbaseTx;
 
@@ -382,7 +433,7 @@ CryptoKernel::Blockchain::dbTransaction::dbTransaction(const transaction&
     id = calculateId();
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::dbTransaction::calculateId() {
+CryptoKernel::uint256 CryptoKernel::Blockchain::dbTransaction::calculateId() {
     std::stringstream buffer;
 
 	if(!inputs.empty()) {
@@ -394,7 +445,7 @@ CryptoKernel::BigNum CryptoKernel::Blockchain::dbTransaction::calculateId() {
     buffer << timestamp;
 
     CryptoKernel::Crypto crypto;
-    return CryptoKernel::BigNum(crypto.sha256(buffer.str()));
+    return CryptoKernel::uint256(crypto.sha256(buffer.str()));
 }
 
 void CryptoKernel::Blockchain::dbTransaction::checkRep () {
@@ -414,11 +465,11 @@ void CryptoKernel::Blockchain::dbTransaction::checkRep () {
 Json::Value CryptoKernel::Blockchain::dbTransaction::toJson() const {
     Json::Value returning;
 
-    for(const BigNum& inp : inputs) {
+    for(const uint256& inp : inputs) {
         returning["inputs"].append(inp.toString());
     }
 
-    for(const BigNum& out : outputs) {
+    for(const uint256& out : outputs) {
         returning["outputs"].append(out.toString());
     }
 
@@ -429,7 +480,7 @@ Json::Value CryptoKernel::Blockchain::dbTransaction::toJson() const {
     return returning;
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::dbTransaction::getId() const {
+CryptoKernel::uint256 CryptoKernel::Blockchain::dbTransaction::getId() const {
     return id;
 }
 
@@ -441,30 +492,30 @@ bool CryptoKernel::Blockchain::dbTransaction::isCoinbaseTx() const {
     return coinbaseTx;
 }
 
-std::set<CryptoKernel::BigNum> CryptoKernel::Blockchain::dbTransaction::getInputs()
+std::set<CryptoKernel::uint256> CryptoKernel::Blockchain::dbTransaction::getInputs()
 const {
     return inputs;
 }
 
-std::set<CryptoKernel::BigNum> CryptoKernel::Blockchain::dbTransaction::getOutputs()
+std::set<CryptoKernel::uint256> CryptoKernel::Blockchain::dbTransaction::getOutputs()
 const {
     return outputs;
 }
 
 CryptoKernel::Blockchain::block::block(const std::set<transaction>& transactions,
-                                       const transaction& coinbaseTx, const BigNum& previousBlockId, const uint64_t timestamp,
+                                       const transaction& coinbaseTx, const uint256& previousBlockId, const uint64_t timestamp,
                                        const Json::Value& consensusData, const uint64_t height, const Json::Value data)
     : coinbaseTx(coinbaseTx.getInputs(), coinbaseTx.getOutputs(), coinbaseTx.getTimestamp(),
                  true) {
-    this->transactions = transactions;
+    this->transactions = std::make_shared<const std::set<transaction>>(transactions);
     this->previousBlockId = previousBlockId;
     this->timestamp = timestamp;
     this->consensusData = consensusData;
     this->height = height;
 	this->data = data;
 
-	if(!this->transactions.empty()) {
-		std::set<BigNum> txIds;
+	if(!transactions.empty()) {
+		std::set<uint256> txIds;
 		for(const auto& tx : transactions) {
 			txIds.insert(tx.getId());
 		}
@@ -481,19 +532,24 @@ CryptoKernel::Blockchain::block::block(const Json::Value& jsonBlock)
     : coinbaseTx(jsonBlock["coinbaseTx"], true) {
     try {
         timestamp = jsonBlock["timestamp"].asUInt64();
-        previousBlockId = CryptoKernel::BigNum(jsonBlock["previousBlockId"].asString());
+        previousBlockId = CryptoKernel::uint256(jsonBlock["previousBlockId"].asString());
         consensusData = jsonBlock["consensusData"];
 		data = jsonBlock["data"];
 
 		if(!jsonBlock["transactions"].empty()) {
-			transactionMerkleRoot = CryptoKernel::BigNum(jsonBlock["transactionMerkleRoot"].asString());
+			transactionMerkleRoot = CryptoKernel::uint256(jsonBlock["transactionMerkleRoot"].asString());
 		}
 
+        std::set<transaction> transactions;
         for(const Json::Value& tx : jsonBlock["transactions"]) {
             transactions.insert(CryptoKernel::Blockchain::transaction(tx));
         }
+
+        this->transactions = std::make_shared<const std::set<transaction>>(std::move(transactions));
     } catch(const Json::Exception& e) {
         throw InvalidElementException("Block JSON is malformed");
+    } catch(const std::invalid_argument& e) {
+        throw InvalidElementException("Block JSON is malformed");
     }
 
     try {
@@ -507,14 +563,27 @@ CryptoKernel::Blockchain::block::block(const Json::Value& jsonBlock)
     id = calculateId();
 }
 
+CryptoKernel::Blockchain::block::block(const std::set<transaction>& transactions,
+                                       const transaction& coinbaseTx, const dbBlock& header)
+    : coinbaseTx(coinbaseTx) {
+    this->transactions = std::make_shared<const std::set<transaction>>(transactions);
+    previousBlockId = header.getPreviousBlockId();
+    timestamp = header.getTimestamp();
+    consensusData = header.getConsensusData();
+    height = header.getHeight();
+	data = header.getData();
+	transactionMerkleRoot = header.getTransactionMerkleRoot();
+    id = header.getId();
+}
+
 void CryptoKernel::Blockchain::block::setConsensusData(const Json::Value& data) {
     consensusData = data;
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::block::calculateId() {
+CryptoKernel::uint256 CryptoKernel::Blockchain::block::calculateId() {
     std::stringstream buffer;
 
-    if(!transactions.empty()) {
+    if(!transactions->empty()) {
         buffer << transactionMerkleRoot.toString();
     }
 
@@ -522,7 +591,7 @@ CryptoKernel::BigNum CryptoKernel::Blockchain::block::calculateId() {
 		   << CryptoKernel::Storage::toString(data);
 
     CryptoKernel::Crypto crypto;
-    return CryptoKernel::BigNum(crypto.sha256(buffer.str()));
+    return CryptoKernel::uint256(crypto.sha256(buffer.str()));
 }
 
 void CryptoKernel::Blockchain::block::checkRep() {
@@ -542,20 +611,17 @@ void CryptoKernel::Blockchain::block::checkRep() {
     // Check for input/output conflicts
     unsigned int totalPuts = 0;
     unsigned int totalInputs = 0;
-    std::set<BigNum> outputIds;
-    std::set<BigNum> inputIds;
-    for(const transaction& tx : transactions) {
-        const std::set<input> inputs = tx.getInputs();
-        const std::set<output> outputs = tx.getOutputs();
-
-        for(const input& inp : inputs) {
+    std::set<uint256> outputIds;
+    std::set<uint256> inputIds;
+    for(const transaction& tx : *transactions) {
+        for(const input& inp : tx.getInputs()) {
             totalPuts++;
             totalInputs++;
             outputIds.insert(inp.getOutputId());
             inputIds.insert(inp.getId());
         }
 
-        for(const output& out : outputs) {
+        for(const output& out : tx.getOutputs()) {
             totalPuts++;
             outputIds.insert(out.getId());
         }
@@ -566,10 +632,7 @@ void CryptoKernel::Blockchain::block::checkRep() {
     }
 
     // Coinbase tx should have no inputs, others should have at least 1
-    const std::set<input> inputs = coinbaseTx.getInputs();
-    const std::set<output> outputs = coinbaseTx.getOutputs();
-
-    for(const output& out : outputs) {
+    for(const output& out : coinbaseTx.getOutputs()) {
         totalPuts++;
         outputIds.insert(out.getId());
     }
@@ -582,9 +645,9 @@ void CryptoKernel::Blockchain::block::checkRep() {
         throw InvalidElementException("Block contains duplicate inputs");
     }
 
-	if(!transactions.empty()) {
-		std::set<BigNum> txIds;
-		for(const auto& tx : transactions) {
+	if(!transactions->empty()) {
+		std::set<uint256> txIds;
+		for(const auto& tx : *transactions) {
 			txIds.insert(tx.getId());
 		}
 
@@ -603,36 +666,36 @@ Json::Value CryptoKernel::Blockchain::block::toJson() const {
     returning["height"] = height;
 	returning["data"] = data;
 
-    for(const transaction& tx : transactions) {
+    for(const transaction& tx : *transactions) {
         returning["transactions"].append(tx.toJson());
     }
 
-	if(!transactions.empty()) {
+	if(!transactions->empty()) {
 		returning["transactionMerkleRoot"] = transactionMerkleRoot.toString();
 	}
 
     return returning;
 }
 
-Json::Value CryptoKernel::Blockchain::block::getData() const {
+const Json::Value& CryptoKernel::Blockchain::block::getData() const {
 	return data;
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::block::getTransactionMerkleRoot() const {
+CryptoKernel::uint256 CryptoKernel::Blockchain::block::getTransactionMerkleRoot() const {
 	return transactionMerkleRoot;
 }
 
-std::set<CryptoKernel::Blockchain::transaction>
+const std::set<CryptoKernel::Blockchain::transaction>&
 CryptoKernel::Blockchain::block::getTransactions() const {
-    return transactions;
+    return *transactions;
 }
 
-CryptoKernel::Blockchain::transaction CryptoKernel::Blockchain::block::getCoinbaseTx()
+const CryptoKernel::Blockchain::transaction& CryptoKernel::Blockchain::block::getCoinbaseTx()
 const {
     return coinbaseTx;
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::block::getPreviousBlockId() const {
+CryptoKernel::uint256 CryptoKernel::Blockchain::block::getPreviousBlockId() const {
     return previousBlockId;
 }
 
@@ -640,11 +703,11 @@ uint64_t CryptoKernel::Blockchain::block::getTimestamp() const {
     return timestamp;
 }
 
-Json::Value CryptoKernel::Blockchain::block::getConsensusData() const {
+const Json::Value& CryptoKernel::Blockchain::block::getConsensusData() const {
     return consensusData;
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::block::getId() const {
+CryptoKernel::uint256 CryptoKernel::Blockchain::block::getId() const {
     return id;
 }
 
@@ -654,22 +717,24 @@ uint64_t CryptoKernel::Blockchain::block::getHeight() const {
 
 CryptoKernel::Blockchain::dbBlock::dbBlock(const Json::Value& jsonBlock) {
     try {
-        coinbaseTx = CryptoKernel::BigNum(jsonBlock["coinbaseTx"].asString());
-        previousBlockId = CryptoKernel::BigNum(jsonBlock["previousBlockId"].asString());
+        coinbaseTx = CryptoKernel::uint256(jsonBlock["coinbaseTx"].asString());
+        previousBlockId = CryptoKernel::uint256(jsonBlock["previousBlockId"].asString());
         timestamp = jsonBlock["timestamp"].asUInt64();
         height = jsonBlock["height"].asUInt64();
         consensusData = jsonBlock["consensusData"];
 		data = jsonBlock["data"];
 
 		if(!jsonBlock["transactions"].empty()) {
-			transactionMerkleRoot = CryptoKernel::BigNum(jsonBlock["transactionMerkleRoot"].asString());
+			transactionMerkleRoot = CryptoKernel::uint256(jsonBlock["transactionMerkleRoot"].asString());
 		}
 
         for(const Json::Value& tx : jsonBlock["transactions"]) {
-            transactions.insert(CryptoKernel::BigNum(tx.asString()));
+            transactions.insert(CryptoKernel::uint256(tx.asString()));
         }
     } catch(const Json::Exception& e) {
         throw InvalidElementException("Block JSON is malformed");
+    } catch(const std::invalid_argument& e) {
+        throw InvalidElementException("Block JSON is malformed");
     }
 
     checkRep();
@@ -736,7 +801,7 @@ void CryptoKernel::Blockchain::dbBlock::checkRep() {
 	}
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::dbBlock::calculateId() {
+CryptoKernel::uint256 CryptoKernel::Blockchain::dbBlock::calculateId() {
     std::stringstream buffer;
 
     if(!transactions.empty()) {
@@ -747,7 +812,7 @@ CryptoKernel::BigNum CryptoKernel::Blockchain::dbBlock::calculateId() {
 		   << CryptoKernel::Storage::toString(data);
 
     CryptoKernel::Crypto crypto;
-    return CryptoKernel::BigNum(crypto.sha256(buffer.str()));
+    return CryptoKernel::uint256(crypto.sha256(buffer.str()));
 }
 
 Json::Value CryptoKernel::Blockchain::dbBlock::toJson() const {
@@ -760,7 +825,7 @@ Json::Value CryptoKernel::Blockchain::dbBlock::toJson() const {
     returning["height"] = height;
 	returning["data"] = data;
 
-    for(const BigNum& tx : transactions) {
+    for(const uint256& tx : transactions) {
         returning["transactions"].append(tx.toString());
     }
 
@@ -775,20 +840,20 @@ Json::Value CryptoKernel::Blockchain::dbBlock::getData() const {
 	return data;
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::dbBlock::getTransactionMerkleRoot() const {
+CryptoKernel::uint256 CryptoKernel::Blockchain::dbBlock::getTransactionMerkleRoot() const {
 	return transactionMerkleRoot;
 }
 
-std::set<CryptoKernel::BigNum> CryptoKernel::Blockchain::dbBlock::getTransactions()
+std::set<CryptoKernel::uint256> CryptoKernel::Blockchain::dbBlock::getTransactions()
 const {
     return transactions;
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::dbBlock::getCoinbaseTx() const {
+CryptoKernel::uint256 CryptoKernel::Blockchain::dbBlock::getCoinbaseTx() const {
     return coinbaseTx;
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::dbBlock::getPreviousBlockId() const {
+CryptoKernel::uint256 CryptoKernel::Blockchain::dbBlock::getPreviousBlockId() const {
     return previousBlockId;
 }
 
@@ -804,6 +869,159 @@ Json::Value CryptoKernel::Blockchain::dbBlock::getConsensusData() const {
     return consensusData;
 }
 
-CryptoKernel::BigNum CryptoKernel::Blockchain::dbBlock::getId() const {
+CryptoKernel::uint256 CryptoKernel::Blockchain::dbBlock::getId() const {
+    return id;
+}
+
+CryptoKernel::Blockchain::blockHeader CryptoKernel::Blockchain::dbBlock::getHeader() const {
+    return blockHeader(*this);
+}
+
+CryptoKernel::Blockchain::blockHeader CryptoKernel::Blockchain::block::getHeader() const {
+    return blockHeader(*this);
+}
+
+CryptoKernel::Blockchain::blockHeader::blockHeader(const block& fullBlock) {
+    coinbaseTx = fullBlock.getCoinbaseTx().getId();
+    previousBlockId = fullBlock.getPreviousBlockId();
+    timestamp = fullBlock.getTimestamp();
+    consensusData = fullBlock.getConsensusData();
+    data = fullBlock.getData();
+    height = fullBlock.getHeight();
+    transactions = !fullBlock.getTransactions().empty();
+    transactionMerkleRoot = fullBlock.getTransactionMerkleRoot();
+    id = fullBlock.getId();
+}
+
+CryptoKernel::Blockchain::blockHeader::blockHeader(const dbBlock& storedBlock) {
+    coinbaseTx = storedBlock.getCoinbaseTx();
+    previousBlockId = storedBlock.getPreviousBlockId();
+    timestamp = storedBlock.getTimestamp();
+    consensusData = storedBlock.getConsensusData();
+    data = storedBlock.getData();
+    height = storedBlock.getHeight();
+    transactions = !storedBlock.getTransactions().empty();
+    transactionMerkleRoot = storedBlock.getTransactionMerkleRoot();
+    id = storedBlock.getId();
+}
+
+CryptoKernel::Blockchain::blockHeader::blockHeader(const Json::Value& jsonBlock) {
+    try {
+        // Full blocks carry the coinbase transaction, stored blocks and
+        // headers only its id
+        const Json::Value& coinbaseJson = jsonBlock["coinbaseTx"];
+        if(coinbaseJson.isObject()) {
+            coinbaseTx = transaction(coinbaseJson, true).getId();
+        } else {
+            coinbaseTx = CryptoKernel::uint256(coinbaseJson.asString());
+        }
+
+        previousBlockId = CryptoKernel::uint256(jsonBlock["previousBlockId"].asString());
+        timestamp = jsonBlock["timestamp"].asUInt64();
+        consensusData = jsonBlock["consensusData"];
+        data = jsonBlock["data"];
+
+        // Headers have no transaction list, only the merkle root of a
+        // non-empty one
+        if(jsonBlock.isMember("transactions")) {
+            transactions = !jsonBlock["transactions"].empty();
+        } else {
+            transactions = jsonBlock.isMember("transactionMerkleRoot");
+        }
+
+        if(transactions) {
+            transactionMerkleRoot = CryptoKernel::uint256(jsonBlock["transactionMerkleRoot"].asString());
+        }
+    } catch(const Json::Exception& e) {
+        throw InvalidElementException("Block header JSON is malformed");
+    } catch(const std::invalid_argument& e) {
+        throw InvalidElementException("Block header JSON is malformed");
+    }
+
+    try {
+        height = jsonBlock["height"].asUInt64();
+    } catch(const Json::Exception& e) {
+        height = 0;
+    }
+
+    checkRep();
+
+    id = calculateId();
+}
+
+void CryptoKernel::Blockchain::blockHeader::checkRep() {
+    if(CryptoKernel::Storage::toString(data).size() > 100 * 1024) {
+        throw InvalidElementException("Data field is too large");
+    }
+
+    if(!data.isObject() && !data.isNull()) {
+        throw InvalidElementException("Data field is neither an object or null");
+    }
+}
+
+CryptoKernel::uint256 CryptoKernel::Blockchain::blockHeader::calculateId() {
+    std::stringstream buffer;
+
+    if(transactions) {
+        buffer << transactionMerkleRoot.toString();
+    }
+
+    buffer << coinbaseTx.toString() << previousBlockId.toString() << timestamp
+           << CryptoKernel::Storage::toString(data);
+
+    CryptoKernel::Crypto crypto;
+    return CryptoKernel::uint256(crypto.sha256(buffer.str()));
+}
+
+Json::Value CryptoKernel::Blockchain::blockHeader::toJson() const {
+    Json::Value returning;
+
+    returning["coinbaseTx"] = coinbaseTx.toString();
+    returning["previousBlockId"] = previousBlockId.toString();
+    returning["timestamp"] = timestamp;
+    returning["consensusData"] = consensusData;
+    returning["height"] = height;
+    returning["data"] = data;
+
+    if(transactions) {
+        returning["transactionMerkleRoot"] = transactionMerkleRoot.toString();
+    }
+
+    return returning;
+}
+
+CryptoKernel::uint256 CryptoKernel::Blockchain::blockHeader::getCoinbaseTx() const {
+    return coinbaseTx;
+}
+
+CryptoKernel::uint256 CryptoKernel::Blockchain::blockHeader::getPreviousBlockId() const {
+    return previousBlockId;
+}
+
+uint64_t CryptoKernel::Blockchain::blockHeader::getTimestamp() const {
+    return timestamp;
+}
+
+const Json::Value& CryptoKernel::Blockchain::blockHeader::getConsensusData() const {
+    return consensusData;
+}
+
+const Json::Value& CryptoKernel::Blockchain::blockHeader::getData() const {
+    return data;
+}
+
+uint64_t CryptoKernel::Blockchain::blockHeader::getHeight() const {
+    return height;
+}
+
+CryptoKernel::uint256 CryptoKernel::Blockchain::blockHeader::getTransactionMerkleRoot() const {
+    return transactionMerkleRoot;
+}
+
+bool CryptoKernel::Blockchain::blockHeader::hasTransactions() const {
+    return transactions;
+}
+
+CryptoKernel::uint256 CryptoKernel::Blockchain::blockHeader::getId() const {
     return id;
 }
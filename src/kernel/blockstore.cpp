@@ -0,0 +1,311 @@
+/*  CryptoKernel - A library for creating blockchain based digital currency
+    Copyright (C) 2016  James Lovejoy
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "blockstore.h"
+
+namespace {
+    // Appends are unbuffered so a failed write leaves nothing behind in
+    // stdio to reach the file later
+    std::FILE* openAppending(const std::string& filename) {
+        std::FILE* f = std::fopen(filename.c_str(), "ab");
+        if(f != nullptr) {
+            std::setvbuf(f, nullptr, _IONBF, 0);
+        }
+
+        return f;
+    }
+
+    bool syncFile(std::FILE* f) {
+#ifdef _WIN32
+        return _commit(_fileno(f)) == 0;
+#elif defined(__APPLE__)
+        return fsync(fileno(f)) == 0;
+#else
+        return fdatasync(fileno(f)) == 0;
+#endif
+    }
+
+    bool truncateFile(std::FILE* f, const uint64_t size) {
+#ifdef _WIN32
+        return _chsize_s(_fileno(f), size) == 0;
+#else
+        return ftruncate(fileno(f), size) == 0;
+#endif
+    }
+}
+
+class CryptoKernel::BlockStore::Segment {
+public:
+    Segment(const std::string& filename, const uint64_t size) {
+        this->filename = filename;
+        this->size = size;
+    }
+
+    // Bytes appended so far, guarded by the store's mutex
+    uint64_t size;
+
+#ifdef _WIN32
+    std::string read(const Position& position) {
+        std::FILE* f = std::fopen(filename.c_str(), "rb");
+        if(f == nullptr) {
+            throw std::runtime_error("Could not open " + filename);
+        }
+
+        std::string returning(position.length, '\0');
+        const bool ok = _fseeki64(f, position.offset, SEEK_SET) == 0 &&
+                        std::fread(&returning[0], 1, position.length, f) == position.length;
+        std::fclose(f);
+        if(!ok) {
+            throw std::runtime_error("Could not read " + filename);
+        }
+
+        return returning;
+    }
+#else
+    class Mapping {
+    public:
+        Mapping(const std::string& filename, const uint64_t length) {
+            FILE* f = std::fopen(filename.c_str(), "rb");
+            if(f == nullptr) {
+                throw std::runtime_error("Could not open " + filename);
+            }
+
+            // Mapped past the end of the file so it need not be mapped again
+            // as the segment grows. Only the bytes written are ever read.
+            data = mmap(nullptr, length, PROT_READ, MAP_SHARED, fileno(f), 0);
+            std::fclose(f);
+            if(data == MAP_FAILED) {
+                throw std::runtime_error("Could not map " + filename);
+            }
+
+            this->length = length;
+        }
+
+        ~Mapping() {
+            munmap(data, length);
+        }
+
+        void* data;
+        uint64_t length;
+    };
+
+    // Returns a mapping covering the first length bytes. Called under the
+    // store's mutex, readers keep the mapping they got alive themselves.
+    std::shared_ptr<Mapping> getMapping(const uint64_t length) {
+        if(!mapping || mapping->length < length) {
+            mapping.reset(new Mapping(filename, length));
+        }
+
+        return mapping;
+    }
+
+private:
+    std::shared_ptr<Mapping> mapping;
+#endif
+
+    std::string filename;
+};
+
+CryptoKernel::BlockStore::BlockStore(const std::string& directory, const uint64_t segmentSize) {
+    this->directory = directory;
+    this->segmentSize = segmentSize;
+    appending = nullptr;
+    unsynced = false;
+
+#ifdef _WIN32
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+
+    openLast();
+}
+
+CryptoKernel::BlockStore::~BlockStore() {
+    if(appending != nullptr) {
+        std::fclose(appending);
+    }
+}
+
+std::string CryptoKernel::BlockStore::segmentFile(const uint32_t file) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/blk%05u.dat", file);
+    return directory + name;
+}
+
+void CryptoKernel::BlockStore::openLast() {
+    // Segments are numbered from zero without gaps
+    for(uint32_t file = 0; ; file++) {
+        const std::string filename = segmentFile(file);
+        std::FILE* f = openAppending(filename);
+        if(f == nullptr) {
+            throw std::runtime_error("Could not open " + filename);
+        }
+
+        std::fseek(f, 0, SEEK_END);
+        const long size = std::ftell(f);
+        if(size < 0) {
+            std::fclose(f);
+            throw std::runtime_error("Could not open " + filename);
+        }
+
+        const std::string next = segmentFile(file + 1);
+        std::FILE* nextFile = std::fopen(next.c_str(), "rb");
+        segments.emplace_back(new Segment(filename, size));
+        if(nextFile == nullptr) {
+            appending = f;
+            return;
+        }
+
+        std::fclose(nextFile);
+        std::fclose(f);
+    }
+}
+
+CryptoKernel::BlockStore::Position CryptoKernel::BlockStore::append(const std::string& data) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // A body is never split across segments
+    if(segments.back()->size > 0 && segments.back()->size + data.size() > segmentSize) {
+        const uint32_t file = segments.size();
+        const std::string filename = segmentFile(file);
+        std::FILE* f = openAppending(filename);
+        if(f == nullptr) {
+            throw std::runtime_error("Could not open " + filename);
+        }
+
+        if(unsynced && !syncFile(appending)) {
+            std::fclose(f);
+            throw std::runtime_error("Could not sync " + segmentFile(file - 1));
+        }
+        std::fclose(appending);
+
+        appending = f;
+        unsynced = false;
+        segments.emplace_back(new Segment(filename, 0));
+    }
+
+    Position returning;
+    returning.file = segments.size() - 1;
+    returning.offset = segments.back()->size;
+    returning.length = data.size();
+
+    // Written straight to the operating system so the memory map sees it
+    if(std::fwrite(data.data(), 1, data.size(), appending) != data.size() ||
+       std::fflush(appending) != 0) {
+        // Part of the data may have reached the file. It is cut off so the
+        // next append lands at the offset the segment's size says, or the
+        // size follows the file if that fails.
+        std::clearerr(appending);
+        if(!truncateFile(appending, returning.offset)) {
+            std::fseek(appending, 0, SEEK_END);
+            const long size = std::ftell(appending);
+            if(size >= 0) {
+                segments.back()->size = size;
+            }
+        }
+
+        throw std::runtime_error("Could not write " + segmentFile(returning.file));
+    }
+
+    segments.back()->size += data.size();
+    unsynced = true;
+
+    return returning;
+}
+
+std::string CryptoKernel::BlockStore::read(const Position& position) {
+#ifdef _WIN32
+    std::shared_ptr<Segment> segment;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(position.file >= segments.size() ||
+           position.offset + position.length > segments[position.file]->size) {
+            throw std::runtime_error("Block position is outside " + directory);
+        }
+
+        segment = segments[position.file];
+    }
+
+    return segment->read(position);
+#else
+    std::shared_ptr<Segment::Mapping> mapping;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(position.file >= segments.size() ||
+           position.offset + position.length > segments[position.file]->size) {
+            throw std::runtime_error("Block position is outside " + directory);
+        }
+
+        mapping = segments[position.file]->getMapping(std::max(segmentSize,
+                                                               segments[position.file]->size));
+    }
+
+    return std::string(static_cast<const char*>(mapping->data) + position.offset, position.length);
+#endif
+}
+
+void CryptoKernel::BlockStore::sync() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if(!unsynced) {
+        return;
+    }
+
+    if(!syncFile(appending)) {
+        throw std::runtime_error("Could not sync " + segmentFile(segments.size() - 1));
+    }
+
+    unsynced = false;
+}
+
+std::pair<uint32_t, uint64_t> CryptoKernel::BlockStore::getSize() {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t bytes = 0;
+    for(const auto& segment : segments) {
+        bytes += segment->size;
+    }
+
+    return std::make_pair(segments.size(), bytes);
+}
+
+void CryptoKernel::BlockStore::destroy(const std::string& directory) {
+    for(uint32_t file = 0; ; file++) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/blk%05u.dat", file);
+        if(std::remove((directory + name).c_str()) != 0) {
+            break;
+        }
+    }
+
+#ifdef _WIN32
+    _rmdir(directory.c_str());
+#else
+    rmdir(directory.c_str());
+#endif
+}
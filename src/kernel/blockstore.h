@@ -0,0 +1,121 @@
+/*  CryptoKernel - A library for creating blockchain based digital currency
+    Copyright (C) 2016  James Lovejoy
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BLOCKSTORE_H_INCLUDED
+#define BLOCKSTORE_H_INCLUDED
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+namespace CryptoKernel {
+/**
+* Keeps block bodies in append-only segment files named blk00000.dat,
+* blk00001.dat and so on. Bodies never change once written so they are kept
+* out of the database, where compaction would rewrite them over and over.
+* The database indexes them by Position. Reads are served from a read-only
+* memory map of each segment.
+*
+* Nothing is ever removed. The bytes of a body whose database transaction
+* was aborted stay in the file unreferenced.
+*/
+class BlockStore {
+public:
+    /**
+    * Where a body was written
+    */
+    struct Position {
+        uint32_t file;
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    /**
+    * Opens the store in the given directory, creating it if it does not
+    * exist. Appends continue at the end of the last segment.
+    *
+    * @param directory the directory of the segment files
+    * @param segmentSize the size in bytes a segment is filled to before
+    *        appends move on to the next one
+    * @throw std::runtime_error if the directory or a segment could not be
+    *        opened
+    */
+    BlockStore(const std::string& directory, const uint64_t segmentSize = defaultSegmentSize);
+    ~BlockStore();
+
+    /**
+    * Appends data to the current segment. The data is passed to the
+    * operating system before returning but is only durable after sync().
+    * A failed write is cut off the segment again.
+    *
+    * @param data the bytes to append
+    * @return the position data was written at
+    * @throw std::runtime_error if the write failed
+    */
+    Position append(const std::string& data);
+
+    /**
+    * Reads back data written by append
+    *
+    * @param position a position returned by append
+    * @return the bytes at position
+    * @throw std::runtime_error if position lies outside the segments
+    */
+    std::string read(const Position& position);
+
+    /**
+    * Flushes appended data to disk. Must be called before a database commit
+    * that refers to it, the database may be synced without it.
+    *
+    * @throw std::runtime_error if the flush failed
+    */
+    void sync();
+
+    /**
+    * Returns the number of segments and the bytes written to them
+    */
+    std::pair<uint32_t, uint64_t> getSize();
+
+    /**
+    * Deletes the segments in the given directory and the directory itself
+    */
+    static void destroy(const std::string& directory);
+
+    static const uint64_t defaultSegmentSize = 128 * 1024 * 1024;
+
+private:
+    class Segment;
+
+    std::string segmentFile(const uint32_t file) const;
+    std::shared_ptr<Segment> getSegment(const uint32_t file);
+    void openLast();
+
+    std::string directory;
+    uint64_t segmentSize;
+
+    // Held while appending, and while opening or looking up a segment
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Segment>> segments;
+    std::FILE* appending;
+    bool unsynced;
+};
+}
+
+#endif // BLOCKSTORE_H_INCLUDED
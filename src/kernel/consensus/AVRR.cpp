@@ -70,7 +70,7 @@ CryptoKernel::Consensus::AVRR::consensusData
 CryptoKernel::Consensus::AVRR::getConsensusData(const CryptoKernel::Blockchain::block&
         block) {
     consensusData returning;
-    const Json::Value data = block.getConsensusData();
+    const Json::Value& data = block.getConsensusData();
     returning.publicKey = data["publicKey"].asString();
     returning.signature = data["signature"].asString();
     returning.sequenceNumber = data["sequenceNumber"].asUInt64();
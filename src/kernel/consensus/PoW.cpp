@@ -5,6 +5,17 @@
 #include "Lyra2REv2/Lyra2RE.h"
 #include "../crypto.h"
 
+namespace {
+    // Kimoto Gravity Well retargets every kgwInterval blocks once the chain
+    // is kgwMinBlocks long, before that it uses the minimum difficulty
+    const uint64_t kgwMinBlocks = 144;
+    const uint64_t kgwInterval = 12;
+
+    CryptoKernel::BigNum kgwMinDifficulty() {
+        return CryptoKernel::BigNum("fffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+    }
+}
+
 CryptoKernel::Consensus::PoW::PoW(const uint64_t blockTarget,
                                   CryptoKernel::Blockchain* blockchain,
                                   const bool miner,
@@ -103,7 +114,7 @@ CryptoKernel::Consensus::PoW::consensusData
 CryptoKernel::Consensus::PoW::getConsensusData(const CryptoKernel::Blockchain::block&
         block) {
     consensusData data;
-    const Json::Value consensusJson = block.getConsensusData();
+    const Json::Value& consensusJson = block.getConsensusData();
     try {
         data.target = CryptoKernel::BigNum(consensusJson["target"].asString());
         data.totalWork = CryptoKernel::BigNum(consensusJson["totalWork"].asString());
@@ -118,7 +129,22 @@ CryptoKernel::Consensus::PoW::consensusData
 CryptoKernel::Consensus::PoW::getConsensusData(const CryptoKernel::Blockchain::dbBlock&
         block) {
     consensusData data;
-    const Json::Value consensusJson = block.getConsensusData();
+    const Json::Value& consensusJson = block.getConsensusData();
+    try {
+        data.target = CryptoKernel::BigNum(consensusJson["target"].asString());
+        data.totalWork = CryptoKernel::BigNum(consensusJson["totalWork"].asString());
+        data.nonce = consensusJson["nonce"].asUInt64();
+    } catch(const Json::Exception& e) {
+        throw CryptoKernel::Blockchain::InvalidElementException("Block consensusData JSON is malformed");
+    }
+    return data;
+}
+
+CryptoKernel::Consensus::PoW::consensusData
+CryptoKernel::Consensus::PoW::getConsensusData(const CryptoKernel::Blockchain::blockHeader&
+        header) {
+    consensusData data;
+    const Json::Value& consensusJson = header.getConsensusData();
     try {
         data.target = CryptoKernel::BigNum(consensusJson["target"].asString());
         data.totalWork = CryptoKernel::BigNum(consensusJson["totalWork"].asString());
@@ -166,6 +192,29 @@ bool CryptoKernel::Consensus::PoW::checkConsensusRules(Storage::Transaction* tra
     }
 }
 
+bool CryptoKernel::Consensus::PoW::checkConsensusRules(Storage::Transaction* transaction,
+        const CryptoKernel::Blockchain::blockHeader& header,
+        const CryptoKernel::Blockchain::blockHeader& previousHeader) {
+    try {
+        const consensusData headerData = getConsensusData(header);
+
+        //Check proof of work against the claimed target
+        if(headerData.target <= calculatePoW(header, headerData.nonce)) {
+            return false;
+        }
+
+        //Check total work
+        const consensusData previousData = getConsensusData(previousHeader);
+        const BigNum inverse =
+            CryptoKernel::BigNum("ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff") -
+            headerData.target;
+
+        return headerData.totalWork == inverse + previousData.totalWork;
+    } catch(const CryptoKernel::Blockchain::InvalidElementException& e) {
+        return false;
+    }
+}
+
 CryptoKernel::BigNum CryptoKernel::Consensus::PoW::calculatePoW(
     const CryptoKernel::Blockchain::block& block, const uint64_t nonce) {
     std::stringstream buffer;
@@ -173,8 +222,15 @@ CryptoKernel::BigNum CryptoKernel::Consensus::PoW::calculatePoW(
     return powFunction(buffer.str());
 }
 
+CryptoKernel::BigNum CryptoKernel::Consensus::PoW::calculatePoW(
+    const CryptoKernel::Blockchain::blockHeader& header, const uint64_t nonce) {
+    std::stringstream buffer;
+    buffer << header.getId().toString() << nonce;
+    return powFunction(buffer.str());
+}
+
 Json::Value CryptoKernel::Consensus::PoW::generateConsensusData(
-    Storage::Transaction* transaction, const CryptoKernel::BigNum& previousBlockId,
+    Storage::Transaction* transaction, const CryptoKernel::uint256& previousBlockId,
     const std::string& publicKey) {
     consensusData data;
     data.target = calculateTarget(transaction, previousBlockId);
@@ -198,20 +254,18 @@ CryptoKernel::BigNum CryptoKernel::Consensus::PoW::KGW_SHA256::powFunction(
 }
 
 CryptoKernel::BigNum CryptoKernel::Consensus::PoW::KGW_SHA256::calculateTarget(
-    Storage::Transaction* transaction, const CryptoKernel::BigNum& previousBlockId) {
-    const uint64_t minBlocks = 144;
+    Storage::Transaction* transaction, const CryptoKernel::uint256& previousBlockId) {
     const uint64_t maxBlocks = 4032;
-    const CryptoKernel::BigNum minDifficulty =
-        CryptoKernel::BigNum("fffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+    const CryptoKernel::BigNum minDifficulty = kgwMinDifficulty();
 
     CryptoKernel::Blockchain::dbBlock currentBlock = blockchain->getBlockDB(transaction,
             previousBlockId.toString());
     consensusData currentBlockData = getConsensusData(currentBlock);
     CryptoKernel::Blockchain::dbBlock lastSolved = currentBlock;
 
-    if(currentBlock.getHeight() < minBlocks) {
+    if(currentBlock.getHeight() < kgwMinBlocks) {
         return minDifficulty;
-    } else if(currentBlock.getHeight() % 12 != 0) {
+    } else if(currentBlock.getHeight() % kgwInterval != 0) {
         return currentBlockData.target;
     } else {
         uint64_t blocksScanned = 0;
@@ -254,12 +308,12 @@ CryptoKernel::BigNum CryptoKernel::Consensus::PoW::KGW_SHA256::calculateTarget(
                 rateAdjustmentRatio = double(targetRate) / double(actualRate);
             }
 
-            eventHorizonDeviation = 1 + (0.7084 * pow((double(blocksScanned)/double(minBlocks)),
+            eventHorizonDeviation = 1 + (0.7084 * pow((double(blocksScanned)/double(kgwMinBlocks)),
                                          -1.228));
             eventHorizonDeviationFast = eventHorizonDeviation;
             eventHorizonDeviationSlow = 1 / eventHorizonDeviation;
 
-            if(blocksScanned >= minBlocks) {
+            if(blocksScanned >= kgwMinBlocks) {
                 if((rateAdjustmentRatio <= eventHorizonDeviationSlow) ||
                         (rateAdjustmentRatio >= eventHorizonDeviationFast)) {
                     break;
@@ -293,6 +347,28 @@ CryptoKernel::BigNum CryptoKernel::Consensus::PoW::KGW_SHA256::calculateTarget(
     }
 }
 
+bool CryptoKernel::Consensus::PoW::KGW_SHA256::checkConsensusRules(
+    Storage::Transaction* transaction, const CryptoKernel::Blockchain::blockHeader& header,
+    const CryptoKernel::Blockchain::blockHeader& previousHeader) {
+    if(!PoW::checkConsensusRules(transaction, header, previousHeader)) {
+        return false;
+    }
+
+    //Check the target follows calculateTarget without the earlier blocks
+    try {
+        const consensusData headerData = getConsensusData(header);
+        if(previousHeader.getHeight() < kgwMinBlocks) {
+            return headerData.target == kgwMinDifficulty();
+        } else if(previousHeader.getHeight() % kgwInterval != 0) {
+            return headerData.target == getConsensusData(previousHeader).target;
+        }
+
+        return headerData.target <= kgwMinDifficulty();
+    } catch(const CryptoKernel::Blockchain::InvalidElementException& e) {
+        return false;
+    }
+}
+
 bool CryptoKernel::Consensus::PoW::KGW_SHA256::verifyTransaction(
     Storage::Transaction* transaction, const CryptoKernel::Blockchain::transaction& tx) {
     return true;
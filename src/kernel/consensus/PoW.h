@@ -51,8 +51,17 @@ public:
                              CryptoKernel::Blockchain::block& block,
                              const CryptoKernel::Blockchain::dbBlock& previousBlock);
 
+    /**
+    * Checks the following rules without the chain state:
+    *   - Proof of Work is below the target the header claims
+    *   - the header's total work is the previous header's plus its own
+    */
+    bool checkConsensusRules(Storage::Transaction* transaction,
+                             const CryptoKernel::Blockchain::blockHeader& header,
+                             const CryptoKernel::Blockchain::blockHeader& previousHeader);
+
     Json::Value generateConsensusData(Storage::Transaction* transaction,
-                                      const CryptoKernel::BigNum& previousBlockId, const std::string& publicKey);
+                                      const CryptoKernel::uint256& previousBlockId, const std::string& publicKey);
 
     /**
     * Pure virtual function that provides a proof of work hash
@@ -72,7 +81,7 @@ public:
     * @return the hex target of the block
     */
     virtual CryptoKernel::BigNum calculateTarget(Storage::Transaction* transaction,
-            const BigNum& previousBlockId) = 0;
+            const uint256& previousBlockId) = 0;
 
     /**
     * This class uses Kimoto Gravity Well for difficulty adjustment
@@ -95,6 +104,12 @@ public:
     CryptoKernel::BigNum calculatePoW(const CryptoKernel::Blockchain::block& block,
                                       const uint64_t nonce);
 
+    /**
+    * Calculate the PoW for a given block header
+    */
+    CryptoKernel::BigNum calculatePoW(const CryptoKernel::Blockchain::blockHeader& header,
+                                      const uint64_t nonce);
+
     virtual void start();
 protected:
     CryptoKernel::Blockchain* blockchain;
@@ -107,6 +122,7 @@ protected:
     };
     consensusData getConsensusData(const CryptoKernel::Blockchain::block& block);
     consensusData getConsensusData(const CryptoKernel::Blockchain::dbBlock& block);
+    consensusData getConsensusData(const CryptoKernel::Blockchain::blockHeader& header);
     Json::Value consensusDataToJson(const consensusData& data);
 
 private:
@@ -133,7 +149,17 @@ public:
     * Uses Kimoto Gravity Well to retarget the difficulty
     */
     virtual CryptoKernel::BigNum calculateTarget(Storage::Transaction* transaction,
-                                         const BigNum& previousBlockId);
+                                         const uint256& previousBlockId);
+
+    using PoW::checkConsensusRules;
+
+    /**
+    * Also checks that the header's target only differs from the previous
+    * header's at a retarget
+    */
+    bool checkConsensusRules(Storage::Transaction* transaction,
+                             const CryptoKernel::Blockchain::blockHeader& header,
+                             const CryptoKernel::Blockchain::blockHeader& previousHeader);
 
     /**
     * Has no effect, always returns true
@@ -23,7 +23,12 @@ bool CryptoKernel::Consensus::Regtest::checkConsensusRules(Storage::Transaction*
 	return true;
 }
 
-Json::Value CryptoKernel::Consensus::Regtest::generateConsensusData(Storage::Transaction* transaction, const CryptoKernel::BigNum& previousBlockId, const std::string& publicKey)
+bool CryptoKernel::Consensus::Regtest::checkConsensusRules(Storage::Transaction* transaction, const CryptoKernel::Blockchain::blockHeader& header, const CryptoKernel::Blockchain::blockHeader& previousHeader)
+{
+	return true;
+}
+
+Json::Value CryptoKernel::Consensus::Regtest::generateConsensusData(Storage::Transaction* transaction, const CryptoKernel::uint256& previousBlockId, const std::string& publicKey)
 {
 	return Json::Value();
 }
@@ -83,7 +88,7 @@ CryptoKernel::Consensus::Regtest::consensusData
 CryptoKernel::Consensus::Regtest::getConsensusData(const CryptoKernel::Blockchain::block& block) 
 {
 	consensusData data;
-	const Json::Value consensusJson = block.getConsensusData();
+	const Json::Value& consensusJson = block.getConsensusData();
 	try {
 		data.isBetter = consensusJson["isBetter"].asBool();
 	} catch(const Json::Exception& e) {
@@ -96,7 +101,7 @@ CryptoKernel::Consensus::Regtest::consensusData
 CryptoKernel::Consensus::Regtest::getConsensusData(const CryptoKernel::Blockchain::dbBlock& block) 
 {
 	consensusData data;
-	const Json::Value consensusJson = block.getConsensusData();
+	const Json::Value& consensusJson = block.getConsensusData();
 	try {
 		data.isBetter = consensusJson["isBetter"].asBool();
 	} catch(const Json::Exception& e) {
@@ -31,8 +31,12 @@ public:
                         	 CryptoKernel::Blockchain::block& block,
                              const CryptoKernel::Blockchain::dbBlock& previousBlock);
 
+	bool checkConsensusRules(Storage::Transaction* transaction,
+                             const CryptoKernel::Blockchain::blockHeader& header,
+                             const CryptoKernel::Blockchain::blockHeader& previousHeader);
+
 	Json::Value generateConsensusData(Storage::Transaction* transaction,
-			const CryptoKernel::BigNum& previousBlockId, 
+			const CryptoKernel::uint256& previousBlockId, 
 	const std::string& publicKey);
 
 	/**
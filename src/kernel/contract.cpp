@@ -103,9 +103,12 @@ void CryptoKernel::ContractRunner::setupEnvironment(Storage::Transaction* dbTx,
 bool CryptoKernel::ContractRunner::evaluateValid(Storage::Transaction* dbTx,
         const CryptoKernel::Blockchain::transaction& tx) {
     for(const CryptoKernel::Blockchain::input& inp : tx.getInputs()) {
-        const CryptoKernel::Blockchain::output out = CryptoKernel::Blockchain::dbOutput(
-                    blockchain->utxos->get(dbTx, inp.getOutputId().toString()));
-        const Json::Value data = out.getData();
+        const auto out = blockchain->getUnspentOutput(dbTx, inp.getOutputId().toString());
+        if(!out) {
+            throw CryptoKernel::Blockchain::InvalidElementException("Output " +
+                    inp.getOutputId().toString() + " is not unspent");
+        }
+        const Json::Value data = out->getData();
         if(!data["contract"].empty()) {
             if(!this->evaluateScriptValid(dbTx, tx, inp, data["contract"].asString())) {
                 return false;
@@ -7,7 +7,7 @@
 #include <json/writer.h>
 #include <json/reader.h>
 
-#include "ckmath.h"
+#include "uint256.h"
 #include "blockchain.h"
 
 namespace CryptoKernel {
@@ -16,7 +16,7 @@ namespace CryptoKernel {
             MerkleProof();
             MerkleProof(const Json::Value& json);
             int positionInTotalSet;
-            std::vector<BigNum> leaves;
+            std::vector<uint256> leaves;
             Json::Value toJson() const;
     };
 
@@ -29,17 +29,17 @@ namespace CryptoKernel {
             
             MerkleNode(const std::shared_ptr<MerkleNode> left);
             
-            MerkleNode(const BigNum& left, const BigNum& right);
+            MerkleNode(const uint256& left, const uint256& right);
             
-            MerkleNode(const BigNum& left);
+            MerkleNode(const uint256& left);
             
-            static std::shared_ptr<MerkleNode> makeMerkleTree(const std::set<BigNum>& leaves);
+            static std::shared_ptr<MerkleNode> makeMerkleTree(const std::set<uint256>& leaves);
             static std::shared_ptr<CryptoKernel::MerkleNode> makeMerkleTreeFromProof(std::shared_ptr<CryptoKernel::MerkleProof> proof);
-            std::shared_ptr<CryptoKernel::MerkleProof> makeProof(BigNum proofValue);
-            BigNum getMerkleRoot() const;
+            std::shared_ptr<CryptoKernel::MerkleProof> makeProof(uint256 proofValue);
+            uint256 getMerkleRoot() const;
             
-            BigNum getLeftVal() const;
-            BigNum getRightVal() const;
+            uint256 getLeftVal() const;
+            uint256 getRightVal() const;
             std::shared_ptr<MerkleNode>  getLeftNode();
             std::shared_ptr<MerkleNode>  getRightNode();
             MerkleNode* getAncestor() const;
@@ -50,20 +50,20 @@ namespace CryptoKernel {
             std::shared_ptr<MerkleNode> leftNode;
             std::shared_ptr<MerkleNode> rightNode;
 
-            BigNum leftVal;
-            BigNum rightVal;
+            uint256 leftVal;
+            uint256 rightVal;
                         
-            const CryptoKernel::MerkleNode* findDescendant(const BigNum& needle) const;
-            static BigNum calcRoot(const std::string& left, const std::string& right);
+            const CryptoKernel::MerkleNode* findDescendant(const uint256& needle) const;
+            static uint256 calcRoot(const std::string& left, const std::string& right);
 
         protected:
             bool leaf;
-            BigNum root;
+            uint256 root;
     };
 
     class MerkleRootNode : public MerkleNode {
         public:
-            MerkleRootNode(const BigNum& merkleRoot);
+            MerkleRootNode(const uint256& merkleRoot);
     };
 
     
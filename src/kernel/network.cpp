@@ -119,7 +119,8 @@ CryptoKernel::Network::Connection::~Connection() {
 CryptoKernel::Network::Network(CryptoKernel::Log* log,
                                CryptoKernel::Blockchain* blockchain,
                                const unsigned int port,
-                               const std::string& dbDir) {
+                               const std::string& dbDir,
+                               const Storage::Profile& storageProfile) {
     this->log = log;
     this->blockchain = blockchain;
     this->port = port;
@@ -129,7 +130,7 @@ CryptoKernel::Network::Network(CryptoKernel::Log* log,
 
     myAddress = sf::IpAddress::getPublicAddress();
 
-    networkdb.reset(new CryptoKernel::Storage(dbDir, false, 8, false));
+    networkdb.reset(new CryptoKernel::Storage(dbDir, storageProfile));
     peers.reset(new Storage::Table("peers"));
 
     std::unique_ptr<Storage::Transaction> dbTx(networkdb->begin());
@@ -537,6 +538,22 @@ void CryptoKernel::Network::networkFunc() {
 							} while(running);
 
 							currentHeight += nBlocks;
+
+							// Batches fetched while searching back can overlap near
+							// the genesis block
+							std::vector<CryptoKernel::Blockchain::blockHeader> headers;
+							for(auto rit = blocks.rbegin(); rit != blocks.rend(); ++rit) {
+								if(headers.empty() || rit->getHeight() > headers.back().getHeight()) {
+									headers.push_back(rit->getHeader());
+								}
+							}
+
+							if(std::get<1>(blockchain->verifyHeaders(headers))) {
+								log->printf(LOG_LEVEL_WARN, "Network(): " + peerUrl + " sent invalid block headers");
+								changeScore(peerUrl, 50);
+								currentHeight = startHeight;
+								continue;
+							}
 						}
 
 						log->printf(LOG_LEVEL_INFO, "Network(): Found common block " + std::to_string(currentHeight-1) + " with peer, starting block download");
@@ -550,6 +567,24 @@ void CryptoKernel::Network::networkFunc() {
 							try {
 								const auto newBlocks = it.second->getBlocks(currentHeight + 1, currentHeight + 6);
 								nBlocks = newBlocks.size();
+
+								// Reject a bogus chain by its headers before its blocks
+								// are queued for the block processor. Headers building on
+								// blocks it has yet to submit cannot be checked here.
+								std::vector<CryptoKernel::Blockchain::blockHeader> headers;
+								for(const auto& newBlock : newBlocks) {
+									headers.push_back(newBlock.getHeader());
+								}
+
+								const auto headerResult = blocks.empty() ?
+														  blockchain->verifyHeaders(headers) :
+														  blockchain->verifyHeaders(blocks.front().getHeader(), headers);
+								if(std::get<1>(headerResult)) {
+									log->printf(LOG_LEVEL_WARN, "Network(): " + peerUrl + " sent invalid block headers");
+									changeScore(peerUrl, 50);
+									break;
+								}
+
 								blocks.insert(blocks.begin(), newBlocks.rbegin(), newBlocks.rend());
 								if(nBlocks > 0) {
 									madeProgress = true;
@@ -779,6 +814,10 @@ unsigned int CryptoKernel::Network::getConnections() {
     return connected.size();
 }
 
+Json::Value CryptoKernel::Network::getStorageInfo() {
+    return networkdb->getProperties();
+}
+
 void CryptoKernel::Network::broadcastTransactions(const
         std::vector<CryptoKernel::Blockchain::transaction> transactions) {
 	std::vector<std::string> keys = connected.keys();
@@ -27,9 +27,11 @@ public:
     * @param blockchain a pointer to the blockchain to sync
     * @param port the port to listen on
     * @param dbDir the directory of the peers database
+    * @param storageProfile the LevelDB tuning of the peers database
     */
     Network(CryptoKernel::Log* log, CryptoKernel::Blockchain* blockchain,
-            const unsigned int port, const std::string& dbDir);
+            const unsigned int port, const std::string& dbDir,
+            const Storage::Profile& storageProfile = Storage::Profile::peers());
 
     /**
     * Default destructor
@@ -43,6 +45,13 @@ public:
     */
     unsigned int getConnections();
 
+    /**
+    * Returns the live properties of the peers database
+    *
+    * @return a json object as described in Storage::getProperties()
+    */
+    Json::Value getStorageInfo();
+
     /**
     * Broadcast a set of transactions to connected peers
     *
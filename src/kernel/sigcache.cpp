@@ -0,0 +1,111 @@
+/*  CryptoKernel - A library for creating blockchain based digital currency
+    Copyright (C) 2016  James Lovejoy
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <random>
+#include <algorithm>
+
+#include "sigcache.h"
+#include "crypto.h"
+
+CryptoKernel::SignatureCache::SignatureCache(const size_t maxEntries) {
+    maxShardEntries = std::max<size_t>(maxEntries / shardCount, 1);
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+
+    for(unsigned int i = 0; i < shardCount; i++) {
+        shards.emplace_back(new Shard());
+    }
+
+    std::random_device r;
+    for(unsigned int i = 0; i < 8; i++) {
+        salt += std::to_string(r()) + ":";
+    }
+}
+
+std::string CryptoKernel::SignatureCache::getKey(const std::string& scheme,
+        const std::string& publicKey, const std::string& message,
+        const std::string& signature) const {
+    // Each field is prefixed with its length so fields cannot run into each other
+    std::string preimage = salt;
+    for(const std::string* field : {&scheme, &publicKey, &message, &signature}) {
+        preimage += std::to_string(field->size()) + ":" + *field;
+    }
+
+    return CryptoKernel::Crypto::sha256(preimage);
+}
+
+CryptoKernel::SignatureCache::Shard& CryptoKernel::SignatureCache::getShard(
+    const std::string& key) {
+    return *shards[std::hash<std::string>()(key) % shardCount];
+}
+
+bool CryptoKernel::SignatureCache::contains(const std::string& scheme,
+        const std::string& publicKey, const std::string& message,
+        const std::string& signature) {
+    const std::string key = getKey(scheme, publicKey, message, signature);
+    Shard& shard = getShard(key);
+
+    bool found;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        found = shard.entries.count(key) > 0;
+    }
+
+    if(found) {
+        hits++;
+    } else {
+        misses++;
+    }
+
+    return found;
+}
+
+void CryptoKernel::SignatureCache::insert(const std::string& scheme,
+        const std::string& publicKey, const std::string& message,
+        const std::string& signature) {
+    const std::string key = getKey(scheme, publicKey, message, signature);
+    Shard& shard = getShard(key);
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if(!shard.entries.insert(key).second) {
+        return;
+    }
+    shard.order.push_back(key);
+
+    while(shard.order.size() > maxShardEntries) {
+        shard.entries.erase(shard.order.front());
+        shard.order.pop_front();
+        evictions++;
+    }
+}
+
+CryptoKernel::SignatureCache::Stats CryptoKernel::SignatureCache::getStats() {
+    Stats stats;
+    stats.entries = 0;
+    for(const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        stats.entries += shard->entries.size();
+    }
+
+    stats.maxEntries = maxShardEntries * shardCount;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.evictions = evictions;
+
+    return stats;
+}
@@ -0,0 +1,103 @@
+/*  CryptoKernel - A library for creating blockchain based digital currency
+    Copyright (C) 2016  James Lovejoy
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SIGCACHE_H_INCLUDED
+#define SIGCACHE_H_INCLUDED
+
+#include <string>
+#include <unordered_set>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+namespace CryptoKernel {
+/**
+* Remembers signatures that have already been verified so that a
+* transaction checked when it entered the mempool is not checked again when
+* its block arrives. Only valid signatures are stored. Entries are keyed by
+* a SHA256 digest salted with a secret chosen at startup, so peers cannot
+* predict which entries collide or are evicted together. The entries are
+* split across shards with their own locks for concurrent verification.
+*/
+class SignatureCache {
+public:
+    /**
+    * Creates an empty cache
+    *
+    * @param maxEntries the number of signatures kept before the oldest are evicted
+    */
+    SignatureCache(const size_t maxEntries);
+
+    /**
+    * Checks whether the given signature has been verified before
+    *
+    * @param scheme names the signature scheme, so the same bytes verified
+    *        under one scheme are not accepted under another
+    * @param publicKey the key the signature was verified against
+    * @param message the message that was signed
+    * @param signature the signature
+    * @return true iff insert was called with the same arguments and the
+    *         entry has not been evicted since
+    */
+    bool contains(const std::string& scheme, const std::string& publicKey,
+                  const std::string& message, const std::string& signature);
+
+    /**
+    * Records that the given signature is valid, see contains()
+    */
+    void insert(const std::string& scheme, const std::string& publicKey,
+                const std::string& message, const std::string& signature);
+
+    struct Stats {
+        uint64_t entries;
+        uint64_t maxEntries;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+    };
+
+    Stats getStats();
+
+    static const size_t defaultMaxEntries = 100000;
+
+private:
+    struct Shard {
+        std::unordered_set<std::string> entries;
+        // Insertion order, the front is evicted first
+        std::deque<std::string> order;
+        std::mutex mutex;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    size_t maxShardEntries;
+    std::string salt;
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> evictions;
+
+    static const unsigned int shardCount = 16;
+
+    std::string getKey(const std::string& scheme, const std::string& publicKey,
+                       const std::string& message, const std::string& signature) const;
+    Shard& getShard(const std::string& key);
+};
+}
+
+#endif // SIGCACHE_H_INCLUDED
@@ -17,59 +17,484 @@
 
 #include <sstream>
 #include <memory>
+#include <cstring>
+#include <list>
+#include <unordered_map>
+#include <condition_variable>
 
 #include <json/writer.h>
 #include <json/reader.h>
 
-#include <leveldb/write_batch.h>
-#include <leveldb/cache.h>
-#include <leveldb/filter_policy.h>
-
 #include "storage.h"
+#include "storagebackend.h"
 
-CryptoKernel::Storage::Storage(const std::string& filename, const bool sync, const unsigned int cache, const bool bloom) {
-    options.create_if_missing = true;
+class CryptoKernel::Storage::ReadCache {
+public:
+    ReadCache(const size_t maxBytes, const unsigned int nShards, const uint64_t seq)
+    : shards(nShards) {
+        maxShardBytes = maxBytes / nShards;
+        for(auto& shard : shards) {
+            shard.bytes = 0;
+            shard.invalidatedSeq = seq;
+        }
+        hits = 0;
+        misses = 0;
+        insertions = 0;
+        evictions = 0;
+        invalidations = 0;
+    }
 
-    if(cache > 0) {
-        options.block_cache = leveldb::NewLRUCache(cache * 1024 * 1024);
+    // Looks up a key for a reader that sees every commit up to seq
+    bool get(const std::string& key, const uint64_t seq, Json::Value& value) {
+        Shard& shard = getShard(key);
+        std::lock_guard<std::mutex> lock(shard.mut);
+        const auto it = shard.entries.find(key);
+        if(it == shard.entries.end() || it->second.since > seq) {
+            misses++;
+            return false;
+        }
+
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lruPos);
+        value = it->second.value;
+        hits++;
+        return true;
     }
 
-    if(bloom) {
-        options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+    // Caches a value read by a reader that sees every commit up to seq
+    void put(const std::string& key, const Json::Value& value, const size_t size,
+             const uint64_t seq) {
+        Shard& shard = getShard(key);
+        std::lock_guard<std::mutex> lock(shard.mut);
+
+        // The key may have been written since the reader's view, so the
+        // value read could already be stale
+        if(shard.invalidatedSeq > seq || size > maxShardBytes) {
+            return;
+        }
+
+        eraseEntry(shard, key);
+
+        shard.lru.push_front(key);
+        // Any write of the key since the shard was last invalidated would have
+        // removed this entry, so it is valid for every reader since then
+        shard.entries[key] = Entry{value, size, shard.invalidatedSeq, shard.lru.begin()};
+        shard.bytes += size;
+        insertions++;
+
+        while(shard.bytes > maxShardBytes) {
+            eraseEntry(shard, shard.lru.back());
+            evictions++;
+        }
     }
 
-    this->sync = sync;
+    void invalidate(const std::string& key, const uint64_t seq) {
+        Shard& shard = getShard(key);
+        std::lock_guard<std::mutex> lock(shard.mut);
+        shard.invalidatedSeq = seq;
+        if(eraseEntry(shard, key)) {
+            invalidations++;
+        }
+    }
 
-    writeLock.lock();
-    readLock.lock();
-    leveldb::Status dbstatus = leveldb::DB::Open(options, filename, &db);
-    readLock.unlock();
-    writeLock.unlock();
+    CryptoKernel::Storage::ReadCacheStats getStats() {
+        CryptoKernel::Storage::ReadCacheStats stats;
+        stats.hits = hits;
+        stats.misses = misses;
+        stats.insertions = insertions;
+        stats.evictions = evictions;
+        stats.invalidations = invalidations;
+        stats.entries = 0;
+        stats.bytes = 0;
+        for(auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mut);
+            stats.entries += shard.entries.size();
+            stats.bytes += shard.bytes;
+        }
+        return stats;
+    }
+
+private:
+    struct Entry {
+        Json::Value value;
+        size_t size;
+        uint64_t since;
+        std::list<std::string>::iterator lruPos;
+    };
+
+    struct Shard {
+        std::mutex mut;
+        std::unordered_map<std::string, Entry> entries;
+        std::list<std::string> lru;
+        size_t bytes;
+        uint64_t invalidatedSeq;
+    };
+
+    Shard& getShard(const std::string& key) {
+        return shards[std::hash<std::string>()(key) % shards.size()];
+    }
+
+    bool eraseEntry(Shard& shard, const std::string& key) {
+        const auto it = shard.entries.find(key);
+        if(it == shard.entries.end()) {
+            return false;
+        }
+        shard.bytes -= it->second.size;
+        shard.lru.erase(it->second.lruPos);
+        shard.entries.erase(it);
+        return true;
+    }
+
+    std::vector<Shard> shards;
+    size_t maxShardBytes;
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> insertions;
+    std::atomic<uint64_t> evictions;
+    std::atomic<uint64_t> invalidations;
+};
+
+class CryptoKernel::Storage::CommitQueue {
+public:
+    struct Write {
+        std::string key;
+        std::string encoded;
+        Json::Value data;
+        bool erased;
+    };
 
-    if(!dbstatus.ok()) {
-        throw std::runtime_error("Failed to open the database");
+    struct Commit {
+        std::vector<Write> writes;
+        bool done;
+        std::string error;
+    };
+
+    CommitQueue(CryptoKernel::Storage* db) {
+        this->db = db;
+        writing = false;
     }
+
+    // Called with the write lock held so commits queue in the order their
+    // transactions ran
+    std::shared_ptr<Commit> enqueue(std::vector<Write>&& writes) {
+        std::shared_ptr<Commit> commit(new Commit{std::move(writes), false, ""});
+
+        std::lock_guard<std::mutex> lock(mut);
+        for(const Write& write : commit->writes) {
+            Pending& pending = pendingWrites[write.key];
+            pending.data = write.data;
+            pending.erased = write.erased;
+            pending.refs++;
+        }
+        queue.push_back(commit);
+
+        return commit;
+    }
+
+    // Blocks until the commit is on disk, writing it along with everything
+    // else queued if nobody else is writing
+    void wait(const std::shared_ptr<Commit>& commit) {
+        std::unique_lock<std::mutex> lock(mut);
+        while(!commit->done) {
+            if(writing) {
+                cond.wait(lock);
+                continue;
+            }
+
+            writing = true;
+            std::vector<std::shared_ptr<Commit>> group;
+            group.swap(queue);
+            lock.unlock();
+
+            std::vector<Backend::Write> batch;
+            std::vector<std::string> keys;
+            for(const auto& member : group) {
+                for(const Write& write : member->writes) {
+                    batch.push_back(Backend::Write{write.key, write.encoded, write.erased});
+                    keys.push_back(write.key);
+                }
+            }
+
+            std::string error;
+            try {
+                db->write(batch, keys, group.size());
+            } catch(const std::runtime_error& e) {
+                error = e.what();
+            }
+
+            lock.lock();
+            finish(group, error);
+            if(!error.empty()) {
+                // Everything still queued was built on top of the failed group
+                finish(queue, error);
+                queue.clear();
+            }
+            writing = false;
+            cond.notify_all();
+        }
+
+        if(!commit->error.empty()) {
+            throw std::runtime_error(commit->error);
+        }
+    }
+
+    // Finds the latest queued change to a key that is not yet on disk
+    bool get(const std::string& key, Json::Value& value) {
+        std::lock_guard<std::mutex> lock(mut);
+        const auto it = pendingWrites.find(key);
+        if(it == pendingWrites.end()) {
+            return false;
+        }
+
+        value = it->second.erased ? Json::Value() : it->second.data;
+        return true;
+    }
+
+    // Blocks until every queued commit is on disk. Only meaningful with the
+    // write lock held, otherwise more commits can arrive.
+    void flush() {
+        std::unique_lock<std::mutex> lock(mut);
+        cond.wait(lock, [&]{ return queue.empty() && !writing; });
+    }
+
+private:
+    struct Pending {
+        Json::Value data;
+        bool erased;
+        unsigned int refs;
+    };
+
+    void finish(const std::vector<std::shared_ptr<Commit>>& commits, const std::string& error) {
+        for(const auto& commit : commits) {
+            for(const Write& write : commit->writes) {
+                const auto it = pendingWrites.find(write.key);
+                if(--it->second.refs == 0) {
+                    pendingWrites.erase(it);
+                }
+            }
+            commit->error = error;
+            commit->done = true;
+        }
+    }
+
+    CryptoKernel::Storage* db;
+
+    std::mutex mut;
+    std::condition_variable cond;
+    std::vector<std::shared_ptr<Commit>> queue;
+    std::unordered_map<std::string, Pending> pendingWrites;
+    bool writing;
+};
+
+CryptoKernel::Storage::Profile CryptoKernel::Storage::Profile::chainstate() {
+    Profile profile;
+    profile.backend = "leveldb";
+    profile.sync = false;
+    profile.cacheSize = 64;
+    profile.bloomBits = 10;
+    // Block sync writes in bulk, a bigger buffer means fewer level 0 files
+    profile.writeBufferSize = 32 * 1024 * 1024;
+    profile.maxOpenFiles = 1000;
+    profile.blockSize = 4096;
+    profile.compression = true;
+    profile.readCacheSize = 64 * 1024 * 1024;
+    profile.mapSize = uint64_t(64) * 1024 * 1024 * 1024;
+    // Blocks verify and commit in parallel
+    profile.optimistic = true;
+    profile.groupCommit = true;
+    return profile;
+}
+
+CryptoKernel::Storage::Profile CryptoKernel::Storage::Profile::peers() {
+    Profile profile;
+    profile.backend = "leveldb";
+    profile.sync = false;
+    profile.cacheSize = 8;
+    profile.bloomBits = 0;
+    profile.writeBufferSize = 1024 * 1024;
+    profile.maxOpenFiles = 64;
+    profile.blockSize = 4096;
+    profile.compression = true;
+    profile.readCacheSize = 0;
+    profile.mapSize = 256 * 1024 * 1024;
+    profile.optimistic = false;
+    profile.groupCommit = false;
+    return profile;
+}
+
+CryptoKernel::Storage::Profile CryptoKernel::Storage::Profile::wallet() {
+    Profile profile;
+    profile.backend = "leveldb";
+    profile.sync = true;
+    profile.cacheSize = 8;
+    profile.bloomBits = 0;
+    profile.writeBufferSize = 4 * 1024 * 1024;
+    profile.maxOpenFiles = 64;
+    profile.blockSize = 4096;
+    profile.compression = true;
+    profile.readCacheSize = 0;
+    profile.mapSize = uint64_t(4) * 1024 * 1024 * 1024;
+    profile.optimistic = false;
+    profile.groupCommit = false;
+    return profile;
+}
+
+CryptoKernel::Storage::Profile CryptoKernel::Storage::Profile::override(const Json::Value& json) const {
+    Profile returning = *this;
+    if(json.isNull()) {
+        return returning;
+    }
+
+    try {
+        if(!json.isObject()) {
+            throw std::runtime_error("Storage profile must be an object");
+        }
+
+        if(json.isMember("backend")) {
+            returning.backend = json["backend"].asString();
+        }
+        if(json.isMember("sync")) {
+            returning.sync = json["sync"].asBool();
+        }
+        if(json.isMember("cacheSize")) {
+            returning.cacheSize = json["cacheSize"].asUInt();
+        }
+        if(json.isMember("bloomBits")) {
+            returning.bloomBits = json["bloomBits"].asUInt();
+        }
+        if(json.isMember("writeBufferSize")) {
+            returning.writeBufferSize = json["writeBufferSize"].asUInt64();
+        }
+        if(json.isMember("maxOpenFiles")) {
+            returning.maxOpenFiles = json["maxOpenFiles"].asInt();
+        }
+        if(json.isMember("blockSize")) {
+            returning.blockSize = json["blockSize"].asUInt64();
+        }
+        if(json.isMember("compression")) {
+            returning.compression = json["compression"].asBool();
+        }
+        if(json.isMember("readCacheSize")) {
+            returning.readCacheSize = json["readCacheSize"].asUInt64();
+        }
+        if(json.isMember("mapSize")) {
+            returning.mapSize = json["mapSize"].asUInt64();
+        }
+        if(json.isMember("optimistic")) {
+            returning.optimistic = json["optimistic"].asBool();
+        }
+        if(json.isMember("groupCommit")) {
+            returning.groupCommit = json["groupCommit"].asBool();
+        }
+    } catch(const Json::Exception& e) {
+        throw std::runtime_error("Invalid storage profile: " + std::string(e.what()));
+    }
+
+    return returning;
+}
+
+Json::Value CryptoKernel::Storage::Profile::toJson() const {
+    Json::Value returning;
+    returning["backend"] = backend;
+    returning["sync"] = sync;
+    returning["cacheSize"] = cacheSize;
+    returning["bloomBits"] = bloomBits;
+    returning["writeBufferSize"] = Json::UInt64(writeBufferSize);
+    returning["maxOpenFiles"] = maxOpenFiles;
+    returning["blockSize"] = Json::UInt64(blockSize);
+    returning["compression"] = compression;
+    returning["readCacheSize"] = Json::UInt64(readCacheSize);
+    returning["mapSize"] = Json::UInt64(mapSize);
+    returning["optimistic"] = optimistic;
+    returning["groupCommit"] = groupCommit;
+    return returning;
+}
+
+namespace {
+    // The options the storage constructor has always used
+    CryptoKernel::Storage::Profile legacyProfile(const bool sync, const unsigned int cache,
+                                                 const bool bloom) {
+        const leveldb::Options defaults;
+
+        CryptoKernel::Storage::Profile profile;
+        profile.backend = "leveldb";
+        profile.sync = sync;
+        profile.cacheSize = cache;
+        profile.bloomBits = bloom ? 10 : 0;
+        profile.writeBufferSize = defaults.write_buffer_size;
+        profile.maxOpenFiles = defaults.max_open_files;
+        profile.blockSize = defaults.block_size;
+        profile.compression = defaults.compression != leveldb::kNoCompression;
+        profile.readCacheSize = 0;
+        profile.mapSize = uint64_t(1024) * 1024 * 1024;
+        profile.optimistic = false;
+        profile.groupCommit = false;
+        return profile;
+    }
+}
+
+CryptoKernel::Storage::Storage(const std::string& filename, const bool sync, const unsigned int cache, const bool bloom)
+    : Storage(filename, legacyProfile(sync, cache, bloom), nullptr) {
+}
+
+CryptoKernel::Storage::Storage(const std::string& filename, const bool sync, const unsigned int cache, const bool bloom,
+                               const std::shared_ptr<Codec>& codec)
+    : Storage(filename, legacyProfile(sync, cache, bloom), codec) {
+}
+
+CryptoKernel::Storage::Storage(const std::string& filename, const Profile& profile,
+                               const std::shared_ptr<Codec>& codec) : commitSeq(0), dbReads(0),
+                               optimistic(false), commitStats(CommitStats{0, 0, 0, 0, {}}) {
+    if(codec) {
+        this->codec = codec;
+    } else {
+        this->codec.reset(new JsonCodec());
+    }
+
+    this->sync = profile.sync;
+    this->profile = profile;
+
+    if(profile.backend == "leveldb") {
+        backend.reset(new LevelDBBackend(filename, profile));
+    } else if(profile.backend == "lmdb") {
+        backend.reset(new LMDBBackend(filename, profile));
+    } else {
+        throw std::runtime_error("Unknown storage backend " + profile.backend);
+    }
+
+    if(profile.readCacheSize > 0) {
+        setReadCache(profile.readCacheSize);
+    }
+
+    setGroupCommit(profile.groupCommit);
+    setOptimistic(profile.optimistic);
 }
 
 CryptoKernel::Storage::~Storage() {
     writeLock.lock();
+    if(commitQueue) {
+        commitQueue->flush();
+    }
     readLock.lock();
-    delete db;
-    delete options.block_cache;
-    delete options.filter_policy;
+    backend.reset();
     readLock.unlock();
     writeLock.unlock();
 }
 
 Json::Value CryptoKernel::Storage::toJson(const std::string& json) {
+    // Building a reader is far more expensive than parsing a typical value
+    // so each thread keeps its own
+    thread_local std::unique_ptr<Json::CharReader> reader;
+    if(!reader) {
+        Json::CharReaderBuilder rbuilder;
+        rbuilder["collectComments"] = false;
+        reader.reset(rbuilder.newCharReader());
+    }
+
     Json::Value returning;
-    Json::CharReaderBuilder rbuilder;
-    rbuilder["collectComments"] = false;
     std::string errs;
-    std::stringstream input;
-    input << json;
     try {
-        Json::parseFromStream(rbuilder, input, &returning, &errs);
+        reader->parse(json.data(), json.data() + json.size(), &returning, &errs);
     } catch(const Json::Exception& e) {
         return Json::Value();
     }
@@ -78,21 +503,582 @@ Json::Value CryptoKernel::Storage::toJson(const std::string& json) {
 }
 
 std::string CryptoKernel::Storage::toString(const Json::Value& json, const bool pretty) {
-    std::stringstream buf;   
-    Json::StreamWriterBuilder builder;
-    std::unique_ptr<Json::StreamWriter> writer;     
-    if(!pretty) {
-        builder["commentStyle"] = "None";
-        builder["indentation"] = "";
-    }
-    writer.reset(builder.newStreamWriter());
+    thread_local std::unique_ptr<Json::StreamWriter> compactWriter;
+    thread_local std::unique_ptr<Json::StreamWriter> prettyWriter;
+
+    std::unique_ptr<Json::StreamWriter>& writer = pretty ? prettyWriter : compactWriter;
+    if(!writer) {
+        Json::StreamWriterBuilder builder;
+        if(!pretty) {
+            builder["commentStyle"] = "None";
+            builder["indentation"] = "";
+        }
+        writer.reset(builder.newStreamWriter());
+    }
+
+    std::stringstream buf;
     writer->write(json, &buf);
     return buf.str() + "\n";
 }
 
+namespace {
+    // First byte of every BinaryCodec value. Json text never starts with it.
+    const unsigned char binaryMarker = 0xcb;
+
+    enum BinaryTag : unsigned char {
+        TAG_NULL = 0,
+        TAG_FALSE = 1,
+        TAG_TRUE = 2,
+        TAG_INT = 3,
+        TAG_UINT = 4,
+        TAG_REAL = 5,
+        TAG_STRING = 6,
+        TAG_HEX = 7,
+        TAG_BASE64 = 8,
+        TAG_ARRAY = 9,
+        TAG_OBJECT = 10
+    };
+
+    // Below this length packing a string saves too little to be worth checking
+    const size_t minPackedLength = 16;
+
+    void putVarint(std::string& out, uint64_t value) {
+        while(value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    bool getVarint(const char*& pos, const char* end, uint64_t& value) {
+        value = 0;
+        for(unsigned int shift = 0; shift < 64 && pos < end; shift += 7) {
+            const unsigned char byte = static_cast<unsigned char>(*pos++);
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if(!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int hexValue(const char c) {
+        if(c >= '0' && c <= '9') {
+            return c - '0';
+        } else if(c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        return -1;
+    }
+
+    bool isLowerHex(const char* str, const size_t len) {
+        for(size_t i = 0; i < len; i++) {
+            if(hexValue(str[i]) < 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const char base64Chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    int base64Value(const char c) {
+        if(c >= 'A' && c <= 'Z') {
+            return c - 'A';
+        } else if(c >= 'a' && c <= 'z') {
+            return c - 'a' + 26;
+        } else if(c >= '0' && c <= '9') {
+            return c - '0' + 52;
+        } else if(c == '+') {
+            return 62;
+        } else if(c == '/') {
+            return 63;
+        }
+        return -1;
+    }
+
+    // Appends the bytes of a base64 string to out. Fails unless encoding the
+    // bytes again would give back exactly the same string.
+    bool unpackBase64(const char* str, const size_t len, std::string& out) {
+        if(len == 0 || len % 4 != 0) {
+            return false;
+        }
+
+        size_t padding = 0;
+        if(str[len - 1] == '=') {
+            padding = str[len - 2] == '=' ? 2 : 1;
+        }
+
+        uint32_t bits = 0;
+        for(size_t i = 0; i < len - padding; i++) {
+            const int v = base64Value(str[i]);
+            if(v < 0) {
+                return false;
+            }
+            bits = (bits << 6) | v;
+            if(i % 4 == 3) {
+                out.push_back(static_cast<char>(bits >> 16));
+                out.push_back(static_cast<char>(bits >> 8));
+                out.push_back(static_cast<char>(bits));
+                bits = 0;
+            }
+        }
+
+        // Unused low bits of the final group must be zero to be canonical
+        if(padding == 1) {
+            if(bits & 0x3) {
+                return false;
+            }
+            out.push_back(static_cast<char>(bits >> 10));
+            out.push_back(static_cast<char>(bits >> 2));
+        } else if(padding == 2) {
+            if(bits & 0xf) {
+                return false;
+            }
+            out.push_back(static_cast<char>(bits >> 4));
+        }
+
+        return true;
+    }
+
+    void packBase64(const unsigned char* bytes, const size_t len, std::string& out) {
+        out.reserve(out.size() + (len + 2) / 3 * 4);
+        size_t i = 0;
+        for(; i + 2 < len; i += 3) {
+            const uint32_t bits = (bytes[i] << 16) | (bytes[i + 1] << 8) | bytes[i + 2];
+            out.push_back(base64Chars[(bits >> 18) & 0x3f]);
+            out.push_back(base64Chars[(bits >> 12) & 0x3f]);
+            out.push_back(base64Chars[(bits >> 6) & 0x3f]);
+            out.push_back(base64Chars[bits & 0x3f]);
+        }
+
+        if(len - i == 1) {
+            const uint32_t bits = bytes[i] << 16;
+            out.push_back(base64Chars[(bits >> 18) & 0x3f]);
+            out.push_back(base64Chars[(bits >> 12) & 0x3f]);
+            out.append("==");
+        } else if(len - i == 2) {
+            const uint32_t bits = (bytes[i] << 16) | (bytes[i + 1] << 8);
+            out.push_back(base64Chars[(bits >> 18) & 0x3f]);
+            out.push_back(base64Chars[(bits >> 12) & 0x3f]);
+            out.push_back(base64Chars[(bits >> 6) & 0x3f]);
+            out.push_back('=');
+        }
+    }
+
+    void putHex(std::string& out, const char* str, const size_t len) {
+        putVarint(out, len);
+        // Odd length strings get a zero nibble in front
+        size_t i = 0;
+        if(len % 2 != 0) {
+            out.push_back(static_cast<char>(hexValue(str[0])));
+            i = 1;
+        }
+        for(; i < len; i += 2) {
+            out.push_back(static_cast<char>((hexValue(str[i]) << 4) | hexValue(str[i + 1])));
+        }
+    }
+
+    bool getHex(const char*& pos, const char* end, std::string& str) {
+        static const char digits[] = "0123456789abcdef";
+        uint64_t nibbles;
+        if(!getVarint(pos, end, nibbles)) {
+            return false;
+        }
+        const uint64_t bytes = (nibbles + 1) / 2;
+        if(static_cast<uint64_t>(end - pos) < bytes) {
+            return false;
+        }
+        str.clear();
+        str.reserve(nibbles);
+        for(uint64_t i = 0; i < bytes; i++) {
+            const unsigned char byte = static_cast<unsigned char>(*pos++);
+            if(i > 0 || nibbles % 2 == 0) {
+                str.push_back(digits[byte >> 4]);
+            }
+            str.push_back(digits[byte & 0x0f]);
+        }
+        return true;
+    }
+
+    void putString(std::string& out, const char* str, const size_t len) {
+        putVarint(out, len);
+        out.append(str, len);
+    }
+
+    bool getString(const char*& pos, const char* end, std::string& str) {
+        uint64_t len;
+        if(!getVarint(pos, end, len) || static_cast<uint64_t>(end - pos) < len) {
+            return false;
+        }
+        str.assign(pos, len);
+        pos += len;
+        return true;
+    }
+
+    void encodeBinary(std::string& out, const Json::Value& value) {
+        switch(value.type()) {
+            case Json::nullValue:
+                out.push_back(TAG_NULL);
+                break;
+            case Json::booleanValue:
+                out.push_back(value.asBool() ? TAG_TRUE : TAG_FALSE);
+                break;
+            case Json::intValue: {
+                // Zigzag so small negative numbers stay short
+                const int64_t i = value.asInt64();
+                out.push_back(TAG_INT);
+                putVarint(out, (static_cast<uint64_t>(i) << 1) ^ static_cast<uint64_t>(i >> 63));
+                break;
+            }
+            case Json::uintValue:
+                out.push_back(TAG_UINT);
+                putVarint(out, value.asUInt64());
+                break;
+            case Json::realValue: {
+                const double d = value.asDouble();
+                uint64_t bits;
+                std::memcpy(&bits, &d, sizeof(bits));
+                out.push_back(TAG_REAL);
+                for(unsigned int i = 0; i < 8; i++) {
+                    out.push_back(static_cast<char>(bits >> (i * 8)));
+                }
+                break;
+            }
+            case Json::stringValue: {
+                const char* begin;
+                const char* end;
+                value.getString(&begin, &end);
+                const size_t len = end - begin;
+                if(len >= minPackedLength) {
+                    if(isLowerHex(begin, len)) {
+                        out.push_back(TAG_HEX);
+                        putHex(out, begin, len);
+                        break;
+                    }
+
+                    std::string bytes;
+                    if(unpackBase64(begin, len, bytes)) {
+                        out.push_back(TAG_BASE64);
+                        putString(out, bytes.data(), bytes.size());
+                        break;
+                    }
+                }
+                out.push_back(TAG_STRING);
+                putString(out, begin, len);
+                break;
+            }
+            case Json::arrayValue:
+                out.push_back(TAG_ARRAY);
+                putVarint(out, value.size());
+                for(const Json::Value& item : value) {
+                    encodeBinary(out, item);
+                }
+                break;
+            case Json::objectValue:
+                out.push_back(TAG_OBJECT);
+                putVarint(out, value.size());
+                for(auto it = value.begin(); it != value.end(); it++) {
+                    const char* end;
+                    const char* name = it.memberName(&end);
+                    putString(out, name, end - name);
+                    encodeBinary(out, *it);
+                }
+                break;
+        }
+    }
+
+    bool decodeBinary(const char*& pos, const char* end, Json::Value& value,
+                      const unsigned int depth) {
+        // Matches the default nesting limit of the json reader
+        if(pos >= end || depth > 1000) {
+            return false;
+        }
+
+        const unsigned char tag = static_cast<unsigned char>(*pos++);
+        switch(tag) {
+            case TAG_NULL:
+                value = Json::Value();
+                return true;
+            case TAG_FALSE:
+            case TAG_TRUE:
+                value = Json::Value(tag == TAG_TRUE);
+                return true;
+            case TAG_INT: {
+                uint64_t zigzag;
+                if(!getVarint(pos, end, zigzag)) {
+                    return false;
+                }
+                value = Json::Value(static_cast<Json::Int64>((zigzag >> 1) ^ (~(zigzag & 1) + 1)));
+                return true;
+            }
+            case TAG_UINT: {
+                uint64_t u;
+                if(!getVarint(pos, end, u)) {
+                    return false;
+                }
+                value = Json::Value(static_cast<Json::UInt64>(u));
+                return true;
+            }
+            case TAG_REAL: {
+                if(end - pos < 8) {
+                    return false;
+                }
+                uint64_t bits = 0;
+                for(unsigned int i = 0; i < 8; i++) {
+                    bits |= static_cast<uint64_t>(static_cast<unsigned char>(*pos++)) << (i * 8);
+                }
+                double d;
+                std::memcpy(&d, &bits, sizeof(d));
+                value = Json::Value(d);
+                return true;
+            }
+            case TAG_STRING:
+            case TAG_HEX:
+            case TAG_BASE64: {
+                std::string str;
+                if(tag == TAG_HEX) {
+                    if(!getHex(pos, end, str)) {
+                        return false;
+                    }
+                } else if(tag == TAG_BASE64) {
+                    uint64_t len;
+                    if(!getVarint(pos, end, len) || static_cast<uint64_t>(end - pos) < len) {
+                        return false;
+                    }
+                    packBase64(reinterpret_cast<const unsigned char*>(pos), len, str);
+                    pos += len;
+                } else {
+                    uint64_t len;
+                    if(!getVarint(pos, end, len) || static_cast<uint64_t>(end - pos) < len) {
+                        return false;
+                    }
+                    value = Json::Value(pos, pos + len);
+                    pos += len;
+                    return true;
+                }
+                value = Json::Value(str);
+                return true;
+            }
+            case TAG_ARRAY: {
+                uint64_t size;
+                if(!getVarint(pos, end, size) || size > static_cast<uint64_t>(end - pos)) {
+                    return false;
+                }
+                value = Json::Value(Json::arrayValue);
+                value.resize(size);
+                for(Json::ArrayIndex i = 0; i < size; i++) {
+                    if(!decodeBinary(pos, end, value[i], depth + 1)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case TAG_OBJECT: {
+                uint64_t size;
+                if(!getVarint(pos, end, size) || size > static_cast<uint64_t>(end - pos)) {
+                    return false;
+                }
+                value = Json::Value(Json::objectValue);
+                std::string name;
+                for(uint64_t i = 0; i < size; i++) {
+                    if(!getString(pos, end, name) ||
+                       !decodeBinary(pos, end, value[name], depth + 1)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+}
+
+std::string CryptoKernel::Storage::toBinary(const Json::Value& json) {
+    std::string returning;
+    returning.push_back(static_cast<char>(binaryMarker));
+    encodeBinary(returning, json);
+    return returning;
+}
+
+Json::Value CryptoKernel::Storage::fromBinary(const std::string& data) {
+    if(data.empty() || static_cast<unsigned char>(data[0]) != binaryMarker) {
+        return Json::Value();
+    }
+
+    Json::Value returning;
+    const char* pos = data.data() + 1;
+    const char* end = data.data() + data.size();
+    if(!decodeBinary(pos, end, returning, 0) || pos != end) {
+        return Json::Value();
+    }
+
+    return returning;
+}
+
+Json::Value CryptoKernel::Storage::Codec::decode(const std::string& data) const {
+    if(!data.empty() && static_cast<unsigned char>(data[0]) == binaryMarker) {
+        return CryptoKernel::Storage::fromBinary(data);
+    }
+
+    return CryptoKernel::Storage::toJson(data);
+}
+
+std::string CryptoKernel::Storage::JsonCodec::encode(const Json::Value& value) const {
+    return CryptoKernel::Storage::toString(value);
+}
+
+std::string CryptoKernel::Storage::BinaryCodec::encode(const Json::Value& value) const {
+    return CryptoKernel::Storage::toBinary(value);
+}
+
+void CryptoKernel::Storage::setReadCache(const size_t maxBytes, const unsigned int shards) {
+    std::lock_guard<std::mutex> wlock(writeLock);
+    std::lock_guard<std::mutex> lock(readLock);
+    if(maxBytes > 0 && shards > 0) {
+        readCache.reset(new ReadCache(maxBytes, shards, commitSeq));
+    } else {
+        readCache.reset();
+    }
+}
+
+CryptoKernel::Storage::ReadCacheStats CryptoKernel::Storage::getReadCacheStats() const {
+    ReadCacheStats stats = ReadCacheStats();
+    if(readCache) {
+        stats = readCache->getStats();
+    }
+    stats.dbReads = dbReads;
+    return stats;
+}
+
+void CryptoKernel::Storage::setGroupCommit(const bool enabled) {
+    std::lock_guard<std::mutex> wlock(writeLock);
+    if(enabled) {
+        if(!commitQueue) {
+            commitQueue.reset(new CommitQueue(this));
+        }
+    } else {
+        commitQueue.reset();
+    }
+}
+
+void CryptoKernel::Storage::setOptimistic(const bool enabled) {
+    std::lock_guard<std::mutex> wlock(writeLock);
+    if(enabled && !versions) {
+        versions.reset(new std::atomic<uint64_t>[versionStripes]);
+        for(size_t i = 0; i < versionStripes; i++) {
+            versions[i] = 0;
+        }
+    }
+    optimistic = enabled;
+}
+
+size_t CryptoKernel::Storage::versionStripe(const std::string& key) const {
+    return std::hash<std::string>()(key) % versionStripes;
+}
+
+Json::Value CryptoKernel::Storage::getProperties() {
+    Json::Value returning;
+    returning["profile"] = profile.toJson();
+
+    returning[profile.backend] = backend->getProperties();
+
+    const ReadCacheStats cacheStats = getReadCacheStats();
+    returning["readCache"]["hits"] = Json::UInt64(cacheStats.hits);
+    returning["readCache"]["misses"] = Json::UInt64(cacheStats.misses);
+    returning["readCache"]["evictions"] = Json::UInt64(cacheStats.evictions);
+    returning["readCache"]["entries"] = Json::UInt64(cacheStats.entries);
+    returning["readCache"]["bytes"] = Json::UInt64(cacheStats.bytes);
+    returning["readCache"]["dbReads"] = Json::UInt64(cacheStats.dbReads);
+
+    const CommitStats stats = getCommitStats();
+    returning["commits"]["commits"] = Json::UInt64(stats.commits);
+    returning["commits"]["writes"] = Json::UInt64(stats.writes);
+    returning["commits"]["syncs"] = Json::UInt64(stats.syncs);
+    returning["commits"]["conflicts"] = Json::UInt64(stats.conflicts);
+
+    return returning;
+}
+
+CryptoKernel::Storage::CommitStats CryptoKernel::Storage::getCommitStats() const {
+    std::lock_guard<std::mutex> lock(commitStatsMutex);
+    return commitStats;
+}
+
+void CryptoKernel::Storage::write(const std::vector<Backend::Write>& batch,
+                                  const std::vector<std::string>& keys,
+                                  const uint64_t commits) {
+    std::lock_guard<std::mutex> lock(readLock);
+    backend->write(batch, sync);
+
+    commitSeq++;
+
+    if(readCache) {
+        for(const std::string& key : keys) {
+            readCache->invalidate(key, commitSeq);
+        }
+    }
+
+    uint64_t bucket = 1;
+    while(bucket < commits) {
+        bucket *= 2;
+    }
+
+    std::lock_guard<std::mutex> statsLock(commitStatsMutex);
+    commitStats.commits += commits;
+    commitStats.writes++;
+    if(sync) {
+        commitStats.syncs++;
+    }
+    commitStats.groupSizes[bucket]++;
+}
+
+uint64_t CryptoKernel::Storage::recode() {
+    std::lock_guard<std::mutex> wlock(writeLock);
+    if(commitQueue) {
+        commitQueue->flush();
+    }
+
+    uint64_t recoded = 0;
+
+    std::vector<Backend::Write> batch;
+    std::vector<std::string> keys;
+
+    const Backend::Snapshot* snapshot = backend->getSnapshot();
+    std::unique_ptr<Backend::Iterator> it(backend->newIterator(snapshot, false));
+
+    for(it->seek(""); it->valid(); it->next()) {
+        const std::string data = it->value();
+        const std::string encoded = codec->encode(codec->decode(data));
+        if(encoded != data) {
+            const std::string key = it->key();
+            batch.push_back(Backend::Write{key, encoded, false});
+            keys.push_back(key);
+            recoded++;
+        }
+
+        if(keys.size() >= 10000) {
+            write(batch, keys);
+            batch.clear();
+            keys.clear();
+        }
+    }
+
+    it.reset();
+    backend->releaseSnapshot(snapshot);
+
+    if(!keys.empty()) {
+        write(batch, keys);
+    }
+
+    return recoded;
+}
+
 bool CryptoKernel::Storage::destroy(const std::string& filename) {
-    leveldb::Options options;
-    leveldb::DestroyDB(filename, options);
+    if(!LMDBBackend::destroy(filename)) {
+        LevelDBBackend::destroy(filename);
+    }
 
     return true;
 }
@@ -112,33 +1098,49 @@ CryptoKernel::Storage::Transaction* CryptoKernel::Storage::beginReadOnly() {
 
 CryptoKernel::Storage::Transaction::Transaction(CryptoKernel::Storage* db,
                                                 const bool readonly) {
+    optimistic = !readonly && db->optimistic;
     if(!readonly) {
-        db->writeLock.lock();
+        if(!optimistic) {
+            db->writeLock.lock();
+        }
+        snapshot = nullptr;
         finished = false;
     } else {
         std::lock_guard<std::mutex> lock(db->readLock);
-        snapshot = db->db->GetSnapshot();
+        snapshot = db->backend->getSnapshot();
+        snapshotSeq = db->commitSeq;
         finished = true;
     }
     this->db = db;
     this->readonly = readonly;
     mut = nullptr;
+    memoizeReads = false;
+    reads = 0;
+    repeatedReads = 0;
 }
 
 CryptoKernel::Storage::Transaction::Transaction(CryptoKernel::Storage* db,
                                                 std::recursive_mutex& mut,
                                                 const bool readonly) {
+    optimistic = !readonly && db->optimistic;
     if(!readonly) {
-        db->writeLock.lock();
+        if(!optimistic) {
+            db->writeLock.lock();
+        }
+        snapshot = nullptr;
         finished = false;
     } else {
         std::lock_guard<std::mutex> lock(db->readLock);
-        snapshot = db->db->GetSnapshot();
+        snapshot = db->backend->getSnapshot();
+        snapshotSeq = db->commitSeq;
         finished = true;
     }
     this->db = db;
     this->mut = &mut;
     this->readonly = readonly;
+    memoizeReads = false;
+    reads = 0;
+    repeatedReads = 0;
 }
 
 CryptoKernel::Storage::Transaction::~Transaction() {
@@ -148,7 +1150,7 @@ CryptoKernel::Storage::Transaction::~Transaction() {
 
     if(readonly) {
         std::lock_guard<std::mutex> lock(db->readLock);
-        db->db->ReleaseSnapshot(snapshot);
+        db->backend->releaseSnapshot(snapshot);
     }
 
     if(mut != nullptr) {
@@ -161,35 +1163,94 @@ bool CryptoKernel::Storage::Transaction::ended() {
 }
 
 void CryptoKernel::Storage::Transaction::commit() {
-    if(!finished) {
-        leveldb::WriteBatch batch;
-        for(auto& update : dbStateCache) {
-            if(update.second.erased) {
-                batch.Delete(update.first);
-            } else {
-                batch.Put(update.first, CryptoKernel::Storage::toString(update.second.data));
+    if(finished) {
+        throw std::runtime_error("Attempted to commit finished transaction");
+    }
+
+    std::unique_lock<std::mutex> lock;
+    if(optimistic) {
+        lock = std::unique_lock<std::mutex>(db->writeLock);
+        if(!validate()) {
+            lock.unlock();
+            finished = true;
+            {
+                std::lock_guard<std::mutex> statsLock(db->commitStatsMutex);
+                db->commitStats.conflicts++;
             }
+            throw ConflictException("Transaction read values written by a concurrent commit");
         }
+    } else {
+        // Held since the transaction began
+        lock = std::unique_lock<std::mutex>(db->writeLock, std::adopt_lock);
+    }
 
-        leveldb::WriteOptions options;
-        options.sync = db->sync;
+    finished = true;
+    writeChanges(lock);
+}
 
-        std::lock_guard<std::mutex> lock(db->readLock);
-        leveldb::Status status = db->db->Write(options, &batch);
+bool CryptoKernel::Storage::Transaction::validate() {
+    std::lock_guard<std::mutex> lock(readSetMutex);
+    for(const auto& read : readVersions) {
+        if(db->versions[read.first] != read.second) {
+            return false;
+        }
+    }
 
-        if(!status.ok()) {
-            throw std::runtime_error("Could not commit transaction " + status.ToString());
+    return true;
+}
+
+void CryptoKernel::Storage::Transaction::writeChanges(std::unique_lock<std::mutex>& writeLock) {
+    if(dbStateCache.empty()) {
+        return;
+    }
+
+    // Optimistic readers record a version before reading a key, so versions
+    // only move on once the new value is visible to them
+    const auto bumpVersions = [&]{
+        if(db->optimistic) {
+            for(const auto& update : dbStateCache) {
+                db->versions[db->versionStripe(update.first)]++;
+            }
         }
+    };
 
-        abort();
+    if(db->commitQueue) {
+        std::vector<CommitQueue::Write> writes;
+        writes.reserve(dbStateCache.size());
+        for(auto& update : dbStateCache) {
+            writes.push_back(CommitQueue::Write{update.first,
+                             update.second.erased ? "" : db->codec->encode(update.second.data),
+                             update.second.data, update.second.erased});
+        }
+
+        CommitQueue* queue = db->commitQueue.get();
+        const auto pending = queue->enqueue(std::move(writes));
+        bumpVersions();
+
+        // Later writers see the queued changes so they can start now
+        writeLock.unlock();
+
+        queue->wait(pending);
     } else {
-        throw std::runtime_error("Attempted to commit finished transaction");
+        std::vector<Backend::Write> batch;
+        std::vector<std::string> keys;
+        batch.reserve(dbStateCache.size());
+        keys.reserve(dbStateCache.size());
+        for(auto& update : dbStateCache) {
+            batch.push_back(Backend::Write{update.first,
+                                           update.second.erased ? "" : db->codec->encode(update.second.data),
+                                           update.second.erased});
+            keys.push_back(update.first);
+        }
+
+        db->write(batch, keys);
+        bumpVersions();
     }
 }
 
 void CryptoKernel::Storage::Transaction::abort() {
     finished = true;
-    if(!readonly) {
+    if(!readonly && !optimistic) {
         db->writeLock.unlock();
     }
 }
@@ -203,98 +1264,330 @@ void CryptoKernel::Storage::Transaction::erase(const std::string& key) {
     dbStateCache[key] = dbObject{Json::Value(), true};
 }
 
+void CryptoKernel::Storage::Transaction::setReadMemoization(const bool enabled) {
+    std::lock_guard<std::mutex> lock(readSetMutex);
+    memoizeReads = enabled;
+    if(!enabled) {
+        readSet.clear();
+    }
+}
+
+CryptoKernel::Storage::Transaction::ReadStats
+CryptoKernel::Storage::Transaction::getReadStats() const {
+    return ReadStats{reads, repeatedReads};
+}
+
 Json::Value CryptoKernel::Storage::Transaction::get(const std::string& key) {
     const auto it = dbStateCache.find(key);
     if(it != dbStateCache.end()) {
         return it->second.data;
     } else {
-        std::string data;
-        
-        leveldb::ReadOptions options;
-        if(readonly) {
-            options.snapshot = snapshot;
+        reads++;
+
+        if(optimistic) {
+            const size_t stripe = db->versionStripe(key);
+            const uint64_t version = db->versions[stripe];
+            std::lock_guard<std::mutex> lock(readSetMutex);
+            readVersions.emplace(stripe, version);
+        }
+
+        if(memoizeReads) {
+            std::lock_guard<std::mutex> lock(readSetMutex);
+            const auto memo = readSet.find(key);
+            if(memo != readSet.end()) {
+                repeatedReads++;
+                return memo->second;
+            }
+        }
+
+        const Json::Value returning = load(key);
+
+        if(memoizeReads) {
+            std::lock_guard<std::mutex> lock(readSetMutex);
+            readSet.emplace(key, returning);
+        }
+
+        return returning;
+    }
+}
+
+Json::Value CryptoKernel::Storage::Transaction::load(const std::string& key) {
+    Json::Value returning;
+    if(!readonly && db->commitQueue && db->commitQueue->get(key, returning)) {
+        return returning;
+    }
+
+    // Anything committed after seq is loaded invalidates the key before the
+    // value read below could be cached
+    const uint64_t seq = readonly ? snapshotSeq : db->commitSeq.load();
+
+    if(db->readCache && db->readCache->get(key, seq, returning)) {
+        return returning;
+    }
+
+    std::string data;
+    db->backend->get(key, data, readonly ? snapshot : nullptr);
+    db->dbReads++;
+    returning = db->codec->decode(data);
+
+    if(db->readCache) {
+        db->readCache->put(key, returning, key.size() + 2 * data.size() + 64, seq);
+    }
+
+    return returning;
+}
+
+namespace {
+    enum KeySegmentTag : unsigned char {
+        SEGMENT_ID = 1,
+        SEGMENT_TEXT = 2,
+        SEGMENT_NUMBER = 3
+    };
+
+    const size_t idBytes = 32;
+
+    // Ids are BigNum hex strings, which never have leading zeros. Shorter
+    // strings take less space as text.
+    bool isCanonicalId(const std::string& segment) {
+        return segment.size() >= idBytes && segment.size() <= idBytes * 2 &&
+               segment[0] != '0' && isLowerHex(segment.data(), segment.size());
+    }
+}
+
+CryptoKernel::Storage::Key::Key() {
+}
+
+CryptoKernel::Storage::Key::Key(const std::string& segment) {
+    append(segment);
+}
+
+CryptoKernel::Storage::Key::Key(const char* segment) {
+    append(std::string(segment));
+}
+
+CryptoKernel::Storage::Key& CryptoKernel::Storage::Key::append(const std::string& segment) {
+    text += segment;
+
+    if(isCanonicalId(segment)) {
+        encoded.push_back(static_cast<char>(SEGMENT_ID));
+        std::string packed(idBytes, '\0');
+        // Right align the id, the missing leading nibbles are zero
+        size_t nibble = idBytes * 2 - segment.size();
+        for(const char c : segment) {
+            packed[nibble / 2] |= static_cast<char>(hexValue(c) << (nibble % 2 == 0 ? 4 : 0));
+            nibble++;
+        }
+        encoded += packed;
+    } else {
+        encoded.push_back(static_cast<char>(SEGMENT_TEXT));
+        // Zero terminated, with zero bytes in the text escaped as 0x00 0xff
+        for(const char c : segment) {
+            encoded.push_back(c);
+            if(c == '\0') {
+                encoded.push_back('\xff');
+            }
         }
+        encoded.push_back('\0');
+        encoded.push_back('\0');
+    }
+
+    return *this;
+}
+
+CryptoKernel::Storage::Key& CryptoKernel::Storage::Key::append(const uint64_t number) {
+    text += std::to_string(number);
 
-        db->db->Get(options, key, &data);
-        return CryptoKernel::Storage::toJson(data);
+    encoded.push_back(static_cast<char>(SEGMENT_NUMBER));
+    for(int shift = 56; shift >= 0; shift -= 8) {
+        encoded.push_back(static_cast<char>((number >> shift) & 0xff));
     }
+
+    return *this;
+}
+
+const std::string& CryptoKernel::Storage::Key::getText() const {
+    return text;
+}
+
+const std::string& CryptoKernel::Storage::Key::getEncoded() const {
+    return encoded;
+}
+
+std::string CryptoKernel::Storage::Key::decode(const std::string& encoded) {
+    static const char hexChars[] = "0123456789abcdef";
+
+    std::string returning;
+    size_t pos = 0;
+    while(pos < encoded.size()) {
+        const unsigned char tag = encoded[pos++];
+        if(tag == SEGMENT_ID) {
+            if(encoded.size() - pos < idBytes) {
+                throw std::runtime_error("Malformed key");
+            }
+
+            bool leading = true;
+            for(size_t i = 0; i < idBytes * 2; i++) {
+                const unsigned char byte = encoded[pos + i / 2];
+                const int nibble = i % 2 == 0 ? byte >> 4 : byte & 0x0f;
+                if(leading && nibble == 0) {
+                    continue;
+                }
+                leading = false;
+                returning.push_back(hexChars[nibble]);
+            }
+            pos += idBytes;
+        } else if(tag == SEGMENT_TEXT) {
+            while(true) {
+                if(pos + 1 >= encoded.size()) {
+                    throw std::runtime_error("Malformed key");
+                }
+
+                const char c = encoded[pos++];
+                if(c != '\0') {
+                    returning.push_back(c);
+                } else if(encoded[pos] == '\xff') {
+                    returning.push_back('\0');
+                    pos++;
+                } else if(encoded[pos] == '\0') {
+                    pos++;
+                    break;
+                } else {
+                    throw std::runtime_error("Malformed key");
+                }
+            }
+        } else if(tag == SEGMENT_NUMBER) {
+            if(encoded.size() - pos < 8) {
+                throw std::runtime_error("Malformed key");
+            }
+
+            uint64_t number = 0;
+            for(size_t i = 0; i < 8; i++) {
+                number = (number << 8) | static_cast<unsigned char>(encoded[pos++]);
+            }
+            returning += std::to_string(number);
+        } else {
+            throw std::runtime_error("Malformed key");
+        }
+    }
+
+    return returning;
 }
 
 CryptoKernel::Storage::Table::Table(const std::string& name) {
     tableName = name;
+    id = 0;
 }
 
-std::string CryptoKernel::Storage::Table::getKey(const std::string& key,
+CryptoKernel::Storage::Table::Table(const std::string& name, const uint8_t id) {
+    if(id == 0 || id >= 0x20) {
+        throw std::runtime_error("Table id out of range");
+    }
+
+    tableName = name;
+    this->id = id;
+}
+
+bool CryptoKernel::Storage::Table::isCompact() const {
+    return id != 0;
+}
+
+std::string CryptoKernel::Storage::Table::getKey(const Key& key,
         const int index) {
-    return tableName + "/" + std::to_string(index + 1) + "/" + key;
+    if(isCompact()) {
+        std::string returning;
+        returning.reserve(2 + key.getEncoded().size());
+        returning.push_back(static_cast<char>(id));
+        returning.push_back(static_cast<char>(index + 1));
+        returning += key.getEncoded();
+        return returning;
+    }
+
+    return tableName + "/" + std::to_string(index + 1) + "/" + key.getText();
 }
 
-void CryptoKernel::Storage::Table::put(Transaction* transaction, const std::string& key,
+void CryptoKernel::Storage::Table::put(Transaction* transaction, const Key& key,
                                        const Json::Value& data, const int index) {
     transaction->put(getKey(key, index), data);
 }
 
-void CryptoKernel::Storage::Table::erase(Transaction* transaction, const std::string& key,
+void CryptoKernel::Storage::Table::erase(Transaction* transaction, const Key& key,
         const int index) {
     transaction->erase(getKey(key, index));
 }
 
 Json::Value CryptoKernel::Storage::Table::get(Transaction* transaction,
-        const std::string& key, const int index) {
+        const Key& key, const int index) {
     return transaction->get(getKey(key, index));
 }
 
 CryptoKernel::Storage::Table::Iterator::Iterator(Table* table, Storage* db, const 
-leveldb::Snapshot* snapshot, const std::string& prefix, const int index) {
+Backend::Snapshot* snapshot, const Key& prefix, const int index, const bool fillCache) {
     this->table = table;
     this->db = db;
-    
-    leveldb::ReadOptions options;
-
-    this->snapshot = snapshot;
 
-    if(snapshot != nullptr) {
-        options.snapshot = snapshot;
-    } else {
-         db->writeLock.lock();
+    ownsSnapshot = snapshot == nullptr;
+    if(ownsSnapshot) {
+        std::lock_guard<std::mutex> lock(db->readLock);
+        snapshot = db->backend->getSnapshot();
     }
 
-    it = db->db->NewIterator(options);
+    this->snapshot = snapshot;
 
-    this->prefix = table->getKey("", index);
+    it.reset(db->backend->newIterator(snapshot, fillCache));
 
-    if(prefix != "") {
-        this->prefix += prefix;
-    }
+    this->prefix = table->getKey(prefix, index);
 }
 
 CryptoKernel::Storage::Table::Iterator::~Iterator() {
-    delete it;
-    if(snapshot == nullptr) {
-        db->writeLock.unlock();
+    it.reset();
+    if(ownsSnapshot) {
+        std::lock_guard<std::mutex> lock(db->readLock);
+        db->backend->releaseSnapshot(snapshot);
     }
 }
 
 void CryptoKernel::Storage::Table::Iterator::SeekToFirst() {
-    it->Seek(prefix);
+    it->seek(prefix);
 }
 
 bool CryptoKernel::Storage::Table::Iterator::Valid() {
-    if(it->Valid()) {
-        return it->key().ToString().compare(0, prefix.size(), prefix) == 0;
+    if(it->valid()) {
+        return it->key().compare(0, prefix.size(), prefix) == 0;
     } else {
         return false;
     }
 }
 
 void CryptoKernel::Storage::Table::Iterator::Next() {
-    it->Next();
+    it->next();
 }
 
 std::string CryptoKernel::Storage::Table::Iterator::key() {
-    return it->key().ToString().substr(prefix.size());
+    const std::string rest = it->key().substr(prefix.size());
+    if(table->isCompact()) {
+        return Key::decode(rest);
+    }
+    return rest;
 }
 
 Json::Value CryptoKernel::Storage::Table::Iterator::value() {
-    return CryptoKernel::Storage::toJson(it->value().ToString());
+    return db->codec->decode(it->value());
+}
+
+std::vector<std::pair<std::string, Json::Value>>
+CryptoKernel::Storage::Table::Iterator::nextBatch(const size_t count) {
+    std::vector<std::pair<std::string, std::string>> raw;
+    raw.reserve(count);
+    while(raw.size() < count && Valid()) {
+        raw.emplace_back(key(), it->value());
+        it->next();
+    }
+
+    std::vector<std::pair<std::string, Json::Value>> returning;
+    returning.reserve(raw.size());
+    for(const auto& entry : raw) {
+        returning.emplace_back(entry.first, db->codec->decode(entry.second));
+    }
+
+    return returning;
 }
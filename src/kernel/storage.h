@@ -20,20 +20,27 @@
 
 #include <mutex>
 #include <memory>
+#include <atomic>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <stdexcept>
 
 #include <json/writer.h>
 #include <json/reader.h>
-#include <leveldb/db.h>
 
 namespace CryptoKernel {
 /**
 * The storage class provide a key-value json storage database
-* interface. This particular implementation uses LevelDB as the
-* underlying storage. It provides functions for saving, retrieving,
-* deleting and iterating over the database.
+* interface. By default it uses LevelDB as the underlying storage,
+* LMDB can be selected per database instead. It provides functions
+* for saving, retrieving, deleting and iterating over the database.
 */
 class Storage {
 public:
+    class Codec;
+    class Backend;
+
     /**
     * Constructs a storage database in the given directory. If no database
     * is found in the given directory then it is created. Otherwise open
@@ -47,11 +54,329 @@ public:
     */
     Storage(const std::string& filename, const bool sync, const unsigned int cache, const bool bloom);
 
+    /**
+    * Constructs a storage database that writes values with the given codec.
+    * Values already in the database are readable whichever codec wrote them.
+    *
+    * @param codec the codec used to encode values, uses a JsonCodec when null
+    * @see Storage(const std::string&, const bool, const unsigned int, const bool)
+    */
+    Storage(const std::string& filename, const bool sync, const unsigned int cache, const bool bloom,
+            const std::shared_ptr<Codec>& codec);
+
+    /**
+    * Backend and tuning for a database. Each workload has its own defaults
+    * which can be overridden from config.
+    */
+    struct Profile {
+        // "leveldb" or "lmdb"
+        std::string backend;
+        // fsync after every write. Without it a crash loses the most recent
+        // writes: LevelDB keeps what reached its log, LMDB rolls back to the
+        // last commit whose meta page was flushed. Neither corrupts the
+        // database.
+        bool sync;
+        // Size of LevelDB's block cache in MB, 0 disables it
+        unsigned int cacheSize;
+        // Bloom filter bits per key, 0 disables the filter
+        unsigned int bloomBits;
+        size_t writeBufferSize;
+        int maxOpenFiles;
+        size_t blockSize;
+        bool compression;
+        // Size of the decoded value cache in bytes, 0 disables it
+        size_t readCacheSize;
+        // Largest size in bytes an LMDB database can grow to. Only reserves
+        // address space, the file grows as it is written.
+        uint64_t mapSize;
+        // Validate concurrent writers at commit instead of serializing
+        // them, see setOptimistic
+        bool optimistic;
+        // Write concurrent commits as one batch, see setGroupCommit
+        bool groupCommit;
+
+        /**
+        * Large, read heavy and written in bulk while syncing
+        */
+        static Profile chainstate();
+
+        /**
+        * Small and rarely read
+        */
+        static Profile peers();
+
+        /**
+        * Small but must never lose a write
+        */
+        static Profile wallet();
+
+        /**
+        * Returns a copy of this profile with the fields present in the given
+        * json object replaced
+        *
+        * @param json an object with any of the fields of the profile
+        * @return the overridden profile
+        * @throw std::runtime_error if a field has the wrong type
+        */
+        Profile override(const Json::Value& json) const;
+
+        Json::Value toJson() const;
+    };
+
+    /**
+    * Constructs a storage database tuned with the given profile
+    *
+    * @param profile the backend, its options and the cache sizes to use
+    * @param codec the codec used to encode values, uses a JsonCodec when null
+    * @see Storage(const std::string&, const bool, const unsigned int, const bool)
+    */
+    Storage(const std::string& filename, const Profile& profile,
+            const std::shared_ptr<Codec>& codec = nullptr);
+
     /**
     * Default destructor, saves and closes the database
     */
     ~Storage();
 
+    /**
+    * Reports the live state of the database: its profile, the backend's own
+    * statistics and the read cache and commit counters
+    *
+    * @return a json object describing the database
+    */
+    Json::Value getProperties();
+
+    /**
+    * Thrown by Transaction::commit in optimistic mode when a value the
+    * transaction read was changed by another commit. The transaction is
+    * aborted and should be retried from the start.
+    */
+    class ConflictException : public std::runtime_error {
+    public:
+        ConflictException(const std::string& message) : std::runtime_error(message) {}
+    };
+
+    /**
+    * Interface for converting stored values to and from their on-disk
+    * representation. Every codec must be able to decode values written by
+    * any other codec so that databases can be read regardless of the
+    * format they were written in.
+    */
+    class Codec {
+    public:
+        virtual ~Codec() {};
+
+        /**
+        * Encodes the given json value for storage
+        *
+        * @param value the value to encode
+        * @return the encoded value
+        */
+        virtual std::string encode(const Json::Value& value) const = 0;
+
+        /**
+        * Decodes a stored value. Returns a null value if data is empty or
+        * cannot be decoded.
+        *
+        * @param data the stored value to decode
+        * @return the decoded json value
+        */
+        virtual Json::Value decode(const std::string& data) const;
+    };
+
+    /**
+    * Stores values as compact json text. This is the format all databases
+    * were written in before codecs were introduced.
+    */
+    class JsonCodec : public Codec {
+    public:
+        std::string encode(const Json::Value& value) const;
+    };
+
+    /**
+    * Stores values in a tagged binary format. Integers are stored as varints,
+    * lowercase hex strings (ids) are packed to half their length and base64
+    * strings (keys and signatures) are packed to three quarters of their
+    * length. Encoded values start with a marker byte that can never begin a
+    * json document so both formats can coexist in one database.
+    */
+    class BinaryCodec : public Codec {
+    public:
+        std::string encode(const Json::Value& value) const;
+    };
+
+    /**
+    * Interface to the ordered key-value store underneath a database. Keys and
+    * values are raw bytes and keys are ordered bytewise. Every method must
+    * be safe to call from several threads at once.
+    */
+    class Backend {
+    public:
+        virtual ~Backend() {};
+
+        /**
+        * A consistent read-only view of the store as it was when the
+        * snapshot was taken
+        */
+        class Snapshot {
+        public:
+            virtual ~Snapshot() {};
+        };
+
+        /**
+        * Walks the store in key order. Only ever used by one thread at a time.
+        */
+        class Iterator {
+        public:
+            virtual ~Iterator() {};
+
+            /**
+            * Moves to the first key at or after the given key
+            */
+            virtual void seek(const std::string& key) = 0;
+            virtual bool valid() = 0;
+            virtual void next() = 0;
+            virtual std::string key() = 0;
+            virtual std::string value() = 0;
+        };
+
+        struct Write {
+            std::string key;
+            std::string value;
+            bool erased;
+        };
+
+        /**
+        * Reads a value
+        *
+        * @param key the key to read
+        * @param value set to the stored value when the key exists
+        * @param snapshot the view to read from, the latest state when null
+        * @return true if the key exists, false otherwise
+        */
+        virtual bool get(const std::string& key, std::string& value,
+                         const Snapshot* snapshot = nullptr) = 0;
+
+        /**
+        * Applies a batch of writes atomically
+        *
+        * @param batch the puts and erases to apply, in order
+        * @param sync true to fsync before returning
+        * @throw std::runtime_error if the batch could not be written
+        */
+        virtual void write(const std::vector<Write>& batch, const bool sync) = 0;
+
+        virtual const Snapshot* getSnapshot() = 0;
+        virtual void releaseSnapshot(const Snapshot* snapshot) = 0;
+
+        /**
+        * Creates an iterator over the store
+        *
+        * @param snapshot the view to iterate over, the latest state when null
+        * @param fillCache false to keep scans from evicting the backend's cache
+        * @return a new iterator, owned by the caller
+        */
+        virtual Iterator* newIterator(const Snapshot* snapshot, const bool fillCache) = 0;
+
+        /**
+        * Returns the backend's own statistics
+        */
+        virtual Json::Value getProperties() = 0;
+    };
+
+    /**
+    * Re-encodes every value in the database with this database's codec.
+    * Used to migrate an existing database from one format to another.
+    *
+    * @return the number of values that were rewritten
+    */
+    uint64_t recode();
+
+    /**
+    * Counters describing the effectiveness of the read cache
+    */
+    struct ReadCacheStats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t insertions;
+        uint64_t evictions;
+        uint64_t invalidations;
+        uint64_t entries;
+        uint64_t bytes;
+        uint64_t dbReads;
+    };
+
+    /**
+    * Enables a cache of decoded values in front of the database. Values
+    * are cached by key, evicted least recently used first once the cache
+    * exceeds its size and invalidated when a transaction writing them
+    * commits. Read-only transactions only see cached values that were
+    * current when their snapshot was taken. Must be called before any
+    * transactions are started.
+    *
+    * @param maxBytes the approximate size limit of the cache in bytes, 0 disables the cache
+    * @param shards the number of independently locked partitions of the cache
+    */
+    void setReadCache(const size_t maxBytes, const unsigned int shards = 16);
+
+    /**
+    * Returns the read cache counters. All zero if the cache is disabled,
+    * except dbReads which counts every value read from the backend.
+    *
+    * @return the current read cache counters
+    */
+    ReadCacheStats getReadCacheStats() const;
+
+    /**
+    * Counters describing how commits reached the database
+    */
+    struct CommitStats {
+        uint64_t commits;
+        uint64_t writes;
+        uint64_t syncs;
+        uint64_t conflicts;
+        // Number of writes by how many commits they carried, keyed by that
+        // count rounded up to a power of two
+        std::map<uint64_t, uint64_t> groupSizes;
+    };
+
+    /**
+    * Enables group commit. A committing write transaction hands its changes
+    * to a queue and releases the write lock straight away so the next writer
+    * can start, then waits until its changes are on disk. Whichever waiting
+    * committer finds the database idle writes everything queued so far as a
+    * single batch, so one fsync covers the whole group when sync is enabled.
+    * Queued changes are visible to later write transactions but not to
+    * read-only snapshots until they are written. Must be called before any
+    * transactions are started.
+    *
+    * @param enabled true to group concurrent commits, false to write each one separately
+    */
+    void setGroupCommit(const bool enabled);
+
+    /**
+    * Returns the commit counters
+    *
+    * @return the number of commits, database writes and fsyncs so far and
+    *         the distribution of commits per write
+    */
+    CommitStats getCommitStats() const;
+
+    /**
+    * Enables optimistic concurrency. Write transactions no longer hold the
+    * write lock for their whole lifetime so they can run in parallel. Each
+    * one records the version of every key it reads from the database and
+    * commit checks none of them were written since, throwing a
+    * ConflictException if any were. Versions are tracked per stripe of the
+    * key space so unrelated keys occasionally conflict too. Writers read the
+    * latest committed values rather than a snapshot and may see a mix of
+    * states before their commit fails validation. Must be called before any
+    * transactions are started.
+    *
+    * @param enabled true to validate writers at commit, false to serialize them
+    */
+    void setOptimistic(const bool enabled);
+
     class Transaction {
     public:
         Transaction(Storage* db, const bool readonly = false);
@@ -68,7 +393,30 @@ public:
 
         bool ended();
 
-        const leveldb::Snapshot* snapshot;
+        /**
+        * Turns on memoization of reads. Once enabled, each key is fetched and
+        * decoded at most once for the rest of the transaction, and later gets
+        * return the memoized value. Safe to use from several threads at once.
+        *
+        * @param enabled true to memoize reads, false to stop and drop memoized values
+        */
+        void setReadMemoization(const bool enabled);
+
+        struct ReadStats {
+            uint64_t reads;
+            uint64_t repeatedReads;
+        };
+
+        /**
+        * Returns the number of gets that were not served from this transaction's
+        * own writes, and how many of those were repeats served by memoization
+        *
+        * @return the read counters of this transaction
+        */
+        ReadStats getReadStats() const;
+
+        // The view read-only transactions read from, null for writers
+        const Backend::Snapshot* snapshot;
 
     private:
         struct dbObject {
@@ -80,6 +428,21 @@ public:
         bool finished;
         bool readonly;
         std::recursive_mutex* mut;
+        uint64_t snapshotSeq;
+        bool optimistic;
+
+        Json::Value load(const std::string& key);
+        bool validate();
+        void writeChanges(std::unique_lock<std::mutex>& writeLock);
+
+        std::atomic<bool> memoizeReads;
+        std::map<std::string, Json::Value> readSet;
+        std::mutex readSetMutex;
+        std::atomic<uint64_t> reads;
+        std::atomic<uint64_t> repeatedReads;
+
+        // Version of each stripe when it was first read, optimistic mode only
+        std::unordered_map<size_t, uint64_t> readVersions;
     };
 
     Transaction* begin();
@@ -88,19 +451,106 @@ public:
 
     Transaction* beginReadOnly();
 
+    /**
+    * A table key built from one or more segments. Tables created with an id
+    * store keys in a compact binary form where each segment is tagged and
+    * canonical lowercase hex ids of at least 32 characters are packed into
+    * 32 raw bytes. Other tables store the segments concatenated as text.
+    */
+    class Key {
+    public:
+        Key();
+
+        /**
+        * Constructs a key with a single segment
+        *
+        * @param segment the text of the segment
+        */
+        Key(const std::string& segment);
+        Key(const char* segment);
+
+        /**
+        * Adds a text segment to the end of the key. Ids are detected and
+        * packed automatically.
+        *
+        * @param segment the text of the segment
+        * @return this key
+        */
+        Key& append(const std::string& segment);
+
+        /**
+        * Adds a number segment to the end of the key. Numbers are stored as
+        * 8 big-endian bytes in compact keys and in decimal otherwise.
+        *
+        * @param number the number to add
+        * @return this key
+        */
+        Key& append(const uint64_t number);
+
+        /**
+        * Returns the key as text, the segments concatenated
+        *
+        * @return the text form of the key
+        */
+        const std::string& getText() const;
+
+        /**
+        * Returns the compact binary form of the key
+        *
+        * @return the encoded key
+        */
+        const std::string& getEncoded() const;
+
+        /**
+        * Converts compact segments back to the text form of the key
+        *
+        * @param encoded one or more whole segments produced by getEncoded
+        * @return the text form of the segments
+        * @throw std::runtime_error if encoded is malformed
+        */
+        static std::string decode(const std::string& encoded);
+
+    private:
+        std::string text;
+        std::string encoded;
+    };
+
     class Table {
     public:
         Table(const std::string& name);
 
-        void put(Transaction* transaction, const std::string& key, const Json::Value& data,
+        /**
+        * Constructs a table that stores compact keys prefixed by the given
+        * id rather than by its name. Every table in a database needs a
+        * different id.
+        *
+        * @param name the name of the table
+        * @param id the prefix byte of the table, from 1 to 31 so that compact
+        *        keys never collide with the keys of named tables
+        * @throw std::runtime_error if id is out of range
+        */
+        Table(const std::string& name, const uint8_t id);
+
+        void put(Transaction* transaction, const Key& key, const Json::Value& data,
                  const int index = -1);
-        void erase(Transaction* transaction, const std::string& key, const int index = -1);
-        Json::Value get(Transaction* transaction, const std::string& key, const int index = -1);
+        void erase(Transaction* transaction, const Key& key, const int index = -1);
+        Json::Value get(Transaction* transaction, const Key& key, const int index = -1);
 
         class Iterator {
         public:
-            Iterator(Table* table, Storage* db, const leveldb::Snapshot* snapshot = nullptr,
-                     const std::string& prefix = "", const int index = -1);
+            /**
+            * Iterates over the keys of an index of the table that start with
+            * the given prefix. For compact tables the prefix has to consist
+            * of whole segments. Without a snapshot the iterator takes its own,
+            * so it sees the database as it was when it was constructed and
+            * never blocks writers.
+            *
+            * @param fillCache set to true to keep the blocks read in the
+            *        backend's cache, by default scans leave the cache untouched
+            */
+            Iterator(Table* table, Storage* db, const Backend::Snapshot* snapshot = nullptr,
+                     const Key& prefix = Key(), const int index = -1,
+                     const bool fillCache = false);
 
             ~Iterator();
 
@@ -134,24 +584,43 @@ public:
             * @return the json value the iterator points to
             */
             Json::Value value();
+
+            /**
+            * Reads up to count entries from the current position onwards,
+            * copying them out of the backend before decoding any values, and
+            * leaves the iterator after the last one
+            *
+            * @param count the maximum number of entries to read
+            * @return the keys and values read, empty once the iterator is exhausted
+            */
+            std::vector<std::pair<std::string, Json::Value>> nextBatch(const size_t count);
         private:
-            leveldb::Iterator* it;
+            std::unique_ptr<Backend::Iterator> it;
             Table* table;
             Storage* db;
             std::string prefix;
-            const leveldb::Snapshot* snapshot;
+            const Backend::Snapshot* snapshot;
+            bool ownsSnapshot;
         };
 
-        std::string getKey(const std::string& key, const int index = -1);
+        std::string getKey(const Key& key, const int index = -1);
+
+        /**
+        * Returns whether the table stores compact keys
+        *
+        * @return true if the table was constructed with an id
+        */
+        bool isCompact() const;
     private:
         std::string tableName;
+        uint8_t id;
     };
 
 
     /**
-    * Deletes the LevelDB database in the given directory
+    * Deletes the database at the given path, whichever backend it uses
     *
-    * @param filename the directory of the database to delete
+    * @param filename the path of the database to delete
     * @return true if the database was deleted successfully, false otherwise
     */
     static bool destroy(const std::string& filename);
@@ -174,12 +643,51 @@ public:
     */
     static std::string toString(const Json::Value& json, const bool pretty = false);
 
+    /**
+    * Converts a Json::Value to its BinaryCodec representation
+    *
+    * @param json the value to encode
+    * @return the binary representation of the given value
+    */
+    static std::string toBinary(const Json::Value& json);
+
+    /**
+    * Converts a BinaryCodec encoded string to a Json::Value
+    *
+    * @param data a string produced by toBinary
+    * @return the decoded value, or a null value if data is malformed
+    */
+    static Json::Value fromBinary(const std::string& data);
+
 private:
-    leveldb::DB* db;
+    std::unique_ptr<Backend> backend;
     std::mutex readLock;
     std::mutex writeLock;
     bool sync;
-    leveldb::Options options;
+    Profile profile;
+    std::shared_ptr<Codec> codec;
+
+    class ReadCache;
+    std::unique_ptr<ReadCache> readCache;
+
+    // Incremented by every write to the database, under readLock
+    std::atomic<uint64_t> commitSeq;
+    std::atomic<uint64_t> dbReads;
+
+    class CommitQueue;
+    std::unique_ptr<CommitQueue> commitQueue;
+
+    std::atomic<bool> optimistic;
+    // Bumped when a key hashing to the stripe is committed in optimistic mode
+    std::unique_ptr<std::atomic<uint64_t>[]> versions;
+    static const size_t versionStripes = 16384;
+    size_t versionStripe(const std::string& key) const;
+
+    mutable std::mutex commitStatsMutex;
+    CommitStats commitStats;
+
+    void write(const std::vector<Backend::Write>& batch, const std::vector<std::string>& keys,
+               const uint64_t commits = 1);
 };
 }
 
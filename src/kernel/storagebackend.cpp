@@ -0,0 +1,416 @@
+/*  CryptoKernel - A library for creating blockchain based digital currency
+    Copyright (C) 2016  James Lovejoy
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <limits>
+#include <algorithm>
+
+#include <leveldb/write_batch.h>
+#include <leveldb/cache.h>
+#include <leveldb/filter_policy.h>
+
+#include "storagebackend.h"
+
+class CryptoKernel::LevelDBBackend::LevelDBSnapshot : public Storage::Backend::Snapshot {
+public:
+    LevelDBSnapshot(const leveldb::Snapshot* snapshot) {
+        this->snapshot = snapshot;
+    }
+
+    const leveldb::Snapshot* snapshot;
+};
+
+class CryptoKernel::LevelDBBackend::LevelDBIterator : public Storage::Backend::Iterator {
+public:
+    LevelDBIterator(leveldb::Iterator* it) : it(it) {}
+
+    void seek(const std::string& key) {
+        it->Seek(key);
+    }
+
+    bool valid() {
+        return it->Valid();
+    }
+
+    void next() {
+        it->Next();
+    }
+
+    std::string key() {
+        return it->key().ToString();
+    }
+
+    std::string value() {
+        return it->value().ToString();
+    }
+
+private:
+    std::unique_ptr<leveldb::Iterator> it;
+};
+
+CryptoKernel::LevelDBBackend::LevelDBBackend(const std::string& filename,
+                                             const Storage::Profile& profile) {
+    options.create_if_missing = true;
+
+    if(profile.cacheSize > 0) {
+        options.block_cache = leveldb::NewLRUCache(profile.cacheSize * 1024 * 1024);
+    }
+
+    if(profile.bloomBits > 0) {
+        options.filter_policy = leveldb::NewBloomFilterPolicy(profile.bloomBits);
+    }
+
+    options.write_buffer_size = profile.writeBufferSize;
+    options.max_open_files = profile.maxOpenFiles;
+    options.block_size = profile.blockSize;
+    options.compression = profile.compression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+
+    leveldb::Status dbstatus = leveldb::DB::Open(options, filename, &db);
+
+    if(!dbstatus.ok()) {
+        delete options.block_cache;
+        delete options.filter_policy;
+        throw std::runtime_error("Failed to open the database");
+    }
+}
+
+CryptoKernel::LevelDBBackend::~LevelDBBackend() {
+    delete db;
+    delete options.block_cache;
+    delete options.filter_policy;
+}
+
+bool CryptoKernel::LevelDBBackend::get(const std::string& key, std::string& value,
+                                       const Snapshot* snapshot) {
+    leveldb::ReadOptions readOptions;
+    if(snapshot != nullptr) {
+        readOptions.snapshot = static_cast<const LevelDBSnapshot*>(snapshot)->snapshot;
+    }
+
+    return db->Get(readOptions, key, &value).ok();
+}
+
+void CryptoKernel::LevelDBBackend::write(const std::vector<Write>& batch, const bool sync) {
+    leveldb::WriteBatch writeBatch;
+    for(const Write& write : batch) {
+        if(write.erased) {
+            writeBatch.Delete(write.key);
+        } else {
+            writeBatch.Put(write.key, write.value);
+        }
+    }
+
+    leveldb::WriteOptions writeOptions;
+    writeOptions.sync = sync;
+
+    leveldb::Status status = db->Write(writeOptions, &writeBatch);
+
+    if(!status.ok()) {
+        throw std::runtime_error("Could not commit transaction " + status.ToString());
+    }
+}
+
+const CryptoKernel::Storage::Backend::Snapshot* CryptoKernel::LevelDBBackend::getSnapshot() {
+    return new LevelDBSnapshot(db->GetSnapshot());
+}
+
+void CryptoKernel::LevelDBBackend::releaseSnapshot(const Snapshot* snapshot) {
+    const LevelDBSnapshot* levelSnapshot = static_cast<const LevelDBSnapshot*>(snapshot);
+    db->ReleaseSnapshot(levelSnapshot->snapshot);
+    delete levelSnapshot;
+}
+
+CryptoKernel::Storage::Backend::Iterator* CryptoKernel::LevelDBBackend::newIterator(
+    const Snapshot* snapshot, const bool fillCache) {
+    leveldb::ReadOptions readOptions;
+    readOptions.fill_cache = fillCache;
+    if(snapshot != nullptr) {
+        readOptions.snapshot = static_cast<const LevelDBSnapshot*>(snapshot)->snapshot;
+    }
+
+    return new LevelDBIterator(db->NewIterator(readOptions));
+}
+
+Json::Value CryptoKernel::LevelDBBackend::getProperties() {
+    Json::Value returning;
+
+    std::string value;
+    if(db->GetProperty("leveldb.stats", &value)) {
+        returning["stats"] = value;
+    }
+    if(db->GetProperty("leveldb.approximate-memory-usage", &value)) {
+        returning["approximateMemoryUsage"] = value;
+    }
+    for(unsigned int level = 0; level < 7; level++) {
+        if(db->GetProperty("leveldb.num-files-at-level" + std::to_string(level), &value)) {
+            returning["filesAtLevel"].append(value);
+        }
+    }
+
+    return returning;
+}
+
+void CryptoKernel::LevelDBBackend::destroy(const std::string& filename) {
+    leveldb::Options options;
+    leveldb::DestroyDB(filename, options);
+}
+
+// LMDB read transactions and their cursors must not be used by two threads
+// at once, but a storage snapshot can be shared between threads, so every
+// use of the transaction goes through the mutex
+class CryptoKernel::LMDBBackend::LMDBSnapshot : public Storage::Backend::Snapshot {
+public:
+    LMDBSnapshot(MDB_env* env) {
+        check(mdb_txn_begin(env, nullptr, MDB_RDONLY, &txn), "begin read transaction");
+    }
+
+    ~LMDBSnapshot() {
+        mdb_txn_abort(txn);
+    }
+
+    MDB_txn* txn;
+    std::mutex mut;
+};
+
+class CryptoKernel::LMDBBackend::LMDBIterator : public Storage::Backend::Iterator {
+public:
+    LMDBIterator(MDB_env* env, const MDB_dbi dbi, LMDBSnapshot* snapshot) {
+        ownsSnapshot = snapshot == nullptr;
+        if(ownsSnapshot) {
+            snapshot = new LMDBSnapshot(env);
+        }
+        this->snapshot = snapshot;
+        isValid = false;
+
+        std::lock_guard<std::mutex> lock(snapshot->mut);
+        check(mdb_cursor_open(snapshot->txn, dbi, &cursor), "open cursor");
+    }
+
+    ~LMDBIterator() {
+        {
+            std::lock_guard<std::mutex> lock(snapshot->mut);
+            mdb_cursor_close(cursor);
+        }
+
+        if(ownsSnapshot) {
+            delete snapshot;
+        }
+    }
+
+    void seek(const std::string& key) {
+        std::lock_guard<std::mutex> lock(snapshot->mut);
+        if(key.empty()) {
+            // LMDB rejects zero length keys so seek to the start instead
+            isValid = mdb_cursor_get(cursor, &k, &v, MDB_FIRST) == MDB_SUCCESS;
+        } else {
+            k.mv_size = key.size();
+            k.mv_data = const_cast<char*>(key.data());
+            isValid = mdb_cursor_get(cursor, &k, &v, MDB_SET_RANGE) == MDB_SUCCESS;
+        }
+    }
+
+    bool valid() {
+        return isValid;
+    }
+
+    void next() {
+        std::lock_guard<std::mutex> lock(snapshot->mut);
+        isValid = mdb_cursor_get(cursor, &k, &v, MDB_NEXT) == MDB_SUCCESS;
+    }
+
+    // k and v point into the map and stay valid for the life of the snapshot
+    std::string key() {
+        return std::string(static_cast<const char*>(k.mv_data), k.mv_size);
+    }
+
+    std::string value() {
+        return std::string(static_cast<const char*>(v.mv_data), v.mv_size);
+    }
+
+private:
+    LMDBSnapshot* snapshot;
+    bool ownsSnapshot;
+    MDB_cursor* cursor;
+    MDB_val k;
+    MDB_val v;
+    bool isValid;
+};
+
+CryptoKernel::LMDBBackend::LMDBBackend(const std::string& filename,
+                                       const Storage::Profile& profile) {
+    check(mdb_env_create(&env), "create environment");
+
+    try {
+        const uint64_t mapSize = std::min<uint64_t>(profile.mapSize,
+                                                    std::numeric_limits<size_t>::max());
+        check(mdb_env_set_mapsize(env, mapSize), "set map size");
+        // Every open read-only transaction and iterator holds a reader slot
+        check(mdb_env_set_maxreaders(env, 1024), "set max readers");
+
+        // Snapshots are handed between threads so readers can't be tied to
+        // thread local storage. Commits flush their data pages but not the
+        // meta page, which writes that must not be lost sync explicitly. A
+        // crash can roll back the last unsynced commits but, unlike
+        // MDB_NOSYNC, can't leave the file corrupt.
+        const int rc = mdb_env_open(env, filename.c_str(),
+                                    MDB_NOSUBDIR | MDB_NOTLS | MDB_NOMETASYNC | MDB_NORDAHEAD, 0644);
+        if(rc != MDB_SUCCESS) {
+            throw std::runtime_error("Failed to open the database");
+        }
+
+        // Clear reader slots left behind by processes that crashed
+        int dead;
+        mdb_reader_check(env, &dead);
+
+        MDB_txn* txn;
+        check(mdb_txn_begin(env, nullptr, 0, &txn), "begin write transaction");
+        const int dbiRc = mdb_dbi_open(txn, nullptr, 0, &dbi);
+        if(dbiRc != MDB_SUCCESS) {
+            mdb_txn_abort(txn);
+            check(dbiRc, "open database");
+        }
+        check(mdb_txn_commit(txn), "commit");
+    } catch(const std::runtime_error&) {
+        mdb_env_close(env);
+        throw;
+    }
+}
+
+CryptoKernel::LMDBBackend::~LMDBBackend() {
+    mdb_env_close(env);
+}
+
+void CryptoKernel::LMDBBackend::check(const int rc, const std::string& operation) {
+    if(rc != MDB_SUCCESS) {
+        throw std::runtime_error("LMDB failed to " + operation + ": " + mdb_strerror(rc));
+    }
+}
+
+bool CryptoKernel::LMDBBackend::get(const std::string& key, std::string& value,
+                                    const Snapshot* snapshot) {
+    if(key.empty()) {
+        return false;
+    }
+
+    MDB_val k{key.size(), const_cast<char*>(key.data())};
+    MDB_val v;
+
+    if(snapshot != nullptr) {
+        LMDBSnapshot* lmdbSnapshot = const_cast<LMDBSnapshot*>(
+                                         static_cast<const LMDBSnapshot*>(snapshot));
+        std::lock_guard<std::mutex> lock(lmdbSnapshot->mut);
+        if(mdb_get(lmdbSnapshot->txn, dbi, &k, &v) != MDB_SUCCESS) {
+            return false;
+        }
+        value.assign(static_cast<const char*>(v.mv_data), v.mv_size);
+        return true;
+    }
+
+    MDB_txn* txn;
+    check(mdb_txn_begin(env, nullptr, MDB_RDONLY, &txn), "begin read transaction");
+    const bool found = mdb_get(txn, dbi, &k, &v) == MDB_SUCCESS;
+    if(found) {
+        value.assign(static_cast<const char*>(v.mv_data), v.mv_size);
+    }
+    mdb_txn_abort(txn);
+
+    return found;
+}
+
+void CryptoKernel::LMDBBackend::write(const std::vector<Write>& batch, const bool sync) {
+    MDB_txn* txn;
+    check(mdb_txn_begin(env, nullptr, 0, &txn), "begin write transaction");
+
+    for(const Write& write : batch) {
+        MDB_val k{write.key.size(), const_cast<char*>(write.key.data())};
+        int rc;
+        if(write.erased) {
+            rc = mdb_del(txn, dbi, &k, nullptr);
+            if(rc == MDB_NOTFOUND) {
+                rc = MDB_SUCCESS;
+            }
+        } else {
+            MDB_val v{write.value.size(), const_cast<char*>(write.value.data())};
+            rc = mdb_put(txn, dbi, &k, &v, 0);
+        }
+
+        if(rc != MDB_SUCCESS) {
+            mdb_txn_abort(txn);
+            throw std::runtime_error("Could not commit transaction " + std::string(mdb_strerror(rc)));
+        }
+    }
+
+    const int rc = mdb_txn_commit(txn);
+    if(rc != MDB_SUCCESS) {
+        throw std::runtime_error("Could not commit transaction " + std::string(mdb_strerror(rc)));
+    }
+
+    if(sync) {
+        check(mdb_env_sync(env, 1), "sync");
+    }
+}
+
+const CryptoKernel::Storage::Backend::Snapshot* CryptoKernel::LMDBBackend::getSnapshot() {
+    return new LMDBSnapshot(env);
+}
+
+void CryptoKernel::LMDBBackend::releaseSnapshot(const Snapshot* snapshot) {
+    delete static_cast<const LMDBSnapshot*>(snapshot);
+}
+
+CryptoKernel::Storage::Backend::Iterator* CryptoKernel::LMDBBackend::newIterator(
+    const Snapshot* snapshot, const bool fillCache) {
+    // The page cache belongs to the kernel so there is nothing to keep scans out of
+    return new LMDBIterator(env, dbi, const_cast<LMDBSnapshot*>(
+                                          static_cast<const LMDBSnapshot*>(snapshot)));
+}
+
+Json::Value CryptoKernel::LMDBBackend::getProperties() {
+    Json::Value returning;
+
+    MDB_stat stat;
+    if(mdb_env_stat(env, &stat) == MDB_SUCCESS) {
+        returning["pageSize"] = stat.ms_psize;
+        returning["depth"] = stat.ms_depth;
+        returning["branchPages"] = Json::UInt64(stat.ms_branch_pages);
+        returning["leafPages"] = Json::UInt64(stat.ms_leaf_pages);
+        returning["overflowPages"] = Json::UInt64(stat.ms_overflow_pages);
+        returning["entries"] = Json::UInt64(stat.ms_entries);
+    }
+
+    MDB_envinfo info;
+    if(mdb_env_info(env, &info) == MDB_SUCCESS) {
+        returning["mapSize"] = Json::UInt64(info.me_mapsize);
+        returning["lastPage"] = Json::UInt64(info.me_last_pgno);
+        returning["lastTransaction"] = Json::UInt64(info.me_last_txnid);
+        returning["maxReaders"] = info.me_maxreaders;
+        returning["readers"] = info.me_numreaders;
+    }
+
+    return returning;
+}
+
+bool CryptoKernel::LMDBBackend::destroy(const std::string& filename) {
+    // A LevelDB database is a non-empty directory, which remove refuses
+    if(std::remove(filename.c_str()) != 0) {
+        return false;
+    }
+
+    std::remove((filename + "-lock").c_str());
+
+    return true;
+}
@@ -0,0 +1,118 @@
+/*  CryptoKernel - A library for creating blockchain based digital currency
+    Copyright (C) 2016  James Lovejoy
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STORAGEBACKEND_H_INCLUDED
+#define STORAGEBACKEND_H_INCLUDED
+
+#include <leveldb/db.h>
+#include <lmdb.h>
+
+#include "storage.h"
+
+namespace CryptoKernel {
+/**
+* Stores a database in a LevelDB log-structured merge tree. Suited to write
+* heavy workloads such as syncing the chain.
+*/
+class LevelDBBackend : public Storage::Backend {
+public:
+    /**
+    * Opens the LevelDB database in the given directory, creating it if it
+    * does not exist
+    *
+    * @param filename the directory of the database
+    * @param profile the LevelDB options to open the database with
+    * @throw std::runtime_error if the database could not be opened
+    */
+    LevelDBBackend(const std::string& filename, const Storage::Profile& profile);
+    ~LevelDBBackend();
+
+    bool get(const std::string& key, std::string& value, const Snapshot* snapshot = nullptr);
+    void write(const std::vector<Write>& batch, const bool sync);
+    const Snapshot* getSnapshot();
+    void releaseSnapshot(const Snapshot* snapshot);
+    Iterator* newIterator(const Snapshot* snapshot, const bool fillCache);
+
+    /**
+    * Returns leveldb.stats, the approximate memory usage and the number of
+    * files at each level
+    */
+    Json::Value getProperties();
+
+    /**
+    * Deletes the LevelDB database in the given directory
+    */
+    static void destroy(const std::string& filename);
+
+private:
+    class LevelDBSnapshot;
+    class LevelDBIterator;
+
+    leveldb::DB* db;
+    leveldb::Options options;
+};
+
+/**
+* Stores a database in a memory-mapped LMDB B+tree. Readers never block and
+* never copy pages out of the kernel's page cache, which suits read heavy
+* workloads such as serving explorer RPCs. Writes are serialized.
+*/
+class LMDBBackend : public Storage::Backend {
+public:
+    /**
+    * Opens the LMDB database at the given path, creating it if it does not
+    * exist. The database is a single file with a lock file alongside it
+    * named filename + "-lock".
+    *
+    * @param filename the path of the database file
+    * @param profile sets the size of the memory map
+    * @throw std::runtime_error if the database could not be opened
+    */
+    LMDBBackend(const std::string& filename, const Storage::Profile& profile);
+    ~LMDBBackend();
+
+    bool get(const std::string& key, std::string& value, const Snapshot* snapshot = nullptr);
+    void write(const std::vector<Write>& batch, const bool sync);
+    const Snapshot* getSnapshot();
+    void releaseSnapshot(const Snapshot* snapshot);
+    Iterator* newIterator(const Snapshot* snapshot, const bool fillCache);
+
+    /**
+    * Returns the B+tree depth, page counts, number of entries, map size and
+    * number of active readers
+    */
+    Json::Value getProperties();
+
+    /**
+    * Deletes the LMDB database at the given path
+    *
+    * @return true if there was a database file at the path, false otherwise
+    */
+    static bool destroy(const std::string& filename);
+
+private:
+    class LMDBSnapshot;
+    class LMDBIterator;
+
+    MDB_env* env;
+    MDB_dbi dbi;
+
+    static void check(const int rc, const std::string& operation);
+};
+}
+
+#endif // STORAGEBACKEND_H_INCLUDED
@@ -0,0 +1,187 @@
+/*  CryptoKernel - A library for creating blockchain based digital currency
+    Copyright (C) 2016  James Lovejoy
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+
+#include "threadpool.h"
+
+namespace {
+    // The pool and queue of the worker running on this thread, if any
+    thread_local const CryptoKernel::ThreadPool* currentPool = nullptr;
+    thread_local unsigned int currentQueue = 0;
+}
+
+CryptoKernel::ThreadPool::ThreadPool(const unsigned int threads) {
+    queued = 0;
+    nextQueue = 0;
+    stopping = false;
+
+    const unsigned int count = std::max(threads, 1u);
+    for(unsigned int i = 0; i < count; i++) {
+        queues.emplace_back(new Queue());
+    }
+
+    for(unsigned int i = 0; i < count; i++) {
+        workers.emplace_back(&ThreadPool::run, this, i);
+    }
+}
+
+CryptoKernel::ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cond.notify_all();
+
+    for(auto& worker : workers) {
+        worker.join();
+    }
+}
+
+unsigned int CryptoKernel::ThreadPool::size() const {
+    return workers.size();
+}
+
+void CryptoKernel::ThreadPool::submit(std::function<void()> task) {
+    unsigned int index;
+    {
+        // Counted before it is queued so a worker never takes an uncounted task
+        std::lock_guard<std::mutex> lock(mutex);
+        queued++;
+        if(currentPool == this) {
+            index = currentQueue;
+        } else {
+            index = nextQueue;
+            nextQueue = (nextQueue + 1) % queues.size();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+
+    cond.notify_one();
+}
+
+bool CryptoKernel::ThreadPool::take(const unsigned int index, std::function<void()>& task) {
+    bool found = false;
+    if(index < queues.size()) {
+        Queue& own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            found = true;
+        }
+    }
+
+    for(unsigned int i = 1; !found && i <= queues.size(); i++) {
+        Queue& victim = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            found = true;
+        }
+    }
+
+    if(found) {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued--;
+    }
+
+    return found;
+}
+
+void CryptoKernel::ThreadPool::run(const unsigned int index) {
+    currentPool = this;
+    currentQueue = index;
+
+    while(true) {
+        std::function<void()> task;
+        if(take(index, task)) {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]{ return stopping || queued > 0; });
+        if(stopping && queued == 0) {
+            return;
+        }
+    }
+}
+
+bool CryptoKernel::ThreadPool::parallelFor(const size_t count,
+                                           const std::function<bool(const size_t)>& task) {
+    struct Job {
+        std::atomic<bool> cancelled;
+        std::atomic<size_t> remaining;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+
+    if(count == 0) {
+        return true;
+    }
+
+    const auto job = std::make_shared<Job>();
+    job->cancelled = false;
+    job->remaining = count;
+
+    for(size_t i = 0; i < count; i++) {
+        submit([job, &task, i] {
+            if(!job->cancelled) {
+                try {
+                    if(!task(i)) {
+                        job->cancelled = true;
+                    }
+                } catch(...) {
+                    std::lock_guard<std::mutex> lock(job->mutex);
+                    if(!job->error) {
+                        job->error = std::current_exception();
+                    }
+                    job->cancelled = true;
+                }
+            }
+
+            if(--job->remaining == 0) {
+                std::lock_guard<std::mutex> lock(job->mutex);
+                job->done.notify_all();
+            }
+        });
+    }
+
+    // Work rather than wait, which also lets a worker call this without
+    // blocking the queue its own tasks went to
+    const unsigned int index = currentPool == this ? currentQueue : queues.size();
+    std::function<void()> next;
+    while(job->remaining > 0 && take(index, next)) {
+        next();
+    }
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->done.wait(lock, [&]{ return job->remaining == 0; });
+
+    if(job->error) {
+        std::rethrow_exception(job->error);
+    }
+
+    return !job->cancelled;
+}
@@ -0,0 +1,95 @@
+/*  CryptoKernel - A library for creating blockchain based digital currency
+    Copyright (C) 2016  James Lovejoy
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef THREADPOOL_H_INCLUDED
+#define THREADPOOL_H_INCLUDED
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <memory>
+
+namespace CryptoKernel {
+/**
+* A fixed set of worker threads that run tasks until the pool is destroyed.
+* Each worker has its own queue and takes work from the back of it, and
+* steals from the front of the other queues once its own is empty.
+*/
+class ThreadPool {
+public:
+    /**
+    * Starts the workers
+    *
+    * @param threads the number of workers, at least one is started
+    */
+    ThreadPool(const unsigned int threads = std::thread::hardware_concurrency());
+
+    /**
+    * Runs the tasks already queued and stops the workers
+    */
+    ~ThreadPool();
+
+    unsigned int size() const;
+
+    /**
+    * Queues a task to be run by one of the workers
+    *
+    * @param task the task to run, it must not throw
+    */
+    void submit(std::function<void()> task);
+
+    /**
+    * Calls task once for each index in [0, count) across the workers and the
+    * calling thread, returning once every call has finished. Indices that
+    * have not started are skipped once a call returns false. Safe to call
+    * from inside a task.
+    *
+    * @param count the number of indices
+    * @param task called with each index, returns false to cancel the rest
+    * @return true iff every call returned true
+    * @throw the first exception thrown by a call, the rest are cancelled
+    */
+    bool parallelFor(const size_t count, const std::function<bool(const size_t)>& task);
+
+private:
+    struct Queue {
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    // Tasks queued but not yet taken, only changed while holding mutex
+    size_t queued;
+    unsigned int nextQueue;
+    bool stopping;
+
+    void run(const unsigned int index);
+
+    // Pops from the back of the given queue, otherwise steals from the front of another
+    bool take(const unsigned int index, std::function<void()>& task);
+};
+}
+
+#endif // THREADPOOL_H_INCLUDED
@@ -0,0 +1,86 @@
+/*  CryptoKernel - A library for creating blockchain based digital currency
+    Copyright (C) 2016  James Lovejoy
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdexcept>
+
+#include "uint256.h"
+
+namespace {
+    const char hexDigits[] = "0123456789abcdef";
+
+    // The value of a hex digit of either case, or -1
+    int hexValue(const char c) {
+        if(c >= '0' && c <= '9') {
+            return c - '0';
+        } else if(c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        } else if(c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+
+        return -1;
+    }
+}
+
+CryptoKernel::uint256::uint256(const std::string& hexString) : bytes{} {
+    size_t digits = 0;
+    while(digits < hexString.size() && hexValue(hexString[digits]) >= 0) {
+        digits++;
+    }
+
+    size_t leadingZeros = 0;
+    while(leadingZeros < digits && hexString[leadingZeros] == '0') {
+        leadingZeros++;
+    }
+
+    // BigNum would keep such a value distinct from its low 256 bits
+    if(digits - leadingZeros > size() * 2) {
+        throw std::invalid_argument("Hex value is wider than 256 bits");
+    }
+
+    // Filled from the least significant digit
+    const size_t used = digits < size() * 2 ? digits : size() * 2;
+    for(size_t i = 0; i < used; i++) {
+        const int value = hexValue(hexString[digits - 1 - i]);
+        bytes[size() - 1 - i / 2] |= i % 2 == 0 ? value : value << 4;
+    }
+}
+
+std::string CryptoKernel::uint256::toString() const {
+    char buffer[size() * 2];
+    for(size_t i = 0; i < size(); i++) {
+        buffer[i * 2] = hexDigits[bytes[i] >> 4];
+        buffer[i * 2 + 1] = hexDigits[bytes[i] & 0xf];
+    }
+
+    size_t start = 0;
+    while(start < sizeof(buffer) - 1 && buffer[start] == '0') {
+        start++;
+    }
+
+    return std::string(buffer + start, sizeof(buffer) - start);
+}
+
+bool CryptoKernel::uint256::isNull() const {
+    for(const uint8_t byte : bytes) {
+        if(byte != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,112 @@
+/*  CryptoKernel - A library for creating blockchain based digital currency
+    Copyright (C) 2016  James Lovejoy
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UINT256_H_INCLUDED
+#define UINT256_H_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <functional>
+#include <ostream>
+
+namespace CryptoKernel {
+/**
+* A 256-bit unsigned integer stored inline as 32 big-endian bytes, used for
+* the ids of inputs, outputs, transactions and blocks. It orders and prints
+* exactly like a BigNum holding the same value, so either can read ids the
+* other wrote. Arithmetic is left to BigNum.
+*/
+class uint256 {
+public:
+    constexpr uint256() : bytes{} {}
+
+    /**
+    * Parses a hex string the way BigNum does, reading hex digits of either
+    * case up to the first other character
+    *
+    * @param hexString the hex to parse
+    * @throw std::invalid_argument if the value is wider than 256 bits
+    */
+    uint256(const std::string& hexString);
+
+    /**
+    * Returns the value in lowercase hex without leading zeros, "0" for zero
+    */
+    std::string toString() const;
+
+    bool isNull() const;
+
+    // The 32 big-endian bytes of the value
+    const uint8_t* data() const {
+        return bytes;
+    }
+
+    uint8_t* data() {
+        return bytes;
+    }
+
+    static constexpr size_t size() {
+        return 32;
+    }
+
+    bool operator==(const uint256& rhs) const {
+        return std::memcmp(bytes, rhs.bytes, sizeof(bytes)) == 0;
+    }
+
+    bool operator!=(const uint256& rhs) const {
+        return !(*this == rhs);
+    }
+
+    bool operator<(const uint256& rhs) const {
+        return std::memcmp(bytes, rhs.bytes, sizeof(bytes)) < 0;
+    }
+
+    bool operator>(const uint256& rhs) const {
+        return rhs < *this;
+    }
+
+    bool operator<=(const uint256& rhs) const {
+        return !(rhs < *this);
+    }
+
+    bool operator>=(const uint256& rhs) const {
+        return !(*this < rhs);
+    }
+
+private:
+    uint8_t bytes[32];
+};
+
+inline std::ostream& operator<<(std::ostream& os, const uint256& value) {
+    return os << value.toString();
+}
+}
+
+namespace std {
+template<> struct hash<CryptoKernel::uint256> {
+    size_t operator()(const CryptoKernel::uint256& value) const {
+        // Ids are hashes, so any of their bytes are already uniform
+        size_t returning;
+        std::memcpy(&returning, value.data() + CryptoKernel::uint256::size() - sizeof(returning),
+                    sizeof(returning));
+        return returning;
+    }
+};
+}
+
+#endif // UINT256_H_INCLUDED
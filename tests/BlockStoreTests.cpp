@@ -0,0 +1,96 @@
+#include "BlockStoreTests.h"
+
+#include <fstream>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(BlockStoreTest);
+
+BlockStoreTest::BlockStoreTest() {
+}
+
+BlockStoreTest::~BlockStoreTest() {
+}
+
+void BlockStoreTest::setUp() {
+    CryptoKernel::BlockStore::destroy("./testblockstore");
+}
+
+void BlockStoreTest::tearDown() {
+    CryptoKernel::BlockStore::destroy("./testblockstore");
+}
+
+void BlockStoreTest::testAppendRead() {
+    CryptoKernel::BlockStore store("./testblockstore");
+
+    const auto first = store.append("first body");
+    const auto second = store.append(std::string("second\0body", 11));
+
+    CPPUNIT_ASSERT_EQUAL(uint32_t(0), first.file);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), first.offset);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(10), second.offset);
+
+    CPPUNIT_ASSERT_EQUAL(std::string("first body"), store.read(first));
+    CPPUNIT_ASSERT_EQUAL(std::string("second\0body", 11), store.read(second));
+
+    // Part of a body, as a single transaction of a block is read
+    CPPUNIT_ASSERT_EQUAL(std::string("body"),
+                         store.read(CryptoKernel::BlockStore::Position{0, 6, 4}));
+
+    CPPUNIT_ASSERT_NO_THROW(store.sync());
+}
+
+void BlockStoreTest::testSegments() {
+    CryptoKernel::BlockStore store("./testblockstore", 16);
+
+    const auto first = store.append("0123456789");
+    const auto second = store.append("abcdef");
+    // Does not fit in what is left of the segment
+    const auto third = store.append("ghi");
+    // Larger than a segment, so it fills one on its own
+    const auto fourth = store.append(std::string(40, 'x'));
+
+    CPPUNIT_ASSERT_EQUAL(uint32_t(0), first.file);
+    CPPUNIT_ASSERT_EQUAL(uint32_t(0), second.file);
+    CPPUNIT_ASSERT_EQUAL(uint32_t(1), third.file);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), third.offset);
+    CPPUNIT_ASSERT_EQUAL(uint32_t(2), fourth.file);
+
+    CPPUNIT_ASSERT_EQUAL(std::string("0123456789"), store.read(first));
+    CPPUNIT_ASSERT_EQUAL(std::string("abcdef"), store.read(second));
+    CPPUNIT_ASSERT_EQUAL(std::string("ghi"), store.read(third));
+    CPPUNIT_ASSERT_EQUAL(std::string(40, 'x'), store.read(fourth));
+
+    const auto size = store.getSize();
+    CPPUNIT_ASSERT_EQUAL(uint32_t(3), size.first);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(59), size.second);
+
+    std::ifstream f("./testblockstore/blk00001.dat", std::ios::binary);
+    CPPUNIT_ASSERT(f.is_open());
+}
+
+void BlockStoreTest::testReopen() {
+    CryptoKernel::BlockStore::Position first;
+    {
+        CryptoKernel::BlockStore store("./testblockstore", 16);
+        store.append("0123456789");
+        first = store.append("abcdefghij");
+    }
+
+    CryptoKernel::BlockStore store("./testblockstore", 16);
+    CPPUNIT_ASSERT_EQUAL(std::string("abcdefghij"), store.read(first));
+
+    // Appends continue in the last segment
+    const auto second = store.append("klm");
+    CPPUNIT_ASSERT_EQUAL(uint32_t(1), second.file);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(10), second.offset);
+    CPPUNIT_ASSERT_EQUAL(std::string("klm"), store.read(second));
+}
+
+void BlockStoreTest::testOutOfRange() {
+    CryptoKernel::BlockStore store("./testblockstore");
+    store.append("body");
+
+    CPPUNIT_ASSERT_THROW(store.read(CryptoKernel::BlockStore::Position{0, 2, 3}),
+                         std::runtime_error);
+    CPPUNIT_ASSERT_THROW(store.read(CryptoKernel::BlockStore::Position{1, 0, 1}),
+                         std::runtime_error);
+}
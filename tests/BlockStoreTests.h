@@ -0,0 +1,31 @@
+#ifndef BLOCKSTORETEST_H
+#define BLOCKSTORETEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "blockstore.h"
+
+class BlockStoreTest : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE(BlockStoreTest);
+
+    CPPUNIT_TEST(testAppendRead);
+    CPPUNIT_TEST(testSegments);
+    CPPUNIT_TEST(testReopen);
+    CPPUNIT_TEST(testOutOfRange);
+
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    BlockStoreTest();
+    virtual ~BlockStoreTest();
+    void setUp();
+    void tearDown();
+
+private:
+    void testAppendRead();
+    void testSegments();
+    void testReopen();
+    void testOutOfRange();
+};
+
+#endif
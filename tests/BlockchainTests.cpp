@@ -28,6 +28,8 @@ void BlockchainTest::tearDown() {
     consensus.reset();
     std::remove("genesistest.json");
     CryptoKernel::Storage::destroy("./testblockdb");
+    CryptoKernel::BlockStore::destroy("./testblockdb.blocks");
+    std::remove("./testblockdb.mempool");
 }
 
 BlockchainTest::testChain::testChain(CryptoKernel::Log* GlobalLog) : CryptoKernel::Blockchain(GlobalLog, "./testblockdb") {}
@@ -936,4 +938,695 @@ void BlockchainTest::testPayToMerkleRootMalformed() {
     const auto res6 = blockchain->submitTransaction(CryptoKernel::Blockchain::transaction({CryptoKernel::Blockchain::input(p2mrout.getId(), invalidSpendData)}, {p2pkout}, 1530888581));
     CPPUNIT_ASSERT_MESSAGE("Invalid merkleProof[1] did not fail the transaction", !std::get<0>(res6));
 
-}
\ No newline at end of file
+}
+
+void BlockchainTest::testBlockReadMemoization() {
+    CryptoKernel::Crypto crypto(true);
+
+    const auto pubKey = crypto.getPublicKey();
+
+    consensus->mineBlock(true, pubKey);
+
+    const auto outs = blockchain->getUnspentOutputs(pubKey);
+    const auto& out = *outs.begin();
+
+    Json::Value outData;
+    outData["publicKey"] = pubKey;
+    CryptoKernel::Blockchain::output out2(out.getValue() - 20000, 0, outData);
+
+    const std::string outputSetId = CryptoKernel::Blockchain::transaction::getOutputSetId({out2}).toString();
+
+    Json::Value spendData;
+    spendData["signature"] = crypto.sign(out.getId().toString() + outputSetId);
+
+    CryptoKernel::Blockchain::input inp(out.getId(), spendData);
+    CryptoKernel::Blockchain::transaction tx({inp}, {out2}, 1530888581);
+
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitTransaction(tx)));
+
+    CryptoKernel::Crypto miner(true);
+    consensus->mineBlock(true, miner.getPublicKey());
+
+    const auto stats = blockchain->getBlockReadStats();
+    CPPUNIT_ASSERT(stats.reads > 0);
+    CPPUNIT_ASSERT(stats.reads >= stats.repeatedReads);
+
+    const auto outs2 = blockchain->getUnspentOutputs(pubKey);
+    CPPUNIT_ASSERT_EQUAL(size_t(1), outs2.size());
+    CPPUNIT_ASSERT_EQUAL(out2.getId(), outs2.begin()->getId());
+}
+
+void BlockchainTest::testCoinsCache() {
+    CryptoKernel::Crypto crypto(true);
+
+    const auto pubKey = crypto.getPublicKey();
+
+    consensus->mineBlock(true, pubKey);
+
+    const auto outs = blockchain->getUnspentOutputs(pubKey);
+    const auto& out = *outs.begin();
+
+    Json::Value outData;
+    outData["publicKey"] = pubKey;
+    CryptoKernel::Blockchain::output out2(out.getValue() - 20000, 0, outData);
+
+    const std::string outputSetId = CryptoKernel::Blockchain::transaction::getOutputSetId({out2}).toString();
+
+    Json::Value spendData;
+    spendData["signature"] = crypto.sign(out.getId().toString() + outputSetId);
+
+    CryptoKernel::Blockchain::input inp(out.getId(), spendData);
+    CryptoKernel::Blockchain::transaction tx({inp}, {out2}, 1530888581);
+
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitTransaction(tx)));
+
+    const Json::Value before = blockchain->getStorageInfo()["coins"];
+
+    CryptoKernel::Crypto miner(true);
+    consensus->mineBlock(true, miner.getPublicKey());
+
+    // The spent output is read for the fee when the block is built and again
+    // when it is verified, and the spend waits in the cache for a later flush
+    const Json::Value after = blockchain->getStorageInfo()["coins"];
+    CPPUNIT_ASSERT(after["hits"].asUInt64() >= before["hits"].asUInt64() + 2);
+    CPPUNIT_ASSERT_EQUAL(before["flushes"].asUInt64(), after["flushes"].asUInt64());
+    CPPUNIT_ASSERT(after["dirtyBytes"].asUInt64() > 0);
+    CPPUNIT_ASSERT(after["hitRate"].asDouble() > 0);
+
+    const auto unspent = blockchain->getUnspentOutputs(pubKey);
+    CPPUNIT_ASSERT_EQUAL(size_t(1), unspent.size());
+    CPPUNIT_ASSERT_EQUAL(out2.getId(), unspent.begin()->getId());
+    CPPUNIT_ASSERT_EQUAL(out.getValue(), blockchain->getOutput(out.getId().toString()).getValue());
+
+    // Shutting down flushes the spend to the tables
+    consensus.reset();
+    blockchain.reset();
+    setUp();
+
+    const auto spent = blockchain->getSpentOutputs(pubKey);
+    CPPUNIT_ASSERT_EQUAL(size_t(1), spent.size());
+    CPPUNIT_ASSERT_EQUAL(out.getId(), spent.begin()->getId());
+
+    CryptoKernel::Blockchain::output out3(out.getValue() - 30000, 0, outData);
+    const std::string outputSetId3 = CryptoKernel::Blockchain::transaction::getOutputSetId({out3}).toString();
+    spendData["signature"] = crypto.sign(out.getId().toString() + outputSetId3);
+    CryptoKernel::Blockchain::transaction doubleSpend({CryptoKernel::Blockchain::input(out.getId(), spendData)},
+                                                      {out3}, 1530888582);
+
+    CPPUNIT_ASSERT(!std::get<0>(blockchain->submitTransaction(doubleSpend)));
+}
+
+void BlockchainTest::testBlockVerifyStats() {
+    CryptoKernel::Crypto crypto(true);
+
+    const auto pubKey = crypto.getPublicKey();
+
+    consensus->mineBlock(true, pubKey);
+
+    const auto outs = blockchain->getUnspentOutputs(pubKey);
+    const auto& out = *outs.begin();
+
+    Json::Value outData;
+    outData["publicKey"] = pubKey;
+
+    // Each spend is valid against the chain on its own
+    std::set<CryptoKernel::Blockchain::transaction> spends;
+    for(const uint64_t fee : {20000, 30000}) {
+        CryptoKernel::Blockchain::output spendOut(out.getValue() - fee, 0, outData);
+        const std::string outputSetId = CryptoKernel::Blockchain::transaction::getOutputSetId({spendOut}).toString();
+
+        Json::Value spendData;
+        spendData["signature"] = crypto.sign(out.getId().toString() + outputSetId);
+
+        spends.insert(CryptoKernel::Blockchain::transaction({CryptoKernel::Blockchain::input(out.getId(), spendData)},
+                                                            {spendOut}, 1530888581));
+    }
+
+    CryptoKernel::Crypto miner(true);
+    const CryptoKernel::Blockchain::block verifying = blockchain->generateVerifyingBlock(miner.getPublicKey());
+
+    Json::Value consensusData;
+    consensusData["isBetter"] = true;
+
+    // Spending an output twice within a block never reaches verification
+    CPPUNIT_ASSERT_THROW(CryptoKernel::Blockchain::block(spends, verifying.getCoinbaseTx(),
+                                                         verifying.getPreviousBlockId(),
+                                                         verifying.getTimestamp(), consensusData,
+                                                         verifying.getHeight()),
+                         CryptoKernel::Blockchain::InvalidElementException);
+
+    blockchain->setVerifyThreads(2);
+
+    const CryptoKernel::Blockchain::block single({*spends.begin()}, verifying.getCoinbaseTx(),
+                                                 verifying.getPreviousBlockId(),
+                                                 verifying.getTimestamp(), consensusData,
+                                                 verifying.getHeight());
+
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitBlock(single)));
+
+    const auto stats = blockchain->getBlockVerifyStats();
+    CPPUNIT_ASSERT_EQUAL(size_t(1), stats.transactions);
+    CPPUNIT_ASSERT_EQUAL(2u, stats.threads);
+    CPPUNIT_ASSERT(stats.stateMs >= 0 && stats.rulesMs >= 0);
+
+    CPPUNIT_ASSERT_EQUAL(size_t(1), blockchain->getUnspentOutputs(pubKey).size());
+}
+
+void BlockchainTest::testSignatureCache() {
+    CryptoKernel::Crypto crypto(true);
+
+    const auto pubKey = crypto.getPublicKey();
+
+    consensus->mineBlock(true, pubKey);
+
+    const auto outs = blockchain->getUnspentOutputs(pubKey);
+    const auto& out = *outs.begin();
+
+    Json::Value outData;
+    outData["publicKey"] = pubKey;
+    CryptoKernel::Blockchain::output out2(out.getValue() - 20000, 0, outData);
+
+    const std::string outputSetId = CryptoKernel::Blockchain::transaction::getOutputSetId({out2}).toString();
+
+    Json::Value spendData;
+    spendData["signature"] = crypto.sign(out.getId().toString() + outputSetId);
+
+    CryptoKernel::Blockchain::input inp(out.getId(), spendData);
+    CryptoKernel::Blockchain::transaction tx({inp}, {out2}, 1530888581);
+
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitTransaction(tx)));
+
+    const Json::Value before = blockchain->getSignatureCacheInfo();
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), before["entries"].asUInt64());
+
+    CryptoKernel::Crypto miner(true);
+    consensus->mineBlock(true, miner.getPublicKey());
+
+    // The signature checked when the transaction entered the mempool is not
+    // checked again when its block is connected
+    const Json::Value after = blockchain->getSignatureCacheInfo();
+    CPPUNIT_ASSERT_EQUAL(before["hits"].asUInt64() + 1, after["hits"].asUInt64());
+    CPPUNIT_ASSERT_EQUAL(before["misses"].asUInt64(), after["misses"].asUInt64());
+    CPPUNIT_ASSERT(after["hitRate"].asDouble() > 0);
+
+    const auto unspent = blockchain->getUnspentOutputs(pubKey);
+    CPPUNIT_ASSERT_EQUAL(size_t(1), unspent.size());
+    CPPUNIT_ASSERT_EQUAL(out2.getId(), unspent.begin()->getId());
+}
+
+void BlockchainTest::testMempoolConflictEviction() {
+    CryptoKernel::Crypto crypto(true);
+
+    const auto pubKey = crypto.getPublicKey();
+
+    consensus->mineBlock(true, pubKey);
+    consensus->mineBlock(true, pubKey);
+
+    const auto outs = blockchain->getUnspentOutputs(pubKey);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), outs.size());
+
+    Json::Value outData;
+    outData["publicKey"] = pubKey;
+
+    auto spend = [&](const CryptoKernel::Blockchain::dbOutput& out, const uint64_t fee) {
+        CryptoKernel::Blockchain::output spendOut(out.getValue() - fee, 0, outData);
+        const std::string outputSetId = CryptoKernel::Blockchain::transaction::getOutputSetId({spendOut}).toString();
+
+        Json::Value spendData;
+        spendData["signature"] = crypto.sign(out.getId().toString() + outputSetId);
+
+        return CryptoKernel::Blockchain::transaction({CryptoKernel::Blockchain::input(out.getId(), spendData)},
+                                                     {spendOut}, 1530888581);
+    };
+
+    const auto pending = spend(*outs.begin(), 20000);
+    const auto unrelated = spend(*outs.rbegin(), 25000);
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitTransaction(pending)));
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitTransaction(unrelated)));
+    CPPUNIT_ASSERT_EQUAL(2u, blockchain->mempoolCount());
+
+    // A block that spends the first output another way, with a fee that
+    // covers the coinbase built for both mempool transactions
+    CryptoKernel::Crypto miner(true);
+    const CryptoKernel::Blockchain::block verifying = blockchain->generateVerifyingBlock(miner.getPublicKey());
+
+    Json::Value consensusData;
+    consensusData["isBetter"] = true;
+
+    const CryptoKernel::Blockchain::block conflicting({spend(*outs.begin(), 50000)},
+                                                      verifying.getCoinbaseTx(),
+                                                      verifying.getPreviousBlockId(),
+                                                      verifying.getTimestamp(), consensusData,
+                                                      verifying.getHeight());
+
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitBlock(conflicting)));
+
+    // Only the double spend is evicted
+    const auto unconfirmed = blockchain->getUnconfirmedTransactions();
+    CPPUNIT_ASSERT_EQUAL(size_t(1), unconfirmed.size());
+    CPPUNIT_ASSERT_EQUAL(unrelated.getId(), unconfirmed.begin()->getId());
+
+    CPPUNIT_ASSERT_EQUAL(0u, blockchain->rescanMempool());
+    CPPUNIT_ASSERT_EQUAL(1u, blockchain->mempoolCount());
+}
+
+void BlockchainTest::testMempoolFeeOrder() {
+    CryptoKernel::Blockchain::Mempool mempool;
+
+    // Fifty transactions of about 90KB, more than fit in one block
+    Json::Value padding;
+    padding["padding"] = std::string(90 * 1024, 'a');
+
+    std::vector<CryptoKernel::Blockchain::transaction> txs;
+    for(unsigned int i = 0; i < 50; i++) {
+        const CryptoKernel::uint256 outputId(CryptoKernel::Crypto::sha256("spent" + std::to_string(i)));
+        CryptoKernel::Blockchain::output out(1000, i, padding);
+        CryptoKernel::Blockchain::transaction tx({CryptoKernel::Blockchain::input(outputId, Json::Value())},
+                                                 {out}, 1530888581);
+        txs.push_back(tx);
+
+        CPPUNIT_ASSERT(mempool.insert(tx, (i + 1) * 100000, false));
+    }
+
+    uint64_t fees;
+    const auto selected = mempool.getTransactions(fees);
+    CPPUNIT_ASSERT(selected.size() < txs.size());
+
+    // The highest paying transactions are chosen, whatever their ids
+    uint64_t expectedFees = 0;
+    for(unsigned int i = 0; i < txs.size(); i++) {
+        const bool chosen = selected.find(txs[i]) != selected.end();
+        CPPUNIT_ASSERT_EQUAL(i >= txs.size() - selected.size(), chosen);
+        if(chosen) {
+            expectedFees += (i + 1) * 100000;
+        }
+    }
+    CPPUNIT_ASSERT_EQUAL(expectedFees, fees);
+
+    mempool.remove(txs.back());
+    CPPUNIT_ASSERT_EQUAL(49u, mempool.count());
+    CPPUNIT_ASSERT(mempool.getTransactions().count(txs.back()) == 0);
+}
+
+void BlockchainTest::testMempoolLimit() {
+    CryptoKernel::Blockchain::Mempool mempool;
+
+    Json::Value outData;
+    outData["publicKey"] = "BGOjpbmxzX26d7zHmNxy3RWb94MzTciGhF7y8ehF2EH2BlTDStCrAhSmmfmbaWDuRYqagRViAhVj6QhOsfp4oT4=";
+
+    std::vector<CryptoKernel::Blockchain::transaction> txs;
+    for(unsigned int i = 0; i < 20; i++) {
+        const CryptoKernel::uint256 outputId(CryptoKernel::Crypto::sha256("spent" + std::to_string(i)));
+        CryptoKernel::Blockchain::transaction tx({CryptoKernel::Blockchain::input(outputId, Json::Value())},
+                                                 {CryptoKernel::Blockchain::output(1000, i, outData)},
+                                                 1530888581);
+        txs.push_back(tx);
+
+        CPPUNIT_ASSERT(mempool.insert(tx, (i + 1) * 100000, false));
+    }
+
+    // The estimate counts the heap behind each entry, not just its serialized size
+    CPPUNIT_ASSERT(mempool.usage() > mempool.size());
+    CPPUNIT_ASSERT_EQUAL(0u, mempool.trim());
+    CPPUNIT_ASSERT_EQUAL(0.0, mempool.getMinFeeRate());
+
+    const uint64_t entryUsage = CryptoKernel::Blockchain::Mempool::memoryUsage(txs[0]);
+    mempool.setMaxUsage(entryUsage * 15);
+
+    CPPUNIT_ASSERT_EQUAL(5u, mempool.trim());
+    CPPUNIT_ASSERT_EQUAL(15u, mempool.count());
+    CPPUNIT_ASSERT_EQUAL(uint64_t(5), mempool.getEvictions());
+    CPPUNIT_ASSERT(mempool.usage() <= mempool.getMaxUsage());
+
+    // The cheapest transactions go first and the minimum rises above them
+    for(unsigned int i = 0; i < txs.size(); i++) {
+        CPPUNIT_ASSERT_EQUAL(i >= 5, mempool.contains(txs[i].getId()));
+    }
+
+    const double evictedRate = 500000.0 / txs[4].size();
+    CPPUNIT_ASSERT(mempool.getMinFeeRate() > evictedRate);
+    CPPUNIT_ASSERT(mempool.getMinFeeRate() < 600000.0 / txs[5].size());
+
+    for(const auto& tx : txs) {
+        mempool.remove(tx);
+    }
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), mempool.usage());
+}
+
+void BlockchainTest::testMempoolPersistence() {
+    CryptoKernel::Crypto crypto(true);
+
+    const auto pubKey = crypto.getPublicKey();
+
+    consensus->mineBlock(true, pubKey);
+    consensus->mineBlock(true, pubKey);
+
+    const auto outs = blockchain->getUnspentOutputs(pubKey);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), outs.size());
+
+    Json::Value outData;
+    outData["publicKey"] = pubKey;
+
+    auto spend = [&](const CryptoKernel::Blockchain::dbOutput& out, const uint64_t fee) {
+        CryptoKernel::Blockchain::output spendOut(out.getValue() - fee, 0, outData);
+        const std::string outputSetId = CryptoKernel::Blockchain::transaction::getOutputSetId({spendOut}).toString();
+
+        Json::Value spendData;
+        spendData["signature"] = crypto.sign(out.getId().toString() + outputSetId);
+
+        return CryptoKernel::Blockchain::transaction({CryptoKernel::Blockchain::input(out.getId(), spendData)},
+                                                     {spendOut}, 1530888581);
+    };
+
+    const auto first = spend(*outs.begin(), 20000);
+    const auto second = spend(*outs.rbegin(), 25000);
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitTransaction(first)));
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitTransaction(second)));
+
+    // Shutting down saves the mempool and loading the chain revalidates it
+    consensus.reset();
+    blockchain.reset();
+    setUp();
+
+    CPPUNIT_ASSERT_EQUAL(2u, blockchain->mempoolCount());
+    const auto unconfirmed = blockchain->getUnconfirmedTransactions();
+    CPPUNIT_ASSERT(unconfirmed.find(first) != unconfirmed.end());
+    CPPUNIT_ASSERT(unconfirmed.find(second) != unconfirmed.end());
+
+    // A snapshot whose transactions have since been mined restores nothing
+    CPPUNIT_ASSERT_EQUAL(2u, blockchain->saveMempool());
+    CPPUNIT_ASSERT_EQUAL(0, std::rename("./testblockdb.mempool", "./testblockdb.mempool.old"));
+
+    CryptoKernel::Crypto miner(true);
+    consensus->mineBlock(true, miner.getPublicKey());
+    CPPUNIT_ASSERT_EQUAL(0u, blockchain->mempoolCount());
+
+    consensus.reset();
+    blockchain.reset();
+    CPPUNIT_ASSERT_EQUAL(0, std::rename("./testblockdb.mempool.old", "./testblockdb.mempool"));
+    setUp();
+
+    CPPUNIT_ASSERT_EQUAL(0u, blockchain->mempoolCount());
+}
+
+void BlockchainTest::testReorgUndo() {
+    CryptoKernel::Crypto crypto(true);
+    CryptoKernel::Crypto miner(true);
+
+    const auto pubKey = crypto.getPublicKey();
+
+    consensus->mineBlock(true, pubKey);
+    consensus->mineBlock(true, pubKey);
+
+    const auto outs = blockchain->getUnspentOutputs(pubKey);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), outs.size());
+    const auto& out = *outs.begin();
+
+    Json::Value outData;
+    outData["publicKey"] = pubKey;
+    CryptoKernel::Blockchain::output spendOut(out.getValue() - 20000, 0, outData);
+    const std::string outputSetId = CryptoKernel::Blockchain::transaction::getOutputSetId({spendOut}).toString();
+
+    Json::Value spendData;
+    spendData["signature"] = crypto.sign(out.getId().toString() + outputSetId);
+    const CryptoKernel::Blockchain::transaction tx({CryptoKernel::Blockchain::input(out.getId(), spendData)},
+                                                   {spendOut}, 1530888581);
+
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitTransaction(tx)));
+
+    const CryptoKernel::Blockchain::dbBlock forkPoint = blockchain->getBlockDB("tip");
+    consensus->mineBlock(true, miner.getPublicKey());
+    CPPUNIT_ASSERT_EQUAL(0u, blockchain->mempoolCount());
+    CPPUNIT_ASSERT_EQUAL(size_t(1), blockchain->getSpentOutputs(pubKey).size());
+
+    // A longer fork without the spend, connected once its last block arrives
+    auto forkBlock = [&](const CryptoKernel::uint256& previousBlockId, const uint64_t height,
+                         const bool isBetter) {
+        Json::Value data;
+        data["publicKey"] = miner.getPublicKey();
+        const CryptoKernel::Blockchain::transaction coinbaseTx({},
+            {CryptoKernel::Blockchain::output(100000000, height, data)}, 1530888581 + height, true);
+
+        Json::Value consensusData;
+        consensusData["isBetter"] = isBetter;
+
+        return CryptoKernel::Blockchain::block({}, coinbaseTx, previousBlockId,
+                                               1530888581 + height, consensusData, height);
+    };
+
+    const auto first = forkBlock(forkPoint.getId(), forkPoint.getHeight() + 1, false);
+    const auto second = forkBlock(first.getId(), forkPoint.getHeight() + 2, true);
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitBlock(first)));
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitBlock(second)));
+
+    CPPUNIT_ASSERT_EQUAL(second.getId(), blockchain->getBlockDB("tip").getId());
+    CPPUNIT_ASSERT_EQUAL(forkPoint.getHeight() + 2, blockchain->getBlockDB("tip").getHeight());
+
+    // The spend was undone and went back to the mempool
+    CPPUNIT_ASSERT_EQUAL(size_t(2), blockchain->getUnspentOutputs(pubKey).size());
+    CPPUNIT_ASSERT(blockchain->getSpentOutputs(pubKey).empty());
+    CPPUNIT_ASSERT_EQUAL(out.getValue(), blockchain->getOutput(out.getId().toString()).getValue());
+    CPPUNIT_ASSERT_EQUAL(1u, blockchain->mempoolCount());
+
+    // The restored output can be spent again after a restart flushes it
+    consensus.reset();
+    blockchain.reset();
+    setUp();
+
+    CPPUNIT_ASSERT_EQUAL(size_t(2), blockchain->getUnspentOutputs(pubKey).size());
+    consensus->mineBlock(true, miner.getPublicKey());
+    CPPUNIT_ASSERT_EQUAL(size_t(1), blockchain->getSpentOutputs(pubKey).size());
+}
+
+void BlockchainTest::testFailedReorgMempool() {
+    CryptoKernel::Crypto crypto(true);
+    CryptoKernel::Crypto miner(true);
+
+    const auto pubKey = crypto.getPublicKey();
+
+    consensus->mineBlock(true, pubKey);
+    consensus->mineBlock(true, pubKey);
+
+    const auto outs = blockchain->getUnspentOutputs(pubKey);
+    const auto& out = *outs.begin();
+
+    Json::Value outData;
+    outData["publicKey"] = pubKey;
+    CryptoKernel::Blockchain::output spendOut(out.getValue() - 20000, 0, outData);
+    const std::string outputSetId = CryptoKernel::Blockchain::transaction::getOutputSetId({spendOut}).toString();
+
+    Json::Value spendData;
+    spendData["signature"] = crypto.sign(out.getId().toString() + outputSetId);
+    const CryptoKernel::Blockchain::transaction tx({CryptoKernel::Blockchain::input(out.getId(), spendData)},
+                                                   {spendOut}, 1530888581);
+
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitTransaction(tx)));
+
+    const CryptoKernel::Blockchain::dbBlock forkPoint = blockchain->getBlockDB("tip");
+    consensus->mineBlock(true, miner.getPublicKey());
+    const CryptoKernel::uint256 tipId = blockchain->getBlockDB("tip").getId();
+    CPPUNIT_ASSERT_EQUAL(0u, blockchain->mempoolCount());
+
+    // A fork whose first block spends an output that does not exist, so the
+    // reorg reverses the tip and then fails
+    Json::Value data;
+    data["publicKey"] = miner.getPublicKey();
+    Json::Value consensusData;
+    consensusData["isBetter"] = false;
+
+    const uint64_t firstHeight = forkPoint.getHeight() + 1;
+    CryptoKernel::Blockchain::output missingOut(1000, 1, outData);
+    const CryptoKernel::Blockchain::transaction invalid(
+        {CryptoKernel::Blockchain::input(missingOut.getId(), spendData)}, {spendOut}, 1530888582);
+    const CryptoKernel::Blockchain::block first({invalid},
+        CryptoKernel::Blockchain::transaction({},
+            {CryptoKernel::Blockchain::output(100000000, firstHeight, data)},
+            1530888581 + firstHeight, true),
+        forkPoint.getId(), 1530888581 + firstHeight, consensusData, firstHeight);
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitBlock(first)));
+
+    consensusData["isBetter"] = true;
+    const CryptoKernel::Blockchain::block second({},
+        CryptoKernel::Blockchain::transaction({},
+            {CryptoKernel::Blockchain::output(100000000, firstHeight + 1, data)},
+            1530888582 + firstHeight, true),
+        first.getId(), 1530888582 + firstHeight, consensusData, firstHeight + 1);
+    CPPUNIT_ASSERT(!std::get<0>(blockchain->submitBlock(second)));
+
+    // The mempool does not see the reversed block or its transaction
+    CPPUNIT_ASSERT_EQUAL(tipId, blockchain->getBlockDB("tip").getId());
+    CPPUNIT_ASSERT_EQUAL(0u, blockchain->mempoolCount());
+
+    const CryptoKernel::Blockchain::block verifying = blockchain->generateVerifyingBlock(miner.getPublicKey());
+    CPPUNIT_ASSERT_EQUAL(tipId, verifying.getPreviousBlockId());
+}
+
+void BlockchainTest::testStoredBlock() {
+    CryptoKernel::Crypto crypto(true);
+
+    const auto pubKey = crypto.getPublicKey();
+
+    consensus->mineBlock(true, pubKey);
+    consensus->mineBlock(true, pubKey);
+
+    const auto out = *blockchain->getUnspentOutputs(pubKey).begin();
+
+    Json::Value outData;
+    outData["publicKey"] = pubKey;
+    CryptoKernel::Blockchain::output spendOut(out.getValue() - 20000, 0, outData);
+    const std::string outputSetId = CryptoKernel::Blockchain::transaction::getOutputSetId({spendOut}).toString();
+
+    Json::Value spendData;
+    spendData["signature"] = crypto.sign(out.getId().toString() + outputSetId);
+    const CryptoKernel::Blockchain::transaction tx({CryptoKernel::Blockchain::input(out.getId(), spendData)},
+                                                   {spendOut}, 1530888581);
+
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitTransaction(tx)));
+    consensus->mineBlock(true, pubKey);
+
+    // Read back from blockStore with the ids they were stored under
+    const CryptoKernel::Blockchain::dbBlock tip = blockchain->getBlockDB("tip");
+    const auto Block = blockchain->getBlockByHeight(tip.getHeight());
+    CPPUNIT_ASSERT_EQUAL(tip.getId(), Block.getId());
+    CPPUNIT_ASSERT_EQUAL(size_t(1), Block.getTransactions().size());
+
+    const auto& stored = *Block.getTransactions().begin();
+    CPPUNIT_ASSERT_EQUAL(tx.getId(), stored.getId());
+    CPPUNIT_ASSERT_EQUAL(tx.getOutputSetId(), stored.getOutputSetId());
+    CPPUNIT_ASSERT_EQUAL(tx.size(), stored.size());
+    CPPUNIT_ASSERT_EQUAL(CryptoKernel::Storage::toString(tx.toJson()),
+                         CryptoKernel::Storage::toString(blockchain->getTransaction(tx.getId().toString()).toJson()));
+    CPPUNIT_ASSERT_EQUAL(Block.getCoinbaseTx().getId(),
+                         blockchain->getTransaction(tip.getCoinbaseTx().toString()).getId());
+
+    // The whole block rebuilds to the same id as the one that was mined
+    CPPUNIT_ASSERT_EQUAL(tip.getId(), CryptoKernel::Blockchain::block(Block.toJson()).getId());
+
+    // Every body was written to the block store rather than the database
+    const Json::Value info = blockchain->getStorageInfo();
+    CPPUNIT_ASSERT_EQUAL(1u, info["blockStore"]["segments"].asUInt());
+    CPPUNIT_ASSERT(info["blockStore"]["bytes"].asUInt64() > tx.size());
+}
+
+void BlockchainTest::testBlockIndex() {
+    CryptoKernel::Crypto miner(true);
+
+    consensus->mineBlock(true, miner.getPublicKey());
+    consensus->mineBlock(true, miner.getPublicKey());
+    consensus->mineBlock(true, miner.getPublicKey());
+
+    const CryptoKernel::Blockchain::dbBlock tip = blockchain->getBlockDB("tip");
+    const CryptoKernel::Blockchain::block forkPoint = blockchain->getBlockByHeight(tip.getHeight() - 2);
+
+    auto forkBlock = [&](const CryptoKernel::uint256& previousBlockId, const uint64_t height,
+                         const bool isBetter) {
+        Json::Value data;
+        data["publicKey"] = miner.getPublicKey();
+        const CryptoKernel::Blockchain::transaction coinbaseTx({},
+            {CryptoKernel::Blockchain::output(100000000, height + (isBetter ? 200 : 100), data)},
+            1530888681 + height, true);
+
+        Json::Value consensusData;
+        consensusData["isBetter"] = isBetter;
+
+        return CryptoKernel::Blockchain::block({}, coinbaseTx, previousBlockId,
+                                               1530888681 + height, consensusData, height);
+    };
+
+    // Two candidates that do not beat the tip
+    const auto first = forkBlock(forkPoint.getId(), forkPoint.getHeight() + 1, false);
+    const auto second = forkBlock(first.getId(), forkPoint.getHeight() + 2, false);
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitBlock(first)));
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitBlock(second)));
+    CPPUNIT_ASSERT_EQUAL(tip.getId(), blockchain->getBlockDB("tip").getId());
+
+    // The candidates are loaded back into the index when the chain reopens,
+    // so the fork can still be followed back to the main chain
+    consensus.reset();
+    blockchain.reset();
+    setUp();
+
+    const auto third = forkBlock(second.getId(), forkPoint.getHeight() + 3, true);
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitBlock(third)));
+    CPPUNIT_ASSERT_EQUAL(third.getId(), blockchain->getBlockDB("tip").getId());
+    CPPUNIT_ASSERT_EQUAL(forkPoint.getHeight() + 3, blockchain->getBlockDB("tip").getHeight());
+    CPPUNIT_ASSERT_EQUAL(first.getId(), blockchain->getBlockByHeight(forkPoint.getHeight() + 1).getId());
+
+    // A better block on a main chain block below the tip forks from its parent
+    const auto sibling = forkBlock(first.getId(), forkPoint.getHeight() + 2, true);
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitBlock(sibling)));
+    CPPUNIT_ASSERT_EQUAL(sibling.getId(), blockchain->getBlockDB("tip").getId());
+    CPPUNIT_ASSERT_EQUAL(forkPoint.getHeight() + 2, blockchain->getBlockDB("tip").getHeight());
+
+    // The tables agree with the index after another restart
+    consensus.reset();
+    blockchain.reset();
+    setUp();
+
+    CPPUNIT_ASSERT_EQUAL(sibling.getId(), blockchain->getBlockDB("tip").getId());
+    const uint64_t bytesBefore = blockchain->getStorageInfo()["blockStore"]["bytes"].asUInt64();
+    consensus->mineBlock(true, miner.getPublicKey());
+    CPPUNIT_ASSERT_EQUAL(forkPoint.getHeight() + 3, blockchain->getBlockDB("tip").getHeight());
+    CPPUNIT_ASSERT_EQUAL(sibling.getId(), blockchain->getBlockDB("tip").getPreviousBlockId());
+
+    // Reconnecting second and third reuses the bodies written for them, so
+    // only the new tip's body is appended
+    const uint64_t bytesMined = blockchain->getStorageInfo()["blockStore"]["bytes"].asUInt64();
+    const auto fourth = forkBlock(third.getId(), forkPoint.getHeight() + 4, true);
+    CPPUNIT_ASSERT(std::get<0>(blockchain->submitBlock(fourth)));
+    CPPUNIT_ASSERT_EQUAL(fourth.getId(), blockchain->getBlockDB("tip").getId());
+    CPPUNIT_ASSERT_EQUAL(third.getId(), blockchain->getBlock(third.getId().toString()).getId());
+
+    const uint64_t bytesAfter = blockchain->getStorageInfo()["blockStore"]["bytes"].asUInt64();
+    CPPUNIT_ASSERT(bytesAfter - bytesMined < 2 * (bytesMined - bytesBefore));
+}
+
+/**
+* Tests that chains of headers are checked against the stored chain and
+* each other without their blocks
+*/
+void BlockchainTest::testVerifyHeaders() {
+    CryptoKernel::Crypto miner(true);
+
+    consensus->mineBlock(true, miner.getPublicKey());
+    consensus->mineBlock(true, miner.getPublicKey());
+    consensus->mineBlock(true, miner.getPublicKey());
+
+    const uint64_t tipHeight = blockchain->getBlockDB("tip").getHeight();
+    std::vector<CryptoKernel::Blockchain::blockHeader> headers;
+    for(uint64_t height = tipHeight - 2; height <= tipHeight; height++) {
+        headers.push_back(CryptoKernel::Blockchain::blockHeader(
+                          blockchain->getBlockByHeight(height).toJson()));
+    }
+
+    auto result = blockchain->verifyHeaders(headers);
+    CPPUNIT_ASSERT(std::get<0>(result));
+
+    // Continuing from a header checked earlier
+    const std::vector<CryptoKernel::Blockchain::blockHeader> rest(headers.begin() + 1, headers.end());
+    result = blockchain->verifyHeaders(headers.front(), rest);
+    CPPUNIT_ASSERT(std::get<0>(result));
+
+    // A gap in the chain
+    std::vector<CryptoKernel::Blockchain::blockHeader> gap = headers;
+    gap.erase(gap.begin() + 1);
+    result = blockchain->verifyHeaders(gap);
+    CPPUNIT_ASSERT(!std::get<0>(result));
+    CPPUNIT_ASSERT(std::get<1>(result));
+
+    // A height that does not follow the previous block's
+    Json::Value wrongHeight = headers.back().toJson();
+    wrongHeight["height"] = tipHeight + 1;
+    std::vector<CryptoKernel::Blockchain::blockHeader> misnumbered(headers.begin(), headers.end() - 1);
+    misnumbered.push_back(CryptoKernel::Blockchain::blockHeader(wrongHeight));
+    result = blockchain->verifyHeaders(misnumbered);
+    CPPUNIT_ASSERT(!std::get<0>(result));
+    CPPUNIT_ASSERT(std::get<1>(result));
+
+    // Headers building on a block that is not stored cannot be judged
+    Json::Value orphan = headers.front().toJson();
+    orphan["previousBlockId"] = CryptoKernel::uint256("ff8840289b59187d16521ddde6b19de1c1b8994220a4dbb112f5978b34605b17").toString();
+    result = blockchain->verifyHeaders({CryptoKernel::Blockchain::blockHeader(orphan)});
+    CPPUNIT_ASSERT(!std::get<0>(result));
+    CPPUNIT_ASSERT(!std::get<1>(result));
+}
@@ -18,6 +18,19 @@ class BlockchainTest : public CPPUNIT_NS::TestFixture {
     CPPUNIT_TEST(testPayToMerkleRoot);
     CPPUNIT_TEST(testPayToMerkleRootScript);
     CPPUNIT_TEST(testPayToMerkleRootMalformed);
+    CPPUNIT_TEST(testBlockReadMemoization);
+    CPPUNIT_TEST(testCoinsCache);
+    CPPUNIT_TEST(testBlockVerifyStats);
+    CPPUNIT_TEST(testSignatureCache);
+    CPPUNIT_TEST(testMempoolConflictEviction);
+    CPPUNIT_TEST(testMempoolFeeOrder);
+    CPPUNIT_TEST(testMempoolLimit);
+    CPPUNIT_TEST(testMempoolPersistence);
+    CPPUNIT_TEST(testReorgUndo);
+    CPPUNIT_TEST(testFailedReorgMempool);
+    CPPUNIT_TEST(testStoredBlock);
+    CPPUNIT_TEST(testBlockIndex);
+    CPPUNIT_TEST(testVerifyHeaders);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -47,6 +60,19 @@ private:
     void testPayToMerkleRoot();
     void testPayToMerkleRootScript();
     void testPayToMerkleRootMalformed();
+    void testBlockReadMemoization();
+    void testCoinsCache();
+    void testBlockVerifyStats();
+    void testSignatureCache();
+    void testMempoolConflictEviction();
+    void testMempoolFeeOrder();
+    void testMempoolLimit();
+    void testMempoolPersistence();
+    void testReorgUndo();
+    void testFailedReorgMempool();
+    void testStoredBlock();
+    void testBlockIndex();
+    void testVerifyHeaders();
 
     
     std::unique_ptr<CryptoKernel::Blockchain> blockchain;
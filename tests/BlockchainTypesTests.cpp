@@ -30,11 +30,90 @@ void BlockchainTypesTest::testOutputId() {
  * invalid
  */
 void BlockchainTypesTest::testTransactionOutputOverflow() {
-    CryptoKernel::BigNum outputToSpend("fffa934e3065e856e16c2f4ee0ec1591f4b80e5150e7cd3c75714d5f8dba2bb3");
+    CryptoKernel::uint256 outputToSpend("fffa934e3065e856e16c2f4ee0ec1591f4b80e5150e7cd3c75714d5f8dba2bb3");
 
     CryptoKernel::Blockchain::input inp(outputToSpend, Json::nullValue);
     CryptoKernel::Blockchain::output out1(std::numeric_limits<uint64_t>::max(), 0, Json::nullValue);
     CryptoKernel::Blockchain::output out2(10, 0, Json::nullValue);
 
     CPPUNIT_ASSERT_THROW(CryptoKernel::Blockchain::transaction({inp}, {out1, out2}, 1), CryptoKernel::Blockchain::InvalidElementException);
-}
\ No newline at end of file
+}
+
+/**
+* Tests that stored outputs keep the id they were stored with and are not
+* checked again when loaded
+*/
+void BlockchainTypesTest::testStoredOutput() {
+    Json::Value data;
+    data["publicKey"] = "BMoEeFbdyC8blWvlklSJ2oKRjEJfcq08+HZkmQW1ICJpC7nebygMt5AXhXDiwHuEF4KlHuJBwNGatpKifhoqp4s=";
+
+    const CryptoKernel::uint256 creationTx("fffa934e3065e856e16c2f4ee0ec1591f4b80e5150e7cd3c75714d5f8dba2bb3");
+    const CryptoKernel::Blockchain::output out(8081988463, 4062896946, data);
+    Json::Value stored = CryptoKernel::Blockchain::dbOutput(out, creationTx).toJson();
+
+    CPPUNIT_ASSERT(CryptoKernel::Blockchain::dbOutput(stored).getId() == out.getId());
+
+    stored["data"]["publicKey"] = "not a key";
+    CPPUNIT_ASSERT_THROW(CryptoKernel::Blockchain::output loaded(stored), CryptoKernel::Blockchain::InvalidElementException);
+    CPPUNIT_ASSERT(CryptoKernel::Blockchain::dbOutput(stored).getId() == out.getId());
+
+    stored.removeMember("id");
+    CPPUNIT_ASSERT_THROW(CryptoKernel::Blockchain::dbOutput loaded(stored), CryptoKernel::Blockchain::InvalidElementException);
+}
+
+/**
+* Tests that an id wider than 256 bits is rejected rather than read as its
+* low 256 bits
+*/
+void BlockchainTypesTest::testOverlongId() {
+    const std::string outputId = "fffa934e3065e856e16c2f4ee0ec1591f4b80e5150e7cd3c75714d5f8dba2bb3";
+
+    Json::Value inputJson;
+    inputJson["outputId"] = outputId;
+    inputJson["data"] = Json::nullValue;
+    CPPUNIT_ASSERT(CryptoKernel::Blockchain::input(inputJson).getOutputId() == CryptoKernel::uint256(outputId));
+
+    inputJson["outputId"] = "1" + outputId;
+    CPPUNIT_ASSERT_THROW(CryptoKernel::Blockchain::input loaded(inputJson), CryptoKernel::Blockchain::InvalidElementException);
+}
+
+/**
+* Tests that a header parsed from block, stored block or header JSON has the
+* id of its block
+*/
+void BlockchainTypesTest::testBlockHeader() {
+    Json::Value data;
+    data["publicKey"] = "BMoEeFbdyC8blWvlklSJ2oKRjEJfcq08+HZkmQW1ICJpC7nebygMt5AXhXDiwHuEF4KlHuJBwNGatpKifhoqp4s=";
+
+    const CryptoKernel::uint256 outputToSpend("fffa934e3065e856e16c2f4ee0ec1591f4b80e5150e7cd3c75714d5f8dba2bb3");
+    const CryptoKernel::Blockchain::transaction tx({CryptoKernel::Blockchain::input(outputToSpend, Json::nullValue)},
+                                                   {CryptoKernel::Blockchain::output(100, 0, data)}, 1);
+    const CryptoKernel::Blockchain::transaction coinbaseTx({},
+                                                           {CryptoKernel::Blockchain::output(100, 1, data)}, 1, true);
+    const CryptoKernel::uint256 previousBlockId("ff8840289b59187d16521ddde6b19de1c1b8994220a4dbb112f5978b34605b17");
+
+    const CryptoKernel::Blockchain::block fullBlock({tx}, coinbaseTx, previousBlockId, 2, Json::nullValue, 5);
+    const CryptoKernel::Blockchain::block emptyBlock({}, coinbaseTx, previousBlockId, 2, Json::nullValue, 5);
+    CPPUNIT_ASSERT(fullBlock.getId() != emptyBlock.getId());
+
+    for(const CryptoKernel::Blockchain::block& Block : {fullBlock, emptyBlock}) {
+        const CryptoKernel::Blockchain::blockHeader header(Block.toJson());
+        CPPUNIT_ASSERT(header.getId() == Block.getId());
+        CPPUNIT_ASSERT(header.getCoinbaseTx() == coinbaseTx.getId());
+        CPPUNIT_ASSERT(header.getPreviousBlockId() == previousBlockId);
+        CPPUNIT_ASSERT_EQUAL(uint64_t(5), header.getHeight());
+        CPPUNIT_ASSERT(header.hasTransactions() == !Block.getTransactions().empty());
+
+        const CryptoKernel::Blockchain::dbBlock storedBlock(Block);
+        CPPUNIT_ASSERT(CryptoKernel::Blockchain::blockHeader(storedBlock.toJson()).getId() == Block.getId());
+        CPPUNIT_ASSERT(storedBlock.getHeader().getId() == Block.getId());
+        CPPUNIT_ASSERT(CryptoKernel::Blockchain::blockHeader(header.toJson()).getId() == Block.getId());
+    }
+
+    Json::Value tampered = fullBlock.getHeader().toJson();
+    tampered["timestamp"] = 3;
+    CPPUNIT_ASSERT(CryptoKernel::Blockchain::blockHeader(tampered).getId() != fullBlock.getId());
+
+    tampered["data"] = "not an object";
+    CPPUNIT_ASSERT_THROW(CryptoKernel::Blockchain::blockHeader header(tampered), CryptoKernel::Blockchain::InvalidElementException);
+}
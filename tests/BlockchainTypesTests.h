@@ -8,6 +8,9 @@ class BlockchainTypesTest : public CPPUNIT_NS::TestFixture {
 
     CPPUNIT_TEST(testOutputId);
     CPPUNIT_TEST(testTransactionOutputOverflow);
+    CPPUNIT_TEST(testStoredOutput);
+    CPPUNIT_TEST(testOverlongId);
+    CPPUNIT_TEST(testBlockHeader);
 
     CPPUNIT_TEST_SUITE_END();
 
@@ -20,6 +23,9 @@ public:
 private:
     void testOutputId();
     void testTransactionOutputOverflow();
+    void testStoredOutput();
+    void testOverlongId();
+    void testBlockHeader();
 
 };
 
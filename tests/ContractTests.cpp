@@ -39,6 +39,7 @@ void ContractTest::tearDown() {
     consensus.reset();
     std::remove("genesistest.json");
     CryptoKernel::Storage::destroy("./testblockdb");
+    CryptoKernel::BlockStore::destroy("./testblockdb.blocks");
 }
 
 void ContractTest::testSimpleFail() {
@@ -0,0 +1,69 @@
+#include "SignatureCacheTests.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(SignatureCacheTest);
+
+SignatureCacheTest::SignatureCacheTest() {
+}
+
+SignatureCacheTest::~SignatureCacheTest() {
+}
+
+void SignatureCacheTest::setUp() {
+}
+
+void SignatureCacheTest::tearDown() {
+}
+
+void SignatureCacheTest::testInsertContains() {
+    CryptoKernel::SignatureCache cache(1000);
+
+    CPPUNIT_ASSERT(!cache.contains("ecdsa", "key", "message", "signature"));
+
+    cache.insert("ecdsa", "key", "message", "signature");
+    CPPUNIT_ASSERT(cache.contains("ecdsa", "key", "message", "signature"));
+
+    // Inserting again does not add a second entry
+    cache.insert("ecdsa", "key", "message", "signature");
+
+    const auto stats = cache.getStats();
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), stats.entries);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), stats.hits);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), stats.misses);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), stats.evictions);
+}
+
+void SignatureCacheTest::testFieldsDistinct() {
+    CryptoKernel::SignatureCache cache(1000);
+
+    cache.insert("ecdsa", "key", "message", "signature");
+
+    CPPUNIT_ASSERT(!cache.contains("schnorr", "key", "message", "signature"));
+    CPPUNIT_ASSERT(!cache.contains("ecdsa", "key2", "message", "signature"));
+    CPPUNIT_ASSERT(!cache.contains("ecdsa", "key", "message2", "signature"));
+    CPPUNIT_ASSERT(!cache.contains("ecdsa", "key", "message", "signature2"));
+
+    // Moving bytes between fields gives a different entry
+    CPPUNIT_ASSERT(!cache.contains("ecdsa", "keym", "essage", "signature"));
+    CPPUNIT_ASSERT(!cache.contains("ecdsa", "key", "messages", "ignature"));
+
+    // Another cache has a different salt but the same answers
+    CryptoKernel::SignatureCache other(1000);
+    CPPUNIT_ASSERT(!other.contains("ecdsa", "key", "message", "signature"));
+    other.insert("ecdsa", "key", "message", "signature");
+    CPPUNIT_ASSERT(other.contains("ecdsa", "key", "message", "signature"));
+}
+
+void SignatureCacheTest::testEviction() {
+    CryptoKernel::SignatureCache cache(160);
+
+    for(unsigned int i = 0; i < 1000; i++) {
+        cache.insert("ecdsa", "key", "message" + std::to_string(i), "signature");
+    }
+
+    const auto stats = cache.getStats();
+    CPPUNIT_ASSERT(stats.entries <= stats.maxEntries);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1000), stats.entries + stats.evictions);
+
+    // The newest entries are kept
+    CPPUNIT_ASSERT(cache.contains("ecdsa", "key", "message999", "signature"));
+}
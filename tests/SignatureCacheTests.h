@@ -0,0 +1,29 @@
+#ifndef SIGNATURECACHETEST_H
+#define SIGNATURECACHETEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "sigcache.h"
+
+class SignatureCacheTest : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE(SignatureCacheTest);
+
+    CPPUNIT_TEST(testInsertContains);
+    CPPUNIT_TEST(testFieldsDistinct);
+    CPPUNIT_TEST(testEviction);
+
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    SignatureCacheTest();
+    virtual ~SignatureCacheTest();
+    void setUp();
+    void tearDown();
+
+private:
+    void testInsertContains();
+    void testFieldsDistinct();
+    void testEviction();
+};
+
+#endif
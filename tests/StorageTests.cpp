@@ -1,13 +1,43 @@
 #include "StorageTests.h"
 
-CPPUNIT_TEST_SUITE_REGISTRATION(StorageTest);
+#include <thread>
 
-StorageTest::StorageTest() {
-    CryptoKernel::Storage::destroy("./testdb");
+CPPUNIT_TEST_SUITE_REGISTRATION(StorageTest);
+CPPUNIT_TEST_SUITE_REGISTRATION(StorageLMDBTest);
+
+StorageTest::StorageTest(const std::string& backend) : backend(backend) {
+    CryptoKernel::Storage::destroy(dbPath("testdb"));
+    CryptoKernel::Storage::destroy(dbPath("testrecodedb"));
+    CryptoKernel::Storage::destroy(dbPath("testcachedb"));
+    CryptoKernel::Storage::destroy(dbPath("testgroupdb"));
+    CryptoKernel::Storage::destroy(dbPath("testoptimisticdb"));
+    CryptoKernel::Storage::destroy(dbPath("testprofiledb"));
 }
 
 StorageTest::~StorageTest() {
-    CryptoKernel::Storage::destroy("./testdb");
+    CryptoKernel::Storage::destroy(dbPath("testdb"));
+    CryptoKernel::Storage::destroy(dbPath("testrecodedb"));
+    CryptoKernel::Storage::destroy(dbPath("testcachedb"));
+    CryptoKernel::Storage::destroy(dbPath("testgroupdb"));
+    CryptoKernel::Storage::destroy(dbPath("testoptimisticdb"));
+    CryptoKernel::Storage::destroy(dbPath("testprofiledb"));
+}
+
+StorageLMDBTest::StorageLMDBTest() : StorageTest("lmdb") {
+}
+
+std::string StorageTest::dbPath(const std::string& name) const {
+    // Each backend gets its own databases since tests build on each other's data
+    return "./" + name + "-" + backend;
+}
+
+CryptoKernel::Storage::Profile StorageTest::getProfile(const bool sync) const {
+    CryptoKernel::Storage::Profile profile = CryptoKernel::Storage::Profile::peers();
+    profile.backend = backend;
+    profile.sync = sync;
+    profile.cacheSize = 10;
+    profile.bloomBits = 10;
+    return profile;
 }
 
 void StorageTest::setUp() {
@@ -17,7 +47,7 @@ void StorageTest::tearDown() {
 }
 
 void StorageTest::testGetNoExcept() {
-    CryptoKernel::Storage database("./testdb", false, 10, true);
+    CryptoKernel::Storage database(dbPath("testdb"), getProfile());
 
     std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(database.begin());
 
@@ -29,7 +59,7 @@ void StorageTest::testGetNoExcept() {
 }
 
 void StorageTest::testStoreGet() {
-    CryptoKernel::Storage database("./testdb", false, 10, true);
+    CryptoKernel::Storage database(dbPath("testdb"), getProfile());
 
     Json::Value dataToStore;
     dataToStore["myval"] = "this";
@@ -52,7 +82,7 @@ void StorageTest::testStoreGet() {
 }
 
 void StorageTest::testPersistence() {
-    CryptoKernel::Storage database("./testdb", false, 10, true);
+    CryptoKernel::Storage database(dbPath("testdb"), getProfile());
 
     Json::Value dataToStore;
     dataToStore["myval"] = "this";
@@ -72,7 +102,7 @@ void StorageTest::testPersistence() {
 
 
 void StorageTest::testErase() {
-    CryptoKernel::Storage database("./testdb", false, 10, true);
+    CryptoKernel::Storage database(dbPath("testdb"), getProfile());
 
     std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(database.begin());
 
@@ -110,7 +140,7 @@ void StorageTest::testToString() {
 }
 
 void StorageTest::testIterator() {
-    CryptoKernel::Storage database("./testdb", false, 10, true);
+    CryptoKernel::Storage database(dbPath("testdb"), getProfile());
 
     CryptoKernel::Storage::Table myTable("myTable");
 
@@ -147,3 +177,498 @@ void StorageTest::testIterator() {
 
     CPPUNIT_ASSERT(!it->Valid());
 }
+
+void StorageTest::testBinaryRoundTrip() {
+    Json::Value expected;
+    expected["id"] = "9f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08";
+    expected["oddHex"] = "f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08";
+    expected["publicKey"] = "BL2AcSzFw2+rGgQwJ25r7v/misIvr3t4JzkH3U1CCknchfkncSneKLBo6tjnKDhDxZUSPXEKMDtTU/YsvkwxJR8=";
+    expected["text"] = "this";
+    expected["empty"] = "";
+    expected["value"] = Json::UInt64(18446744073709551615ULL);
+    expected["negative"] = Json::Int64(-4);
+    expected["real"] = 2.5;
+    expected["flag"] = true;
+    expected["nothing"] = Json::nullValue;
+    expected["anumber"][0] = 4;
+    expected["anumber"][1] = 5;
+    expected["nested"]["emptyArray"] = Json::Value(Json::arrayValue);
+    expected["nested"]["emptyObject"] = Json::Value(Json::objectValue);
+
+    const std::string binary = CryptoKernel::Storage::toBinary(expected);
+
+    CPPUNIT_ASSERT_EQUAL(expected, CryptoKernel::Storage::fromBinary(binary));
+    CPPUNIT_ASSERT(binary.size() < CryptoKernel::Storage::toString(expected).size());
+
+    CryptoKernel::Storage::BinaryCodec binaryCodec;
+    CryptoKernel::Storage::JsonCodec jsonCodec;
+
+    // Both codecs read both formats
+    CPPUNIT_ASSERT_EQUAL(expected, jsonCodec.decode(binaryCodec.encode(expected)));
+    CPPUNIT_ASSERT_EQUAL(CryptoKernel::Storage::toJson(jsonCodec.encode(expected)),
+                         binaryCodec.decode(jsonCodec.encode(expected)));
+    CPPUNIT_ASSERT(binaryCodec.decode("").isNull());
+}
+
+void StorageTest::testBinaryMalformed() {
+    Json::Value data;
+    data["myval"] = "this";
+    data["anumber"][0] = 4;
+
+    const std::string binary = CryptoKernel::Storage::toBinary(data);
+
+    for(size_t i = 1; i < binary.size(); i++) {
+        CPPUNIT_ASSERT(CryptoKernel::Storage::fromBinary(binary.substr(0, i)).isNull());
+    }
+
+    CPPUNIT_ASSERT(CryptoKernel::Storage::fromBinary(binary + "x").isNull());
+    CPPUNIT_ASSERT(CryptoKernel::Storage::fromBinary("{\"myval\":\"this\"}").isNull());
+}
+
+void StorageTest::testRecode() {
+    Json::Value dataToStore;
+    dataToStore["myval"] = "this";
+    dataToStore["anumber"][0] = 4;
+    dataToStore["anumber"][1] = 5;
+
+    {
+        CryptoKernel::Storage database(dbPath("testrecodedb"), getProfile());
+        std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(database.begin());
+        dbTx->put("mydata", dataToStore);
+        dbTx->put("otherdata", dataToStore);
+        dbTx->commit();
+    }
+
+    CryptoKernel::Storage database(dbPath("testrecodedb"), getProfile(),
+                                   std::make_shared<CryptoKernel::Storage::BinaryCodec>());
+
+    std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(database.begin());
+    CPPUNIT_ASSERT_EQUAL(dataToStore, dbTx->get("mydata"));
+    dbTx->abort();
+
+    CPPUNIT_ASSERT_EQUAL(uint64_t(2), database.recode());
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), database.recode());
+
+    dbTx.reset(database.begin());
+    CPPUNIT_ASSERT_EQUAL(dataToStore, dbTx->get("mydata"));
+    CPPUNIT_ASSERT_EQUAL(dataToStore, dbTx->get("otherdata"));
+}
+
+void StorageTest::testReadCache() {
+    CryptoKernel::Storage database(dbPath("testcachedb"), getProfile());
+    database.setReadCache(1024 * 1024);
+
+    Json::Value dataToStore;
+    dataToStore["myval"] = "this";
+
+    std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(database.begin());
+    dbTx->put("mydata", dataToStore);
+    dbTx->commit();
+
+    dbTx.reset(database.begin());
+    CPPUNIT_ASSERT_EQUAL(dataToStore, dbTx->get("mydata"));
+    CPPUNIT_ASSERT_EQUAL(dataToStore, dbTx->get("mydata"));
+
+    auto stats = database.getReadCacheStats();
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), stats.hits);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), stats.misses);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), stats.dbReads);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), stats.entries);
+
+    // Committing a new value invalidates the cached one
+    Json::Value newData;
+    newData["myval"] = "that";
+    dbTx->put("mydata", newData);
+    dbTx->commit();
+
+    dbTx.reset(database.begin());
+    CPPUNIT_ASSERT_EQUAL(newData, dbTx->get("mydata"));
+
+    dbTx->erase("mydata");
+    dbTx->commit();
+
+    dbTx.reset(database.beginReadOnly());
+    CPPUNIT_ASSERT(dbTx->get("mydata").isNull());
+
+    stats = database.getReadCacheStats();
+    CPPUNIT_ASSERT_EQUAL(uint64_t(2), stats.invalidations);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(3), stats.dbReads);
+}
+
+void StorageTest::testReadCacheSnapshot() {
+    CryptoKernel::Storage database(dbPath("testcachedb"), getProfile());
+    database.setReadCache(1024 * 1024);
+
+    Json::Value oldData;
+    oldData["myval"] = "old";
+
+    std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(database.begin());
+    dbTx->put("snapdata", oldData);
+    dbTx->commit();
+
+    std::unique_ptr<CryptoKernel::Storage::Transaction> readTx(database.beginReadOnly());
+
+    Json::Value newData;
+    newData["myval"] = "new";
+
+    dbTx.reset(database.begin());
+    dbTx->put("snapdata", newData);
+    dbTx->commit();
+
+    // Caches the new value
+    dbTx.reset(database.begin());
+    CPPUNIT_ASSERT_EQUAL(newData, dbTx->get("snapdata"));
+    dbTx->abort();
+
+    // The older snapshot must not see it
+    CPPUNIT_ASSERT_EQUAL(oldData, readTx->get("snapdata"));
+    CPPUNIT_ASSERT_EQUAL(oldData, readTx->get("snapdata"));
+
+    std::unique_ptr<CryptoKernel::Storage::Transaction> newReadTx(database.beginReadOnly());
+    CPPUNIT_ASSERT_EQUAL(newData, newReadTx->get("snapdata"));
+}
+
+void StorageTest::testReadCacheEviction() {
+    CryptoKernel::Storage database(dbPath("testcachedb"), getProfile());
+    database.setReadCache(4096, 1);
+
+    std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(database.begin());
+    for(int i = 0; i < 100; i++) {
+        dbTx->put("evict" + std::to_string(i), Json::Value(i));
+    }
+    dbTx->commit();
+
+    dbTx.reset(database.beginReadOnly());
+    for(int i = 0; i < 100; i++) {
+        CPPUNIT_ASSERT_EQUAL(Json::Value(i), dbTx->get("evict" + std::to_string(i)));
+    }
+
+    const auto stats = database.getReadCacheStats();
+    CPPUNIT_ASSERT(stats.evictions > 0);
+    CPPUNIT_ASSERT(stats.bytes <= 4096);
+    CPPUNIT_ASSERT_EQUAL(stats.insertions - stats.evictions, stats.entries);
+}
+
+void StorageTest::testReadMemoization() {
+    CryptoKernel::Storage database(dbPath("testdb"), getProfile());
+
+    Json::Value dataToStore;
+    dataToStore["myval"] = "this";
+
+    std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(database.begin());
+    dbTx->put("memodata", dataToStore);
+    dbTx->commit();
+
+    dbTx.reset(database.begin());
+    dbTx->setReadMemoization(true);
+    CPPUNIT_ASSERT_EQUAL(dataToStore, dbTx->get("memodata"));
+    CPPUNIT_ASSERT_EQUAL(dataToStore, dbTx->get("memodata"));
+    CPPUNIT_ASSERT(dbTx->get("missing").isNull());
+    CPPUNIT_ASSERT(dbTx->get("missing").isNull());
+
+    auto stats = dbTx->getReadStats();
+    CPPUNIT_ASSERT_EQUAL(uint64_t(4), stats.reads);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(2), stats.repeatedReads);
+
+    // The transaction's own writes take precedence over memoized reads
+    Json::Value newData;
+    newData["myval"] = "that";
+    dbTx->put("memodata", newData);
+    CPPUNIT_ASSERT_EQUAL(newData, dbTx->get("memodata"));
+    dbTx->erase("memodata");
+    CPPUNIT_ASSERT(dbTx->get("memodata").isNull());
+
+    stats = dbTx->getReadStats();
+    CPPUNIT_ASSERT_EQUAL(uint64_t(4), stats.reads);
+    dbTx->abort();
+
+    dbTx.reset(database.begin());
+    CPPUNIT_ASSERT_EQUAL(dataToStore, dbTx->get("memodata"));
+    CPPUNIT_ASSERT_EQUAL(dataToStore, dbTx->get("memodata"));
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), dbTx->getReadStats().repeatedReads);
+}
+
+void StorageTest::testGroupCommit() {
+    CryptoKernel::Storage database(dbPath("testgroupdb"), getProfile(true));
+    database.setGroupCommit(true);
+
+    std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(database.begin());
+    dbTx->put("counter", Json::Value(0));
+    dbTx->commit();
+
+    // Each writer reads the counter before earlier commits may have reached
+    // the disk, so the total is only right if queued changes are visible
+    const int nThreads = 8;
+    const int nCommits = 50;
+    std::vector<std::thread> threads;
+    for(int t = 0; t < nThreads; t++) {
+        threads.push_back(std::thread([&database, t, nCommits]{
+            for(int i = 0; i < nCommits; i++) {
+                std::unique_ptr<CryptoKernel::Storage::Transaction> tx(database.begin());
+                tx->put("counter", Json::Value(tx->get("counter").asInt() + 1));
+                tx->put("thread" + std::to_string(t), Json::Value(i));
+                tx->commit();
+            }
+        }));
+    }
+
+    for(auto& thread : threads) {
+        thread.join();
+    }
+
+    dbTx.reset(database.beginReadOnly());
+    CPPUNIT_ASSERT_EQUAL(Json::Value(nThreads * nCommits), dbTx->get("counter"));
+    for(int t = 0; t < nThreads; t++) {
+        CPPUNIT_ASSERT_EQUAL(Json::Value(nCommits - 1), dbTx->get("thread" + std::to_string(t)));
+    }
+
+    const auto stats = database.getCommitStats();
+    CPPUNIT_ASSERT_EQUAL(uint64_t(nThreads * nCommits + 1), stats.commits);
+    CPPUNIT_ASSERT_EQUAL(stats.writes, stats.syncs);
+    CPPUNIT_ASSERT(stats.writes <= stats.commits);
+
+    uint64_t grouped = 0;
+    for(const auto& bucket : stats.groupSizes) {
+        grouped += bucket.second;
+    }
+    CPPUNIT_ASSERT_EQUAL(stats.writes, grouped);
+}
+
+void StorageTest::testOptimisticConflict() {
+    CryptoKernel::Storage database(dbPath("testoptimisticdb"), getProfile());
+    database.setOptimistic(true);
+
+    // Writers no longer exclude each other so both can be open at once
+    std::unique_ptr<CryptoKernel::Storage::Transaction> tx1(database.begin());
+    std::unique_ptr<CryptoKernel::Storage::Transaction> tx2(database.begin());
+
+    CPPUNIT_ASSERT(tx1->get("shared").isNull());
+    CPPUNIT_ASSERT(tx2->get("shared").isNull());
+    tx1->put("shared", Json::Value(1));
+    tx2->put("shared", Json::Value(2));
+    tx1->commit();
+    CPPUNIT_ASSERT_THROW(tx2->commit(), CryptoKernel::Storage::ConflictException);
+    CPPUNIT_ASSERT(tx2->ended());
+
+    // Reading a key is enough to conflict with a commit that writes it
+    tx1.reset(database.begin());
+    tx2.reset(database.begin());
+    tx1->put("first", tx1->get("shared"));
+    tx2->put("second", tx2->get("other"));
+    tx2->put("shared", Json::Value(3));
+    tx2->commit();
+    CPPUNIT_ASSERT_THROW(tx1->commit(), CryptoKernel::Storage::ConflictException);
+
+    // Writers touching different keys do not
+    tx1.reset(database.begin());
+    tx2.reset(database.begin());
+    tx1->put("first", tx1->get("shared"));
+    tx2->put("second", tx2->get("other"));
+    tx2->commit();
+    tx1->commit();
+
+    tx1.reset(database.beginReadOnly());
+    CPPUNIT_ASSERT_EQUAL(Json::Value(3), tx1->get("first"));
+    CPPUNIT_ASSERT_EQUAL(Json::Value(3), tx1->get("shared"));
+
+    CPPUNIT_ASSERT_EQUAL(uint64_t(2), database.getCommitStats().conflicts);
+}
+
+void StorageTest::testOptimisticRetry() {
+    for(const bool groupCommit : {false, true}) {
+        CryptoKernel::Storage::destroy(dbPath("testoptimisticdb"));
+        CryptoKernel::Storage database(dbPath("testoptimisticdb"), getProfile());
+        database.setOptimistic(true);
+        database.setGroupCommit(groupCommit);
+
+        const int nThreads = 8;
+        const int nCommits = 50;
+        std::vector<std::thread> threads;
+        for(int t = 0; t < nThreads; t++) {
+            threads.push_back(std::thread([&database, nCommits]{
+                for(int i = 0; i < nCommits; i++) {
+                    while(true) {
+                        std::unique_ptr<CryptoKernel::Storage::Transaction> tx(database.begin());
+                        tx->put("counter", Json::Value(tx->get("counter").asInt() + 1));
+                        try {
+                            tx->commit();
+                            break;
+                        } catch(const CryptoKernel::Storage::ConflictException& e) {
+                        }
+                    }
+                }
+            }));
+        }
+
+        for(auto& thread : threads) {
+            thread.join();
+        }
+
+        std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(database.beginReadOnly());
+        CPPUNIT_ASSERT_EQUAL(Json::Value(nThreads * nCommits), dbTx->get("counter"));
+
+        const auto stats = database.getCommitStats();
+        CPPUNIT_ASSERT_EQUAL(uint64_t(nThreads * nCommits), stats.commits);
+    }
+}
+
+void StorageTest::testCompactKeys() {
+    const std::string id = "3d1fbf3cc0b9fcb0d3c36e1bd8f46fb3aa4b1cd98eb2e3c3a2d6ae9a3ae2c7d";
+    const std::string paddedId = "0" + id;
+    const std::string publicKey = "BL2AcSzFw2+rGgQwJ25r7v/misIvr3t4JzkH3U1CCknchfkncSneKLBo6tjnKDhDxZUSPXEKMDtTU/YsvkwxJR8=";
+
+    // Ids are packed, anything that would not round trip stays text
+    CPPUNIT_ASSERT_EQUAL(size_t(33), CryptoKernel::Storage::Key(id).getEncoded().size());
+    CPPUNIT_ASSERT_EQUAL(size_t(paddedId.size() + 3), CryptoKernel::Storage::Key(paddedId).getEncoded().size());
+    CPPUNIT_ASSERT_EQUAL(size_t(6), CryptoKernel::Storage::Key("tip").getEncoded().size());
+
+    const std::vector<std::string> segments = {id, paddedId, publicKey, "tip", "", std::string("a\0b", 3),
+                                               std::string(64, 'f'), "1" + std::string(31, '0')};
+    for(const auto& segment : segments) {
+        const CryptoKernel::Storage::Key key(segment);
+        CPPUNIT_ASSERT_EQUAL(segment, key.getText());
+        CPPUNIT_ASSERT_EQUAL(segment, CryptoKernel::Storage::Key::decode(key.getEncoded()));
+    }
+
+    CryptoKernel::Storage::Key key(publicKey);
+    key.append(id).append(uint64_t(1234));
+    CPPUNIT_ASSERT_EQUAL(publicKey + id + "1234", key.getText());
+    CPPUNIT_ASSERT_EQUAL(publicKey + id + "1234", CryptoKernel::Storage::Key::decode(key.getEncoded()));
+
+    CPPUNIT_ASSERT_THROW(CryptoKernel::Storage::Key::decode(std::string("\x01\x02", 2)), std::runtime_error);
+    CPPUNIT_ASSERT_THROW(CryptoKernel::Storage::Key::decode("\x02text"), std::runtime_error);
+    CPPUNIT_ASSERT_THROW(CryptoKernel::Storage::Table("bad", 0x20), std::runtime_error);
+
+    // Named tables keep the old text format
+    CryptoKernel::Storage::Table named("utxos");
+    CPPUNIT_ASSERT_EQUAL("utxos/1/" + publicKey + id, named.getKey(CryptoKernel::Storage::Key(publicKey).append(id), 0));
+
+    CryptoKernel::Storage::Table compact("utxos", 4);
+    CPPUNIT_ASSERT_EQUAL(size_t(2 + 33), compact.getKey(id).size());
+}
+
+void StorageTest::testCompactIterator() {
+    CryptoKernel::Storage database(dbPath("testdb"), getProfile());
+
+    CryptoKernel::Storage::Table outputs("outputs", 1);
+    CryptoKernel::Storage::Table other("other", 2);
+
+    const std::vector<std::string> ids = {"2d1fbf3cc0b9fcb0d3c36e1bd8f46fb3aa4b1cd98eb2e3c3a2d6ae9a3ae2c7d6",
+                                          "9c5e1b1ff8e5a5ea3bd73a6b1e3cbb1b0a1f0e7e2bd4d1b5d0ce1e7d5a7b2c1"};
+
+    std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(database.begin());
+    for(const auto& id : ids) {
+        outputs.put(dbTx.get(), id, Json::Value(id));
+        outputs.put(dbTx.get(), CryptoKernel::Storage::Key("owner").append(id), Json::nullValue, 0);
+    }
+    outputs.put(dbTx.get(), CryptoKernel::Storage::Key("ownerTwo").append(ids[0]), Json::nullValue, 0);
+    other.put(dbTx.get(), ids[0], Json::Value(true));
+    dbTx->commit();
+
+    dbTx.reset(database.beginReadOnly());
+    CPPUNIT_ASSERT_EQUAL(Json::Value(ids[1]), outputs.get(dbTx.get(), ids[1]));
+
+    // A prefix of whole segments does not match longer segments. Ids come
+    // back in numeric order.
+    std::unique_ptr<CryptoKernel::Storage::Table::Iterator> it(new
+            CryptoKernel::Storage::Table::Iterator(&outputs, &database, dbTx->snapshot, "owner", 0));
+
+    const std::vector<std::string> sortedIds = {ids[1], ids[0]};
+    std::vector<std::string> found;
+    for(it->SeekToFirst(); it->Valid(); it->Next()) {
+        found.push_back(it->key());
+    }
+    CPPUNIT_ASSERT(sortedIds == found);
+
+    it.reset(new CryptoKernel::Storage::Table::Iterator(&outputs, &database, dbTx->snapshot));
+    found.clear();
+    for(it->SeekToFirst(); it->Valid(); it->Next()) {
+        found.push_back(it->key());
+        CPPUNIT_ASSERT_EQUAL(Json::Value(it->key()), it->value());
+    }
+    CPPUNIT_ASSERT(sortedIds == found);
+}
+
+void StorageTest::testIteratorSnapshot() {
+    CryptoKernel::Storage database(dbPath("testdb"), getProfile());
+
+    CryptoKernel::Storage::Table myTable("scanTable");
+
+    std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(database.begin());
+    for(int i = 0; i < 5; i++) {
+        myTable.put(dbTx.get(), std::to_string(i), Json::Value(i));
+    }
+    dbTx->commit();
+
+    std::unique_ptr<CryptoKernel::Storage::Table::Iterator> it(new
+            CryptoKernel::Storage::Table::Iterator(&myTable, &database));
+
+    // Writers are not blocked by the open iterator, which does not see them
+    dbTx.reset(database.begin());
+    myTable.put(dbTx.get(), "5", Json::Value(5));
+    myTable.erase(dbTx.get(), "0");
+    dbTx->commit();
+
+    it->SeekToFirst();
+    auto batch = it->nextBatch(3);
+    CPPUNIT_ASSERT_EQUAL(size_t(3), batch.size());
+    for(int i = 0; i < 3; i++) {
+        CPPUNIT_ASSERT_EQUAL(std::to_string(i), batch[i].first);
+        CPPUNIT_ASSERT_EQUAL(Json::Value(i), batch[i].second);
+    }
+
+    batch = it->nextBatch(3);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), batch.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("4"), batch[1].first);
+    CPPUNIT_ASSERT(!it->Valid());
+    CPPUNIT_ASSERT(it->nextBatch(3).empty());
+
+    it.reset(new CryptoKernel::Storage::Table::Iterator(&myTable, &database));
+    it->SeekToFirst();
+    CPPUNIT_ASSERT_EQUAL(std::string("1"), it->key());
+    CPPUNIT_ASSERT_EQUAL(size_t(5), it->nextBatch(10).size());
+}
+
+void StorageTest::testStorageProfile() {
+    Json::Value overrides;
+    overrides["backend"] = backend;
+    overrides["sync"] = true;
+    overrides["writeBufferSize"] = 1024 * 1024;
+    overrides["compression"] = false;
+    overrides["optimistic"] = false;
+
+    const auto defaults = CryptoKernel::Storage::Profile::chainstate();
+    const auto profile = defaults.override(overrides);
+    CPPUNIT_ASSERT_EQUAL(backend, profile.backend);
+    CPPUNIT_ASSERT(profile.sync);
+    CPPUNIT_ASSERT(!profile.compression);
+    CPPUNIT_ASSERT_EQUAL(size_t(1024 * 1024), profile.writeBufferSize);
+    CPPUNIT_ASSERT_EQUAL(defaults.cacheSize, profile.cacheSize);
+    CPPUNIT_ASSERT_EQUAL(defaults.readCacheSize, profile.readCacheSize);
+    CPPUNIT_ASSERT(!profile.optimistic);
+    CPPUNIT_ASSERT_EQUAL(defaults.groupCommit, profile.groupCommit);
+
+    // A missing section leaves the defaults alone
+    CPPUNIT_ASSERT_EQUAL(defaults.toJson(), defaults.override(Json::Value()).toJson());
+
+    overrides["cacheSize"] = "big";
+    CPPUNIT_ASSERT_THROW(defaults.override(overrides), std::runtime_error);
+
+    CryptoKernel::Storage database(dbPath("testprofiledb"), profile);
+
+    std::unique_ptr<CryptoKernel::Storage::Transaction> dbTx(database.begin());
+    Json::Value dataToStore;
+    dataToStore["myval"] = "this";
+    dbTx->put("mydata", dataToStore);
+    dbTx->commit();
+
+    const Json::Value properties = database.getProperties();
+    CPPUNIT_ASSERT_EQUAL(profile.toJson(), properties["profile"]);
+    if(backend == "leveldb") {
+        CPPUNIT_ASSERT(properties["leveldb"]["stats"].isString());
+        CPPUNIT_ASSERT_EQUAL(7u, properties["leveldb"]["filesAtLevel"].size());
+    } else {
+        CPPUNIT_ASSERT_EQUAL(Json::UInt64(1), properties["lmdb"]["entries"].asUInt64());
+    }
+    CPPUNIT_ASSERT_EQUAL(Json::UInt64(1), properties["commits"]["commits"].asUInt64());
+}
@@ -15,16 +15,35 @@ class StorageTest : public CPPUNIT_NS::TestFixture {
     CPPUNIT_TEST(testToJson);
     CPPUNIT_TEST(testToString);
     CPPUNIT_TEST(testIterator);
+    CPPUNIT_TEST(testBinaryRoundTrip);
+    CPPUNIT_TEST(testBinaryMalformed);
+    CPPUNIT_TEST(testRecode);
+    CPPUNIT_TEST(testReadCache);
+    CPPUNIT_TEST(testReadCacheSnapshot);
+    CPPUNIT_TEST(testReadCacheEviction);
+    CPPUNIT_TEST(testReadMemoization);
+    CPPUNIT_TEST(testGroupCommit);
+    CPPUNIT_TEST(testOptimisticConflict);
+    CPPUNIT_TEST(testOptimisticRetry);
+    CPPUNIT_TEST(testCompactKeys);
+    CPPUNIT_TEST(testCompactIterator);
+    CPPUNIT_TEST(testIteratorSnapshot);
+    CPPUNIT_TEST(testStorageProfile);
 
     CPPUNIT_TEST_SUITE_END();
 
 public:
-    StorageTest();
+    StorageTest(const std::string& backend = "leveldb");
     virtual ~StorageTest();
     void setUp();
     void tearDown();
 
 private:
+    std::string backend;
+
+    std::string dbPath(const std::string& name) const;
+    CryptoKernel::Storage::Profile getProfile(const bool sync = false) const;
+
     void testGetNoExcept();
     void testStoreGet();
     void testPersistence();
@@ -32,6 +51,31 @@ private:
     void testToJson();
     void testToString();
     void testIterator();
+    void testBinaryRoundTrip();
+    void testBinaryMalformed();
+    void testRecode();
+    void testReadCache();
+    void testReadCacheSnapshot();
+    void testReadCacheEviction();
+    void testReadMemoization();
+    void testGroupCommit();
+    void testOptimisticConflict();
+    void testOptimisticRetry();
+    void testCompactKeys();
+    void testCompactIterator();
+    void testIteratorSnapshot();
+    void testStorageProfile();
+};
+
+/**
+* Runs every storage test against the LMDB backend
+*/
+class StorageLMDBTest : public StorageTest {
+    CPPUNIT_TEST_SUB_SUITE(StorageLMDBTest, StorageTest);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    StorageLMDBTest();
 };
 
 #endif
@@ -0,0 +1,93 @@
+#include "ThreadPoolTests.h"
+
+#include <stdexcept>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ThreadPoolTest);
+
+ThreadPoolTest::ThreadPoolTest() {
+}
+
+ThreadPoolTest::~ThreadPoolTest() {
+}
+
+void ThreadPoolTest::setUp() {
+    pool = new CryptoKernel::ThreadPool(4);
+}
+
+void ThreadPoolTest::tearDown() {
+    delete pool;
+}
+
+void ThreadPoolTest::testParallelFor() {
+    CPPUNIT_ASSERT_EQUAL(4u, pool->size());
+
+    std::vector<std::atomic<unsigned int>> calls(1000);
+    for(auto& count : calls) {
+        count = 0;
+    }
+
+    CPPUNIT_ASSERT(pool->parallelFor(calls.size(), [&](const size_t i) {
+        calls[i]++;
+        return true;
+    }));
+
+    for(const auto& count : calls) {
+        CPPUNIT_ASSERT_EQUAL(1u, count.load());
+    }
+
+    CPPUNIT_ASSERT(pool->parallelFor(0, [](const size_t) {
+        return false;
+    }));
+}
+
+void ThreadPoolTest::testCancel() {
+    std::atomic<unsigned int> calls(0);
+    CPPUNIT_ASSERT(!pool->parallelFor(10000, [&](const size_t i) {
+        calls++;
+        return i != 0;
+    }));
+
+    // Indices not yet started when index 0 failed are skipped
+    CPPUNIT_ASSERT(calls < 10000);
+}
+
+void ThreadPoolTest::testException() {
+    CPPUNIT_ASSERT_THROW(pool->parallelFor(100, [](const size_t i) -> bool {
+        if(i == 50) {
+            throw std::runtime_error("Task failed");
+        }
+        return true;
+    }), std::runtime_error);
+
+    // The pool is still usable afterwards
+    CPPUNIT_ASSERT(pool->parallelFor(100, [](const size_t) {
+        return true;
+    }));
+}
+
+void ThreadPoolTest::testNested() {
+    std::atomic<unsigned int> calls(0);
+    CPPUNIT_ASSERT(pool->parallelFor(8, [&](const size_t) {
+        return pool->parallelFor(8, [&](const size_t) {
+            calls++;
+            return true;
+        });
+    }));
+
+    CPPUNIT_ASSERT_EQUAL(64u, calls.load());
+}
+
+void ThreadPoolTest::testSubmit() {
+    std::atomic<unsigned int> calls(0);
+    {
+        CryptoKernel::ThreadPool single(1);
+        for(unsigned int i = 0; i < 100; i++) {
+            single.submit([&] {
+                calls++;
+            });
+        }
+    }
+
+    // Destroying the pool runs what was already queued
+    CPPUNIT_ASSERT_EQUAL(100u, calls.load());
+}
@@ -0,0 +1,35 @@
+#ifndef THREADPOOLTEST_H
+#define THREADPOOLTEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "threadpool.h"
+
+class ThreadPoolTest : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE(ThreadPoolTest);
+
+    CPPUNIT_TEST(testParallelFor);
+    CPPUNIT_TEST(testCancel);
+    CPPUNIT_TEST(testException);
+    CPPUNIT_TEST(testNested);
+    CPPUNIT_TEST(testSubmit);
+
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    ThreadPoolTest();
+    virtual ~ThreadPoolTest();
+    void setUp();
+    void tearDown();
+
+private:
+    void testParallelFor();
+    void testCancel();
+    void testException();
+    void testNested();
+    void testSubmit();
+
+    CryptoKernel::ThreadPool* pool;
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "Uint256Tests.h"
+
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <type_traits>
+
+#include "ckmath.h"
+#include "crypto.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Uint256Test);
+
+Uint256Test::Uint256Test() {
+}
+
+Uint256Test::~Uint256Test() {
+}
+
+void Uint256Test::setUp() {
+}
+
+void Uint256Test::tearDown() {
+}
+
+void Uint256Test::testToString() {
+    CPPUNIT_ASSERT_EQUAL(std::string("0"), CryptoKernel::uint256().toString());
+    CPPUNIT_ASSERT(CryptoKernel::uint256().isNull());
+
+    const std::string id = "fffa934e3065e856e16c2f4ee0ec1591f4b80e5150e7cd3c75714d5f8dba2bb3";
+    CPPUNIT_ASSERT_EQUAL(id, CryptoKernel::uint256(id).toString());
+
+    // Leading zeros are dropped like BigNum drops them
+    CPPUNIT_ASSERT_EQUAL(std::string("a934e3"), CryptoKernel::uint256("000a934e3").toString());
+
+    static_assert(std::is_trivially_copyable<CryptoKernel::uint256>::value,
+                  "uint256 must be trivially copyable");
+    static_assert(sizeof(CryptoKernel::uint256) == 32, "uint256 must hold its bytes inline");
+}
+
+void Uint256Test::testParse() {
+    CPPUNIT_ASSERT_EQUAL(std::string("abcdef"), CryptoKernel::uint256("AbCdEf").toString());
+
+    // Parsing stops at the first character that is not a hex digit
+    CPPUNIT_ASSERT_EQUAL(std::string("12"), CryptoKernel::uint256("12xyz").toString());
+    CPPUNIT_ASSERT(CryptoKernel::uint256("").isNull());
+    CPPUNIT_ASSERT(CryptoKernel::uint256("xyz").isNull());
+
+    // Wider values are refused rather than cut to their low 256 bits,
+    // leading zeros do not count
+    const std::string low(64, 'e');
+    CPPUNIT_ASSERT_THROW(CryptoKernel::uint256("12" + low), std::invalid_argument);
+    CPPUNIT_ASSERT_THROW(CryptoKernel::uint256("1" + low + "xyz"), std::invalid_argument);
+    CPPUNIT_ASSERT_EQUAL(low, CryptoKernel::uint256("00" + low).toString());
+
+    const CryptoKernel::uint256 one("1");
+    CPPUNIT_ASSERT_EQUAL(uint8_t(1), one.data()[CryptoKernel::uint256::size() - 1]);
+}
+
+void Uint256Test::testCompare() {
+    const CryptoKernel::uint256 small("ff");
+    const CryptoKernel::uint256 large("100");
+
+    CPPUNIT_ASSERT(small < large);
+    CPPUNIT_ASSERT(large > small);
+    CPPUNIT_ASSERT(small <= small);
+    CPPUNIT_ASSERT(small >= small);
+    CPPUNIT_ASSERT(small != large);
+    CPPUNIT_ASSERT(small == CryptoKernel::uint256("00ff"));
+
+    CPPUNIT_ASSERT_EQUAL(std::hash<CryptoKernel::uint256>()(small),
+                         std::hash<CryptoKernel::uint256>()(CryptoKernel::uint256("0ff")));
+}
+
+void Uint256Test::testMatchesBigNum() {
+    // Sets of ids have to keep the order they had as BigNums for block ids to stay the same
+    std::mt19937 random(42);
+    std::set<CryptoKernel::uint256> ids;
+    std::set<CryptoKernel::BigNum> bigNums;
+    for(unsigned int i = 0; i < 200; i++) {
+        std::string hex = CryptoKernel::Crypto::sha256(std::to_string(i));
+        hex = hex.substr(random() % 8);
+
+        CPPUNIT_ASSERT_EQUAL(CryptoKernel::BigNum(hex).toString(), CryptoKernel::uint256(hex).toString());
+
+        ids.insert(CryptoKernel::uint256(hex));
+        bigNums.insert(CryptoKernel::BigNum(hex));
+    }
+
+    auto bigNum = bigNums.begin();
+    for(const auto& id : ids) {
+        CPPUNIT_ASSERT_EQUAL(bigNum->toString(), id.toString());
+        ++bigNum;
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef UINT256TEST_H
+#define UINT256TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "uint256.h"
+
+class Uint256Test : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE(Uint256Test);
+
+    CPPUNIT_TEST(testToString);
+    CPPUNIT_TEST(testParse);
+    CPPUNIT_TEST(testCompare);
+    CPPUNIT_TEST(testMatchesBigNum);
+
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    Uint256Test();
+    virtual ~Uint256Test();
+    void setUp();
+    void tearDown();
+
+private:
+    void testToString();
+    void testParse();
+    void testCompare();
+    void testMatchesBigNum();
+};
+
+#endif